@@ -167,4 +167,55 @@ BENCHMARK(BM_DeConvolutionk2x2s2x2g4)
 
 BENCHMARK(BM_DeConvolutionk2x2s2x2g4)
     ->Args({512, 1024, 24, 24, 1})
-    ->Unit(benchmark::kMillisecond);
\ No newline at end of file
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_ConvolutionBlockSparse(benchmark::State &state) {
+  using namespace kuiper_infer;
+
+  uint32_t kernel_count = state.range(0);
+  uint32_t channels = state.range(1);
+  uint32_t rows = state.range(2);
+  uint32_t cols = state.range(3);
+  uint32_t kernel_size = state.range(4);
+  // 剪掉的4x4块所占的百分比
+  uint32_t sparsity = state.range(5);
+
+  sftensor input = std::make_shared<ftensor>(channels, rows, cols);
+  input->RandN();
+
+  std::vector<sftensor> weights(kernel_count);
+  for (uint32_t k = 0; k < kernel_count; ++k) {
+    sftensor weight = std::make_shared<ftensor>(channels, kernel_size, kernel_size);
+    weight->RandN();
+    for (uint32_t c = 0; c < channels; ++c) {
+      if (((k / 4) * 37 + (c / 4) * 53) % 100 < sparsity) {
+        weight->slice(c).zeros();
+      }
+    }
+    weights.at(k) = weight;
+  }
+
+  std::vector<sftensor> outputs(1);
+  std::vector<sftensor> inputs;
+  inputs.push_back(input);
+  const uint32_t padding = kernel_size / 2;
+  ConvolutionLayer conv_layer(kernel_count, channels, kernel_size, kernel_size, padding,
+                              padding, 1, 1, 1, false);
+  conv_layer.set_weights(weights);
+  conv_layer.Forward(inputs, outputs);
+  for (auto _ : state) {
+    conv_layer.Forward(inputs, outputs);
+  }
+  state.counters["block_sparse"] = conv_layer.block_sparse() ? 1 : 0;
+}
+
+BENCHMARK(BM_ConvolutionBlockSparse)
+    ->Args({256, 256, 40, 40, 1, 0})
+    ->Args({256, 256, 40, 40, 1, 50})
+    ->Args({256, 256, 40, 40, 1, 75})
+    ->Args({256, 256, 40, 40, 1, 90})
+    ->Args({256, 256, 40, 40, 3, 0})
+    ->Args({256, 256, 40, 40, 3, 50})
+    ->Args({256, 256, 40, 40, 3, 75})
+    ->Args({256, 256, 40, 40, 3, 90})
+    ->Unit(benchmark::kMillisecond);
@@ -182,6 +182,34 @@ BENCHMARK(BM_Expression)->Args({32, 160, 160});
 BENCHMARK(BM_Expression)->Args({64, 80, 80});
 BENCHMARK(BM_Expression)->Args({128, 40, 40});
 
+static void BM_ExpressionChannelScale(benchmark::State& state) {
+  const int32_t channels = (int32_t)state.range(0);
+  const int32_t rows = (int32_t)state.range(1);
+  const int32_t cols = (int32_t)state.range(2);
+
+  using namespace kuiper_infer;
+  // SE模块中逐通道的缩放, 第二个输入的形状为channels x 1 x 1
+  const std::string& str = "mul(@0,@1)";
+  ExpressionLayer layer(str);
+  std::shared_ptr<Tensor<float>> input1 = std::make_shared<Tensor<float>>(channels, rows, cols);
+  input1->RandN();
+  std::shared_ptr<Tensor<float>> input2 = std::make_shared<Tensor<float>>(channels, 1, 1);
+  input2->RandN();
+
+  std::vector<std::shared_ptr<Tensor<float>>> inputs;
+  inputs.push_back(input1);
+  inputs.push_back(input2);
+
+  std::vector<std::shared_ptr<Tensor<float>>> outputs(1);
+  for (auto _ : state) {
+    layer.Forward(inputs, outputs);
+  }
+}
+
+BENCHMARK(BM_ExpressionChannelScale)->Args({32, 160, 160})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ExpressionChannelScale)->Args({64, 80, 80})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ExpressionChannelScale)->Args({128, 40, 40})->Unit(benchmark::kMillisecond);
+
 static void BM_HardSwish(benchmark::State& state) {
   using namespace kuiper_infer;
 
@@ -0,0 +1,93 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <benchmark/benchmark.h>
+#include "../source/layer/details/convolution.hpp"
+#include "runtime/runtime_ir.hpp"
+#include "utils/cpu/numa.hpp"
+
+// 数据放在节点0上, 分别从节点0(本地)和最后一个节点(远端)的线程读取
+static void BM_NumaWeightRead(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t read_node = state.range(0) == 0 ? 0 : utils::GetNumaTopology().node_count() - 1;
+  const uint32_t size = state.range(1);
+  if (utils::GetNumaTopology().node_count() <= 1) {
+    state.SetLabel("single numa node");
+  }
+
+  std::vector<float> weights(size, 1.f);
+  utils::MoveToNumaNode(weights.data(), weights.size() * sizeof(float), 0);
+  utils::BindThreadToNumaNode(read_node);
+  for (auto _ : state) {
+    float sum = 0.f;
+    for (uint32_t i = 0; i < size; ++i) {
+      sum += weights[i];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * size * sizeof(float));
+}
+
+BENCHMARK(BM_NumaWeightRead)->Args({0, 1 << 24})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_NumaWeightRead)->Args({1, 1 << 24})->Unit(benchmark::kMillisecond);
+
+// 权重在节点0上初始化, 在最后一个节点上执行卷积, 比较是否复制权重
+static void BM_NumaConvForward(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const bool replicate_weights = state.range(0) != 0;
+  const uint32_t kernel_count = state.range(1);
+  const uint32_t channels = state.range(2);
+  const uint32_t rows = state.range(3);
+  const uint32_t cols = state.range(4);
+  const uint32_t node_count = utils::GetNumaTopology().node_count();
+  if (node_count <= 1) {
+    state.SetLabel("single numa node");
+  }
+
+  sftensor input = std::make_shared<ftensor>(channels, rows, cols);
+  input->RandN();
+  std::vector<sftensor> weights(kernel_count);
+  for (uint32_t k = 0; k < kernel_count; ++k) {
+    sftensor weight = std::make_shared<ftensor>(channels, 3, 3);
+    weight->RandN();
+    weights.at(k) = weight;
+  }
+
+  std::vector<sftensor> inputs{input};
+  std::vector<sftensor> outputs(1);
+  utils::BindThreadToNumaNode(0);
+  ConvolutionLayer conv_layer(kernel_count, channels, 3, 3, 1, 1, 1, 1, 1, false);
+  conv_layer.set_weights(weights);
+  conv_layer.Forward(inputs, outputs);
+  if (replicate_weights) {
+    conv_layer.ReplicateWeights();
+  }
+
+  utils::BindThreadToNumaNode(node_count - 1);
+  for (auto _ : state) {
+    conv_layer.Forward(inputs, outputs);
+  }
+}
+
+BENCHMARK(BM_NumaConvForward)->Args({0, 256, 256, 40, 40})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_NumaConvForward)->Args({1, 256, 256, 40, 40})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_NumaConvForward)->Args({0, 512, 512, 20, 20})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_NumaConvForward)->Args({1, 512, 512, 20, 20})->Unit(benchmark::kMillisecond);
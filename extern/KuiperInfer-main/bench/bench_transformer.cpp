@@ -0,0 +1,113 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <benchmark/benchmark.h>
+#include "../source/layer/details/attention.hpp"
+#include "../source/layer/details/layer_norm.hpp"
+#include "../source/layer/details/matmul.hpp"
+#include "../source/layer/details/softmax.hpp"
+
+// ViT-B的12个头, 每个头64维
+static constexpr uint32_t kHeads = 12;
+static constexpr uint32_t kHeadDim = 64;
+
+static void BM_ScaledDotProductAttention(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t seq_len = state.range(0);
+  const bool is_causal = state.range(1) != 0;
+
+  std::vector<sftensor> inputs;
+  for (uint32_t i = 0; i < 3; ++i) {
+    sftensor input = std::make_shared<ftensor>(kHeads, seq_len, kHeadDim);
+    input->RandN();
+    inputs.push_back(input);
+  }
+  std::vector<sftensor> outputs(1);
+  ScaledDotProductAttentionLayer attention_layer(is_causal);
+  for (auto _ : state) {
+    attention_layer.Forward(inputs, outputs);
+  }
+}
+
+BENCHMARK(BM_ScaledDotProductAttention)
+    ->Args({197, 0})
+    ->Args({512, 0})
+    ->Args({1024, 0})
+    ->Args({2048, 0})
+    ->Args({2048, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// 分别执行矩阵乘法, softmax和矩阵乘法, 保存完整的注意力矩阵
+static void BM_AttentionUnfused(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t seq_len = state.range(0);
+
+  sftensor query = std::make_shared<ftensor>(kHeads, seq_len, kHeadDim);
+  sftensor key_t = std::make_shared<ftensor>(kHeads, kHeadDim, seq_len);
+  sftensor value = std::make_shared<ftensor>(kHeads, seq_len, kHeadDim);
+  query->RandN();
+  key_t->RandN();
+  value->RandN();
+
+  MatMulLayer matmul_layer;
+  SoftmaxLayer softmax_layer(-1);
+  std::vector<sftensor> scores(1);
+  std::vector<sftensor> probs(1);
+  std::vector<sftensor> outputs(1);
+  for (auto _ : state) {
+    std::vector<sftensor> score_inputs = {query, key_t};
+    matmul_layer.Forward(score_inputs, scores);
+    softmax_layer.Forward(scores, probs);
+    std::vector<sftensor> output_inputs = {probs.front(), value};
+    matmul_layer.Forward(output_inputs, outputs);
+  }
+}
+
+BENCHMARK(BM_AttentionUnfused)
+    ->Args({197})
+    ->Args({512})
+    ->Args({1024})
+    ->Args({2048})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_LayerNorm(benchmark::State& state) {
+  using namespace kuiper_infer;
+  const uint32_t seq_len = state.range(0);
+  const uint32_t features = state.range(1);
+
+  sftensor input = std::make_shared<ftensor>(seq_len, features);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs(1);
+  LayerNormLayer layer_norm({int32_t(features)}, 1e-5f, std::vector<float>(features, 1.f),
+                            std::vector<float>(features, 0.f));
+  for (auto _ : state) {
+    layer_norm.Forward(inputs, outputs);
+  }
+}
+
+BENCHMARK(BM_LayerNorm)
+    ->Args({197, 768})
+    ->Args({512, 768})
+    ->Args({1024, 768})
+    ->Args({2048, 768})
+    ->Args({2048, 1024})
+    ->Unit(benchmark::kMillisecond);
@@ -44,4 +44,38 @@ static void BM_Unet_Batch1_512x512(benchmark::State& state) {
   }
 }
 
-BENCHMARK(BM_Unet_Batch1_512x512)->Unit(benchmark::kMillisecond)->Iterations(kIterationNum);
\ No newline at end of file
+// 参数为激活的存储精度: 0为fp32, 1为fp16, 2为bf16
+static void BM_Unet_Batch1_512x512_Activation(benchmark::State& state) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph("tmp/unet/unet_demo.pnnx.param", "tmp/unet/unet_demo.pnnx.bin");
+  const ActivationPrecision precision = ActivationPrecision(state.range(0));
+  graph.set_activation_precision(precision);
+  graph.Build();
+  const uint32_t batch_size = 1;
+  std::vector<std::shared_ptr<Tensor<float>>> inputs;
+
+  for (int i = 0; i < batch_size; ++i) {
+    std::shared_ptr<Tensor<float>> input = std::make_shared<Tensor<float>>(3, 512, 512);
+    input->RandN();
+    inputs.push_back(input);
+  }
+
+  graph.set_inputs("pnnx_input_0", inputs);
+  for (auto _ : state) {
+    graph.Forward(false);
+  }
+  state.SetLabel(ActivationPrecisionName(precision));
+  state.counters["activation_mb"] = double(graph.activation_bytes()) / (1024. * 1024.);
+  // 每次Forward读写激活的字节数, 及其对应的带宽
+  const size_t traffic_bytes = graph.activation_traffic_bytes();
+  state.counters["traffic_mb"] = double(traffic_bytes) / (1024. * 1024.);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(traffic_bytes));
+}
+
+BENCHMARK(BM_Unet_Batch1_512x512)->Unit(benchmark::kMillisecond)->Iterations(kIterationNum);
+BENCHMARK(BM_Unet_Batch1_512x512_Activation)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2)
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(kIterationNum);
@@ -0,0 +1,485 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// 端到端的模型性能测试工具, 输出各分位数延迟, 吞吐量, 峰值内存和逐层耗时
+#include <glog/logging.h>
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "data/tensor_util.hpp"
+#include "runtime/runtime_ir.hpp"
+#include "utils/cpu/cpu_features.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace kuiper_infer;
+
+struct BenchInput {
+  std::string name;
+  std::vector<uint32_t> shapes;
+};
+
+struct BenchOptions {
+  std::string param_path;
+  std::string bin_path;
+  std::vector<BenchInput> inputs;
+  std::vector<uint32_t> batch_sizes = {1};
+  std::vector<uint32_t> thread_counts;
+  uint32_t warmup = 3;
+  uint32_t iterations = 20;
+  bool tiled = false;
+  bool numa = false;
+  std::string tuning_cache_path;
+  ActivationPrecision activation_precision = ActivationPrecision::kFP32;
+  std::string output_path;
+};
+
+struct LayerRecord {
+  std::string name;
+  std::string type;
+  double time_ms = 0.;
+};
+
+struct BenchResult {
+  uint32_t batch = 0;
+  uint32_t threads = 0;
+  uint32_t iterations = 0;
+  double p50_ms = 0.;
+  double p90_ms = 0.;
+  double p99_ms = 0.;
+  double mean_ms = 0.;
+  double throughput = 0.;
+  long peak_rss_kb = 0;
+  long activation_kb = 0;
+  std::vector<LayerRecord> layers;
+};
+
+static void PrintUsage() {
+  std::cerr
+      << "Usage:\n"
+      << "  kuiper_bench --param <file> --bin <file> [--input name:CxHxW]... [--batch 1,8]\n"
+      << "               [--threads 1,4] [--warmup 3] [--iterations 20] [--tiled]\n"
+      << "               [--numa] [--autotune cache_file] [--activation fp16|bf16]\n"
+      << "               [--output result.json]\n"
+      << "  kuiper_bench --compare <base.json> <new.json> [--threshold 0.05]\n"
+      << "{batch} in the model paths is replaced by the batch size. Without --input the shapes\n"
+      << "of all pnnx.Input operators in the model are used. --tiled runs chains of\n"
+      << "convolution, batchnorm, activation and pooling layers tile by tile. --numa binds\n"
+      << "the threads to the NUMA nodes and replicates the weights on every node. --autotune\n"
+      << "picks the fastest convolution algorithms and keeps them in the cache file.\n"
+      << "--activation stores the activations kept across layers in 16 bits.\n";
+}
+
+static std::vector<uint32_t> ParseList(const std::string& str, char delimiter) {
+  std::vector<uint32_t> values;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, delimiter)) {
+    CHECK(!item.empty()) << "Wrong number list: " << str;
+    const int64_t value = std::stoll(item);
+    CHECK(value > 0) << "The numbers in " << str << " should be positive";
+    values.push_back(uint32_t(value));
+  }
+  CHECK(!values.empty()) << "Empty number list";
+  return values;
+}
+
+static std::string ReplaceBatch(std::string path, uint32_t batch) {
+  const std::string placeholder = "{batch}";
+  size_t pos = path.find(placeholder);
+  while (pos != std::string::npos) {
+    path.replace(pos, placeholder.size(), std::to_string(batch));
+    pos = path.find(placeholder, pos);
+  }
+  return path;
+}
+
+static std::string JsonEscape(const std::string& str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      escaped.push_back('\\');
+      escaped.push_back(c);
+    } else if ((unsigned char)c < 0x20) {
+      escaped.push_back(' ');
+    } else {
+      escaped.push_back(c);
+    }
+  }
+  return escaped;
+}
+
+static long PeakRssKb() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return long(counters.PeakWorkingSetSize / 1024);
+  }
+  return 0;
+#else
+  struct rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return long(usage.ru_maxrss / 1024);
+#else
+  return long(usage.ru_maxrss);
+#endif
+#endif
+}
+
+// 按最近秩取分位数, latencies已经排序
+static double Percentile(const std::vector<double>& latencies, double p) {
+  CHECK(!latencies.empty());
+  const size_t rank = (size_t)std::ceil(p * (double)latencies.size());
+  return latencies.at(std::min(latencies.size(), std::max<size_t>(rank, 1)) - 1);
+}
+
+static void SetGraphInputs(RuntimeGraph& graph, const std::vector<BenchInput>& bench_inputs,
+                           uint32_t batch) {
+  std::vector<BenchInput> inputs = bench_inputs;
+  if (inputs.empty()) {
+    for (const auto& op : graph.operators()) {
+      if (op->type != "pnnx.Input") {
+        continue;
+      }
+      CHECK(op->output_operands != nullptr) << "The input " << op->name << " has no shape";
+      const std::vector<int32_t>& operand_shapes = op->output_operands->shapes;
+      CHECK(operand_shapes.size() >= 2) << "The input " << op->name << " has no shape";
+      BenchInput input;
+      input.name = op->name;
+      // 第一维是批次大小
+      for (size_t i = 1; i < operand_shapes.size(); ++i) {
+        input.shapes.push_back(uint32_t(operand_shapes.at(i)));
+      }
+      inputs.push_back(input);
+    }
+  }
+  CHECK(!inputs.empty()) << "The model has no input";
+
+  for (const BenchInput& input : inputs) {
+    std::vector<sftensor> tensors;
+    for (uint32_t b = 0; b < batch; ++b) {
+      sftensor tensor = TensorCreate<float>(input.shapes);
+      tensor->RandN();
+      tensors.push_back(tensor);
+    }
+    graph.set_inputs(input.name, tensors);
+  }
+}
+
+static BenchResult RunBench(RuntimeGraph& graph, const BenchOptions& options, uint32_t batch,
+                            uint32_t threads) {
+  omp_set_num_threads(int(threads));
+  for (uint32_t i = 0; i < options.warmup; ++i) {
+    graph.Forward(false);
+  }
+
+  std::vector<double> latencies;
+  latencies.reserve(options.iterations);
+  for (uint32_t i = 0; i < options.iterations; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    graph.Forward(false);
+    const auto end = std::chrono::steady_clock::now();
+    latencies.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  // 逐层耗时单独统计, 不影响上面的延迟
+  graph.set_profile(true);
+  graph.ResetProfile();
+  for (uint32_t i = 0; i < options.iterations; ++i) {
+    graph.Forward(false);
+  }
+  graph.set_profile(false);
+
+  BenchResult result;
+  result.batch = batch;
+  result.threads = threads;
+  result.iterations = options.iterations;
+  double total = 0.;
+  for (double latency : latencies) {
+    total += latency;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  result.p50_ms = Percentile(latencies, 0.5);
+  result.p90_ms = Percentile(latencies, 0.9);
+  result.p99_ms = Percentile(latencies, 0.99);
+  result.mean_ms = total / (double)latencies.size();
+  result.throughput = result.mean_ms > 0. ? (double)batch * 1000. / result.mean_ms : 0.;
+  result.peak_rss_kb = PeakRssKb();
+  result.activation_kb = long(graph.activation_bytes() / 1024);
+
+  const auto& operators = graph.operators();
+  const std::vector<double>& profile_times = graph.profile_times();
+  for (size_t i = 0; i < operators.size() && i < profile_times.size(); ++i) {
+    const auto& op = operators.at(i);
+    if (op->type == "pnnx.Input" || op->type == "pnnx.Output") {
+      continue;
+    }
+    LayerRecord layer;
+    layer.name = op->name;
+    layer.type = op->type;
+    layer.time_ms = profile_times.at(i) / 1000. / (double)options.iterations;
+    result.layers.push_back(layer);
+  }
+  return result;
+}
+
+// 每个结果的统计值写在一行中, 比较模式按行读取
+static void WriteResults(std::ostream& os, const BenchOptions& options,
+                         const std::vector<BenchResult>& results) {
+  const utils::CpuFeatures& features = utils::GetCpuFeatures();
+  os << "{\n";
+  os << "  \"model\": \"" << JsonEscape(options.param_path) << "\",\n";
+  os << "  \"cpu\": \"" << JsonEscape(features.brand) << "\",\n";
+  os << "  \"isa\": \"" << utils::CpuIsaName(utils::GetCpuIsa()) << "\",\n";
+  os << "  \"tiled\": " << (options.tiled ? "true" : "false") << ",\n";
+  os << "  \"numa\": " << (options.numa ? "true" : "false") << ",\n";
+  os << "  \"autotune\": " << (options.tuning_cache_path.empty() ? "false" : "true") << ",\n";
+  os << "  \"activation\": \"" << ActivationPrecisionName(options.activation_precision)
+     << "\",\n";
+  os << "  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchResult& result = results.at(i);
+    os << "    {\"batch\": " << result.batch << ", \"threads\": " << result.threads
+       << ", \"iterations\": " << result.iterations << ", \"p50_ms\": " << result.p50_ms
+       << ", \"p90_ms\": " << result.p90_ms << ", \"p99_ms\": " << result.p99_ms
+       << ", \"mean_ms\": " << result.mean_ms << ", \"throughput\": " << result.throughput
+       << ", \"peak_rss_kb\": " << result.peak_rss_kb
+       << ", \"activation_kb\": " << result.activation_kb << ",\n";
+    os << "     \"layers\": [\n";
+    for (size_t j = 0; j < result.layers.size(); ++j) {
+      const LayerRecord& layer = result.layers.at(j);
+      os << "       {\"name\": \"" << JsonEscape(layer.name) << "\", \"type\": \""
+         << JsonEscape(layer.type) << "\", \"time_ms\": " << layer.time_ms << "}"
+         << (j + 1 < result.layers.size() ? "," : "") << "\n";
+    }
+    os << "     ]}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n";
+  os << "}\n";
+}
+
+static bool ReadJsonNumber(const std::string& line, const std::string& key, double& value) {
+  const std::string pattern = "\"" + key + "\": ";
+  const size_t pos = line.find(pattern);
+  if (pos == std::string::npos) {
+    return false;
+  }
+  value = std::strtod(line.c_str() + pos + pattern.size(), nullptr);
+  return true;
+}
+
+static std::vector<BenchResult> ReadResults(const std::string& path) {
+  std::ifstream file(path);
+  CHECK(file.is_open()) << "Can not open the result file: " << path;
+  std::vector<BenchResult> results;
+  std::string line;
+  while (std::getline(file, line)) {
+    double batch = 0.;
+    double threads = 0.;
+    if (!ReadJsonNumber(line, "batch", batch) || !ReadJsonNumber(line, "threads", threads)) {
+      continue;
+    }
+    BenchResult result;
+    double value = 0.;
+    result.batch = uint32_t(batch);
+    result.threads = uint32_t(threads);
+    if (ReadJsonNumber(line, "iterations", value)) result.iterations = uint32_t(value);
+    ReadJsonNumber(line, "p50_ms", result.p50_ms);
+    ReadJsonNumber(line, "p90_ms", result.p90_ms);
+    ReadJsonNumber(line, "p99_ms", result.p99_ms);
+    ReadJsonNumber(line, "mean_ms", result.mean_ms);
+    ReadJsonNumber(line, "throughput", result.throughput);
+    if (ReadJsonNumber(line, "peak_rss_kb", value)) result.peak_rss_kb = long(value);
+    if (ReadJsonNumber(line, "activation_kb", value)) result.activation_kb = long(value);
+    results.push_back(result);
+  }
+  return results;
+}
+
+// 新结果的p50/p90延迟或吞吐量比基准差threshold以上时认为性能退化, 返回退化的数量
+static int CompareResults(const std::string& base_path, const std::string& new_path,
+                          double threshold) {
+  const std::vector<BenchResult> base_results = ReadResults(base_path);
+  const std::vector<BenchResult> new_results = ReadResults(new_path);
+  CHECK(!base_results.empty()) << "No result in " << base_path;
+
+  std::map<std::pair<uint32_t, uint32_t>, BenchResult> new_map;
+  for (const BenchResult& result : new_results) {
+    new_map[{result.batch, result.threads}] = result;
+  }
+
+  int regressions = 0;
+  std::printf("%6s %8s %12s %12s %9s %12s %12s %9s  %s\n", "batch", "threads", "base_p50",
+              "new_p50", "p50", "base_p90", "new_p90", "p90", "status");
+  for (const BenchResult& base : base_results) {
+    const auto iter = new_map.find({base.batch, base.threads});
+    if (iter == new_map.end()) {
+      std::printf("%6u %8u %63s  MISSING\n", base.batch, base.threads, "");
+      regressions += 1;
+      continue;
+    }
+    const BenchResult& current = iter->second;
+    const double p50_change = base.p50_ms > 0. ? current.p50_ms / base.p50_ms - 1. : 0.;
+    const double p90_change = base.p90_ms > 0. ? current.p90_ms / base.p90_ms - 1. : 0.;
+    const double throughput_change =
+        base.throughput > 0. ? current.throughput / base.throughput - 1. : 0.;
+    const bool regression =
+        p50_change > threshold || p90_change > threshold || throughput_change < -threshold;
+    if (regression) {
+      regressions += 1;
+    }
+    std::printf("%6u %8u %12.3f %12.3f %+8.1f%% %12.3f %12.3f %+8.1f%%  %s\n", base.batch,
+                base.threads, base.p50_ms, current.p50_ms, p50_change * 100., base.p90_ms,
+                current.p90_ms, p90_change * 100., regression ? "REGRESSION" : "ok");
+  }
+  return regressions;
+}
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = true;
+
+  BenchOptions options;
+  std::string compare_base;
+  std::string compare_new;
+  double threshold = 0.05;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    auto next_value = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        PrintUsage();
+        LOG(FATAL) << "Missing value of the option " << arg;
+      }
+      return argv[++i];
+    };
+    if (arg == "--param") {
+      options.param_path = next_value();
+    } else if (arg == "--bin") {
+      options.bin_path = next_value();
+    } else if (arg == "--input") {
+      // name:CxHxW
+      const std::string value = next_value();
+      const size_t colon = value.rfind(':');
+      CHECK(colon != std::string::npos && colon > 0) << "Wrong input: " << value;
+      BenchInput input;
+      input.name = value.substr(0, colon);
+      input.shapes = ParseList(value.substr(colon + 1), 'x');
+      CHECK(input.shapes.size() <= 3) << "The input shape should have at most 3 dims";
+      options.inputs.push_back(input);
+    } else if (arg == "--batch") {
+      options.batch_sizes = ParseList(next_value(), ',');
+    } else if (arg == "--threads") {
+      options.thread_counts = ParseList(next_value(), ',');
+    } else if (arg == "--warmup") {
+      options.warmup = uint32_t(std::stoul(next_value()));
+    } else if (arg == "--iterations") {
+      options.iterations = ParseList(next_value(), ',').front();
+    } else if (arg == "--tiled") {
+      options.tiled = true;
+    } else if (arg == "--numa") {
+      options.numa = true;
+    } else if (arg == "--autotune") {
+      options.tuning_cache_path = next_value();
+    } else if (arg == "--activation") {
+      const std::string value = next_value();
+      if (value == "fp16") {
+        options.activation_precision = ActivationPrecision::kFP16;
+      } else if (value == "bf16") {
+        options.activation_precision = ActivationPrecision::kBF16;
+      } else {
+        CHECK(value == "fp32") << "Unknown activation precision: " << value;
+        options.activation_precision = ActivationPrecision::kFP32;
+      }
+    } else if (arg == "--output") {
+      options.output_path = next_value();
+    } else if (arg == "--compare") {
+      compare_base = next_value();
+      compare_new = next_value();
+    } else if (arg == "--threshold") {
+      threshold = std::stod(next_value());
+    } else if (arg == "--help" || arg == "-h") {
+      PrintUsage();
+      return 0;
+    } else {
+      PrintUsage();
+      LOG(FATAL) << "Unknown option: " << arg;
+    }
+  }
+
+  if (!compare_base.empty()) {
+    const int regressions = CompareResults(compare_base, compare_new, threshold);
+    if (regressions > 0) {
+      std::printf("%d regression(s) over %.1f%%\n", regressions, threshold * 100.);
+      return 1;
+    }
+    return 0;
+  }
+
+  if (options.param_path.empty() || options.bin_path.empty()) {
+    PrintUsage();
+    return 2;
+  }
+  if (options.thread_counts.empty()) {
+    options.thread_counts.push_back(uint32_t(omp_get_max_threads()));
+  }
+
+  std::vector<BenchResult> results;
+  for (uint32_t batch : options.batch_sizes) {
+    RuntimeGraph graph(ReplaceBatch(options.param_path, batch),
+                       ReplaceBatch(options.bin_path, batch));
+    graph.set_tiled_execution(options.tiled);
+    graph.set_numa_aware(options.numa, options.numa);
+    graph.set_autotune(!options.tuning_cache_path.empty(), options.tuning_cache_path);
+    graph.set_activation_precision(options.activation_precision);
+    graph.Build();
+    SetGraphInputs(graph, options.inputs, batch);
+    for (uint32_t threads : options.thread_counts) {
+      const BenchResult result = RunBench(graph, options, batch, threads);
+      LOG(INFO) << "batch: " << batch << " threads: " << threads << " p50: " << result.p50_ms
+                << "ms p90: " << result.p90_ms << "ms p99: " << result.p99_ms
+                << "ms throughput: " << result.throughput << "/s";
+      results.push_back(result);
+    }
+  }
+
+  if (options.output_path.empty()) {
+    WriteResults(std::cout, options, results);
+  } else {
+    std::ofstream file(options.output_path);
+    CHECK(file.is_open()) << "Can not open the output file: " << options.output_path;
+    WriteResults(file, options, results);
+  }
+  return 0;
+}
@@ -27,46 +27,26 @@
 #include "data/tensor.hpp"
 #include "runtime/runtime_ir.hpp"
 #include "tick.hpp"
+#include "utils/image/image_preprocess.hpp"
 
 // python ref https://pytorch.org/hub/pytorch_vision_resnet/
 kuiper_infer::sftensor PreProcessImage(const cv::Mat& image) {
   using namespace kuiper_infer;
   assert(!image.empty());
-  // 调整输入大小
-  cv::Mat resize_image;
-  cv::resize(image, resize_image, cv::Size(224, 224));
-
-  cv::Mat rgb_image;
-  cv::cvtColor(resize_image, rgb_image, cv::COLOR_BGR2RGB);
-
-  rgb_image.convertTo(rgb_image, CV_32FC3);
-  std::vector<cv::Mat> split_images;
-  cv::split(rgb_image, split_images);
+  assert(image.type() == CV_8UC3);
   uint32_t input_w = 224;
   uint32_t input_h = 224;
   uint32_t input_c = 3;
-  sftensor input = std::make_shared<ftensor>(input_c, input_h, input_w);
 
-  uint32_t index = 0;
-  for (const auto& split_image : split_images) {
-    assert(split_image.total() == input_w * input_h);
-    const cv::Mat& split_image_t = split_image.t();
-    memcpy(input->slice(index).memptr(), split_image_t.data, sizeof(float) * split_image.total());
-    index += 1;
-  }
-
-  float mean_r = 0.485f;
-  float mean_g = 0.456f;
-  float mean_b = 0.406f;
+  // 调整输入大小, BGR转RGB和归一化在一次遍历中完成
+  utils::ImagePreprocessParam param;
+  param.letterbox = false;
+  param.scale = 1.f / 255.f;
+  param.mean = {0.485f, 0.456f, 0.406f};
+  param.std = {0.229f, 0.224f, 0.225f};
 
-  float var_r = 0.229f;
-  float var_g = 0.224f;
-  float var_b = 0.225f;
-  assert(input->channels() == 3);
-  input->data() = input->data() / 255.f;
-  input->slice(0) = (input->slice(0) - mean_r) / var_r;
-  input->slice(1) = (input->slice(1) - mean_g) / var_g;
-  input->slice(2) = (input->slice(2) - mean_b) / var_b;
+  sftensor input = std::make_shared<ftensor>(input_c, input_h, input_w);
+  utils::ImagePreprocess(image.data, image.rows, image.cols, image.step, param, input);
   return input;
 }
 
@@ -28,39 +28,23 @@
 #include "data/tensor.hpp"
 #include "runtime/runtime_ir.hpp"
 #include "tick.hpp"
+#include "utils/image/image_preprocess.hpp"
 
 kuiper_infer::sftensor PreProcessImage(const cv::Mat& image, const int32_t input_h,
                                        const int32_t input_w) {
   assert(!image.empty());
+  assert(image.type() == CV_8UC3);
   using namespace kuiper_infer;
   const int32_t input_c = 3;
 
-  int stride = 32;
-  cv::Mat out_image;
-  Letterbox(image, out_image, {input_h, input_w}, stride, {114, 114, 114}, true);
-
-  cv::Mat rgb_image;
-  cv::cvtColor(out_image, rgb_image, cv::COLOR_BGR2RGB);
-
-  cv::Mat normalize_image;
-  rgb_image.convertTo(normalize_image, CV_32FC3, 1. / 255.);
-
-  std::vector<cv::Mat> split_images;
-  cv::split(normalize_image, split_images);
-  assert(split_images.size() == input_c);
+  // letterbox, BGR转RGB, 归一化和转置在一次遍历中完成
+  utils::ImagePreprocessParam param;
+  param.letterbox = true;
+  param.pad_value = 114.f;
+  param.scale = 1.f / 255.f;
 
   std::shared_ptr<Tensor<float>> input = std::make_shared<Tensor<float>>(input_c, input_h, input_w);
-  input->Fill(0.f);
-
-  int index = 0;
-  int offset = 0;
-  for (const auto& split_image : split_images) {
-    assert(split_image.total() == input_w * input_h);
-    const cv::Mat& split_image_t = split_image.t();
-    memcpy(input->slice(index).memptr(), split_image_t.data, sizeof(float) * split_image.total());
-    index += 1;
-    offset += split_image.total();
-  }
+  utils::ImagePreprocess(image.data, image.rows, image.cols, image.step, param, input);
   return input;
 }
 
@@ -28,6 +28,7 @@
 #include <memory>
 #include <numeric>
 #include <vector>
+#include "data/tensor_memory.hpp"
 
 namespace kuiper_infer {
 template <typename T>
@@ -69,6 +70,31 @@ class Tensor {
    */
   explicit Tensor(const std::vector<uint32_t>& shapes);
 
+  /**
+   * @brief Construct Tensor on existing memory without copying
+   *
+   * The memory has to be in the tensor layout: one column-major matrix per
+   * channel, channel after channel.
+   *
+   * @param raw_ptr Pointer to the tensor data
+   * @param shapes Tensor dimensions
+   * @param owner Keeps the memory alive as long as the tensor uses it
+   */
+  explicit Tensor(T* raw_ptr, const std::vector<uint32_t>& shapes, std::shared_ptr<void> owner);
+
+  /**
+   * @brief Copies a Tensor into a new buffer of the tensor memory resource
+   *
+   * @param tensor Source tensor
+   */
+  Tensor(const Tensor& tensor);
+
+  Tensor(Tensor&& tensor) noexcept;
+
+  Tensor& operator=(const Tensor& tensor);
+
+  Tensor& operator=(Tensor&& tensor) noexcept;
+
   /**
    * @brief Gets number of rows
    *
@@ -308,9 +334,24 @@ class Tensor {
    */
   void Review(const std::vector<uint32_t>& shapes);
 
+  /**
+   * @brief Creates a cube on a new buffer of the tensor memory resource
+   *
+   * @param buffer Buffer holding the cube memory
+   * @param rows Number of rows
+   * @param cols Number of columns
+   * @param channels Number of channels
+   * @return Cube using the buffer as auxiliary memory, not initialized
+   */
+  static arma::Cube<T> CreateCube(TensorBuffer& buffer, uint32_t rows, uint32_t cols,
+                                  uint32_t channels);
+
   /// Raw tensor dimensions
   std::vector<uint32_t> raw_shapes_;
 
+  /// Aligned memory of the tensor data, has to outlive data_
+  TensorBuffer buffer_;
+
   /// Tensor data
   arma::Cube<T> data_;
 };
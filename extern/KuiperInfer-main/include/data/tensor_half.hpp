@@ -0,0 +1,158 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_DATA_TENSOR_HALF_HPP_
+#define KUIPER_INFER_INCLUDE_DATA_TENSOR_HALF_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "data/tensor.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief Storage precision of the activations between layers
+ */
+enum class ActivationPrecision {
+  kFP32 = 0,
+  kFP16 = 1,  // IEEE half precision
+  kBF16 = 2,  // bfloat16, the upper half of a float
+};
+
+/**
+ * @brief Gets the name of an activation precision
+ *
+ * @param precision Activation precision
+ * @return "fp32", "fp16" or "bf16"
+ */
+const char* ActivationPrecisionName(ActivationPrecision precision);
+
+/**
+ * @brief Converts floats to 16-bit values, rounding to nearest even
+ *
+ * Uses F16C or AVX-512 when the CPU supports them.
+ *
+ * @param input Input floats
+ * @param output Output 16-bit values
+ * @param size Number of values
+ * @param precision kFP16 or kBF16
+ */
+void FloatToHalfSpan(const float* input, uint16_t* output, size_t size,
+                     ActivationPrecision precision);
+
+/**
+ * @brief Converts 16-bit values back to floats
+ *
+ * @param input Input 16-bit values
+ * @param output Output floats
+ * @param size Number of values
+ * @param precision kFP16 or kBF16
+ */
+void HalfToFloatSpan(const uint16_t* input, float* output, size_t size,
+                     ActivationPrecision precision);
+
+/**
+ * @brief Tensor data stored in 16 bits, half the size of a float tensor
+ */
+class HalfTensor {
+ public:
+  /**
+   * @brief Stores a float tensor, resizing the storage if the shape changed
+   *
+   * @param tensor Float tensor
+   * @param precision kFP16 or kBF16
+   */
+  void Pack(const sftensor& tensor, ActivationPrecision precision);
+
+  /**
+   * @brief Widens the stored values into a float tensor of the same shape
+   *
+   * @param tensor Float tensor
+   */
+  void Unpack(const sftensor& tensor) const;
+
+  /**
+   * @brief Widens the stored values into a float buffer of size() values
+   *
+   * @param output Output floats
+   */
+  void Unpack(float* output) const;
+
+  /**
+   * @brief Allocates the storage for a shape ahead of the first Pack
+   *
+   * @param shapes Shape of the float tensor, channels, rows and cols
+   * @param precision kFP16 or kBF16
+   */
+  void Reshape(const std::vector<uint32_t>& shapes, ActivationPrecision precision);
+
+  /**
+   * @brief Widens a range of the stored values, in the element order of the tensor
+   *
+   * Kernels reading 16-bit inputs widen the part they work on, a channel or a
+   * block, instead of a float copy of the whole tensor.
+   *
+   * @param offset Index of the first value
+   * @param size Number of values
+   * @param output Output floats
+   */
+  void UnpackSpan(size_t offset, size_t size, float* output) const;
+
+  const std::vector<uint32_t>& shapes() const { return shapes_; }
+
+  uint32_t channels() const { return shapes_.at(0); }
+
+  uint32_t rows() const { return shapes_.at(1); }
+
+  uint32_t cols() const { return shapes_.at(2); }
+
+  size_t size() const { return data_.size(); }
+
+  ActivationPrecision precision() const { return precision_; }
+
+  /**
+   * @brief Gets the size of the storage in bytes
+   */
+  size_t bytes() const { return data_.size() * sizeof(uint16_t); }
+
+ private:
+  ActivationPrecision precision_ = ActivationPrecision::kFP16;
+  std::vector<uint32_t> shapes_;
+  std::vector<uint16_t> data_;
+};
+
+/**
+ * @brief Runs a kernel on every channel of an input stored in float or in 16 bits
+ *
+ * A 16-bit channel is widened into a buffer of the calling thread right
+ * before the kernel reads it, so the widened values are read from cache.
+ * The channels run in parallel.
+ *
+ * @param input Float input, read when packed_input is nullptr
+ * @param packed_input 16-bit input or nullptr
+ * @param kernel Called with the channel index and the float values of the channel
+ */
+void ForEachInputChannel(const sftensor& input, const HalfTensor* packed_input,
+                         const std::function<void(uint32_t, const float*)>& kernel);
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_DATA_TENSOR_HALF_HPP_
@@ -0,0 +1,87 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_DATA_TENSOR_IO_HPP_
+#define KUIPER_INFER_INCLUDE_DATA_TENSOR_IO_HPP_
+#include <memory>
+#include <string>
+#include <vector>
+#include "data/tensor.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief Loads a tensor from a NumPy .npy file
+ *
+ * The file is memory mapped. Arrays of up to three dimensions (and four with
+ * a leading 1) are read as channels x rows x cols. When the array layout is
+ * already the tensor layout, e.g. vectors, single-row matrices or Fortran
+ * order matrices, the tensor uses the mapped pages without a copy. The
+ * mapping is private, so writing to the tensor does not change the file.
+ *
+ * @param file_path Path to the .npy file
+ * @param zero_copy Whether the tensor may use the mapped file directly
+ * @return Loaded tensor, nullptr if the file can not be opened
+ */
+template <typename T>
+std::shared_ptr<Tensor<T>> TensorLoadNpy(const std::string& file_path, bool zero_copy = true);
+
+/**
+ * @brief Saves a tensor as a NumPy .npy file
+ *
+ * The array has the shape of the tensor's raw shapes in C order, so it can be
+ * compared with the PyTorch outputs directly.
+ *
+ * @param tensor Tensor to save
+ * @param file_path Path to the .npy file
+ * @return True if the file was written
+ */
+template <typename T>
+bool TensorSaveNpy(const std::shared_ptr<Tensor<T>>& tensor, const std::string& file_path);
+
+/**
+ * @brief Loads a tensor from a raw binary file
+ *
+ * A raw file holds the tensor memory as it is, without a header, so it is
+ * always loaded without a copy from the memory mapped file.
+ *
+ * @param file_path Path to the raw file
+ * @param shapes Tensor dimensions
+ * @param zero_copy Whether the tensor may use the mapped file directly
+ * @return Loaded tensor, nullptr if the file can not be opened
+ */
+template <typename T>
+std::shared_ptr<Tensor<T>> TensorLoadRaw(const std::string& file_path,
+                                         const std::vector<uint32_t>& shapes,
+                                         bool zero_copy = true);
+
+/**
+ * @brief Saves the memory of a tensor to a raw binary file
+ *
+ * @param tensor Tensor to save
+ * @param file_path Path to the raw file
+ * @return True if the file was written
+ */
+template <typename T>
+bool TensorSaveRaw(const std::shared_ptr<Tensor<T>>& tensor, const std::string& file_path);
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_DATA_TENSOR_IO_HPP_
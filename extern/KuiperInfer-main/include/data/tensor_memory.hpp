@@ -0,0 +1,224 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_DATA_TENSOR_MEMORY_HPP_
+#define KUIPER_INFER_INCLUDE_DATA_TENSOR_MEMORY_HPP_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace kuiper_infer {
+
+/**
+ * @brief Allocation statistics of a tensor memory resource
+ */
+struct TensorMemoryStatistics {
+  /// Number of Allocate and Deallocate calls
+  uint64_t allocate_count = 0;
+  uint64_t deallocate_count = 0;
+
+  /// Number of allocations served from the free lists
+  uint64_t pool_hit_count = 0;
+
+  /// Number of blocks requested from and returned to the system
+  uint64_t system_allocate_count = 0;
+  uint64_t system_free_count = 0;
+
+  /// Bytes held by live tensors, and its peak value
+  uint64_t bytes_in_use = 0;
+  uint64_t peak_bytes_in_use = 0;
+
+  /// Bytes kept in the free lists for reuse
+  uint64_t bytes_cached = 0;
+};
+
+/**
+ * @brief Memory resource of the tensor data
+ *
+ * Every block returned by Allocate is aligned to kAlignment bytes and has to be
+ * released by Deallocate of the same resource with the same size.
+ */
+class TensorMemoryResource {
+ public:
+  static constexpr size_t kAlignment = 64;
+
+  virtual ~TensorMemoryResource() = default;
+
+  /**
+   * @brief Allocates an aligned memory block
+   *
+   * @param bytes Block size in bytes
+   * @return Pointer to the memory block
+   */
+  virtual void* Allocate(size_t bytes) = 0;
+
+  /**
+   * @brief Releases a memory block
+   *
+   * @param ptr Pointer returned by Allocate
+   * @param bytes Size passed to Allocate
+   */
+  virtual void Deallocate(void* ptr, size_t bytes) = 0;
+
+  /**
+   * @brief Gets allocation statistics
+   *
+   * @return Statistics snapshot
+   */
+  virtual TensorMemoryStatistics statistics() const = 0;
+
+  /**
+   * @brief Releases cached blocks back to the system
+   */
+  virtual void Trim() {}
+};
+
+/**
+ * @brief Memory resource allocating every block from the system
+ */
+class AlignedMemoryResource : public TensorMemoryResource {
+ public:
+  void* Allocate(size_t bytes) override;
+
+  void Deallocate(void* ptr, size_t bytes) override;
+
+  TensorMemoryStatistics statistics() const override;
+
+ private:
+  std::atomic<uint64_t> allocate_count_{0};
+  std::atomic<uint64_t> deallocate_count_{0};
+  std::atomic<uint64_t> bytes_in_use_{0};
+  std::atomic<uint64_t> peak_bytes_in_use_{0};
+};
+
+/**
+ * @brief Memory resource recycling blocks by size class
+ *
+ * Sizes are rounded up to size classes (four classes per power of two), freed
+ * blocks are kept in thread local free lists and spill into a shared free list,
+ * so steady-state inference does not call the system allocator.
+ */
+class PooledMemoryResource : public TensorMemoryResource {
+ public:
+  PooledMemoryResource();
+
+  ~PooledMemoryResource() override;
+
+  void* Allocate(size_t bytes) override;
+
+  void Deallocate(void* ptr, size_t bytes) override;
+
+  TensorMemoryStatistics statistics() const override;
+
+  void Trim() override;
+
+  /**
+   * @brief Gets the size class of an allocation
+   *
+   * @param bytes Requested size in bytes
+   * @return Size class index
+   */
+  static uint32_t SizeClass(size_t bytes);
+
+  /**
+   * @brief Gets the block size of a size class
+   *
+   * @param size_class Size class index
+   * @return Block size in bytes
+   */
+  static size_t SizeClassBytes(uint32_t size_class);
+
+  struct State;
+
+ private:
+  std::shared_ptr<State> state_;
+};
+
+/**
+ * @brief Gets the memory resource used by new tensors
+ *
+ * The default resource is a process wide PooledMemoryResource.
+ */
+std::shared_ptr<TensorMemoryResource> GetTensorMemoryResource();
+
+/**
+ * @brief Sets the memory resource used by new tensors
+ *
+ * Tensors allocated before the call keep releasing into their own resource.
+ *
+ * @param resource New memory resource, nullptr restores the default one
+ */
+void SetTensorMemoryResource(std::shared_ptr<TensorMemoryResource> resource);
+
+/**
+ * @brief Owning handle of a tensor memory block
+ */
+class TensorBuffer {
+ public:
+  TensorBuffer() = default;
+
+  /**
+   * @brief Allocates a block from the current memory resource
+   *
+   * @param bytes Block size in bytes
+   */
+  explicit TensorBuffer(size_t bytes);
+
+  /**
+   * @brief Wraps memory not allocated by a memory resource
+   *
+   * @param data Pointer to the memory
+   * @param bytes Size of the memory in bytes
+   * @param owner Keeps the memory alive until the buffer is released
+   */
+  TensorBuffer(void* data, size_t bytes, std::shared_ptr<void> owner);
+
+  ~TensorBuffer();
+
+  TensorBuffer(TensorBuffer&& other) noexcept;
+
+  TensorBuffer& operator=(TensorBuffer&& other) noexcept;
+
+  TensorBuffer(const TensorBuffer&) = delete;
+
+  TensorBuffer& operator=(const TensorBuffer&) = delete;
+
+  void* data() const { return data_; }
+
+  size_t bytes() const { return bytes_; }
+
+  bool empty() const { return data_ == nullptr; }
+
+  /**
+   * @brief Returns the block to its memory resource, or drops the external owner
+   */
+  void Release();
+
+ private:
+  void* data_ = nullptr;
+  size_t bytes_ = 0;
+  std::shared_ptr<TensorMemoryResource> resource_;
+  std::shared_ptr<void> owner_;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_DATA_TENSOR_MEMORY_HPP_
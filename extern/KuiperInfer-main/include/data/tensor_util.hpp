@@ -108,6 +108,63 @@ void TensorElementMultiply(const std::shared_ptr<Tensor<T>>& tensor1,
                            const std::shared_ptr<Tensor<T>>& tensor2,
                            const std::shared_ptr<Tensor<T>>& output_tensor);
 
+/**
+ * @brief Element-wise add of one contiguous span
+ *
+ * @param input1 Input 1, only the first element is read if input1_broadcast
+ * @param input1_broadcast Whether input 1 is broadcast along the span (stride 0)
+ * @param input2 Input 2, only the first element is read if input2_broadcast
+ * @param input2_broadcast Whether input 2 is broadcast along the span (stride 0)
+ * @param output Output span, can be the same memory as a non-broadcast input
+ * @param size Number of elements in the span
+ */
+template <typename T>
+void ElementAddSpan(const T* input1, bool input1_broadcast, const T* input2, bool input2_broadcast,
+                    T* output, uint32_t size);
+
+/**
+ * @brief Element-wise multiply of one contiguous span
+ *
+ * @param input1 Input 1, only the first element is read if input1_broadcast
+ * @param input1_broadcast Whether input 1 is broadcast along the span (stride 0)
+ * @param input2 Input 2, only the first element is read if input2_broadcast
+ * @param input2_broadcast Whether input 2 is broadcast along the span (stride 0)
+ * @param output Output span, can be the same memory as a non-broadcast input
+ * @param size Number of elements in the span
+ */
+template <typename T>
+void ElementMultiplySpan(const T* input1, bool input1_broadcast, const T* input2,
+                         bool input2_broadcast, T* output, uint32_t size);
+
+/**
+ * @brief Gets the shape two tensors broadcast to
+ *
+ * Every dimension of the tensors has to be equal or 1.
+ *
+ * @param tensor1 Tensor 1
+ * @param tensor2 Tensor 2
+ * @return Broadcast shape as channels, rows and cols
+ */
+template <typename T>
+std::vector<uint32_t> TensorBroadcastShapes(const std::shared_ptr<Tensor<T>>& tensor1,
+                                            const std::shared_ptr<Tensor<T>>& tensor2);
+
+/**
+ * @brief Element-wise binary operation with stride-0 broadcasting
+ *
+ * Dimensions of size 1 are read repeatedly instead of being expanded into a new tensor,
+ * the span function runs over the contiguous rows (or whole channels) of the output.
+ *
+ * @param tensor1 Tensor 1
+ * @param tensor2 Tensor 2
+ * @param output_tensor Output with the broadcast shape of the inputs
+ * @param span_func Function computing one contiguous span
+ */
+template <typename T, typename SpanFunc>
+void TensorElementBinary(const std::shared_ptr<Tensor<T>>& tensor1,
+                         const std::shared_ptr<Tensor<T>>& tensor2,
+                         const std::shared_ptr<Tensor<T>>& output_tensor, SpanFunc span_func);
+
 /**
  * @brief Creates a 3D tensor
  *
@@ -168,76 +225,138 @@ bool TensorIsSame(const std::shared_ptr<Tensor<T>>& a, const std::shared_ptr<Ten
   return is_same;
 }
 
+template <typename T>
+void ElementAddSpan(const T* input1, bool input1_broadcast, const T* input2, bool input2_broadcast,
+                    T* output, uint32_t size) {
+  const uint32_t step1 = input1_broadcast ? 0 : 1;
+  const uint32_t step2 = input2_broadcast ? 0 : 1;
+  for (uint32_t i = 0; i < size; ++i) {
+    output[i] = input1[i * step1] + input2[i * step2];
+  }
+}
+
+template <typename T>
+void ElementMultiplySpan(const T* input1, bool input1_broadcast, const T* input2,
+                         bool input2_broadcast, T* output, uint32_t size) {
+  const uint32_t step1 = input1_broadcast ? 0 : 1;
+  const uint32_t step2 = input2_broadcast ? 0 : 1;
+  for (uint32_t i = 0; i < size; ++i) {
+    output[i] = input1[i * step1] * input2[i * step2];
+  }
+}
+
+// float版本使用SIMD指令, 实现在tensor_utils.cpp中
+template <>
+void ElementAddSpan<float>(const float* input1, bool input1_broadcast, const float* input2,
+                           bool input2_broadcast, float* output, uint32_t size);
+
+template <>
+void ElementMultiplySpan<float>(const float* input1, bool input1_broadcast, const float* input2,
+                                bool input2_broadcast, float* output, uint32_t size);
+
+template <typename T>
+std::vector<uint32_t> TensorBroadcastShapes(const std::shared_ptr<Tensor<T>>& tensor1,
+                                            const std::shared_ptr<Tensor<T>>& tensor2) {
+  CHECK(tensor1 != nullptr && tensor2 != nullptr);
+  const std::vector<uint32_t>& shapes1 = tensor1->shapes();
+  const std::vector<uint32_t>& shapes2 = tensor2->shapes();
+  CHECK(shapes1.size() == 3 && shapes2.size() == 3);
+  std::vector<uint32_t> shapes(3);
+  for (uint32_t i = 0; i < 3; ++i) {
+    CHECK(shapes1.at(i) == shapes2.at(i) || shapes1.at(i) == 1 || shapes2.at(i) == 1)
+        << "Tensors shape are not adapting";
+    shapes.at(i) = std::max(shapes1.at(i), shapes2.at(i));
+  }
+  return shapes;
+}
+
+template <typename T, typename SpanFunc>
+void TensorElementBinary(const std::shared_ptr<Tensor<T>>& tensor1,
+                         const std::shared_ptr<Tensor<T>>& tensor2,
+                         const std::shared_ptr<Tensor<T>>& output_tensor, SpanFunc span_func) {
+  CHECK(tensor1 != nullptr && tensor2 != nullptr && output_tensor != nullptr);
+  CHECK(!tensor1->empty() && !tensor2->empty() && !output_tensor->empty());
+  CHECK(output_tensor->shapes() == TensorBroadcastShapes(tensor1, tensor2))
+      << "The output shape is not equal to the broadcast shape of inputs";
+
+  const uint32_t channels = output_tensor->channels();
+  const uint32_t rows = output_tensor->rows();
+  const uint32_t cols = output_tensor->cols();
+  const size_t planes = (size_t)rows * cols;
+  const T* input1 = tensor1->raw_ptr();
+  const T* input2 = tensor2->raw_ptr();
+  T* output = output_tensor->raw_ptr();
+
+  // 大小为1的维度步长为0, 每个矩阵在内存中按列优先存储, rows是连续的维度
+  const size_t channel_step1 =
+      tensor1->channels() == 1 ? 0 : (size_t)tensor1->rows() * tensor1->cols();
+  const size_t channel_step2 =
+      tensor2->channels() == 1 ? 0 : (size_t)tensor2->rows() * tensor2->cols();
+  const size_t col_step1 = tensor1->cols() == 1 ? 0 : tensor1->rows();
+  const size_t col_step2 = tensor2->cols() == 1 ? 0 : tensor2->rows();
+  const bool row_broadcast1 = tensor1->rows() != rows;
+  const bool row_broadcast2 = tensor2->rows() != rows;
+  const bool plane_full1 = !row_broadcast1 && tensor1->cols() == cols;
+  const bool plane_full2 = !row_broadcast2 && tensor2->cols() == cols;
+  const bool plane_single1 = tensor1->rows() == 1 && tensor1->cols() == 1;
+  const bool plane_single2 = tensor2->rows() == 1 && tensor2->cols() == 1;
+
+  for (uint32_t c = 0; c < channels; ++c) {
+    const T* channel1 = input1 + c * channel_step1;
+    const T* channel2 = input2 + c * channel_step2;
+    T* channel_output = output + c * planes;
+    if ((plane_full1 || plane_single1) && (plane_full2 || plane_single2)) {
+      // 整个矩阵作为一个连续的区间, 例如逐通道的缩放
+      span_func(channel1, !plane_full1, channel2, !plane_full2, channel_output, planes);
+    } else {
+      for (uint32_t col = 0; col < cols; ++col) {
+        span_func(channel1 + col * col_step1, row_broadcast1, channel2 + col * col_step2,
+                  row_broadcast2, channel_output + (size_t)col * rows, rows);
+      }
+    }
+  }
+}
+
 template <typename T>
 void TensorElementAdd(const std::shared_ptr<Tensor<T>>& tensor1,
                       const std::shared_ptr<Tensor<T>>& tensor2,
                       const std::shared_ptr<Tensor<T>>& output_tensor) {
-  CHECK(tensor1 != nullptr && tensor2 != nullptr && output_tensor != nullptr);
-  if (tensor1->shapes() == tensor2->shapes()) {
-    CHECK(tensor1->shapes() == output_tensor->shapes());
-    output_tensor->set_data(tensor1->data() + tensor2->data());
-  } else {
-    CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-    const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-    CHECK(output_tensor->shapes() == input_tensor1->shapes() &&
-          output_tensor->shapes() == input_tensor2->shapes());
-    output_tensor->set_data(input_tensor1->data() + input_tensor2->data());
-  }
+  TensorElementBinary(tensor1, tensor2, output_tensor, ElementAddSpan<T>);
 }
 
 template <typename T>
 void TensorElementMultiply(const std::shared_ptr<Tensor<T>>& tensor1,
                            const std::shared_ptr<Tensor<T>>& tensor2,
                            const std::shared_ptr<Tensor<T>>& output_tensor) {
-  CHECK(tensor1 != nullptr && tensor2 != nullptr && output_tensor != nullptr);
-  if (tensor1->shapes() == tensor2->shapes()) {
-    CHECK(tensor1->shapes() == output_tensor->shapes());
-    output_tensor->set_data(tensor1->data() % tensor2->data());
-  } else {
-    CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-    const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-    CHECK(output_tensor->shapes() == input_tensor1->shapes() &&
-          output_tensor->shapes() == input_tensor2->shapes());
-    output_tensor->set_data(input_tensor1->data() % input_tensor2->data());
-  }
+  TensorElementBinary(tensor1, tensor2, output_tensor, ElementMultiplySpan<T>);
 }
 
 template <typename T>
 std::shared_ptr<Tensor<T>> TensorElementAdd(const std::shared_ptr<Tensor<T>>& tensor1,
                                             const std::shared_ptr<Tensor<T>>& tensor2) {
   CHECK(tensor1 != nullptr && tensor2 != nullptr);
+  std::shared_ptr<Tensor<T>> output_tensor;
   if (tensor1->shapes() == tensor2->shapes()) {
-    std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(tensor1->shapes());
-    output_tensor->set_data(tensor1->data() + tensor2->data());
-    return output_tensor;
+    output_tensor = TensorCreate<T>(tensor1->shapes());
   } else {
-    // broadcast
-    CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-    const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-    CHECK(input_tensor1->shapes() == input_tensor2->shapes());
-    std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(input_tensor1->shapes());
-    output_tensor->set_data(input_tensor1->data() + input_tensor2->data());
-    return output_tensor;
+    output_tensor = TensorCreate<T>(TensorBroadcastShapes(tensor1, tensor2));
   }
+  TensorElementBinary(tensor1, tensor2, output_tensor, ElementAddSpan<T>);
+  return output_tensor;
 }
 
 template <typename T>
 std::shared_ptr<Tensor<T>> TensorElementMultiply(const std::shared_ptr<Tensor<T>>& tensor1,
                                                  const std::shared_ptr<Tensor<T>>& tensor2) {
   CHECK(tensor1 != nullptr && tensor2 != nullptr);
+  std::shared_ptr<Tensor<T>> output_tensor;
   if (tensor1->shapes() == tensor2->shapes()) {
-    std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(tensor1->shapes());
-    output_tensor->set_data(tensor1->data() % tensor2->data());
-    return output_tensor;
+    output_tensor = TensorCreate<T>(tensor1->shapes());
   } else {
-    // broadcast
-    CHECK(tensor1->channels() == tensor2->channels()) << "Tensors shape are not adapting";
-    const auto& [input_tensor1, input_tensor2] = TensorBroadcast(tensor1, tensor2);
-    CHECK(input_tensor1->shapes() == input_tensor2->shapes());
-    std::shared_ptr<Tensor<T>> output_tensor = TensorCreate<T>(input_tensor1->shapes());
-    output_tensor->set_data(input_tensor1->data() % input_tensor2->data());
-    return output_tensor;
+    output_tensor = TensorCreate<T>(TensorBroadcastShapes(tensor1, tensor2));
   }
+  TensorElementBinary(tensor1, tensor2, output_tensor, ElementMultiplySpan<T>);
+  return output_tensor;
 }
 
 template <typename T>
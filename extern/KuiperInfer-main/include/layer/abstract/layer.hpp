@@ -36,9 +36,31 @@ namespace kuiper_infer {
 template <typename T>
 class Layer;
 
+class HalfTensor;
+
 template <>
 class Layer<int8_t> {};
 
+/**
+ * @brief Input window of a layer over the spatial axes
+ *
+ * Describes which input rows and columns one output element reads, so that a
+ * layer can run on a spatial tile of its input.
+ */
+struct TileWindow {
+  uint32_t kernel_h = 1;
+  uint32_t kernel_w = 1;
+  uint32_t stride_h = 1;
+  uint32_t stride_w = 1;
+  uint32_t padding_h = 0;
+  uint32_t padding_w = 0;
+  uint32_t dilation_h = 1;
+  uint32_t dilation_w = 1;
+
+  /// Value of the padded elements
+  float padding_value = 0.f;
+};
+
 /**
  * @brief Base layer class
  *
@@ -83,6 +105,62 @@ class Layer<float> {
   virtual StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                              std::vector<std::shared_ptr<Tensor<float>>>& outputs);
 
+  /**
+   * @brief Validates the inputs, outputs and parameters of Forward
+   *
+   * Checks everything Forward relies on: the tensor array sizes, the input
+   * and output shapes and the weight shapes. Empty output tensors are
+   * accepted, Forward creates them. RuntimeGraph calls it once in Build with
+   * tensors of the execution shapes.
+   *
+   * @param inputs Input tensors
+   * @param outputs Output tensors
+   * @return Status code
+   */
+  virtual StatusCode Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                           const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
+    return StatusCode::kSuccess;
+  }
+
+  /**
+   * @brief Performs forward inference without validation
+   *
+   * Only valid on tensors of the shapes which passed Check. Layers without a
+   * separate unchecked path run Forward.
+   *
+   * @param inputs Input tensors
+   * @param outputs Output tensors
+   * @return Status code
+   */
+  virtual StatusCode ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+    return Forward(inputs, outputs);
+  }
+
+  /**
+   * @brief Whether ForwardPacked can read inputs stored in 16 bits
+   *
+   * @return True if the layer widens 16-bit inputs inside its kernel
+   */
+  virtual bool is_packed_input_supported() const { return false; }
+
+  /**
+   * @brief Performs forward inference on inputs partly stored in 16 bits
+   *
+   * Input i is read from packed_inputs[i] when it is not nullptr and from
+   * inputs[i] otherwise. The layer widens the 16-bit values as it reads them,
+   * so no float copy of the input is made. Only valid on shapes which passed
+   * Check, and the output tensors have to be allocated.
+   *
+   * @param inputs Input tensors, ignored where packed_inputs is not nullptr
+   * @param packed_inputs 16-bit inputs, nullptr for the inputs in float
+   * @param outputs Output tensors
+   * @return Status code
+   */
+  virtual StatusCode ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                   const std::vector<const HalfTensor*>& packed_inputs,
+                                   std::vector<std::shared_ptr<Tensor<float>>>& outputs);
+
   /**
    * @brief Gets layer weights
    *
@@ -140,6 +218,71 @@ class Layer<float> {
    */
   virtual const std::string& layer_name() const { return this->layer_name_; }
 
+  /**
+   * @brief Whether the layer can write its outputs into its inputs
+   *
+   * Layers returning true must produce correct results when the input and
+   * output tensors are the same object.
+   *
+   * @return True if the layer supports in-place execution
+   */
+  virtual bool is_inplace_supported() const { return false; }
+
+  /**
+   * @brief Gets the spatial input window for tiled execution
+   *
+   * Layers returning true compute every output element from the window of
+   * the input described by window, and nothing else.
+   *
+   * @param window Input window of the layer
+   * @return True if the layer can run on spatial tiles of its input
+   */
+  virtual bool GetTileWindow(TileWindow& window) const { return false; }
+
+  /**
+   * @brief Creates a copy of the layer for tiled execution
+   *
+   * The copy shares the weights of the layer but does not pad its input,
+   * since the tiles are padded before they reach it. Layers without padding
+   * return nullptr and run on the tiles directly.
+   *
+   * @return Copy of the layer without padding
+   */
+  virtual std::shared_ptr<Layer<float>> CreateTileLayer() const { return nullptr; }
+
+  /**
+   * @brief Copies the weights read by Forward to every NUMA node
+   *
+   * Forward afterwards reads the copy on the node of the calling thread
+   * instead of fetching every weight from the node that loaded it.
+   */
+  virtual void ReplicateWeights() {}
+
+  /**
+   * @brief Gets the signature of the layer parameters for the tuning cache
+   *
+   * Layers with the same signature and input shapes run the same computation,
+   * so they share the tuned choice. Layers returning an empty string are not
+   * tuned.
+   *
+   * @return Signature of the layer parameters
+   */
+  virtual std::string tuning_signature() const { return ""; }
+
+  /**
+   * @brief Gets the names of the implementations the layer can choose from
+   *
+   * @return Names of the tuning choices, in the index order of set_tuning_choice
+   */
+  virtual std::vector<std::string> tuning_choices() const { return {}; }
+
+  /**
+   * @brief Selects the implementation used by Forward
+   *
+   * @param choice Index in tuning_choices()
+   */
+  virtual void set_tuning_choice(uint32_t choice) {}
+
   /**
    * @brief Sets corresponding runtime operator
    *
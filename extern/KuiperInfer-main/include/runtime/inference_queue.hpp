@@ -0,0 +1,145 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_RUNTIME_INFERENCE_QUEUE_HPP_
+#define KUIPER_INFER_INCLUDE_RUNTIME_INFERENCE_QUEUE_HPP_
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "runtime/runtime_ir.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief Snapshot of the inference queue statistics
+ */
+struct InferenceQueueStatistics {
+  /// Number of finished requests
+  uint64_t request_count = 0;
+
+  /// Number of Forward calls issued by the batcher
+  uint64_t batch_count = 0;
+
+  /// Request latency percentiles (submit to result) in milliseconds
+  double latency_p50 = 0.;
+  double latency_p90 = 0.;
+  double latency_p99 = 0.;
+
+  /// batch_histogram[i] is the number of batches containing i real requests
+  std::vector<uint64_t> batch_histogram;
+};
+
+/**
+ * @brief Asynchronous inference queue with dynamic batching
+ *
+ * Wraps a built RuntimeGraph behind a submit/future interface. A worker
+ * thread groups single-image requests into one Forward call, waiting at most
+ * max_wait_time for a batch to fill up to max_batch_size, and then splits the
+ * graph outputs back to the callers.
+ *
+ * The pnnx graph has a fixed batch size, so max_batch_size must be equal to
+ * the batch the model was exported with. Partial batches are padded with the
+ * last request's input and the padded outputs are discarded.
+ */
+class InferenceQueue {
+ public:
+  /**
+   * @brief Construct and start the inference queue
+   *
+   * @param graph Runtime graph, built on construction if it is not yet
+   * @param input_name Name of the graph input operator
+   * @param output_name Name of the graph output operator
+   * @param max_batch_size Batch size of the graph
+   * @param max_wait_time Maximum time the first request of a batch waits
+   */
+  InferenceQueue(std::shared_ptr<RuntimeGraph> graph, std::string input_name,
+                 std::string output_name, uint32_t max_batch_size,
+                 std::chrono::microseconds max_wait_time);
+
+  ~InferenceQueue();
+
+  InferenceQueue(const InferenceQueue&) = delete;
+
+  InferenceQueue& operator=(const InferenceQueue&) = delete;
+
+  /**
+   * @brief Submits one image for inference
+   *
+   * @param input Input tensor of a single image
+   * @return Future holding the output tensor of this image
+   */
+  std::future<sftensor> Submit(sftensor input);
+
+  /**
+   * @brief Stops the worker after draining the pending requests
+   */
+  void Stop();
+
+  /**
+   * @brief Gets the latency percentiles and batch size histogram
+   *
+   * @return Statistics snapshot
+   */
+  InferenceQueueStatistics statistics() const;
+
+ private:
+  struct Request {
+    sftensor input;
+    std::promise<sftensor> output;
+    std::chrono::steady_clock::time_point submit_time;
+  };
+
+  void WorkerLoop();
+
+  void ForwardBatch(std::vector<Request>& batch);
+
+ private:
+  /// Number of latency samples kept for the percentiles
+  static constexpr size_t kLatencyWindow = 8192;
+
+  std::shared_ptr<RuntimeGraph> graph_;
+  std::string input_name_;
+  std::string output_name_;
+  uint32_t max_batch_size_ = 1;
+  std::chrono::microseconds max_wait_time_;
+
+  bool stopped_ = false;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cond_;
+  std::deque<Request> requests_;
+  std::thread worker_;
+
+  mutable std::mutex stats_mutex_;
+  uint64_t request_count_ = 0;
+  uint64_t batch_count_ = 0;
+  std::vector<double> latencies_;
+  size_t latency_pos_ = 0;
+  std::vector<uint64_t> batch_histogram_;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_RUNTIME_INFERENCE_QUEUE_HPP_
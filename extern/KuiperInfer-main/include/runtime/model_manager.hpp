@@ -0,0 +1,225 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_RUNTIME_MODEL_MANAGER_HPP_
+#define KUIPER_INFER_INCLUDE_RUNTIME_MODEL_MANAGER_HPP_
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "runtime/runtime_ir.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief Snapshot of the statistics of one model in the model manager
+ */
+struct ModelStatistics {
+  /// Number of finished requests
+  uint64_t request_count = 0;
+
+  /// Number of finished requests which missed their deadline
+  uint64_t deadline_miss_count = 0;
+
+  /// Number of executed layer steps
+  uint64_t step_count = 0;
+
+  /// Time the workers spent on the layers of the model in milliseconds
+  double busy_time = 0.;
+
+  /// Share of the worker time spent on the model since the manager started
+  double utilization = 0.;
+
+  /// Mean request latency (submit to result) in milliseconds
+  double latency_mean = 0.;
+
+  /// Time the last request of the model finished
+  std::chrono::steady_clock::time_point last_finish_time;
+};
+
+/**
+ * @brief Runs several models on one shared pool of workers
+ *
+ * Every model is a built RuntimeGraph with a priority. Requests are split
+ * into the steps of the graph's execution plan, and each time a worker is
+ * free it runs the next layer of the most urgent model: the highest priority
+ * first, then the earliest deadline, then the earliest submission. A model
+ * runs one request at a time, picked from its queue by the same deadline and
+ * submission order, so a high priority request waits for at most one layer
+ * of a low priority model instead of its whole forward.
+ *
+ * Each worker has a budget of thread_count / worker_count OpenMP threads,
+ * and the layers size their batch loops with utils::ParallelTeamSize, so the
+ * models never hold more threads than the pool has, unlike graphs forwarded
+ * from separate threads.
+ */
+class ModelManager {
+ public:
+  /**
+   * @brief Construct and start the model manager
+   *
+   * @param worker_count Number of layers run at the same time
+   * @param thread_count Number of threads of the pool, 0 for omp_get_max_threads()
+   */
+  explicit ModelManager(uint32_t worker_count = 1, uint32_t thread_count = 0);
+
+  ~ModelManager();
+
+  ModelManager(const ModelManager&) = delete;
+
+  ModelManager& operator=(const ModelManager&) = delete;
+
+  /**
+   * @brief Adds a model to the manager
+   *
+   * @param model_name Name used to submit requests to the model
+   * @param graph Runtime graph, built here if it is not yet
+   * @param input_name Name of the graph input operator
+   * @param output_name Name of the graph output operator
+   * @param priority Priority of the model, larger values run first
+   */
+  void AddModel(const std::string& model_name, std::shared_ptr<RuntimeGraph> graph,
+                std::string input_name, std::string output_name, int32_t priority = 0);
+
+  /**
+   * @brief Loads a pnnx model and adds it to the manager
+   *
+   * @param model_name Name used to submit requests to the model
+   * @param param_path Path to the parameter file of the model
+   * @param bin_path Path to the bin file of the model
+   * @param input_name Name of the graph input operator
+   * @param output_name Name of the graph output operator
+   * @param priority Priority of the model, larger values run first
+   */
+  void LoadModel(const std::string& model_name, const std::string& param_path,
+                 const std::string& bin_path, std::string input_name, std::string output_name,
+                 int32_t priority = 0);
+
+  /**
+   * @brief Submits a batch of inputs to a model
+   *
+   * @param model_name Name of the model
+   * @param inputs Input tensors, one per batch element of the graph
+   * @param deadline Time the outputs are needed by, orders requests of the same priority
+   * @return Future holding the output tensors
+   */
+  std::future<std::vector<sftensor>> Submit(const std::string& model_name,
+                                            std::vector<sftensor> inputs,
+                                            std::chrono::steady_clock::time_point deadline =
+                                                std::chrono::steady_clock::time_point::max());
+
+  /**
+   * @brief Holds the queued requests until Resume, the running layers finish
+   */
+  void Pause();
+
+  /**
+   * @brief Lets the workers pick the queued requests again
+   */
+  void Resume();
+
+  /**
+   * @brief Stops the workers after draining the pending requests
+   */
+  void Stop();
+
+  /**
+   * @brief Gets the request count, busy time and utilization of a model
+   *
+   * @param model_name Name of the model
+   * @return Statistics snapshot
+   */
+  ModelStatistics statistics(const std::string& model_name) const;
+
+ private:
+  struct Request {
+    std::vector<sftensor> inputs;
+    std::promise<std::vector<sftensor>> outputs;
+    std::chrono::steady_clock::time_point submit_time;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  struct Model {
+    std::shared_ptr<RuntimeGraph> graph;
+    std::string input_name;
+    std::string output_name;
+    int32_t priority = 0;
+
+    /// A worker is running a step of the model
+    bool running = false;
+
+    /// Request being executed and its next step
+    std::unique_ptr<Request> active;
+    uint32_t next_step = 0;
+    std::deque<Request> requests;
+
+    uint64_t request_count = 0;
+    uint64_t deadline_miss_count = 0;
+    uint64_t step_count = 0;
+    double busy_time = 0.;
+    double latency_sum = 0.;
+    std::chrono::steady_clock::time_point last_finish_time;
+  };
+
+  void WorkerLoop();
+
+  /**
+   * @brief Picks the most urgent model which has work and is not running
+   *
+   * @return Model or nullptr, called with queue_mutex_ held
+   */
+  Model* PickModel();
+
+  /**
+   * @brief Gets the queued request of a model to run next
+   *
+   * @return The request with the earliest deadline, the earliest submitted among equal ones
+   */
+  static std::deque<Request>::iterator NextRequest(Model* model);
+
+  /**
+   * @brief Runs the next step of the active request of a model
+   *
+   * @return True if the request has finished
+   */
+  bool RunStep(Model* model);
+
+ private:
+  uint32_t worker_count_ = 1;
+  uint32_t thread_count_ = 1;
+  std::chrono::steady_clock::time_point start_time_;
+
+  bool stopped_ = false;
+  bool paused_ = false;
+  mutable std::mutex queue_mutex_;
+  std::condition_variable queue_cond_;
+  std::map<std::string, std::unique_ptr<Model>> models_;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_RUNTIME_MODEL_MANAGER_HPP_
@@ -0,0 +1,246 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_RUNTIME_PIPELINE_EXECUTOR_HPP_
+#define KUIPER_INFER_INCLUDE_RUNTIME_PIPELINE_EXECUTOR_HPP_
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "runtime/runtime_ir.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief Bounded lock-free queue for one producer thread and one consumer thread
+ */
+template <typename T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(size_t capacity) : slots_(capacity + 1) {}
+
+  SpscQueue(const SpscQueue&) = delete;
+
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  /**
+   * @brief Moves a value into the queue, only called by the producer
+   *
+   * @return False if the queue is full, the value is left untouched then
+   */
+  bool TryPush(T& value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t next_tail = (tail + 1) % slots_.size();
+    if (next_tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    slots_.at(tail) = std::move(value);
+    tail_.store(next_tail, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Moves the oldest value out of the queue, only called by the consumer
+   *
+   * @return False if the queue is empty
+   */
+  bool TryPop(T& value) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = std::move(slots_.at(head));
+    head_.store((head + 1) % slots_.size(), std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::vector<T> slots_;
+
+  /// 生产者和消费者的位置放在不同的缓存行, 避免伪共享
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+/**
+ * @brief Statistics of one stage of the pipeline executor
+ */
+struct PipelineStageStatistics {
+  /// Execution steps of the stage, from begin_step to end_step - 1
+  uint32_t begin_step = 0;
+  uint32_t end_step = 0;
+
+  /// Profiled forward time of the steps in milliseconds, used to balance the stages
+  double profiled_time = 0.;
+
+  /// Time the stage spent on frames in milliseconds
+  double busy_time = 0.;
+
+  /// Share of the time since the executor started spent on frames
+  double utilization = 0.;
+};
+
+/**
+ * @brief Snapshot of the pipeline executor statistics
+ */
+struct PipelineStatistics {
+  /// Number of frames which left the last stage
+  uint64_t frame_count = 0;
+
+  /// Finished frames per second since the executor started
+  double frames_per_second = 0.;
+
+  std::vector<PipelineStageStatistics> stages;
+};
+
+/**
+ * @brief Streams frames through a graph split into pipeline stages
+ *
+ * The execution plan is split into stage_count stages of consecutive steps,
+ * balanced by the layer times profiled on the sample inputs. Every stage runs
+ * on its own thread, bound to its own group of cores, and hands the frames to
+ * the next stage through a bounded lock-free queue. A frame is in one stage at
+ * a time, so up to stage_count frames run at the same time and the frames per
+ * second scale with the cores even at batch size 1, while the latency of a
+ * frame stays about one Forward.
+ *
+ * Push and Pop may be called from two different threads, but each of them
+ * from one thread only.
+ */
+class PipelineExecutor {
+ public:
+  /**
+   * @brief Construct and start the pipeline executor
+   *
+   * @param graph Runtime graph, built here if it is not yet
+   * @param input_name Name of the graph input operator
+   * @param output_name Name of the graph output operator
+   * @param sample_inputs Inputs used to profile the layer times
+   * @param stage_count Number of pipeline stages
+   * @param threads_per_stage OpenMP threads of each stage, 0 for the size of its core group
+   * @param queue_capacity Number of frames waiting between two stages
+   */
+  PipelineExecutor(std::shared_ptr<RuntimeGraph> graph, std::string input_name,
+                   std::string output_name, const std::vector<sftensor>& sample_inputs,
+                   uint32_t stage_count, uint32_t threads_per_stage = 0,
+                   uint32_t queue_capacity = 4);
+
+  ~PipelineExecutor();
+
+  PipelineExecutor(const PipelineExecutor&) = delete;
+
+  PipelineExecutor& operator=(const PipelineExecutor&) = delete;
+
+  /**
+   * @brief Pushes a frame into the first stage, waits while its queue is full
+   *
+   * @param inputs Input tensors of the frame
+   */
+  void Push(std::vector<sftensor> inputs);
+
+  /**
+   * @brief Pops the outputs of the oldest finished frame, waits for it if needed
+   *
+   * @param outputs Output tensors of the frame
+   * @return False if the executor is stopped and all frames have been popped
+   */
+  bool Pop(std::vector<sftensor>& outputs);
+
+  /**
+   * @brief Stops the stages after the pushed frames went through the pipeline
+   *
+   * The outputs of those frames can still be popped afterwards.
+   */
+  void Stop();
+
+  /**
+   * @brief Gets the frames per second and the utilization of each stage
+   *
+   * @return Statistics snapshot
+   */
+  PipelineStatistics statistics() const;
+
+  /**
+   * @brief Splits steps into consecutive stages minimizing the largest stage cost
+   *
+   * @param costs Cost of every step
+   * @param stage_count Number of stages, reduced to the number of steps if larger
+   * @return End step of every stage
+   */
+  static std::vector<uint32_t> PartitionStages(const std::vector<double>& costs,
+                                               uint32_t stage_count);
+
+ private:
+  using Frame = std::map<std::string, std::vector<sftensor>>;
+
+  using FrameQueue = SpscQueue<std::unique_ptr<Frame>>;
+
+  struct Stage {
+    std::vector<uint32_t> cpus;
+
+    /// Frames waiting for the stage
+    std::unique_ptr<FrameQueue> queue;
+
+    /// The stage has finished its last frame
+    std::atomic<bool> done{false};
+
+    double profiled_time = 0.;
+    double busy_time = 0.;
+    std::thread thread;
+  };
+
+  void StageLoop(uint32_t stage_index);
+
+ private:
+  /// Number of forwards profiled before the stages are split
+  static constexpr uint32_t kProfileRepeats = 3;
+
+  std::shared_ptr<RuntimeGraph> graph_;
+  std::string input_name_;
+  std::string output_name_;
+  uint32_t threads_per_stage_ = 1;
+  std::vector<uint32_t> stage_ends_;
+  std::vector<std::unique_ptr<Stage>> stages_;
+  std::chrono::steady_clock::time_point start_time_;
+
+  /// No frame is pushed anymore
+  std::atomic<bool> input_closed_{false};
+  std::mutex stop_mutex_;
+  bool stopped_ = false;
+
+  /// 最后一个阶段的输出交给调用者, 调用者可以在停止后继续取出
+  std::mutex output_mutex_;
+  std::condition_variable output_cond_;
+  std::deque<std::vector<sftensor>> outputs_;
+
+  mutable std::mutex stats_mutex_;
+  uint64_t frame_count_ = 0;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_RUNTIME_PIPELINE_EXECUTOR_HPP_
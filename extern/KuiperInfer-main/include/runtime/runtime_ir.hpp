@@ -25,10 +25,13 @@
 #include <memory>
 #include <queue>
 #include <string>
+#include <utility>
 #include <vector>
+#include "data/tensor_half.hpp"
 #include "layer/abstract/layer.hpp"
 #include "runtime/pnnx/ir.h"
 #include "runtime/runtime_operand.hpp"
+#include "runtime/runtime_tiling.hpp"
 #include "runtime_op.hpp"
 
 namespace kuiper_infer {
@@ -56,7 +59,10 @@ class RuntimeGraph {
   /**
    * @brief Sets the inputs to the graph
    *
-   * Sets the input tensors for executing the graph.
+   * Sets the input tensors for executing the graph. Their shapes have to
+   * match the input shapes of the model, the layers do not check them again.
+   * With a memory budget any number of input tensors is accepted, Forward
+   * runs them in micro-batches.
    *
    * @param input_name Name of the input
    * @param inputs Vector of input tensors
@@ -66,7 +72,9 @@ class RuntimeGraph {
   /**
    * @brief Gets output tensors from the graph
    *
-   * Returns the output tensors with the given name.
+   * Returns the output tensors with the given name. With a memory budget
+   * they are the outputs of all micro-batches of the last Forward, in the
+   * order of the inputs.
    *
    * @param output_name Name of the graph output
    * @return Vector of output tensors
@@ -93,6 +101,15 @@ class RuntimeGraph {
    */
   bool is_output_op(const std::string& op_name) const;
 
+  /**
+   * @brief Gets the operators of the graph
+   *
+   * Operators are sorted in execution order after Build.
+   *
+   * @return Vector of runtime operators
+   */
+  const std::vector<std::shared_ptr<RuntimeOperator>>& operators() const;
+
   /**
    * @brief Builds the runtime graph
    *
@@ -139,6 +156,215 @@ class RuntimeGraph {
    */
   void Forward(bool debug = false);
 
+  /**
+   * @brief Gets the number of steps in the execution plan
+   *
+   * @return Number of steps, one per operator after Build
+   */
+  uint32_t execution_step_count() const;
+
+  /**
+   * @brief Executes one step of the execution plan
+   *
+   * Running the steps 0 to execution_step_count() - 1 in order is equivalent
+   * to one Forward. It lets a scheduler interleave the layers of several
+   * graphs.
+   *
+   * @param step_index Index of the step in the execution plan
+   */
+  void ForwardStep(uint32_t step_index);
+
+  /**
+   * @brief Executes only the operators needed for the requested outputs
+   *
+   * Walks up from the requested operators and runs the minimal upstream
+   * subgraph in execution order. Operators with cached outputs are not run,
+   * their tensors are fed to their next operators instead, so nothing above
+   * them runs either. Cached tensors are only read, unless they are the
+   * graph's own output tensors of an operator with an in-place consumer.
+   * Operators inside tiled chains can be neither requested nor cached.
+   *
+   * @param output_names Names of the operators whose outputs are needed, graph outputs included
+   * @param cached_outputs Known output tensors of operators, by operator name
+   * @return Output tensors of the requested operators, by operator name
+   */
+  std::map<std::string, std::vector<sftensor>> PartialForward(
+      const std::vector<std::string>& output_names,
+      const std::map<std::string, std::vector<sftensor>>& cached_outputs = {});
+
+  /**
+   * @brief Enables timing of every operator in Forward
+   *
+   * Times are accumulated over forwards until ResetProfile is called.
+   *
+   * @param profile Whether to time the operators
+   */
+  void set_profile(bool profile);
+
+  /**
+   * @brief Clears the accumulated operator times
+   */
+  void ResetProfile();
+
+  /**
+   * @brief Gets the accumulated forward time of every operator
+   *
+   * @return Times in microseconds, in the order of operators()
+   */
+  const std::vector<double>& profile_times() const;
+
+  /**
+   * @brief Enables depth-first tiled execution
+   *
+   * Chains of layers which feed only each other and support tile windows
+   * (convolution, batchnorm, activations and max pooling) run tile by tile
+   * through a TiledLayerChain, so the intermediate tiles stay in the cache.
+   * It has to be set before Build. A chain is timed as its last operator.
+   *
+   * @param tiled_execution Whether to run layer chains on tiles
+   */
+  void set_tiled_execution(bool tiled_execution);
+
+  /**
+   * @brief Gets the tiled layer chains created by Build
+   *
+   * @return Tiled layer chains in execution order
+   */
+  const std::vector<std::shared_ptr<TiledLayerChain>>& tiled_chains() const;
+
+  /**
+   * @brief Enables NUMA-aware execution
+   *
+   * On machines with more than one NUMA node, Build binds the OpenMP threads
+   * to the nodes round-robin and moves the output tensor of every batch
+   * element to the node of the thread which writes it. With
+   * replicate_weights the layers also keep a copy of their weights on every
+   * node. It has to be set before Build.
+   *
+   * @param numa_aware Whether to place threads and tensors on NUMA nodes
+   * @param replicate_weights Whether to copy the weights to every node
+   */
+  void set_numa_aware(bool numa_aware, bool replicate_weights = false);
+
+  /**
+   * @brief Dumps the output of every operator during Forward
+   *
+   * Output i of an operator is written to <dump_dir>/<operator name>_<i>.npy
+   * right after the operator runs. Operators inside tiled chains are not
+   * dumped, only the output of the chain. An empty directory disables it.
+   *
+   * @param dump_dir Directory of the dumped tensors, created if it is missing
+   */
+  void set_dump_dir(const std::string& dump_dir);
+
+  /**
+   * @brief Enables autotuning of the layer implementations in Build
+   *
+   * Build times every implementation of the tunable layers (convolutions) on
+   * their input shapes and keeps the fastest one. The choices are stored in
+   * the cache file by CPU model and layer signature, so later builds on the
+   * same machine read them instead of timing. It has to be set before Build.
+   *
+   * @param autotune Whether to tune the layers
+   * @param cache_path Path to the tuning cache file, empty to tune without a cache file
+   */
+  void set_autotune(bool autotune, const std::string& cache_path = "");
+
+  /**
+   * @brief Stores the activations kept across layers in 16 bits
+   *
+   * Outputs read by operators further down the execution plan than the next
+   * step, such as the skip connections of UNet and YOLO, are packed into FP16
+   * or BF16 right after their operator runs. Activation, pooling, cat and
+   * upsample layers read the packed values and widen them inside their
+   * kernels. For other layers the values are widened into a float staging
+   * tensor before the layer runs, and staging tensors whose lifetimes do not
+   * overlap share memory, so the resident activations take about half the
+   * memory. The layers still compute in float. Graph outputs and
+   * tensors shared by in-place operators stay in float. It has to be set
+   * before Build, without tiled execution, and the packed outputs are not
+   * kept in the operators' output tensors after Forward.
+   *
+   * @param precision Storage precision of the activations
+   */
+  void set_activation_precision(ActivationPrecision precision);
+
+  /**
+   * @brief Gets the memory of the activations in the execution plan
+   *
+   * Counts every float output and staging tensor once and the 16-bit storage
+   * of the packed outputs, without the graph inputs and the weights.
+   *
+   * @return Size in bytes
+   */
+  size_t activation_bytes() const;
+
+  /**
+   * @brief Gets the activation bytes read and written by one Forward
+   *
+   * Counts what the layers read from their inputs and write to their outputs
+   * at the precision they are stored in, plus the widening of packed inputs
+   * into staging tensors and the packing of outputs. Weights and the scratch
+   * memory of the layers are not counted.
+   *
+   * @return Size in bytes
+   */
+  size_t activation_traffic_bytes() const;
+
+  /**
+   * @brief Splits the execution plan into pipeline stages
+   *
+   * Stage i runs the steps from stage_ends[i - 1] (0 for the first stage) to
+   * stage_ends[i]. Afterwards the steps no longer feed the operators of other
+   * stages and in-place operators no longer share tensors across stages, so
+   * the stages can run different frames at the same time through
+   * ForwardStage. Forward is not available until the stages are removed with
+   * an empty stage_ends. Removing or changing the stages marks the in-place
+   * operators again, so the tensors split off for the stages are released and
+   * the plan is the same as after Build. It has to be called after Build,
+   * without tiled execution.
+   *
+   * @param stage_ends End step of every stage, increasing, the last one equal to
+   * execution_step_count()
+   */
+  void set_pipeline_stages(const std::vector<uint32_t>& stage_ends);
+
+  /**
+   * @brief Runs one pipeline stage on one frame
+   *
+   * The graph inputs and the outputs of earlier stages are read from
+   * frame_tensors by operator name. Outputs read by later stages and the
+   * graph outputs of the stage are copied into it, so every frame owns the
+   * tensors passed between the stages. Different stages may run at the same
+   * time, each stage on one thread at a time.
+   *
+   * @param stage Index of the stage
+   * @param frame_tensors Tensors of the frame, by operator name
+   */
+  void ForwardStage(uint32_t stage, std::map<std::string, std::vector<sftensor>>& frame_tensors);
+
+  /**
+   * @brief Limits the memory of the activations by running micro-batches
+   *
+   * Build estimates the activation memory of one batch element from the
+   * operand shapes and shrinks the batch dimension of the graph to the
+   * largest micro-batch which fits in the budget, at most the batch size of
+   * the model. Forward then splits the tensors passed to set_inputs into
+   * micro-batches, runs them one after another through the same buffers and
+   * gathers the outputs. ForwardStep and PartialForward are not available.
+   * It has to be set before Build, 0 disables it.
+   *
+   * @param budget_bytes Memory budget of the activations in bytes
+   */
+  void set_memory_budget(size_t budget_bytes);
+
+  /**
+   * @brief Gets the micro-batch size chosen by Build
+   *
+   * @return Batch size of one micro-batch, 0 if micro-batching is disabled
+   */
+  uint32_t micro_batch_size() const;
+
  private:
   /**
    * @brief Initializes the graph
@@ -173,6 +399,24 @@ class RuntimeGraph {
    */
   void CreateNodeRelation();
 
+  /**
+   * @brief Removes the operators which no graph output depends on
+   *
+   * Graph inputs are kept even if they are unused, so set_inputs still
+   * accepts them.
+   */
+  void EliminateDeadOperators();
+
+  /**
+   * @brief Evaluates the constant operators once and removes them
+   *
+   * An operator is constant if all of its inputs come from constant
+   * operators, pnnx.Attribute operators being the constant sources. The
+   * outputs of the constant operators are stored in the input operands of
+   * their consumers, which are never overwritten afterwards.
+   */
+  void FoldConstants();
+
   /**
    * @brief Initializes operator inputs
    *
@@ -228,6 +472,89 @@ class RuntimeGraph {
    */
   static std::shared_ptr<Layer<float>> CreateLayer(const std::shared_ptr<RuntimeOperator>& op);
 
+  /**
+   * @brief Marks operators which can run in place
+   *
+   * An operator whose layer supports in-place execution runs in place when its
+   * only input is consumed by no other operator and has the same shape as its
+   * output. The output operand of such an operator aliases its input tensors.
+   * Graph inputs are never overwritten.
+   */
+  void InitInplaceOperators();
+
+  /**
+   * @brief Places threads, weights and output tensors on the NUMA nodes
+   *
+   * Runs before the in-place operators share their output tensors.
+   */
+  void InitNumaPlacement();
+
+  /**
+   * @brief Compiles the flat execution plan
+   *
+   * Binds each operator to its layer, input and output tensor arrays and the
+   * input arrays of its next operators, so Forward runs without looking up
+   * operators by name or locking the layers' runtime operators.
+   */
+  void InitExecutionPlan();
+
+  /**
+   * @brief Validates every step of the execution plan with Layer::Check
+   *
+   * The shapes of all tensors are fixed once the graph is built, so Forward
+   * runs the layers through ForwardUnchecked afterwards. Graph inputs are
+   * checked against the model input shapes in set_inputs instead.
+   */
+  void CheckExecutionPlan();
+
+  /**
+   * @brief Chooses the fastest implementation of every tunable layer
+   *
+   * Runs before the tiled chains copy their layers.
+   */
+  void InitAutotune();
+
+  /**
+   * @brief Groups operators of the execution plan into tiled layer chains
+   *
+   * The last step of a chain runs the whole chain on the inputs of its first
+   * operator, the other steps of the chain are skipped.
+   */
+  void InitTiledChains();
+
+  /**
+   * @brief Plans the 16-bit storage of the activations kept across layers
+   *
+   * Marks the outputs to pack, moves their later consumers to staging
+   * tensors and assigns float tensors by lifetime.
+   */
+  void InitActivationStorage();
+
+  /**
+   * @brief Chooses the micro-batch size and shrinks the batch of the graph to it
+   *
+   * Runs on the pnnx graph before the layers are created. Operands are
+   * batched if they are produced from a graph input and keep its batch size,
+   * the batch parameter of view and reshape operators is patched as well.
+   * Graphs which change the batch dimension are not split.
+   */
+  void InitMicroBatch();
+
+  /**
+   * @brief Runs the micro-batches of the inputs passed to set_inputs
+   *
+   * @param debug Whether to log the time of the steps
+   */
+  void ForwardMicroBatches(bool debug);
+
+  /**
+   * @brief Runs one step of the execution plan and feeds its outputs to the next operators
+   *
+   * @param step_index Index of the step in the execution plan
+   * @param debug Whether to log the time of the step
+   */
+  void RunExecutionStep(uint32_t step_index, bool debug);
+
   /**
    * Propagate output data from current operator to inputs of next operators.
    *
@@ -257,7 +584,81 @@ class RuntimeGraph {
   GraphState graph_state() const;
 
  private:
+  /**
+   * @brief Pre-bound execution step of an operator
+   */
+  struct ExecutionStep {
+    /// Operator executed by this step
+    RuntimeOperator* op = nullptr;
+
+    /// Layer of the operator, nullptr for skipped steps
+    Layer<float>* layer = nullptr;
+
+    /// Graph input and output operators and operators inside tiled chains are skipped
+    bool skip = false;
+
+    /// Inputs come from a graph input and have to be checked
+    bool check_inputs = false;
+
+    /// Tensor arrays of the input operands in input order
+    std::vector<std::vector<sftensor>*> input_datas;
+
+    /// Gathered inputs of operators with more than one input operand
+    std::vector<sftensor> inputs;
+
+    /// Output tensor array of the operator
+    std::vector<sftensor>* output_datas = nullptr;
+
+    /// Input tensor arrays of the next operators fed by this operator
+    std::vector<std::vector<sftensor>*> next_input_datas;
+
+    /// Tiled chain ending at this operator, run instead of the layer
+    TiledLayerChain* tiled_chain = nullptr;
+
+    /// 16-bit storage of the outputs, empty if the outputs stay in float
+    std::vector<HalfTensor> packed_outputs;
+
+    /// Packed outputs of earlier steps to widen into the input tensor arrays
+    std::vector<std::pair<uint32_t, std::vector<sftensor>*>> unpacked_inputs;
+
+    /// Packed outputs read by the layer itself, in input order with nullptr for float inputs
+    std::vector<const HalfTensor*> packed_inputs;
+  };
+
+  /**
+   * @brief Steps of a pipeline stage and the tensors it exchanges with a frame
+   */
+  struct PipelineStage {
+    uint32_t begin = 0;
+    uint32_t end = 0;
+
+    /// Input operands fed from the frame, with the name of their producer
+    std::vector<std::pair<RuntimeOperand*, std::string>> frame_inputs;
+
+    /// Operators whose outputs are read by later stages
+    std::vector<RuntimeOperator*> frame_outputs;
+
+    /// Graph output operators of the stage
+    std::vector<RuntimeOperator*> graph_outputs;
+  };
+
   int32_t start_forward_index_ = 0;
+  bool profile_ = false;
+  std::vector<double> profile_times_;
+  bool tiled_execution_ = false;
+  bool numa_aware_ = false;
+  bool replicate_weights_ = false;
+  std::string dump_dir_;
+  bool autotune_ = false;
+  std::string tuning_cache_path_;
+  ActivationPrecision activation_precision_ = ActivationPrecision::kFP32;
+  size_t memory_budget_ = 0;
+  uint32_t micro_batch_ = 0;
+  std::map<std::string, std::vector<sftensor>> micro_batch_inputs_;
+  std::map<std::string, std::vector<sftensor>> micro_batch_outputs_;
+  std::map<std::string, uint32_t> step_indices_;
+  std::vector<std::shared_ptr<TiledLayerChain>> tiled_chains_;
+  std::vector<PipelineStage> pipeline_stages_;
   std::string bin_path_;
   std::string param_path_;
   std::unique_ptr<pnnx::Graph> graph_;
@@ -266,6 +667,7 @@ class RuntimeGraph {
   std::vector<std::shared_ptr<RuntimeOperator>> input_ops_;
   std::vector<std::shared_ptr<RuntimeOperator>> output_ops_;
   std::vector<std::shared_ptr<RuntimeOperator>> operators_;
+  std::vector<ExecutionStep> execution_plan_;
 };
 
 }  // namespace kuiper_infer
@@ -54,6 +54,9 @@ struct RuntimeOperatorBase {
   /// Whether this operator has run in current execution
   bool has_forward = false;
 
+  /// Whether the output operand aliases the input tensors
+  bool is_inplace = false;
+
   /// Name of the operator
   std::string name;
 
@@ -118,7 +121,7 @@ class RuntimeOperatorUtils<float> {
    * On later runs, checks shape match.
    *
    * @param pnnx_operators Vector of PNNX operators
-   * @param operators Vector of runtime operators
+   * @param operators Vector of runtime operators, matched to the PNNX operators by name
    */
   static void InitOperatorOutput(const std::vector<pnnx::Operator*>& pnnx_operators,
                                  const std::vector<std::shared_ptr<RuntimeOperator>>& operators);
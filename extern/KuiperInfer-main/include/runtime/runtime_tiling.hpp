@@ -0,0 +1,192 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_TILING_HPP_
+#define KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_TILING_HPP_
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "data/tensor.hpp"
+#include "layer/abstract/layer.hpp"
+#include "status_code.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief Spatial size of a tile
+ */
+struct TileSize {
+  uint32_t rows = 0;
+  uint32_t cols = 0;
+};
+
+/**
+ * @brief Depth-first executor of a chain of layers
+ *
+ * Splits the output of the last layer into spatial tiles and runs each tile
+ * through all layers of the chain before starting the next one. The input
+ * window of a tile includes the halo the kernels of the layers read, so the
+ * intermediate tiles stay in the cache instead of streaming whole feature
+ * maps through memory. Tiles of all batch elements run in parallel.
+ */
+class TiledLayerChain {
+ public:
+  /**
+   * @brief Construct a new tiled layer chain
+   *
+   * @param layers Layers of the chain in execution order
+   * @param shapes Shapes (channels, rows, cols) of the chain input followed by
+   * the output shape of every layer
+   * @param batch_size Batch size of the inputs
+   * @param cache_size Cache budget of the tiles of one thread in bytes, 0 to
+   * use half of the L2 cache
+   */
+  TiledLayerChain(const std::vector<std::shared_ptr<Layer<float>>>& layers,
+                  const std::vector<std::vector<uint32_t>>& shapes, uint32_t batch_size,
+                  uint32_t cache_size = 0);
+
+  /**
+   * @brief Runs the chain
+   *
+   * @param inputs Inputs of the first layer
+   * @param outputs Outputs of the last layer
+   * @return Status code
+   */
+  StatusCode Forward(const std::vector<sftensor>& inputs, std::vector<sftensor>& outputs);
+
+  /**
+   * @brief Checks whether a chain of layers can run on tiles
+   *
+   * Every layer has to report a tile window which produces its output shape
+   * from its input shape, with padding smaller than the kernel extent.
+   *
+   * @param layers Layers of the chain in execution order
+   * @param shapes Shapes of the chain input and of every layer output
+   * @return True if the chain can run on tiles
+   */
+  static bool IsTileable(const std::vector<std::shared_ptr<Layer<float>>>& layers,
+                         const std::vector<std::vector<uint32_t>>& shapes);
+
+  /**
+   * @brief Gets the bytes of all tile buffers of one output tile
+   *
+   * @param windows Tile windows of the layers
+   * @param shapes Shapes of the chain input and of every layer output
+   * @param tile_size Size of the output tile
+   * @return Bytes of the input window and the output tile of every layer
+   */
+  static size_t TileWorkingSet(const std::vector<TileWindow>& windows,
+                               const std::vector<std::vector<uint32_t>>& shapes,
+                               const TileSize& tile_size);
+
+  /**
+   * @brief Picks the output tile size of a chain
+   *
+   * Splits the output until the tile buffers fit in the cache budget and
+   * there are at least min_tiles tiles.
+   *
+   * @param windows Tile windows of the layers
+   * @param shapes Shapes of the chain input and of every layer output
+   * @param cache_size Cache budget of the tile buffers in bytes
+   * @param min_tiles Minimum number of tiles
+   * @return Size of the output tiles
+   */
+  static TileSize PlanTileSize(const std::vector<TileWindow>& windows,
+                               const std::vector<std::vector<uint32_t>>& shapes,
+                               size_t cache_size, uint32_t min_tiles = 1);
+
+  /**
+   * @brief Gets the size of the output tiles
+   *
+   * @return Size of the output tiles
+   */
+  const TileSize& tile_size() const;
+
+  /**
+   * @brief Gets the number of output tiles of one batch element
+   *
+   * @return Number of tiles
+   */
+  uint32_t tile_count() const;
+
+ private:
+  /**
+   * @brief Region of one layer in one tile
+   *
+   * The input window can exceed the input map, the part outside is padded.
+   * The output region always lies inside the output map.
+   */
+  struct TileLevel {
+    int32_t input_row_begin = 0;
+    int32_t input_row_end = 0;
+    int32_t input_col_begin = 0;
+    int32_t input_col_end = 0;
+
+    uint32_t output_row_begin = 0;
+    uint32_t output_row_end = 0;
+    uint32_t output_col_begin = 0;
+    uint32_t output_col_end = 0;
+
+    /// Buffer of the padded input window, kNoBuffer if the previous output is the window
+    uint32_t input_buffer = 0;
+
+    /// Buffer of the output tile
+    uint32_t output_buffer = 0;
+  };
+
+  static constexpr uint32_t kNoBuffer = UINT32_MAX;
+
+  /**
+   * @brief Creates the regions and buffers of all tiles
+   */
+  void InitTiles();
+
+  /**
+   * @brief Gets the id of a tile buffer, adding it if it does not exist
+   *
+   * @param slot Buffer slot, a buffer is never shared between two slots
+   * @param shape Shape of the buffer
+   * @return Buffer id
+   */
+  uint32_t FindBuffer(uint32_t slot, const std::vector<uint32_t>& shape);
+
+  /**
+   * @brief Runs one tile of one batch element through the chain
+   */
+  void ForwardTile(const std::vector<TileLevel>& tile, const sftensor& input,
+                   const sftensor& output, std::vector<sftensor>& buffers) const;
+
+  std::vector<std::shared_ptr<Layer<float>>> layers_;
+  std::vector<TileWindow> windows_;
+  std::vector<std::vector<uint32_t>> shapes_;
+  TileSize tile_size_;
+  std::vector<std::vector<TileLevel>> tiles_;
+
+  /// Slot and shape of every buffer id
+  std::vector<std::pair<uint32_t, std::vector<uint32_t>>> buffer_shapes_;
+
+  /// Tile buffers of every thread, created on first use
+  std::vector<std::vector<sftensor>> thread_buffers_;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_RUNTIME_RUNTIME_TILING_HPP_
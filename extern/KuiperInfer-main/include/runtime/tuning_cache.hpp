@@ -0,0 +1,93 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_RUNTIME_TUNING_CACHE_HPP_
+#define KUIPER_INFER_INCLUDE_RUNTIME_TUNING_CACHE_HPP_
+#include <map>
+#include <string>
+#include <utility>
+
+namespace kuiper_infer {
+
+/**
+ * @brief Persistent cache of the implementation chosen for each layer signature
+ *
+ * Every line of the cache file holds the CPU brand, the layer signature and
+ * the name of the chosen implementation, separated by tabs. Entries of other
+ * CPUs are kept when the file is saved, so one file can serve several machines.
+ */
+class TuningCache {
+ public:
+  /**
+   * @brief Construct an empty tuning cache
+   *
+   * @param file_path Path to the cache file
+   */
+  explicit TuningCache(std::string file_path);
+
+  /**
+   * @brief Reads the cache file
+   *
+   * @return True if the file was read, false if it does not exist
+   */
+  bool Load();
+
+  /**
+   * @brief Writes all entries to the cache file
+   *
+   * @return True if the file was written
+   */
+  bool Save() const;
+
+  /**
+   * @brief Looks up the choice of a layer signature on the current CPU
+   *
+   * @param signature Layer signature including the input shapes
+   * @param choice Name of the cached implementation
+   * @return True if the signature is cached
+   */
+  bool Find(const std::string& signature, std::string& choice) const;
+
+  /**
+   * @brief Stores the choice of a layer signature on the current CPU
+   *
+   * @param signature Layer signature including the input shapes
+   * @param choice Name of the chosen implementation
+   */
+  void Insert(const std::string& signature, const std::string& choice);
+
+  /**
+   * @brief Gets the CPU key of the entries of this machine
+   *
+   * @return CPU brand string, "unknown" if it can not be read
+   */
+  static std::string cpu_key();
+
+ private:
+  std::string file_path_;
+  std::string cpu_key_;
+
+  /// (CPU, 层签名) -> 实现名
+  std::map<std::pair<std::string, std::string>, std::string> entries_;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_RUNTIME_TUNING_CACHE_HPP_
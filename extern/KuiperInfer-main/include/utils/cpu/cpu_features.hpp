@@ -0,0 +1,115 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_CPU_FEATURES_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_CPU_FEATURES_HPP_
+#include <cstdint>
+#include <string>
+
+// SIMD内核的多版本编译: 基线编译选项之外的指令集通过target属性生成, 运行时根据cpuid选择
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KUIPER_X86_DISPATCH 1
+#define KUIPER_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define KUIPER_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#define KUIPER_TARGET_F16C __attribute__((target("avx2,fma,f16c")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define KUIPER_X86_DISPATCH 1
+#define KUIPER_TARGET_AVX2
+#define KUIPER_TARGET_AVX512
+#define KUIPER_TARGET_F16C
+#else
+#define KUIPER_X86_DISPATCH 0
+#define KUIPER_TARGET_AVX2
+#define KUIPER_TARGET_AVX512
+#define KUIPER_TARGET_F16C
+#endif
+
+namespace kuiper_infer {
+namespace utils {
+
+/**
+ * @brief Instruction set level of the SIMD kernels
+ */
+enum class CpuIsa {
+  kSSE4 = 0,
+  kAVX2 = 1,   // AVX2 and FMA
+  kAVX512 = 2, // AVX-512F
+};
+
+/**
+ * @brief CPU features reported by cpuid and enabled by the OS
+ */
+struct CpuFeatures {
+  bool sse4_1 = false;
+  bool sse4_2 = false;
+  bool avx = false;
+  bool avx2 = false;
+  bool fma = false;
+  bool f16c = false;
+  bool avx512f = false;
+  bool avx512bw = false;
+  bool avx512dq = false;
+  bool avx512vl = false;
+  bool avx512_bf16 = false;
+
+  /// Size of the L2 cache of one core in bytes, 0 if unknown
+  uint32_t l2_cache_size = 0;
+
+  /// Processor brand string, e.g. "Intel(R) Xeon(R) Gold 6248 CPU @ 2.50GHz"
+  std::string brand;
+};
+
+/**
+ * @brief Gets the features of the current CPU, detected once
+ *
+ * @return CPU features
+ */
+const CpuFeatures& GetCpuFeatures();
+
+/**
+ * @brief Gets the instruction set level used by the SIMD kernels
+ *
+ * The best level supported by the CPU is selected once. The environment
+ * variable KUIPER_CPU_ISA (sse4, avx2 or avx512) can lower it.
+ *
+ * @return Instruction set level
+ */
+CpuIsa GetCpuIsa();
+
+/**
+ * @brief Checks whether the CPU supports an instruction set level
+ *
+ * @param isa Instruction set level
+ * @return True if the kernels of this level can run on the CPU
+ */
+bool IsCpuIsaSupported(CpuIsa isa);
+
+/**
+ * @brief Gets the name of an instruction set level
+ *
+ * @param isa Instruction set level
+ * @return Name of the level
+ */
+const char* CpuIsaName(CpuIsa isa);
+
+}  // namespace utils
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_CPU_FEATURES_HPP_
@@ -0,0 +1,126 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_NUMA_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_NUMA_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kuiper_infer {
+namespace utils {
+
+/**
+ * @brief NUMA nodes of the machine and their CPUs
+ *
+ * Read from /sys/devices/system/node on Linux. Other systems and machines
+ * without NUMA information are reported as a single node.
+ */
+struct NumaTopology {
+  /// System id of every node, as used by the memory policy of the kernel
+  std::vector<uint32_t> node_ids;
+
+  /// CPUs of every node
+  std::vector<std::vector<uint32_t>> node_cpus;
+
+  /// Node of every CPU, -1 for CPUs outside all nodes
+  std::vector<int32_t> cpu_nodes;
+
+  uint32_t node_count() const { return node_cpus.size(); }
+};
+
+/**
+ * @brief Gets the NUMA topology, detected once
+ *
+ * @return NUMA topology
+ */
+const NumaTopology& GetNumaTopology();
+
+/**
+ * @brief Gets the NUMA node of the CPU running the calling thread
+ *
+ * @return Node index, 0 if it is unknown
+ */
+uint32_t GetCurrentNumaNode();
+
+/**
+ * @brief Gets the NUMA node an OpenMP thread is bound to
+ *
+ * Threads are spread over the nodes round-robin, so that the batch elements
+ * processed by threads 0, 1, 2... alternate between the sockets.
+ *
+ * @param thread_index OpenMP thread number
+ * @return Node index
+ */
+uint32_t NumaNodeOfThread(uint32_t thread_index);
+
+/**
+ * @brief Gets the CPUs the process may run on, grouped by NUMA node
+ *
+ * @return CPU ids, those of node 0 first, empty if they are unknown
+ */
+std::vector<uint32_t> GetAvailableCpus();
+
+/**
+ * @brief Binds the calling thread to a set of CPUs
+ *
+ * Threads created by the calling thread afterwards, such as its OpenMP team,
+ * inherit the binding.
+ *
+ * @param cpus CPU ids
+ * @return True if the affinity was set
+ */
+bool BindThreadToCpus(const std::vector<uint32_t>& cpus);
+
+/**
+ * @brief Binds the calling thread to the CPUs of a NUMA node
+ *
+ * @param node Node index
+ * @return True if the affinity was set
+ */
+bool BindThreadToNumaNode(uint32_t node);
+
+/**
+ * @brief Binds every thread of the OpenMP pool to its NUMA node
+ *
+ * Thread i is bound to the CPUs of node NumaNodeOfThread(i). The binding
+ * lasts as long as the pool threads, later parallel regions reuse them.
+ *
+ * @return True if all threads were bound
+ */
+bool BindOmpThreadsToNumaNodes();
+
+/**
+ * @brief Moves the pages of a memory range to a NUMA node
+ *
+ * Only the pages completely inside the range are moved, and later page faults
+ * in the range are served from the node.
+ *
+ * @param ptr Start of the range
+ * @param bytes Size of the range in bytes
+ * @param node Node index
+ * @return True if the pages were moved or the range has no complete page
+ */
+bool MoveToNumaNode(void* ptr, size_t bytes, uint32_t node);
+
+}  // namespace utils
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_NUMA_HPP_
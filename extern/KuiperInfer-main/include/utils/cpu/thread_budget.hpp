@@ -0,0 +1,49 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_THREAD_BUDGET_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_THREAD_BUDGET_HPP_
+#include <omp.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace kuiper_infer {
+namespace utils {
+
+/**
+ * @brief Gets the team size of a parallel loop over independent items
+ *
+ * The team never exceeds the OpenMP thread count of the calling thread, so
+ * a thread given a budget with omp_set_num_threads, such as a worker of the
+ * model manager or a stage of the pipeline executor, keeps the batch loops
+ * of the layers it runs within that budget.
+ *
+ * @param item_count Number of loop iterations
+ * @return Number of threads, at least one
+ */
+inline int ParallelTeamSize(uint32_t item_count) {
+  const uint32_t max_threads = uint32_t(std::max(omp_get_max_threads(), 1));
+  return int(std::max(std::min(item_count, max_threads), 1u));
+}
+
+}  // namespace utils
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_THREAD_BUDGET_HPP_
@@ -0,0 +1,93 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_INCLUDE_UTILS_IMAGE_PREPROCESS_HPP_
+#define KUIPER_INFER_INCLUDE_UTILS_IMAGE_PREPROCESS_HPP_
+#include <array>
+#include <cstdint>
+#include "data/tensor.hpp"
+
+namespace kuiper_infer {
+namespace utils {
+
+/**
+ * @brief Parameters of the fused image preprocessing
+ *
+ * output = (pixel * scale - mean) / std, computed per output channel after
+ * the optional BGR to RGB swap.
+ */
+struct ImagePreprocessParam {
+  /// Keep the aspect ratio and pad the borders, otherwise stretch the image
+  bool letterbox = true;
+
+  /// Allow the letterbox to enlarge images smaller than the target
+  bool scale_up = false;
+
+  /// Border value of the letterbox, in pixel units
+  float pad_value = 114.f;
+
+  /// Swap the first and the third channel of the input image
+  bool bgr_to_rgb = true;
+
+  /// Pixel scale factor
+  float scale = 1.f / 255.f;
+
+  /// Per channel mean and standard deviation, applied after scaling
+  std::array<float, 3> mean{0.f, 0.f, 0.f};
+  std::array<float, 3> std{1.f, 1.f, 1.f};
+};
+
+/**
+ * @brief Geometry of the letterbox, used to map boxes back to the image
+ */
+struct LetterboxInfo {
+  /// Scale from the resized image to the origin image
+  float ratio = 1.f;
+
+  uint32_t pad_top = 0;
+  uint32_t pad_left = 0;
+  uint32_t resized_h = 0;
+  uint32_t resized_w = 0;
+};
+
+/**
+ * @brief Fused image preprocessing into an input tensor
+ *
+ * Resizes (bilinear, half pixel centers), letterboxes, swaps BGR to RGB,
+ * scales and normalizes an interleaved HWC uint8 image, and writes the
+ * result straight into the column-major planes of a 3-channel tensor in
+ * one pass. The output tensor can be reused across frames.
+ *
+ * @param image Pointer to the first pixel of a 3-channel HWC uint8 image
+ * @param image_h Image height
+ * @param image_w Image width
+ * @param image_step Bytes between two image rows
+ * @param param Preprocessing parameters
+ * @param output Tensor of shape (3, target_h, target_w)
+ * @return Letterbox geometry of the written image
+ */
+LetterboxInfo ImagePreprocess(const uint8_t* image, uint32_t image_h, uint32_t image_w,
+                              size_t image_step, const ImagePreprocessParam& param,
+                              const sftensor& output);
+
+}  // namespace utils
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_INCLUDE_UTILS_IMAGE_PREPROCESS_HPP_
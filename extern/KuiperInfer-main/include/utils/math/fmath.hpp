@@ -19,10 +19,19 @@
 
         __m128 fmath::exp_ps(__m128);
         __m256 fmath::exp_ps256(__m256);
+        __m512 fmath::exp_ps512(__m512);
         __m128 fmath::log_ps(__m128);
+        __m256 fmath::log_ps256(__m256);
+        __m512 fmath::log_ps512(__m512);
+
+        the AVX2 and AVX-512 versions are compiled with target attributes, callers
+        have to check the CPU with kuiper_infer::utils::GetCpuIsa
 
         double fmath::expd_v(double *, size_t n);
 
+        expd_v and add_ps_vec select their AVX2 loops with GetCpuIsa, exp_ps and
+        log_ps only use SSE2
+
         if FMATH_USE_XBYAK is defined then Xbyak version are used
 */
 // #define FMATH_USE_XBYAK
@@ -59,6 +68,7 @@
 #ifndef MIE_PACK
 #define MIE_PACK(x, y, z, w) ((x)*64 + (y)*16 + (z)*4 + (w))
 #endif
+#include "utils/cpu/cpu_features.hpp"
 #ifdef FMATH_USE_XBYAK
 #define XBYAK_NO_OP_NAMES
 #include "xbyak/xbyak.h"
@@ -508,17 +518,15 @@ inline __m128d exp_pd(__m128d x) {
 #endif
 }
 
+#if defined(__AVX2__) || KUIPER_X86_DISPATCH
 /*
-        px : pointer to array of double
-        n : size of array
+        px : pointer to array of double, aligned to 32 bytes
+        n : size of array, a multiple of 4
 */
-inline void expd_v(double* px, size_t n) {
+KUIPER_TARGET_AVX2 inline void expd_v_avx2(double* px, size_t n) {
   using namespace local;
   const ExpdVar<>& c = C<>::expdVar;
   const double b = double(3ULL << 51);
-#ifdef __AVX2__
-  size_t r = n & 3;
-  n &= ~3;
   const __m256d mC1 = _mm256_set1_pd(c.C1[0]);
   const __m256d mC2 = _mm256_set1_pd(c.C2[0]);
   const __m256d mC3 = _mm256_set1_pd(c.C3[0]);
@@ -549,7 +557,28 @@ inline void expd_v(double* px, size_t n) {
     _mm256_store_pd(px, _mm256_mul_pd(y, _mm256_castsi256_pd(u)));
     px += 4;
   }
-#else
+}
+#endif
+
+/*
+        px : pointer to array of double
+        n : size of array
+*/
+inline void expd_v(double* px, size_t n) {
+  using namespace local;
+  const ExpdVar<>& c = C<>::expdVar;
+  const double b = double(3ULL << 51);
+#if defined(__AVX2__) || KUIPER_X86_DISPATCH
+  // AVX2的版本按运行时检测到的指令集选择, 剩下不足4个的元素走SSE2的版本
+  static const bool use_avx2 =
+      kuiper_infer::utils::GetCpuIsa() >= kuiper_infer::utils::CpuIsa::kAVX2;
+  if (use_avx2) {
+    const size_t avx2_size = n & ~size_t(3);
+    expd_v_avx2(px, avx2_size);
+    px += avx2_size;
+    n -= avx2_size;
+  }
+#endif
   size_t r = n & 1;
   n &= ~1;
   const __m128d mC1 = _mm_set1_pd(c.C1[0]);
@@ -590,7 +619,6 @@ inline void expd_v(double* px, size_t n) {
     _mm_store_pd(px, _mm_mul_pd(y, _mm_castsi128_pd(u)));
     px += 2;
   }
-#endif
   for (size_t i = 0; i < r; i++) {
     px[i] = expd(px[i]);
   }
@@ -621,10 +649,7 @@ inline __m128 exp_ps(__m128 x)
   u4 = _mm_srli_epi32(u4, expVar.s);
   u4 = _mm_slli_epi32(u4, 23);
 
-#ifdef __AVX2__  // fast?
-  __m128i ti = _mm_i32gather_epi32((const int*)expVar.tbl, v4, 4);
-  __m128 t0 = _mm_castsi128_ps(ti);
-#else
+  // 查表只用SSE2的指令, 支持AVX2的CPU通过GetCpuIsa选择exp_ps256中的gather版本
   unsigned int v0, v1, v2, v3;
   v0 = _mm_cvtsi128_si32(v4);
   v1 = _mm_extract_epi16(v4, 2);
@@ -649,7 +674,6 @@ inline __m128 exp_ps(__m128 x)
   ti = _mm_insert_epi32(ti, expVar.tbl[v2], 2);
   ti = _mm_insert_epi32(ti, expVar.tbl[v3], 3);
   __m128 t0 = _mm_castsi128_ps(ti);
-#endif
 #endif
   t0 = _mm_or_ps(t0, _mm_castsi128_ps(u4));
 
@@ -657,8 +681,8 @@ inline __m128 exp_ps(__m128 x)
 
   return t;
 }
-#ifdef __AVX2__
-inline __m256 exp_ps256(__m256 x) {
+#if defined(__AVX2__) || KUIPER_X86_DISPATCH
+KUIPER_TARGET_AVX2 inline __m256 exp_ps256(__m256 x) {
   using namespace local;
   const ExpVar<>& expVar = C<>::expVar;
 
@@ -707,6 +731,26 @@ inline __m256 exp_ps256(__m256 x) {
 }
 #endif
 
+#if defined(__AVX512F__) || KUIPER_X86_DISPATCH
+KUIPER_TARGET_AVX512 inline __m512 exp_ps512(__m512 x) {
+  using namespace local;
+  const ExpVar<>& expVar = C<>::expVar;
+
+  x = _mm512_min_ps(x, _mm512_set1_ps(expVar.maxX[0]));
+  x = _mm512_max_ps(x, _mm512_set1_ps(expVar.minX[0]));
+  __m512i r = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(expVar.a[0])));
+  __m512 t = _mm512_sub_ps(x, _mm512_mul_ps(_mm512_cvtepi32_ps(r), _mm512_set1_ps(expVar.b[0])));
+  t = _mm512_add_ps(t, _mm512_set1_ps(expVar.f1[0]));
+  __m512i v16 = _mm512_and_si512(r, _mm512_set1_epi32((int)expVar.mask_s[0]));
+  __m512i u16 = _mm512_add_epi32(r, _mm512_set1_epi32((int)expVar.i127s[0]));
+  u16 = _mm512_srli_epi32(u16, expVar.s);
+  u16 = _mm512_slli_epi32(u16, 23);
+  __m512i ti = _mm512_i32gather_epi32(v16, (const int*)expVar.tbl, 4);
+  __m512 t0 = _mm512_castsi512_ps(_mm512_or_si512(ti, u16));
+  return _mm512_mul_ps(t, t0);
+}
+#endif
+
 inline float log(float x) {
   using namespace local;
   const LogVar<>& logVar = C<>::logVar;
@@ -767,6 +811,58 @@ inline __m128 log_ps(__m128 x) {
   return _mm_add_ps(a, rev);
 }
 
+#if defined(__AVX2__) || KUIPER_X86_DISPATCH
+KUIPER_TARGET_AVX2 inline __m256 log_ps256(__m256 x) {
+  using namespace local;
+  const LogVar<>& logVar = C<>::logVar;
+
+  __m256i xi = _mm256_castps_si256(x);
+  __m256i idx = _mm256_srli_epi32(_mm256_and_si256(xi, _mm256_set1_epi32((int)logVar.m2[0])),
+                                  (23 - logVar.LEN));
+  __m256 a = _mm256_cvtepi32_ps(_mm256_sub_epi32(
+      _mm256_and_si256(xi, _mm256_set1_epi32((int)logVar.m1[0])),
+      _mm256_set1_epi32((int)logVar.m5[0])));
+  __m256 b2 = _mm256_cvtepi32_ps(_mm256_and_si256(xi, _mm256_set1_epi32((int)logVar.m3[0])));
+  a = _mm256_mul_ps(a, _mm256_set1_ps(logVar.m4[0]));  // c_log2
+
+  // tbl中app和rev交错存放
+  idx = _mm256_slli_epi32(idx, 1);
+  __m256 app = _mm256_i32gather_ps(&logVar.tbl[0].app, idx, 4);
+  __m256 rev =
+      _mm256_i32gather_ps(&logVar.tbl[0].app, _mm256_add_epi32(idx, _mm256_set1_epi32(1)), 4);
+
+  a = _mm256_add_ps(a, app);
+  rev = _mm256_mul_ps(b2, rev);
+  return _mm256_add_ps(a, rev);
+}
+#endif
+
+#if defined(__AVX512F__) || KUIPER_X86_DISPATCH
+KUIPER_TARGET_AVX512 inline __m512 log_ps512(__m512 x) {
+  using namespace local;
+  const LogVar<>& logVar = C<>::logVar;
+
+  __m512i xi = _mm512_castps_si512(x);
+  __m512i idx = _mm512_srli_epi32(_mm512_and_si512(xi, _mm512_set1_epi32((int)logVar.m2[0])),
+                                  (23 - logVar.LEN));
+  __m512 a = _mm512_cvtepi32_ps(_mm512_sub_epi32(
+      _mm512_and_si512(xi, _mm512_set1_epi32((int)logVar.m1[0])),
+      _mm512_set1_epi32((int)logVar.m5[0])));
+  __m512 b2 = _mm512_cvtepi32_ps(_mm512_and_si512(xi, _mm512_set1_epi32((int)logVar.m3[0])));
+  a = _mm512_mul_ps(a, _mm512_set1_ps(logVar.m4[0]));  // c_log2
+
+  // tbl中app和rev交错存放
+  idx = _mm512_slli_epi32(idx, 1);
+  __m512 app = _mm512_i32gather_ps(idx, &logVar.tbl[0].app, 4);
+  __m512 rev =
+      _mm512_i32gather_ps(_mm512_add_epi32(idx, _mm512_set1_epi32(1)), &logVar.tbl[0].app, 4);
+
+  a = _mm512_add_ps(a, app);
+  rev = _mm512_mul_ps(b2, rev);
+  return _mm512_add_ps(a, rev);
+}
+#endif
+
 #ifndef __CYGWIN__
 // cygwin defines log2() in global namespace!
 // log2(x) = log(x) / log(2)
@@ -840,47 +936,41 @@ inline __m128d log_pd(__m128d x) {
 inline __m128 pow_ps(__m128 x, __m128 y) { return exp_ps(_mm_mul_ps(y, log_ps(x))); }
 inline __m128d pow_pd(__m128d x, __m128d y) { return exp_pd(_mm_mul_pd(y, log_pd(x))); }
 
+#if defined(__AVX2__) || KUIPER_X86_DISPATCH
+/*
+        adds the first n / 8 * 8 elements, returns how many were added
+*/
+KUIPER_TARGET_AVX2 inline size_t add_ps_vec_avx2(const float* arr1, const float* arr2,
+                                                 float* output, size_t n) {
+  const size_t packet_size = 8;
+  size_t j = 0;
+  for (; j + packet_size <= n; j += packet_size) {
+    __m256 _p1 = _mm256_loadu_ps(arr1 + j);
+    __m256 _p2 = _mm256_loadu_ps(arr2 + j);
+    _mm256_storeu_ps(output + j, _mm256_add_ps(_p1, _p2));
+  }
+  return j;
+}
+#endif
+
 inline void add_ps_vec(const float* arr1, size_t n1, const float* arr2, size_t n2, float* output,
                        size_t n3) {
   assert(n1 == n2 && n2 == n3);
   size_t n = n1;
   size_t j = 0;
-#ifdef __AVX2__
-  size_t packet_size = 8;
-  if (n < packet_size) {
-    while (j < n) {
-      output[j] = arr1[j] + arr2[j];
-      j++;
-    }
-    return;
+#if defined(__AVX2__) || KUIPER_X86_DISPATCH
+  static const bool use_avx2 =
+      kuiper_infer::utils::GetCpuIsa() >= kuiper_infer::utils::CpuIsa::kAVX2;
+  if (use_avx2) {
+    j = add_ps_vec_avx2(arr1, arr2, output, n);
   }
-
-  for (j = 0; j <= n - packet_size; j += packet_size) {
-    __m256 _p1 = _mm256_loadu_ps(arr1);
-    __m256 _p2 = _mm256_loadu_ps(arr2);
-    __m256 _result = _mm256_add_ps(_p1, _p2);
-    _mm256_storeu_ps(output, _result);
-    arr1 += packet_size;
-    arr2 += packet_size;
-    output += packet_size;
-  }
-#elif __SSE2__
-  int32_t packet_size = 4;
-  if (n < packet_size) {
-    while (j < n) {
-      output[j] = arr1[j] + arr2[j];
-      j++;
-    }
-    return;
-  }
-  for (j = 0; j <= n - packet_size; j += packet_size) {
-    __m128 _p1 = _mm_loadu_ps(arr1);
-    __m128 _p2 = _mm_loadu_ps(arr2);
-    __m128 _result = _mm_add_ps(_p1, _p2);
-    _mm_storeu_ps(output, _result);
-    arr1 += packet_size;
-    arr2 += packet_size;
-    output += packet_size;
+#endif
+#if __SSE2__
+  const size_t packet_size = 4;
+  for (; j + packet_size <= n; j += packet_size) {
+    __m128 _p1 = _mm_loadu_ps(arr1 + j);
+    __m128 _p2 = _mm_loadu_ps(arr2 + j);
+    _mm_storeu_ps(output + j, _mm_add_ps(_p1, _p2));
   }
 #endif
   while (j < n) {
@@ -26,7 +26,8 @@ namespace kuiper_infer {
 
 template <typename T>
 Tensor<T>::Tensor(uint32_t channels, uint32_t rows, uint32_t cols) {
-  data_ = arma::Cube<T>(rows, cols, channels);
+  data_ = CreateCube(buffer_, rows, cols, channels);
+  data_.zeros();
   if (channels == 1 && rows == 1) {
     this->raw_shapes_ = std::vector<uint32_t>{cols};
   } else if (channels == 1) {
@@ -38,13 +39,15 @@ Tensor<T>::Tensor(uint32_t channels, uint32_t rows, uint32_t cols) {
 
 template <typename T>
 Tensor<T>::Tensor(uint32_t size) {
-  data_ = arma::Cube<T>(1, size, 1);
+  data_ = CreateCube(buffer_, 1, size, 1);
+  data_.zeros();
   this->raw_shapes_ = std::vector<uint32_t>{size};
 }
 
 template <typename T>
 Tensor<T>::Tensor(uint32_t rows, uint32_t cols) {
-  data_ = arma::Cube<T>(rows, cols, 1);
+  data_ = CreateCube(buffer_, rows, cols, 1);
+  data_.zeros();
   if (rows == 1) {
     this->raw_shapes_ = std::vector<uint32_t>{cols};
   } else {
@@ -64,7 +67,8 @@ Tensor<T>::Tensor(const std::vector<uint32_t>& shapes) {
   uint32_t rows = shapes_.at(1);
   uint32_t cols = shapes_.at(2);
 
-  data_ = arma::Cube<T>(rows, cols, channels);
+  data_ = CreateCube(buffer_, rows, cols, channels);
+  data_.zeros();
   if (channels == 1 && rows == 1) {
     this->raw_shapes_ = std::vector<uint32_t>{cols};
   } else if (channels == 1) {
@@ -74,6 +78,76 @@ Tensor<T>::Tensor(const std::vector<uint32_t>& shapes) {
   }
 }
 
+template <typename T>
+Tensor<T>::Tensor(T* raw_ptr, const std::vector<uint32_t>& shapes, std::shared_ptr<void> owner) {
+  CHECK(raw_ptr != nullptr);
+  CHECK(!shapes.empty() && shapes.size() <= 3);
+
+  uint32_t remaining = 3 - shapes.size();
+  std::vector<uint32_t> shapes_(3, 1);
+  std::copy(shapes.begin(), shapes.end(), shapes_.begin() + remaining);
+
+  uint32_t channels = shapes_.at(0);
+  uint32_t rows = shapes_.at(1);
+  uint32_t cols = shapes_.at(2);
+
+  buffer_ = TensorBuffer(raw_ptr, sizeof(T) * channels * rows * cols, std::move(owner));
+  data_ = arma::Cube<T>(raw_ptr, rows, cols, channels, false, false);
+  if (channels == 1 && rows == 1) {
+    this->raw_shapes_ = std::vector<uint32_t>{cols};
+  } else if (channels == 1) {
+    this->raw_shapes_ = std::vector<uint32_t>{rows, cols};
+  } else {
+    this->raw_shapes_ = std::vector<uint32_t>{channels, rows, cols};
+  }
+}
+
+template <typename T>
+Tensor<T>::Tensor(const Tensor& tensor) : raw_shapes_(tensor.raw_shapes_) {
+  if (!tensor.data_.empty()) {
+    data_ = CreateCube(buffer_, tensor.data_.n_rows, tensor.data_.n_cols, tensor.data_.n_slices);
+    std::copy(tensor.data_.memptr(), tensor.data_.memptr() + tensor.data_.n_elem, data_.memptr());
+  }
+}
+
+template <typename T>
+Tensor<T>::Tensor(Tensor&& tensor) noexcept
+    : raw_shapes_(std::move(tensor.raw_shapes_)),
+      buffer_(std::move(tensor.buffer_)),
+      data_(std::move(tensor.data_)) {}
+
+template <typename T>
+Tensor<T>& Tensor<T>::operator=(const Tensor& tensor) {
+  if (this != &tensor) {
+    *this = Tensor<T>(tensor);
+  }
+  return *this;
+}
+
+template <typename T>
+Tensor<T>& Tensor<T>::operator=(Tensor&& tensor) noexcept {
+  if (this != &tensor) {
+    // 先断开对旧内存块的引用, 避免同尺寸的拷贝写入已归还的内存
+    data_.reset();
+    buffer_ = std::move(tensor.buffer_);
+    data_ = std::move(tensor.data_);
+    raw_shapes_ = std::move(tensor.raw_shapes_);
+  }
+  return *this;
+}
+
+template <typename T>
+arma::Cube<T> Tensor<T>::CreateCube(TensorBuffer& buffer, uint32_t rows, uint32_t cols,
+                                    uint32_t channels) {
+  const size_t size = (size_t)rows * cols * channels;
+  if (size == 0) {
+    buffer.Release();
+    return arma::Cube<T>(rows, cols, channels);
+  }
+  buffer = TensorBuffer(sizeof(T) * size);
+  return arma::Cube<T>(static_cast<T*>(buffer.data()), rows, cols, channels, false, false);
+}
+
 template <typename T>
 uint32_t Tensor<T>::rows() const {
   CHECK(!this->data_.empty());
@@ -176,13 +250,16 @@ void Tensor<T>::Padding(const std::vector<uint32_t>& pads, T padding_value) {
   uint32_t pad_cols1 = pads.at(2);  // left
   uint32_t pad_cols2 = pads.at(3);  // right
 
-  arma::Cube<T> new_data(this->data_.n_rows + pad_rows1 + pad_rows2,
-                         this->data_.n_cols + pad_cols1 + pad_cols2, this->data_.n_slices);
+  TensorBuffer new_buffer;
+  arma::Cube<T> new_data =
+      CreateCube(new_buffer, this->data_.n_rows + pad_rows1 + pad_rows2,
+                 this->data_.n_cols + pad_cols1 + pad_cols2, this->data_.n_slices);
   new_data.fill(padding_value);
 
   new_data.subcube(pad_rows1, pad_cols1, 0, new_data.n_rows - pad_rows2 - 1,
                    new_data.n_cols - pad_cols2 - 1, new_data.n_slices - 1) = this->data_;
   this->data_ = std::move(new_data);
+  this->buffer_ = std::move(new_buffer);
   this->raw_shapes_ = std::vector<uint32_t>{this->channels(), this->rows(), this->cols()};
 }
 
@@ -388,6 +465,9 @@ void Tensor<T>::set_data(arma::Cube<T>&& data) {
   CHECK(data.n_cols == this->data_.n_cols) << data.n_cols << " != " << this->data_.n_cols;
   CHECK(data.n_slices == this->data_.n_slices) << data.n_slices << " != " << this->data_.n_slices;
   this->data_ = std::move(data);
+  if (this->data_.memptr() != this->buffer_.data()) {
+    this->buffer_.Release();
+  }
 }
 
 template <typename T>
@@ -399,7 +479,8 @@ void Tensor<T>::Review(const std::vector<uint32_t>& shapes) {
   const uint32_t target_cols = shapes.at(2);
 
   CHECK_EQ(this->data_.size(), target_channels * target_cols * target_rows);
-  arma::Cube<T> new_data(target_rows, target_cols, target_channels);
+  TensorBuffer new_buffer;
+  arma::Cube<T> new_data = CreateCube(new_buffer, target_rows, target_cols, target_channels);
   const uint32_t plane_size = target_rows * target_cols;
 #pragma omp parallel for
   for (uint32_t channel = 0; channel < this->data_.n_slices; ++channel) {
@@ -417,6 +498,7 @@ void Tensor<T>::Review(const std::vector<uint32_t>& shapes) {
     }
   }
   this->data_ = std::move(new_data);
+  this->buffer_ = std::move(new_buffer);
 }
 
 template class Tensor<float>;
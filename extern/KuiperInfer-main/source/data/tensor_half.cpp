@@ -0,0 +1,342 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "data/tensor_half.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cstring>
+#include "utils/cpu/cpu_features.hpp"
+#include "utils/cpu/thread_budget.hpp"
+#if KUIPER_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace kuiper_infer {
+static uint32_t FloatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static float BitsFloat(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static uint16_t FloatToFP16(float value) {
+  uint32_t bits = FloatBits(value);
+  const uint32_t sign = bits & 0x80000000u;
+  bits ^= sign;
+  uint16_t half;
+  if (bits >= (127u + 16u) << 23) {
+    // 超出半精度范围的值变为无穷大, NaN与F16C一样保留高位的负载并置静默位
+    half = bits > 0x7f800000u ? uint16_t(0x7e00u | ((bits & 0x7fffffu) >> 13)) : 0x7c00u;
+  } else if (bits < 113u << 23) {
+    // 非规格化数: 借助浮点加法完成移位和舍入
+    const uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    half = uint16_t(FloatBits(BitsFloat(bits) + BitsFloat(denorm_magic)) - denorm_magic);
+  } else {
+    const uint32_t mantissa_odd = (bits >> 13) & 1u;
+    bits += ((15u - 127u) << 23) + 0xfffu + mantissa_odd;
+    half = uint16_t(bits >> 13);
+  }
+  return half | uint16_t(sign >> 16);
+}
+
+static float FP16ToFloat(uint16_t half) {
+  const uint32_t shifted_exponent = 0x7c00u << 13;
+  uint32_t bits = (half & 0x7fffu) << 13;
+  const uint32_t exponent = bits & shifted_exponent;
+  bits += (127u - 15u) << 23;
+  if (exponent == shifted_exponent) {
+    bits += (128u - 16u) << 23;
+  } else if (exponent == 0) {
+    bits += 1u << 23;
+    bits = FloatBits(BitsFloat(bits) - BitsFloat(113u << 23));
+  }
+  return BitsFloat(bits | (uint32_t(half & 0x8000u) << 16));
+}
+
+static uint16_t FloatToBF16(float value) {
+  const uint32_t bits = FloatBits(value);
+  if ((bits & 0x7fffffffu) > 0x7f800000u) {
+    return uint16_t((bits | 0x00400000u) >> 16);
+  }
+  return uint16_t((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+}
+
+static float BF16ToFloat(uint16_t half) { return BitsFloat(uint32_t(half) << 16); }
+
+#if KUIPER_X86_DISPATCH
+KUIPER_TARGET_F16C static size_t FloatToFP16F16C(const float* input, uint16_t* output,
+                                                 size_t size) {
+  size_t i = 0;
+  for (; i + 7 < size; i += 8) {
+    const __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(input + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128((__m128i*)(output + i), half);
+  }
+  return i;
+}
+
+KUIPER_TARGET_F16C static size_t FP16ToFloatF16C(const uint16_t* input, float* output,
+                                                 size_t size) {
+  size_t i = 0;
+  for (; i + 7 < size; i += 8) {
+    _mm256_storeu_ps(output + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(input + i))));
+  }
+  return i;
+}
+
+KUIPER_TARGET_AVX512 static size_t FloatToFP16AVX512(const float* input, uint16_t* output,
+                                                     size_t size) {
+  size_t i = 0;
+  for (; i + 15 < size; i += 16) {
+    const __m256i half = _mm512_cvtps_ph(_mm512_loadu_ps(input + i),
+                                         _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    _mm256_storeu_si256((__m256i*)(output + i), half);
+  }
+  return i;
+}
+
+KUIPER_TARGET_AVX512 static size_t FP16ToFloatAVX512(const uint16_t* input, float* output,
+                                                     size_t size) {
+  size_t i = 0;
+  for (; i + 15 < size; i += 16) {
+    _mm512_storeu_ps(output + i,
+                     _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(input + i))));
+  }
+  return i;
+}
+
+// bfloat16没有F16C指令, 用整数加法实现就近舍入, NaN只置静默位
+KUIPER_TARGET_AVX2 static size_t FloatToBF16AVX2(const float* input, uint16_t* output,
+                                                 size_t size) {
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i bias = _mm256_set1_epi32(0x7fff);
+  const __m256i quiet_bit = _mm256_set1_epi32(0x00400000);
+  size_t i = 0;
+  for (; i + 7 < size; i += 8) {
+    const __m256 value = _mm256_loadu_ps(input + i);
+    const __m256i bits = _mm256_castps_si256(value);
+    const __m256i odd = _mm256_and_si256(_mm256_srli_epi32(bits, 16), one);
+    __m256i rounded = _mm256_add_epi32(bits, _mm256_add_epi32(bias, odd));
+    const __m256i nan_mask = _mm256_castps_si256(_mm256_cmp_ps(value, value, _CMP_UNORD_Q));
+    rounded = _mm256_blendv_epi8(rounded, _mm256_or_si256(bits, quiet_bit), nan_mask);
+    rounded = _mm256_srli_epi32(rounded, 16);
+    const __m128i half = _mm_packus_epi32(_mm256_castsi256_si128(rounded),
+                                          _mm256_extracti128_si256(rounded, 1));
+    _mm_storeu_si128((__m128i*)(output + i), half);
+  }
+  return i;
+}
+
+KUIPER_TARGET_AVX2 static size_t BF16ToFloatAVX2(const uint16_t* input, float* output,
+                                                 size_t size) {
+  size_t i = 0;
+  for (; i + 7 < size; i += 8) {
+    const __m256i bits =
+        _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(input + i)));
+    _mm256_storeu_ps(output + i, _mm256_castsi256_ps(_mm256_slli_epi32(bits, 16)));
+  }
+  return i;
+}
+
+KUIPER_TARGET_AVX512 static size_t FloatToBF16AVX512(const float* input, uint16_t* output,
+                                                     size_t size) {
+  const __m512i one = _mm512_set1_epi32(1);
+  const __m512i bias = _mm512_set1_epi32(0x7fff);
+  const __m512i quiet_bit = _mm512_set1_epi32(0x00400000);
+  size_t i = 0;
+  for (; i + 15 < size; i += 16) {
+    const __m512 value = _mm512_loadu_ps(input + i);
+    const __m512i bits = _mm512_castps_si512(value);
+    const __m512i odd = _mm512_and_si512(_mm512_srli_epi32(bits, 16), one);
+    __m512i rounded = _mm512_add_epi32(bits, _mm512_add_epi32(bias, odd));
+    const __mmask16 nan_mask = _mm512_cmp_ps_mask(value, value, _CMP_UNORD_Q);
+    rounded = _mm512_mask_mov_epi32(rounded, nan_mask, _mm512_or_si512(bits, quiet_bit));
+    const __m256i half = _mm512_cvtepi32_epi16(_mm512_srli_epi32(rounded, 16));
+    _mm256_storeu_si256((__m256i*)(output + i), half);
+  }
+  return i;
+}
+
+KUIPER_TARGET_AVX512 static size_t BF16ToFloatAVX512(const uint16_t* input, float* output,
+                                                     size_t size) {
+  size_t i = 0;
+  for (; i + 15 < size; i += 16) {
+    const __m512i bits =
+        _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(input + i)));
+    _mm512_storeu_ps(output + i, _mm512_castsi512_ps(_mm512_slli_epi32(bits, 16)));
+  }
+  return i;
+}
+#endif
+
+const char* ActivationPrecisionName(ActivationPrecision precision) {
+  switch (precision) {
+    case ActivationPrecision::kFP16:
+      return "fp16";
+    case ActivationPrecision::kBF16:
+      return "bf16";
+    default:
+      return "fp32";
+  }
+}
+
+void FloatToHalfSpan(const float* input, uint16_t* output, size_t size,
+                     ActivationPrecision precision) {
+  CHECK(precision != ActivationPrecision::kFP32);
+  size_t i = 0;
+  if (precision == ActivationPrecision::kFP16) {
+#if KUIPER_X86_DISPATCH
+    static const utils::CpuIsa isa = utils::GetCpuIsa();
+    static const bool use_f16c = isa >= utils::CpuIsa::kAVX2 && utils::GetCpuFeatures().f16c;
+    if (isa >= utils::CpuIsa::kAVX512) {
+      i = FloatToFP16AVX512(input, output, size);
+    } else if (use_f16c) {
+      i = FloatToFP16F16C(input, output, size);
+    }
+#endif
+    for (; i < size; ++i) {
+      output[i] = FloatToFP16(input[i]);
+    }
+  } else {
+#if KUIPER_X86_DISPATCH
+    static const utils::CpuIsa isa = utils::GetCpuIsa();
+    if (isa >= utils::CpuIsa::kAVX512) {
+      i = FloatToBF16AVX512(input, output, size);
+    } else if (isa >= utils::CpuIsa::kAVX2) {
+      i = FloatToBF16AVX2(input, output, size);
+    }
+#endif
+    for (; i < size; ++i) {
+      output[i] = FloatToBF16(input[i]);
+    }
+  }
+}
+
+void HalfToFloatSpan(const uint16_t* input, float* output, size_t size,
+                     ActivationPrecision precision) {
+  CHECK(precision != ActivationPrecision::kFP32);
+  size_t i = 0;
+  if (precision == ActivationPrecision::kFP16) {
+#if KUIPER_X86_DISPATCH
+    static const utils::CpuIsa isa = utils::GetCpuIsa();
+    static const bool use_f16c = isa >= utils::CpuIsa::kAVX2 && utils::GetCpuFeatures().f16c;
+    if (isa >= utils::CpuIsa::kAVX512) {
+      i = FP16ToFloatAVX512(input, output, size);
+    } else if (use_f16c) {
+      i = FP16ToFloatF16C(input, output, size);
+    }
+#endif
+    for (; i < size; ++i) {
+      output[i] = FP16ToFloat(input[i]);
+    }
+  } else {
+#if KUIPER_X86_DISPATCH
+    static const utils::CpuIsa isa = utils::GetCpuIsa();
+    if (isa >= utils::CpuIsa::kAVX512) {
+      i = BF16ToFloatAVX512(input, output, size);
+    } else if (isa >= utils::CpuIsa::kAVX2) {
+      i = BF16ToFloatAVX2(input, output, size);
+    }
+#endif
+    for (; i < size; ++i) {
+      output[i] = BF16ToFloat(input[i]);
+    }
+  }
+}
+
+// 按块并行转换, 每块的数据量足够大以摊薄线程调度的开销
+static constexpr size_t kConvertBlockSize = 1 << 16;
+
+void HalfTensor::Pack(const sftensor& tensor, ActivationPrecision precision) {
+  CHECK(tensor != nullptr && !tensor->empty()) << "Pack an empty tensor";
+  CHECK(precision != ActivationPrecision::kFP32);
+  precision_ = precision;
+  shapes_ = tensor->shapes();
+  data_.resize(tensor->size());
+
+  const float* input = tensor->raw_ptr();
+  const size_t size = data_.size();
+  const int64_t block_count = int64_t((size + kConvertBlockSize - 1) / kConvertBlockSize);
+#pragma omp parallel for if (block_count > 1)
+  for (int64_t block = 0; block < block_count; ++block) {
+    const size_t offset = size_t(block) * kConvertBlockSize;
+    FloatToHalfSpan(input + offset, data_.data() + offset,
+                    std::min(kConvertBlockSize, size - offset), precision_);
+  }
+}
+
+void HalfTensor::Reshape(const std::vector<uint32_t>& shapes, ActivationPrecision precision) {
+  CHECK(shapes.size() == 3) << "The shape of a half tensor has three dimensions";
+  CHECK(precision != ActivationPrecision::kFP32);
+  precision_ = precision;
+  shapes_ = shapes;
+  data_.resize(size_t(shapes.at(0)) * shapes.at(1) * shapes.at(2));
+}
+
+void HalfTensor::UnpackSpan(size_t offset, size_t size, float* output) const {
+  CHECK(offset + size <= data_.size()) << "The span is out of the half tensor";
+  HalfToFloatSpan(data_.data() + offset, output, size, precision_);
+}
+
+void HalfTensor::Unpack(const sftensor& tensor) const {
+  CHECK(tensor != nullptr && tensor->shapes() == shapes_)
+      << "The tensor does not match the shape of the half tensor";
+  Unpack(tensor->raw_ptr());
+}
+
+void HalfTensor::Unpack(float* output) const {
+  const size_t size = data_.size();
+  const int64_t block_count = int64_t((size + kConvertBlockSize - 1) / kConvertBlockSize);
+#pragma omp parallel for if (block_count > 1)
+  for (int64_t block = 0; block < block_count; ++block) {
+    const size_t offset = size_t(block) * kConvertBlockSize;
+    HalfToFloatSpan(data_.data() + offset, output + offset,
+                    std::min(kConvertBlockSize, size - offset), precision_);
+  }
+}
+
+void ForEachInputChannel(const sftensor& input, const HalfTensor* packed_input,
+                         const std::function<void(uint32_t, const float*)>& kernel) {
+  CHECK(packed_input != nullptr || (input != nullptr && !input->empty()))
+      << "The input of the channel kernel is empty";
+  const std::vector<uint32_t> shapes =
+      packed_input != nullptr ? packed_input->shapes() : input->shapes();
+  const uint32_t channels = shapes.at(0);
+  const size_t plane_size = size_t(shapes.at(1)) * shapes.at(2);
+#pragma omp parallel num_threads(utils::ParallelTeamSize(channels))
+  {
+    std::vector<float> channel_buffer(packed_input != nullptr ? plane_size : 0);
+#pragma omp for
+    for (uint32_t c = 0; c < channels; ++c) {
+      if (packed_input != nullptr) {
+        packed_input->UnpackSpan(c * plane_size, plane_size, channel_buffer.data());
+        kernel(c, channel_buffer.data());
+      } else {
+        kernel(c, input->raw_ptr(c * plane_size));
+      }
+    }
+  }
+}
+}  // namespace kuiper_infer
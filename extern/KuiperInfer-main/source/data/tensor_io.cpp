@@ -0,0 +1,396 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "data/tensor_io.hpp"
+#include <glog/logging.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace kuiper_infer {
+namespace {
+/**
+ * @brief Private memory mapping of a whole file
+ *
+ * Pages are copied on write, so tensors on the mapping can be modified in
+ * place without changing the file.
+ */
+class MappedFile {
+ public:
+  static std::shared_ptr<MappedFile> Open(const std::string& file_path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      LOG(ERROR) << "File open failed: " << file_path;
+      return nullptr;
+    }
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+      LOG(ERROR) << "File is empty: " << file_path;
+      CloseHandle(file);
+      return nullptr;
+    }
+    const size_t size = size_t(file_size.QuadPart);
+    // PAGE_WRITECOPY和FILE_MAP_COPY对应MAP_PRIVATE, 写入时复制页面
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+      LOG(ERROR) << "File mmap failed: " << file_path;
+      return nullptr;
+    }
+    // 映射视图会保持映射对象有效
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == nullptr) {
+      LOG(ERROR) << "File mmap failed: " << file_path;
+      return nullptr;
+    }
+#else
+    const int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      LOG(ERROR) << "File open failed: " << file_path;
+      return nullptr;
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+      LOG(ERROR) << "File is empty: " << file_path;
+      close(fd);
+      return nullptr;
+    }
+    const size_t size = size_t(file_stat.st_size);
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      LOG(ERROR) << "File mmap failed: " << file_path;
+      return nullptr;
+    }
+#endif
+    return std::shared_ptr<MappedFile>(new MappedFile(data, size));
+  }
+
+  ~MappedFile() {
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap(data_, size_);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  char* data() const { return static_cast<char*>(data_); }
+
+  size_t size() const { return size_; }
+
+ private:
+  MappedFile(void* data, size_t size) : data_(data), size_(size) {}
+
+  void* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+struct NpyHeader {
+  std::string descr;
+  bool fortran_order = false;
+  std::vector<uint64_t> shapes;
+  size_t data_offset = 0;
+};
+
+template <typename T>
+const char* NpyDescr();
+
+template <>
+const char* NpyDescr<float>() {
+  return "<f4";
+}
+
+template <>
+const char* NpyDescr<int32_t>() {
+  return "<i4";
+}
+
+template <>
+const char* NpyDescr<uint8_t>() {
+  return "|u1";
+}
+
+/// 查找字典中键对应的值的起始位置
+size_t FindNpyValue(const std::string& dict, const std::string& key) {
+  size_t pos = dict.find("'" + key + "'");
+  CHECK(pos != std::string::npos) << "Can not find the key " << key << " in the npy header";
+  pos = dict.find(':', pos);
+  CHECK(pos != std::string::npos) << "The npy header is broken";
+  pos = dict.find_first_not_of(' ', pos + 1);
+  CHECK(pos != std::string::npos) << "The npy header is broken";
+  return pos;
+}
+
+NpyHeader ParseNpyHeader(const MappedFile& file, const std::string& file_path) {
+  const char* data = file.data();
+  CHECK(file.size() >= 10 && std::memcmp(data, "\x93NUMPY", 6) == 0)
+      << "The file is not a npy file: " << file_path;
+
+  // 1.0版本的头部长度为2字节, 2.0和3.0版本为4字节
+  const uint8_t major_version = uint8_t(data[6]);
+  size_t dict_offset = 10;
+  size_t dict_length = uint8_t(data[8]) | (size_t(uint8_t(data[9])) << 8);
+  if (major_version >= 2) {
+    CHECK_GE(file.size(), 12);
+    dict_offset = 12;
+    dict_length |= (size_t(uint8_t(data[10])) << 16) | (size_t(uint8_t(data[11])) << 24);
+  }
+  CHECK_LE(dict_offset + dict_length, file.size()) << "The npy header is broken: " << file_path;
+  const std::string dict(data + dict_offset, dict_length);
+
+  NpyHeader header;
+  header.data_offset = dict_offset + dict_length;
+
+  size_t pos = FindNpyValue(dict, "descr");
+  const char quote = dict.at(pos);
+  const size_t descr_end = dict.find(quote, pos + 1);
+  CHECK(descr_end != std::string::npos) << "The npy header is broken: " << file_path;
+  header.descr = dict.substr(pos + 1, descr_end - pos - 1);
+
+  pos = FindNpyValue(dict, "fortran_order");
+  header.fortran_order = dict.compare(pos, 4, "True") == 0;
+
+  pos = FindNpyValue(dict, "shape");
+  const size_t shape_end = dict.find(')', pos);
+  CHECK(dict.at(pos) == '(' && shape_end != std::string::npos)
+      << "The npy header is broken: " << file_path;
+  const char* shape_str = dict.c_str() + pos + 1;
+  while (true) {
+    char* end = nullptr;
+    const uint64_t dim = std::strtoull(shape_str, &end, 10);
+    if (end == shape_str) {
+      break;
+    }
+    header.shapes.push_back(dim);
+    shape_str = end;
+    while (*shape_str == ',' || *shape_str == ' ') {
+      shape_str += 1;
+    }
+  }
+  return header;
+}
+
+std::string CreateNpyHeader(const char* descr, const std::vector<uint32_t>& shapes) {
+  std::string dict = "{'descr': '" + std::string(descr) + "', 'fortran_order': False, 'shape': (";
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    dict += std::to_string(shapes.at(i));
+    if (shapes.size() == 1 || i + 1 < shapes.size()) {
+      dict += ",";
+    }
+    if (i + 1 < shapes.size()) {
+      dict += " ";
+    }
+  }
+  dict += "), }";
+
+  // 数据的起始位置按64字节对齐, 头部以换行符结束
+  const size_t header_length = 10 + dict.size() + 1;
+  dict.append((64 - header_length % 64) % 64, ' ');
+  dict += '\n';
+  CHECK_LE(dict.size(), 65535);
+
+  std::string header = "\x93NUMPY";
+  header += char(1);
+  header += char(0);
+  header += char(dict.size() & 0xff);
+  header += char((dict.size() >> 8) & 0xff);
+  return header + dict;
+}
+
+template <typename T>
+bool WriteTensorData(std::ofstream& out, const std::shared_ptr<Tensor<T>>& tensor) {
+  const uint32_t rows = tensor->rows();
+  const uint32_t cols = tensor->cols();
+  if (rows == 1 || cols == 1) {
+    out.write(reinterpret_cast<const char*>(tensor->raw_ptr()), tensor->size() * sizeof(T));
+  } else {
+    // 按行优先的顺序写出每个通道
+    arma::Mat<T> channel_t(cols, rows);
+    for (uint32_t c = 0; c < tensor->channels(); ++c) {
+      channel_t = tensor->slice(c).t();
+      out.write(reinterpret_cast<const char*>(channel_t.memptr()), channel_t.n_elem * sizeof(T));
+    }
+  }
+  return out.good();
+}
+}  // namespace
+
+template <typename T>
+std::shared_ptr<Tensor<T>> TensorLoadNpy(const std::string& file_path, bool zero_copy) {
+  std::shared_ptr<MappedFile> file = MappedFile::Open(file_path);
+  if (file == nullptr) {
+    return nullptr;
+  }
+
+  NpyHeader header = ParseNpyHeader(*file, file_path);
+  CHECK(header.descr == NpyDescr<T>())
+      << "The data type " << header.descr << " of the npy file does not match the tensor type "
+      << NpyDescr<T>() << ": " << file_path;
+  if (header.shapes.size() == 4 && header.shapes.front() == 1) {
+    header.shapes.erase(header.shapes.begin());
+  }
+  CHECK_LE(header.shapes.size(), 3) << "Unsupported npy dimensions: " << file_path;
+
+  std::vector<uint32_t> shapes(3, 1);
+  for (size_t i = 0; i < header.shapes.size(); ++i) {
+    const uint64_t dim = header.shapes.at(i);
+    CHECK(dim > 0 && dim <= UINT32_MAX) << "Unsupported npy shape: " << file_path;
+    shapes.at(3 - header.shapes.size() + i) = uint32_t(dim);
+  }
+  const uint32_t channels = shapes.at(0);
+  const uint32_t rows = shapes.at(1);
+  const uint32_t cols = shapes.at(2);
+  const size_t size = size_t(channels) * rows * cols;
+  CHECK_LE(header.data_offset + size * sizeof(T), file->size())
+      << "The npy file is truncated: " << file_path;
+
+  T* data = reinterpret_cast<T*>(file->data() + header.data_offset);
+  // 张量的维数和数组相同, 0维数组作为一个元素的向量
+  const size_t dims = std::max<size_t>(header.shapes.size(), 1);
+  const std::vector<uint32_t> tensor_shapes(shapes.end() - dims, shapes.end());
+  // 行优先时只有一行或一列, 列优先时只有一个通道, 布局和张量相同
+  const bool same_layout = header.fortran_order ? channels == 1 : (rows == 1 || cols == 1);
+  if (zero_copy && same_layout && reinterpret_cast<uintptr_t>(data) % alignof(T) == 0) {
+    return std::make_shared<Tensor<T>>(data, tensor_shapes, std::move(file));
+  }
+
+  auto tensor = std::make_shared<Tensor<T>>(tensor_shapes);
+  if (same_layout) {
+    std::memcpy(tensor->raw_ptr(), data, size * sizeof(T));
+  } else if (!header.fortran_order) {
+    for (uint32_t c = 0; c < channels; ++c) {
+      const arma::Mat<T> channel_t(data + size_t(c) * rows * cols, cols, rows, false, true);
+      tensor->slice(c) = channel_t.t();
+    }
+  } else {
+    for (uint32_t c = 0; c < channels; ++c) {
+      arma::Mat<T>& channel = tensor->slice(c);
+      for (uint32_t w = 0; w < cols; ++w) {
+        for (uint32_t h = 0; h < rows; ++h) {
+          channel.at(h, w) = data[c + size_t(channels) * (h + size_t(rows) * w)];
+        }
+      }
+    }
+  }
+  return tensor;
+}
+
+template <typename T>
+bool TensorSaveNpy(const std::shared_ptr<Tensor<T>>& tensor, const std::string& file_path) {
+  CHECK(tensor != nullptr && !tensor->empty()) << "The tensor to save is empty";
+  std::ofstream out(file_path, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    LOG(ERROR) << "File open failed: " << file_path;
+    return false;
+  }
+  const std::string& header = CreateNpyHeader(NpyDescr<T>(), tensor->raw_shapes());
+  out.write(header.data(), header.size());
+  return WriteTensorData(out, tensor);
+}
+
+template <typename T>
+std::shared_ptr<Tensor<T>> TensorLoadRaw(const std::string& file_path,
+                                         const std::vector<uint32_t>& shapes, bool zero_copy) {
+  std::shared_ptr<MappedFile> file = MappedFile::Open(file_path);
+  if (file == nullptr) {
+    return nullptr;
+  }
+  CHECK(!shapes.empty() && shapes.size() <= 3);
+  size_t size = 1;
+  for (uint32_t dim : shapes) {
+    size *= dim;
+  }
+  CHECK_EQ(size * sizeof(T), file->size())
+      << "The size of the raw file does not match the tensor shapes: " << file_path;
+
+  T* data = reinterpret_cast<T*>(file->data());
+  if (zero_copy) {
+    return std::make_shared<Tensor<T>>(data, shapes, std::move(file));
+  }
+  auto tensor = std::make_shared<Tensor<T>>(shapes);
+  std::memcpy(tensor->raw_ptr(), data, size * sizeof(T));
+  return tensor;
+}
+
+template <typename T>
+bool TensorSaveRaw(const std::shared_ptr<Tensor<T>>& tensor, const std::string& file_path) {
+  CHECK(tensor != nullptr && !tensor->empty()) << "The tensor to save is empty";
+  std::ofstream out(file_path, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    LOG(ERROR) << "File open failed: " << file_path;
+    return false;
+  }
+  out.write(reinterpret_cast<const char*>(tensor->raw_ptr()), tensor->size() * sizeof(T));
+  return out.good();
+}
+
+template std::shared_ptr<Tensor<float>> TensorLoadNpy(const std::string& file_path,
+                                                      bool zero_copy);
+template std::shared_ptr<Tensor<int32_t>> TensorLoadNpy(const std::string& file_path,
+                                                        bool zero_copy);
+template std::shared_ptr<Tensor<uint8_t>> TensorLoadNpy(const std::string& file_path,
+                                                        bool zero_copy);
+
+template bool TensorSaveNpy(const std::shared_ptr<Tensor<float>>& tensor,
+                            const std::string& file_path);
+template bool TensorSaveNpy(const std::shared_ptr<Tensor<int32_t>>& tensor,
+                            const std::string& file_path);
+template bool TensorSaveNpy(const std::shared_ptr<Tensor<uint8_t>>& tensor,
+                            const std::string& file_path);
+
+template std::shared_ptr<Tensor<float>> TensorLoadRaw(const std::string& file_path,
+                                                      const std::vector<uint32_t>& shapes,
+                                                      bool zero_copy);
+template std::shared_ptr<Tensor<int32_t>> TensorLoadRaw(const std::string& file_path,
+                                                        const std::vector<uint32_t>& shapes,
+                                                        bool zero_copy);
+template std::shared_ptr<Tensor<uint8_t>> TensorLoadRaw(const std::string& file_path,
+                                                        const std::vector<uint32_t>& shapes,
+                                                        bool zero_copy);
+
+template bool TensorSaveRaw(const std::shared_ptr<Tensor<float>>& tensor,
+                            const std::string& file_path);
+template bool TensorSaveRaw(const std::shared_ptr<Tensor<int32_t>>& tensor,
+                            const std::string& file_path);
+template bool TensorSaveRaw(const std::shared_ptr<Tensor<uint8_t>>& tensor,
+                            const std::string& file_path);
+}  // namespace kuiper_infer
@@ -0,0 +1,342 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "data/tensor_memory.hpp"
+#include <glog/logging.h>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace kuiper_infer {
+
+// 每个2的幂次区间划分为4个大小等级, 最大支持2^48字节
+static constexpr uint32_t kSubClassCount = 4;
+static constexpr uint32_t kSmallClassCount = 4;
+static constexpr uint32_t kSizeClassCount = kSmallClassCount + (48 - 8) * kSubClassCount;
+
+// 每个线程每个大小等级最多缓存的内存块
+static constexpr size_t kThreadCacheBlocks = 8;
+
+static size_t RoundUpAlignment(size_t bytes) {
+  const size_t alignment = TensorMemoryResource::kAlignment;
+  return (std::max(bytes, (size_t)1) + alignment - 1) / alignment * alignment;
+}
+
+static void* SystemAllocate(size_t bytes) {
+#ifdef _MSC_VER
+  void* ptr = _aligned_malloc(bytes, TensorMemoryResource::kAlignment);
+#else
+  void* ptr = std::aligned_alloc(TensorMemoryResource::kAlignment, bytes);
+#endif
+  CHECK(ptr != nullptr) << "Failed to allocate " << bytes << " bytes for the tensor";
+  return ptr;
+}
+
+static void SystemFree(void* ptr) {
+#ifdef _MSC_VER
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+static void UpdatePeak(std::atomic<uint64_t>& peak, uint64_t value) {
+  uint64_t current = peak.load(std::memory_order_relaxed);
+  while (value > current && !peak.compare_exchange_weak(current, value)) {
+  }
+}
+
+void* AlignedMemoryResource::Allocate(size_t bytes) {
+  bytes = RoundUpAlignment(bytes);
+  allocate_count_ += 1;
+  UpdatePeak(peak_bytes_in_use_, bytes_in_use_ += bytes);
+  return SystemAllocate(bytes);
+}
+
+void AlignedMemoryResource::Deallocate(void* ptr, size_t bytes) {
+  if (ptr == nullptr) {
+    return;
+  }
+  deallocate_count_ += 1;
+  bytes_in_use_ -= RoundUpAlignment(bytes);
+  SystemFree(ptr);
+}
+
+TensorMemoryStatistics AlignedMemoryResource::statistics() const {
+  TensorMemoryStatistics statistics;
+  statistics.allocate_count = allocate_count_;
+  statistics.deallocate_count = deallocate_count_;
+  statistics.system_allocate_count = allocate_count_;
+  statistics.system_free_count = deallocate_count_;
+  statistics.bytes_in_use = bytes_in_use_;
+  statistics.peak_bytes_in_use = peak_bytes_in_use_;
+  return statistics;
+}
+
+struct PooledMemoryResource::State {
+  std::mutex mutex;
+  std::vector<std::vector<void*>> free_lists{kSizeClassCount};
+
+  std::atomic<uint64_t> allocate_count{0};
+  std::atomic<uint64_t> deallocate_count{0};
+  std::atomic<uint64_t> pool_hit_count{0};
+  std::atomic<uint64_t> system_allocate_count{0};
+  std::atomic<uint64_t> system_free_count{0};
+  std::atomic<uint64_t> bytes_in_use{0};
+  std::atomic<uint64_t> peak_bytes_in_use{0};
+  std::atomic<uint64_t> bytes_cached{0};
+
+  ~State() {
+    for (auto& free_list : free_lists) {
+      for (void* ptr : free_list) {
+        SystemFree(ptr);
+      }
+    }
+  }
+};
+
+namespace {
+/**
+ * 线程本地的空闲链表, 线程退出时归还到共享的空闲链表
+ */
+struct ThreadCache {
+  explicit ThreadCache(std::shared_ptr<PooledMemoryResource::State> state)
+      : state(std::move(state)), free_lists(kSizeClassCount) {}
+
+  ~ThreadCache() {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    for (uint32_t size_class = 0; size_class < kSizeClassCount; ++size_class) {
+      auto& shared_list = state->free_lists.at(size_class);
+      auto& local_list = free_lists.at(size_class);
+      shared_list.insert(shared_list.end(), local_list.begin(), local_list.end());
+    }
+  }
+
+  std::shared_ptr<PooledMemoryResource::State> state;
+  std::vector<std::vector<void*>> free_lists;
+};
+
+// 线程退出后线程本地缓存已被析构, 此后的分配和释放直接使用共享链表
+thread_local bool thread_cache_destroyed = false;
+
+struct ThreadCaches {
+  ~ThreadCaches() { thread_cache_destroyed = true; }
+
+  std::vector<std::unique_ptr<ThreadCache>> caches;
+};
+
+ThreadCache* GetThreadCache(const std::shared_ptr<PooledMemoryResource::State>& state) {
+  if (thread_cache_destroyed) {
+    return nullptr;
+  }
+  thread_local ThreadCaches thread_caches;
+  for (const auto& thread_cache : thread_caches.caches) {
+    if (thread_cache->state == state) {
+      return thread_cache.get();
+    }
+  }
+  thread_caches.caches.push_back(std::make_unique<ThreadCache>(state));
+  return thread_caches.caches.back().get();
+}
+}  // namespace
+
+PooledMemoryResource::PooledMemoryResource() : state_(std::make_shared<State>()) {}
+
+PooledMemoryResource::~PooledMemoryResource() = default;
+
+uint32_t PooledMemoryResource::SizeClass(size_t bytes) {
+  bytes = RoundUpAlignment(bytes);
+  if (bytes <= kSmallClassCount * kAlignment) {
+    return bytes / kAlignment - 1;
+  }
+  // 2^exponent < bytes <= 2^(exponent + 1)
+  uint32_t exponent = 0;
+  while (((size_t)1 << (exponent + 1)) < bytes) {
+    exponent += 1;
+  }
+  const size_t step = (size_t)1 << (exponent - 2);
+  const size_t sub_class = (bytes - ((size_t)1 << exponent) + step - 1) / step;
+  const uint32_t size_class =
+      kSmallClassCount + (exponent - 8) * kSubClassCount + (uint32_t)sub_class - 1;
+  CHECK_LT(size_class, kSizeClassCount) << "The tensor is too large: " << bytes << " bytes";
+  return size_class;
+}
+
+size_t PooledMemoryResource::SizeClassBytes(uint32_t size_class) {
+  CHECK_LT(size_class, kSizeClassCount);
+  if (size_class < kSmallClassCount) {
+    return (size_class + 1) * kAlignment;
+  }
+  const uint32_t exponent = 8 + (size_class - kSmallClassCount) / kSubClassCount;
+  const size_t sub_class = (size_class - kSmallClassCount) % kSubClassCount + 1;
+  return ((size_t)1 << exponent) + sub_class * ((size_t)1 << (exponent - 2));
+}
+
+void* PooledMemoryResource::Allocate(size_t bytes) {
+  const uint32_t size_class = SizeClass(bytes);
+  const size_t class_bytes = SizeClassBytes(size_class);
+  State& state = *state_;
+  state.allocate_count += 1;
+  UpdatePeak(state.peak_bytes_in_use, state.bytes_in_use += class_bytes);
+
+  void* ptr = nullptr;
+  ThreadCache* thread_cache = GetThreadCache(state_);
+  if (thread_cache != nullptr && !thread_cache->free_lists.at(size_class).empty()) {
+    auto& local_list = thread_cache->free_lists.at(size_class);
+    ptr = local_list.back();
+    local_list.pop_back();
+  } else {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto& shared_list = state.free_lists.at(size_class);
+    if (!shared_list.empty()) {
+      ptr = shared_list.back();
+      shared_list.pop_back();
+    }
+  }
+
+  if (ptr != nullptr) {
+    state.pool_hit_count += 1;
+    state.bytes_cached -= class_bytes;
+  } else {
+    state.system_allocate_count += 1;
+    ptr = SystemAllocate(class_bytes);
+  }
+  return ptr;
+}
+
+void PooledMemoryResource::Deallocate(void* ptr, size_t bytes) {
+  if (ptr == nullptr) {
+    return;
+  }
+  const uint32_t size_class = SizeClass(bytes);
+  const size_t class_bytes = SizeClassBytes(size_class);
+  State& state = *state_;
+  state.deallocate_count += 1;
+  state.bytes_in_use -= class_bytes;
+  state.bytes_cached += class_bytes;
+
+  ThreadCache* thread_cache = GetThreadCache(state_);
+  if (thread_cache != nullptr &&
+      thread_cache->free_lists.at(size_class).size() < kThreadCacheBlocks) {
+    thread_cache->free_lists.at(size_class).push_back(ptr);
+  } else {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.free_lists.at(size_class).push_back(ptr);
+  }
+}
+
+TensorMemoryStatistics PooledMemoryResource::statistics() const {
+  TensorMemoryStatistics statistics;
+  statistics.allocate_count = state_->allocate_count;
+  statistics.deallocate_count = state_->deallocate_count;
+  statistics.pool_hit_count = state_->pool_hit_count;
+  statistics.system_allocate_count = state_->system_allocate_count;
+  statistics.system_free_count = state_->system_free_count;
+  statistics.bytes_in_use = state_->bytes_in_use;
+  statistics.peak_bytes_in_use = state_->peak_bytes_in_use;
+  statistics.bytes_cached = state_->bytes_cached;
+  return statistics;
+}
+
+void PooledMemoryResource::Trim() {
+  // 只能释放共享链表和当前线程的缓存, 其他线程的缓存在线程退出时归还
+  ThreadCache* thread_cache = GetThreadCache(state_);
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  for (uint32_t size_class = 0; size_class < kSizeClassCount; ++size_class) {
+    const size_t class_bytes = SizeClassBytes(size_class);
+    std::vector<std::vector<void*>*> free_lists{&state_->free_lists.at(size_class)};
+    if (thread_cache != nullptr) {
+      free_lists.push_back(&thread_cache->free_lists.at(size_class));
+    }
+    for (auto* free_list : free_lists) {
+      for (void* ptr : *free_list) {
+        SystemFree(ptr);
+        state_->system_free_count += 1;
+        state_->bytes_cached -= class_bytes;
+      }
+      free_list->clear();
+    }
+  }
+}
+
+static std::shared_ptr<TensorMemoryResource> DefaultTensorMemoryResource() {
+  static std::shared_ptr<TensorMemoryResource> resource = std::make_shared<PooledMemoryResource>();
+  return resource;
+}
+
+static std::shared_ptr<TensorMemoryResource>& CurrentTensorMemoryResource() {
+  static std::shared_ptr<TensorMemoryResource> resource = DefaultTensorMemoryResource();
+  return resource;
+}
+
+std::shared_ptr<TensorMemoryResource> GetTensorMemoryResource() {
+  return std::atomic_load(&CurrentTensorMemoryResource());
+}
+
+void SetTensorMemoryResource(std::shared_ptr<TensorMemoryResource> resource) {
+  if (resource == nullptr) {
+    resource = DefaultTensorMemoryResource();
+  }
+  std::atomic_store(&CurrentTensorMemoryResource(), std::move(resource));
+}
+
+TensorBuffer::TensorBuffer(size_t bytes) : bytes_(bytes), resource_(GetTensorMemoryResource()) {
+  data_ = resource_->Allocate(bytes);
+}
+
+TensorBuffer::TensorBuffer(void* data, size_t bytes, std::shared_ptr<void> owner)
+    : data_(data), bytes_(bytes), owner_(std::move(owner)) {}
+
+TensorBuffer::~TensorBuffer() { Release(); }
+
+TensorBuffer::TensorBuffer(TensorBuffer&& other) noexcept
+    : data_(other.data_),
+      bytes_(other.bytes_),
+      resource_(std::move(other.resource_)),
+      owner_(std::move(other.owner_)) {
+  other.data_ = nullptr;
+  other.bytes_ = 0;
+}
+
+TensorBuffer& TensorBuffer::operator=(TensorBuffer&& other) noexcept {
+  if (this != &other) {
+    Release();
+    data_ = other.data_;
+    bytes_ = other.bytes_;
+    resource_ = std::move(other.resource_);
+    owner_ = std::move(other.owner_);
+    other.data_ = nullptr;
+    other.bytes_ = 0;
+  }
+  return *this;
+}
+
+void TensorBuffer::Release() {
+  if (data_ != nullptr && resource_ != nullptr) {
+    resource_->Deallocate(data_, bytes_);
+  }
+  data_ = nullptr;
+  bytes_ = 0;
+  resource_.reset();
+  owner_.reset();
+}
+
+}  // namespace kuiper_infer
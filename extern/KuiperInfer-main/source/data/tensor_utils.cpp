@@ -21,7 +21,106 @@
 
 // Created by fss on 2023/3/20.
 #include <glog/logging.h>
+#include <algorithm>
 #include "data/tensor.hpp"
 #include "data/tensor_util.hpp"
+#include "utils/cpu/cpu_features.hpp"
+#if __SSE2__ || KUIPER_X86_DISPATCH
+#include <immintrin.h>
+#endif
 
-namespace kuiper_infer {}  // namespace kuiper_infer
\ No newline at end of file
+namespace kuiper_infer {
+
+struct ElementAddOp {
+  static float Apply(float a, float b) { return a + b; }
+#if __SSE2__
+  static __m128 Apply(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+#endif
+#if KUIPER_X86_DISPATCH
+  KUIPER_TARGET_AVX2 static __m256 Apply(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+#endif
+};
+
+struct ElementMultiplyOp {
+  static float Apply(float a, float b) { return a * b; }
+#if __SSE2__
+  static __m128 Apply(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+#endif
+#if KUIPER_X86_DISPATCH
+  KUIPER_TARGET_AVX2 static __m256 Apply(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+#endif
+};
+
+#if KUIPER_X86_DISPATCH
+template <typename Op>
+KUIPER_TARGET_AVX2 static uint32_t ElementSpanAVX2(const float* input1, const float* input2,
+                                                   bool input2_broadcast, float* output,
+                                                   uint32_t size) {
+  uint32_t i = 0;
+  if (input2_broadcast) {
+    const __m256 value2 = _mm256_set1_ps(*input2);
+    for (; i + 7 < size; i += 8) {
+      _mm256_storeu_ps(output + i, Op::Apply(_mm256_loadu_ps(input1 + i), value2));
+    }
+  } else {
+    for (; i + 7 < size; i += 8) {
+      _mm256_storeu_ps(output + i,
+                       Op::Apply(_mm256_loadu_ps(input1 + i), _mm256_loadu_ps(input2 + i)));
+    }
+  }
+  return i;
+}
+#endif
+
+template <typename Op>
+static void ElementSpan(const float* input1, bool input1_broadcast, const float* input2,
+                        bool input2_broadcast, float* output, uint32_t size) {
+  if (input1_broadcast && input2_broadcast) {
+    std::fill(output, output + size, Op::Apply(*input1, *input2));
+    return;
+  }
+  // 加法和乘法满足交换律, 广播的输入统一放在第二个
+  if (input1_broadcast) {
+    std::swap(input1, input2);
+    std::swap(input1_broadcast, input2_broadcast);
+  }
+
+  uint32_t i = 0;
+#if KUIPER_X86_DISPATCH
+  static const bool use_avx2 = utils::GetCpuIsa() >= utils::CpuIsa::kAVX2;
+  if (use_avx2) {
+    i = ElementSpanAVX2<Op>(input1, input2, input2_broadcast, output, size);
+  }
+#endif
+#if __SSE2__
+  if (input2_broadcast) {
+    const __m128 value2 = _mm_set1_ps(*input2);
+    for (; i + 3 < size; i += 4) {
+      _mm_storeu_ps(output + i, Op::Apply(_mm_loadu_ps(input1 + i), value2));
+    }
+  } else {
+    for (; i + 3 < size; i += 4) {
+      _mm_storeu_ps(output + i, Op::Apply(_mm_loadu_ps(input1 + i), _mm_loadu_ps(input2 + i)));
+    }
+  }
+#endif
+  const uint32_t step2 = input2_broadcast ? 0 : 1;
+  for (; i < size; ++i) {
+    output[i] = Op::Apply(input1[i], input2[i * step2]);
+  }
+}
+
+template <>
+void ElementAddSpan<float>(const float* input1, bool input1_broadcast, const float* input2,
+                           bool input2_broadcast, float* output, uint32_t size) {
+  ElementSpan<ElementAddOp>(input1, input1_broadcast, input2, input2_broadcast, output, size);
+}
+
+template <>
+void ElementMultiplySpan<float>(const float* input1, bool input1_broadcast, const float* input2,
+                                bool input2_broadcast, float* output, uint32_t size) {
+  ElementSpan<ElementMultiplyOp>(input1, input1_broadcast, input2, input2_broadcast, output,
+                                 size);
+}
+
+}  // namespace kuiper_infer
\ No newline at end of file
@@ -53,6 +53,13 @@ StatusCode Layer<float>::Forward(const std::vector<std::shared_ptr<Tensor<float>
   return StatusCode::kFunctionNotImplement;
 }
 
+StatusCode Layer<float>::ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                       const std::vector<const HalfTensor*>& packed_inputs,
+                                       std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  LOG(FATAL) << this->layer_name_ << " layer does not support 16-bit inputs!";
+  return StatusCode::kFunctionNotImplement;
+}
+
 StatusCode Layer<float>::Forward() {
   LOG_IF(FATAL, this->runtime_operator_.expired()) << "Runtime operator is expired or nullptr";
   const auto& runtime_operator = this->runtime_operator_.lock();
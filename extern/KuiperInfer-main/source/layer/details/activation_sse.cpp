@@ -24,35 +24,49 @@
 //
 #include "activation_sse.hpp"
 #include <glog/logging.h>
+#include <algorithm>
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 
 namespace activation {
 
-static void SigmoidSSE(sftensor input, sftensor output) {
-  CHECK(input != nullptr && output != nullptr) << "The input or output tensor is empty.";
-  CHECK(!input->empty() && !output->empty()) << "The input or output tensor is empty.";
-  CHECK(input->size() == output->size()) << "The input and output sizes are not equal.";
-  int64_t index = 0;
-  int64_t packet_size = 4;
-  int64_t in_size = static_cast<int64_t>(input->size());
-  const float* in_ptr = input->raw_ptr();
-  float* out_ptr = output->raw_ptr();
-#ifdef __AVX2__
-  packet_size = 8;
-  __m256 _one = _mm256_set1_ps(1.f);
-  __m256 _zero = _mm256_setzero_ps();
-  for (; index <= in_size - packet_size; index += packet_size) {
-    __m256 _p = _mm256_loadu_ps(in_ptr);
-    _p = _mm256_div_ps(_one, _mm256_add_ps(_one, fmath::exp_ps256(_mm256_sub_ps(_zero, _p))));
-    _mm256_storeu_ps(out_ptr, _p);
-    in_ptr += packet_size;
-    out_ptr += packet_size;
+// 向量内核处理前若干个元素并返回处理的个数, 其余元素由标量代码处理
+using ActivationKernel = int64_t (*)(const float* in_ptr, float* out_ptr, int64_t size);
+
+static float SigmoidScalar(float value) { return 1 / (1.f + fmath::exp(-value)); }
+
+static float ReluScalar(float value) { return std::max(value, 0.f); }
+
+static float SiluScalar(float value) { return value / (1.f + fmath::exp(-value)); }
+
+static float HardSwishScalar(float value) {
+  if (value <= -3.f) {
+    return 0.f;
+  } else if (value >= 3.f) {
+    return value;
+  } else {
+    return value * (value + 3.f) / 6;
   }
-#elif __SSE2__
+}
+
+static float HardSigmoidScalar(float value) {
+  if (value <= -3.f) {
+    return 0.f;
+  } else if (value >= 3.f) {
+    return 1.f;
+  } else {
+    return value / 6.f + 0.5f;
+  }
+}
+
+static int64_t SigmoidSSE(const float* in_ptr, float* out_ptr, int64_t size) {
+  int64_t index = 0;
+#if __SSE2__
+  const int64_t packet_size = 4;
   __m128 _one = _mm_set1_ps(1.f);
   __m128 _zero = _mm_setzero_ps();
-  for (; index <= in_size - packet_size; index += packet_size) {
+  for (; index <= size - packet_size; index += packet_size) {
     __m128 _p = _mm_loadu_ps(in_ptr);
     _p = _mm_div_ps(_one, _mm_add_ps(_one, fmath::exp_ps(_mm_sub_ps(_zero, _p))));
     _mm_storeu_ps(out_ptr, _p);
@@ -60,35 +74,13 @@ static void SigmoidSSE(sftensor input, sftensor output) {
     out_ptr += packet_size;
   }
 #endif
-  if (index < in_size) {
-    while (index < in_size) {
-      float value = input->index(index);
-      output->index(index) = 1 / (1.f + fmath::exp(-value));
-      index += 1;
-    }
-  }
+  return index;
 }
 
-static void ReluSSE(sftensor input, sftensor output) {
-  CHECK(input != nullptr && output != nullptr) << "The input or output tensor is empty.";
-  CHECK(!input->empty() && !output->empty()) << "The input or output tensor is empty.";
-  CHECK(input->size() == output->size()) << "The input and output sizes are not equal.";
+static int64_t ReluSSE(const float* in_ptr, float* out_ptr, int64_t size) {
   int64_t j = 0;
-  int64_t packet_size = 4;
-  int64_t size = static_cast<int64_t>(input->size());
-  const float* in_ptr = input->raw_ptr();
-  float* out_ptr = output->raw_ptr();
-#ifdef __AVX2__
-  packet_size = 8;
-  __m256 _zero = _mm256_setzero_ps();
-  for (j = 0; j <= size - packet_size; j += packet_size) {
-    __m256 _p = _mm256_loadu_ps(in_ptr);
-    __m256 _value = _mm256_max_ps(_zero, _p);
-    _mm256_storeu_ps(out_ptr, _value);
-    in_ptr += packet_size;
-    out_ptr += packet_size;
-  }
-#elif __SSE__
+#if __SSE__
+  const int64_t packet_size = 4;
   __m128 _zero = _mm_setzero_ps();
   for (j = 0; j <= size - packet_size; j += packet_size) {
     __m128 _p = _mm_loadu_ps(in_ptr);
@@ -98,37 +90,13 @@ static void ReluSSE(sftensor input, sftensor output) {
     out_ptr += packet_size;
   }
 #endif
-  if (j < size) {
-    while (j < size) {
-      float value = input->index(j);
-      output->index(j) = std::max(value, 0.f);
-      j += 1;
-    }
-  }
+  return j;
 }
 
-static void SiluSSE(sftensor input, sftensor output) {
-  CHECK(input != nullptr && output != nullptr) << "The input or output tensor is empty.";
-  CHECK(!input->empty() && !output->empty()) << "The input or output tensor is empty.";
-  CHECK(input->size() == output->size()) << "The input and output sizes are not equal.";
+static int64_t SiluSSE(const float* in_ptr, float* out_ptr, int64_t size) {
   int64_t j = 0;
-  int64_t packet_size = 4;
-  int64_t size = static_cast<int64_t>(input->size());
-  const float* in_ptr = input->raw_ptr();
-  float* out_ptr = output->raw_ptr();
-#ifdef __AVX2__
-  packet_size = 8;
-  __m256 _one = _mm256_set1_ps(1.f);
-  __m256 _zero = _mm256_setzero_ps();
-
-  for (j = 0; j <= size - packet_size; j += packet_size) {
-    __m256 _p = _mm256_loadu_ps(in_ptr);
-    _p = _mm256_div_ps(_p, _mm256_add_ps(_one, fmath::exp_ps256(_mm256_sub_ps(_zero, _p))));
-    _mm256_storeu_ps(out_ptr, _p);
-    in_ptr += packet_size;
-    out_ptr += packet_size;
-  }
-#elif __SSE__
+#if __SSE__
+  const int64_t packet_size = 4;
   __m128 _one = _mm_set1_ps(1.f);
   __m128 _zero = _mm_setzero_ps();
 
@@ -140,68 +108,62 @@ static void SiluSSE(sftensor input, sftensor output) {
     out_ptr += packet_size;
   }
 #endif
-  if (j < size) {
-    while (j < size) {
-      float value = input->index(j);
-      output->index(j) = value / (1.f + fmath::exp(-value));
-      j += 1;
-    }
-  }
+  return j;
 }
 
-static void HardSwishSSE(sftensor input, sftensor output) {
-  CHECK(input != nullptr && output != nullptr) << "The input or output tensor is empty.";
-  CHECK(!input->empty() && !output->empty()) << "The input or output tensor is empty.";
-  CHECK(input->size() == output->size()) << "The input and output sizes are not equal.";
-
+static int64_t HardSwishSSE(const float* in_ptr, float* out_ptr, int64_t size) {
   int64_t j = 0;
-  float threshold = 3.f;
-  int64_t packet_size = 4;
-  int64_t size = static_cast<int64_t>(input->size());
-
-  const float* in_ptr = input->raw_ptr();
-  float* out_ptr = output->raw_ptr();
-#ifdef __AVX2__
-  packet_size = 8;
-  __m256 zero = _mm256_set1_ps(0.f);
-  __m256 three = _mm256_set1_ps(threshold);
-  __m256 six = _mm256_set1_ps(6.f);
-  __m256 minus_three = _mm256_set1_ps(-threshold);
+#if __SSE2__
+  const float threshold = 3.f;
+  const int64_t packet_size = 4;
+  __m128 zero = _mm_set1_ps(0.f);
+  __m128 three = _mm_set1_ps(threshold);
+  __m128 six = _mm_set1_ps(6.f);
+  __m128 minus_three = _mm_set1_ps(-threshold);
   for (j = 0; j <= size - packet_size; j += packet_size) {
-    __m256 x = _mm256_loadu_ps(in_ptr);
+    __m128 x = _mm_loadu_ps(in_ptr);
 
-    __m256 le_branch = _mm256_cmp_ps(x, minus_three, _CMP_LE_OS);  // <= -3
-    __m256 ge_branch = _mm256_cmp_ps(x, three, _CMP_GE_OS);        // >= 3
-    __m256 mid_branch = _mm256_and_ps(_mm256_cmp_ps(x, minus_three, _CMP_GT_OS),
-                                      _mm256_cmp_ps(x, three, _CMP_LT_OS));  // -3 < x < 3
+    __m128 le_branch = _mm_cmple_ps(x, minus_three);  // <= -3
+    __m128 ge_branch = _mm_cmpge_ps(x, three);        // >= 3
+    __m128 mid_branch =
+        _mm_and_ps(_mm_cmpgt_ps(x, minus_three), _mm_cmplt_ps(x, three));  // -3 < x < 3
 
-    __m256 f1 = _mm256_and_ps(zero, le_branch);
-    __m256 f2 = _mm256_and_ps(x, ge_branch);
-    __m256 f3 =
-        _mm256_and_ps(_mm256_div_ps(_mm256_mul_ps(x, _mm256_add_ps(x, three)), six), mid_branch);
+    __m128 f1 = _mm_and_ps(zero, le_branch);
+    __m128 f2 = _mm_and_ps(x, ge_branch);
+    __m128 f3 = _mm_and_ps(_mm_div_ps(_mm_mul_ps(x, _mm_add_ps(x, three)), six), mid_branch);
 
-    __m256 result = _mm256_add_ps(_mm256_add_ps(f1, f2), f3);
-    _mm256_storeu_ps(out_ptr, result);
+    __m128 result = _mm_add_ps(_mm_add_ps(f1, f2), f3);
+    _mm_storeu_ps(out_ptr, result);
 
     in_ptr += packet_size;
     out_ptr += packet_size;
   }
-#elif __SSE2__
+#endif
+  return j;
+}
+
+static int64_t HardSigmoidSSE(const float* in_ptr, float* out_ptr, int64_t size) {
+  int64_t j = 0;
+#if __SSE2__
+  const float threshold = 3.f;
+  const int64_t packet_size = 4;
   __m128 zero = _mm_set1_ps(0.f);
+  __m128 one = _mm_set1_ps(1.f);
+
   __m128 three = _mm_set1_ps(threshold);
   __m128 six = _mm_set1_ps(6.f);
+  __m128 point_five = _mm_set1_ps(0.5f);
   __m128 minus_three = _mm_set1_ps(-threshold);
   for (j = 0; j <= size - packet_size; j += packet_size) {
     __m128 x = _mm_loadu_ps(in_ptr);
-
     __m128 le_branch = _mm_cmple_ps(x, minus_three);  // <= -3
     __m128 ge_branch = _mm_cmpge_ps(x, three);        // >= 3
     __m128 mid_branch =
         _mm_and_ps(_mm_cmpgt_ps(x, minus_three), _mm_cmplt_ps(x, three));  // -3 < x < 3
 
     __m128 f1 = _mm_and_ps(zero, le_branch);
-    __m128 f2 = _mm_and_ps(x, ge_branch);
-    __m128 f3 = _mm_and_ps(_mm_div_ps(_mm_mul_ps(x, _mm_add_ps(x, three)), six), mid_branch);
+    __m128 f2 = _mm_and_ps(one, ge_branch);
+    __m128 f3 = _mm_and_ps(_mm_add_ps(_mm_div_ps(x, six), point_five), mid_branch);
 
     __m128 result = _mm_add_ps(_mm_add_ps(f1, f2), f3);
     _mm_storeu_ps(out_ptr, result);
@@ -210,37 +172,91 @@ static void HardSwishSSE(sftensor input, sftensor output) {
     out_ptr += packet_size;
   }
 #endif
-  if (j < size) {
-    while (j < size) {
-      float value = input->index(j);
-      float result = 0.f;
-      if (value <= -3.f) {
-        result = 0.f;
-      } else if (value >= 3.f) {
-        result = value;
-      } else {
-        result = value * (value + threshold) / 6;
-      }
-      output->index(j) = result;
-      j += 1;
-    }
+  return j;
+}
+
+#if KUIPER_X86_DISPATCH
+KUIPER_TARGET_AVX2 static int64_t SigmoidAVX2(const float* in_ptr, float* out_ptr, int64_t size) {
+  int64_t index = 0;
+  const int64_t packet_size = 8;
+  __m256 _one = _mm256_set1_ps(1.f);
+  __m256 _zero = _mm256_setzero_ps();
+  for (; index <= size - packet_size; index += packet_size) {
+    __m256 _p = _mm256_loadu_ps(in_ptr);
+    _p = _mm256_div_ps(_one, _mm256_add_ps(_one, fmath::exp_ps256(_mm256_sub_ps(_zero, _p))));
+    _mm256_storeu_ps(out_ptr, _p);
+    in_ptr += packet_size;
+    out_ptr += packet_size;
+  }
+  return index;
+}
+
+KUIPER_TARGET_AVX2 static int64_t ReluAVX2(const float* in_ptr, float* out_ptr, int64_t size) {
+  int64_t j = 0;
+  const int64_t packet_size = 8;
+  __m256 _zero = _mm256_setzero_ps();
+  for (j = 0; j <= size - packet_size; j += packet_size) {
+    __m256 _p = _mm256_loadu_ps(in_ptr);
+    __m256 _value = _mm256_max_ps(_zero, _p);
+    _mm256_storeu_ps(out_ptr, _value);
+    in_ptr += packet_size;
+    out_ptr += packet_size;
   }
+  return j;
 }
 
-static void HardSigmoidSSE(sftensor input, sftensor output) {
-  CHECK(input != nullptr && output != nullptr) << "The input or output tensor is empty.";
-  CHECK(!input->empty() && !output->empty()) << "The input or output tensor is empty.";
-  CHECK(input->size() == output->size()) << "The input and output sizes are not equal.";
+KUIPER_TARGET_AVX2 static int64_t SiluAVX2(const float* in_ptr, float* out_ptr, int64_t size) {
+  int64_t j = 0;
+  const int64_t packet_size = 8;
+  __m256 _one = _mm256_set1_ps(1.f);
+  __m256 _zero = _mm256_setzero_ps();
+
+  for (j = 0; j <= size - packet_size; j += packet_size) {
+    __m256 _p = _mm256_loadu_ps(in_ptr);
+    _p = _mm256_div_ps(_p, _mm256_add_ps(_one, fmath::exp_ps256(_mm256_sub_ps(_zero, _p))));
+    _mm256_storeu_ps(out_ptr, _p);
+    in_ptr += packet_size;
+    out_ptr += packet_size;
+  }
+  return j;
+}
+
+KUIPER_TARGET_AVX2 static int64_t HardSwishAVX2(const float* in_ptr, float* out_ptr,
+                                                int64_t size) {
+  int64_t j = 0;
+  const float threshold = 3.f;
+  const int64_t packet_size = 8;
+  __m256 zero = _mm256_set1_ps(0.f);
+  __m256 three = _mm256_set1_ps(threshold);
+  __m256 six = _mm256_set1_ps(6.f);
+  __m256 minus_three = _mm256_set1_ps(-threshold);
+  for (j = 0; j <= size - packet_size; j += packet_size) {
+    __m256 x = _mm256_loadu_ps(in_ptr);
+
+    __m256 le_branch = _mm256_cmp_ps(x, minus_three, _CMP_LE_OS);  // <= -3
+    __m256 ge_branch = _mm256_cmp_ps(x, three, _CMP_GE_OS);        // >= 3
+    __m256 mid_branch = _mm256_and_ps(_mm256_cmp_ps(x, minus_three, _CMP_GT_OS),
+                                      _mm256_cmp_ps(x, three, _CMP_LT_OS));  // -3 < x < 3
+
+    __m256 f1 = _mm256_and_ps(zero, le_branch);
+    __m256 f2 = _mm256_and_ps(x, ge_branch);
+    __m256 f3 =
+        _mm256_and_ps(_mm256_div_ps(_mm256_mul_ps(x, _mm256_add_ps(x, three)), six), mid_branch);
 
+    __m256 result = _mm256_add_ps(_mm256_add_ps(f1, f2), f3);
+    _mm256_storeu_ps(out_ptr, result);
+
+    in_ptr += packet_size;
+    out_ptr += packet_size;
+  }
+  return j;
+}
+
+KUIPER_TARGET_AVX2 static int64_t HardSigmoidAVX2(const float* in_ptr, float* out_ptr,
+                                                  int64_t size) {
   int64_t j = 0;
-  float threshold = 3.f;
-  int64_t packet_size = 4;
-  int64_t size = static_cast<int64_t>(input->size());
-
-  const float* in_ptr = input->raw_ptr();
-  float* out_ptr = output->raw_ptr();
-#ifdef __AVX2__
-  packet_size = 8;
+  const float threshold = 3.f;
+  const int64_t packet_size = 8;
   __m256 zero = _mm256_set1_ps(0.f);
   __m256 one = _mm256_set1_ps(1.f);
 
@@ -265,76 +281,236 @@ static void HardSigmoidSSE(sftensor input, sftensor output) {
     in_ptr += packet_size;
     out_ptr += packet_size;
   }
-#elif __SSE2__
-  __m128 zero = _mm_set1_ps(0.f);
-  __m128 one = _mm_set1_ps(1.f);
+  return j;
+}
 
-  __m128 three = _mm_set1_ps(threshold);
-  __m128 six = _mm_set1_ps(6.f);
-  __m128 point_five = _mm_set1_ps(0.5f);
-  __m128 minus_three = _mm_set1_ps(-threshold);
-  for (j = 0; j <= size - packet_size; j += packet_size) {
-    __m128 x = _mm_loadu_ps(in_ptr);
-    __m128 le_branch = _mm_cmp_ps(x, minus_three, _CMP_LE_OS);  // <= -3
-    __m128 ge_branch = _mm_cmp_ps(x, three, _CMP_GE_OS);        // >= 3
-    __m128 mid_branch = _mm_and_ps(_mm_cmp_ps(x, minus_three, _CMP_GT_OS),
-                                   _mm_cmp_ps(x, three, _CMP_LT_OS));  // -3 < x < 3
+// AVX-512版本用掩码读写处理末尾不足16个的元素, 不需要标量代码
+KUIPER_TARGET_AVX512 static int64_t SigmoidAVX512(const float* in_ptr, float* out_ptr,
+                                                  int64_t size) {
+  const int64_t packet_size = 16;
+  __m512 _one = _mm512_set1_ps(1.f);
+  __m512 _zero = _mm512_setzero_ps();
+  for (int64_t index = 0; index < size; index += packet_size) {
+    const int64_t remain = std::min(size - index, packet_size);
+    const __mmask16 mask = (__mmask16)((1u << remain) - 1);
+    __m512 _p = _mm512_maskz_loadu_ps(mask, in_ptr + index);
+    _p = _mm512_div_ps(_one, _mm512_add_ps(_one, fmath::exp_ps512(_mm512_sub_ps(_zero, _p))));
+    _mm512_mask_storeu_ps(out_ptr + index, mask, _p);
+  }
+  return size;
+}
 
-    __m128 f1 = _mm_and_ps(zero, le_branch);
-    __m128 f2 = _mm_and_ps(one, ge_branch);
-    __m128 f3 = _mm_and_ps(_mm_add_ps(_mm_div_ps(x, six), point_five), mid_branch);
+KUIPER_TARGET_AVX512 static int64_t ReluAVX512(const float* in_ptr, float* out_ptr,
+                                               int64_t size) {
+  const int64_t packet_size = 16;
+  __m512 _zero = _mm512_setzero_ps();
+  for (int64_t j = 0; j < size; j += packet_size) {
+    const int64_t remain = std::min(size - j, packet_size);
+    const __mmask16 mask = (__mmask16)((1u << remain) - 1);
+    __m512 _p = _mm512_maskz_loadu_ps(mask, in_ptr + j);
+    _mm512_mask_storeu_ps(out_ptr + j, mask, _mm512_max_ps(_zero, _p));
+  }
+  return size;
+}
 
-    __m128 result = _mm_add_ps(_mm_add_ps(f1, f2), f3);
-    _mm_storeu_ps(out_ptr, result);
+KUIPER_TARGET_AVX512 static int64_t SiluAVX512(const float* in_ptr, float* out_ptr,
+                                               int64_t size) {
+  const int64_t packet_size = 16;
+  __m512 _one = _mm512_set1_ps(1.f);
+  __m512 _zero = _mm512_setzero_ps();
+  for (int64_t j = 0; j < size; j += packet_size) {
+    const int64_t remain = std::min(size - j, packet_size);
+    const __mmask16 mask = (__mmask16)((1u << remain) - 1);
+    __m512 _p = _mm512_maskz_loadu_ps(mask, in_ptr + j);
+    _p = _mm512_div_ps(_p, _mm512_add_ps(_one, fmath::exp_ps512(_mm512_sub_ps(_zero, _p))));
+    _mm512_mask_storeu_ps(out_ptr + j, mask, _p);
+  }
+  return size;
+}
 
-    in_ptr += packet_size;
-    out_ptr += packet_size;
+KUIPER_TARGET_AVX512 static int64_t HardSwishAVX512(const float* in_ptr, float* out_ptr,
+                                                    int64_t size) {
+  const int64_t packet_size = 16;
+  __m512 zero = _mm512_setzero_ps();
+  __m512 three = _mm512_set1_ps(3.f);
+  __m512 six = _mm512_set1_ps(6.f);
+  __m512 minus_three = _mm512_set1_ps(-3.f);
+  for (int64_t j = 0; j < size; j += packet_size) {
+    const int64_t remain = std::min(size - j, packet_size);
+    const __mmask16 mask = (__mmask16)((1u << remain) - 1);
+    __m512 x = _mm512_maskz_loadu_ps(mask, in_ptr + j);
+
+    __mmask16 le_branch = _mm512_cmp_ps_mask(x, minus_three, _CMP_LE_OS);  // <= -3
+    __mmask16 ge_branch = _mm512_cmp_ps_mask(x, three, _CMP_GE_OS);        // >= 3
+    __m512 result = _mm512_div_ps(_mm512_mul_ps(x, _mm512_add_ps(x, three)), six);
+    result = _mm512_mask_blend_ps(ge_branch, result, x);
+    result = _mm512_mask_blend_ps(le_branch, result, zero);
+    _mm512_mask_storeu_ps(out_ptr + j, mask, result);
   }
+  return size;
+}
+
+KUIPER_TARGET_AVX512 static int64_t HardSigmoidAVX512(const float* in_ptr, float* out_ptr,
+                                                      int64_t size) {
+  const int64_t packet_size = 16;
+  __m512 zero = _mm512_setzero_ps();
+  __m512 one = _mm512_set1_ps(1.f);
+  __m512 three = _mm512_set1_ps(3.f);
+  __m512 six = _mm512_set1_ps(6.f);
+  __m512 point_five = _mm512_set1_ps(0.5f);
+  __m512 minus_three = _mm512_set1_ps(-3.f);
+  for (int64_t j = 0; j < size; j += packet_size) {
+    const int64_t remain = std::min(size - j, packet_size);
+    const __mmask16 mask = (__mmask16)((1u << remain) - 1);
+    __m512 x = _mm512_maskz_loadu_ps(mask, in_ptr + j);
+
+    __mmask16 le_branch = _mm512_cmp_ps_mask(x, minus_three, _CMP_LE_OS);  // <= -3
+    __mmask16 ge_branch = _mm512_cmp_ps_mask(x, three, _CMP_GE_OS);        // >= 3
+    __m512 result = _mm512_add_ps(_mm512_div_ps(x, six), point_five);
+    result = _mm512_mask_blend_ps(ge_branch, result, one);
+    result = _mm512_mask_blend_ps(le_branch, result, zero);
+    _mm512_mask_storeu_ps(out_ptr + j, mask, result);
+  }
+  return size;
+}
 #endif
-  if (j < size) {
-    while (j < size) {
-      float value = input->index(j);
-      float result = 0.f;
-      if (value <= -3.f) {
-        result = 0.f;
-      } else if (value >= 3.f) {
-        result = 1.f;
-      } else {
-        result = value / 6.f + 0.5f;
-      }
-      output->index(j) = result;
-      j += 1;
-    }
+
+static void ApplyActivationSpan(ActivationKernel kernel, float (*scalar)(float),
+                                const float* in_ptr, float* out_ptr, int64_t size) {
+  int64_t j = kernel(in_ptr, out_ptr, size);
+  while (j < size) {
+    out_ptr[j] = scalar(in_ptr[j]);
+    j += 1;
   }
 }
 
+static ActivationFunc ApplyActivationKernel(ActivationKernel kernel, float (*scalar)(float)) {
+  return [kernel, scalar](sftensor input, sftensor output) {
+    CHECK(input != nullptr && output != nullptr) << "The input or output tensor is empty.";
+    CHECK(!input->empty() && !output->empty()) << "The input or output tensor is empty.";
+    CHECK(input->size() == output->size()) << "The input and output sizes are not equal.";
+    ApplyActivationSpan(kernel, scalar, input->raw_ptr(), output->raw_ptr(),
+                        static_cast<int64_t>(input->size()));
+  };
+}
+
 ActivationFunc ApplySSEActivation(ActivationType act_type) {
-  ActivationFunc function;
+  return ApplySSEActivation(act_type, utils::GetCpuIsa());
+}
+
+static void SelectActivationKernel(ActivationType act_type, utils::CpuIsa isa,
+                                   ActivationKernel& kernel, float (*&scalar)(float)) {
+  CHECK(utils::IsCpuIsaSupported(isa))
+      << "The CPU does not support " << utils::CpuIsaName(isa) << " kernels";
+  // 依次为SSE, AVX2和AVX-512版本
+  ActivationKernel kernels[3];
   switch (act_type) {
     case ActivationType::kActivationRelu: {
-      function = ReluSSE;
-      return function;
+      kernels[0] = ReluSSE;
+#if KUIPER_X86_DISPATCH
+      kernels[1] = ReluAVX2;
+      kernels[2] = ReluAVX512;
+#endif
+      scalar = ReluScalar;
+      break;
     }
     case ActivationType::kActivationSigmoid: {
-      function = SigmoidSSE;
-      return function;
+      kernels[0] = SigmoidSSE;
+#if KUIPER_X86_DISPATCH
+      kernels[1] = SigmoidAVX2;
+      kernels[2] = SigmoidAVX512;
+#endif
+      scalar = SigmoidScalar;
+      break;
     }
     case ActivationType::kActivationSilu: {
-      function = SiluSSE;
-      return function;
+      kernels[0] = SiluSSE;
+#if KUIPER_X86_DISPATCH
+      kernels[1] = SiluAVX2;
+      kernels[2] = SiluAVX512;
+#endif
+      scalar = SiluScalar;
+      break;
     }
     case ActivationType::kActivationHardSwish: {
-      function = HardSwishSSE;
-      return function;
+      kernels[0] = HardSwishSSE;
+#if KUIPER_X86_DISPATCH
+      kernels[1] = HardSwishAVX2;
+      kernels[2] = HardSwishAVX512;
+#endif
+      scalar = HardSwishScalar;
+      break;
     }
     case ActivationType::kActivationHardSigmoid: {
-      function = HardSigmoidSSE;
-      return function;
+      kernels[0] = HardSigmoidSSE;
+#if KUIPER_X86_DISPATCH
+      kernels[1] = HardSigmoidAVX2;
+      kernels[2] = HardSigmoidAVX512;
+#endif
+      scalar = HardSigmoidScalar;
+      break;
     }
     default: {
       LOG(FATAL) << "Unknown SSE activation type: " << int32_t(act_type);
     }
   }
+#if !KUIPER_X86_DISPATCH
+  kernels[1] = kernels[0];
+  kernels[2] = kernels[0];
+#endif
+  kernel = kernels[int32_t(isa)];
+}
+
+ActivationFunc ApplySSEActivation(ActivationType act_type, utils::CpuIsa isa) {
+  ActivationKernel kernel = nullptr;
+  float (*scalar)(float) = nullptr;
+  SelectActivationKernel(act_type, isa, kernel, scalar);
+  return ApplyActivationKernel(kernel, scalar);
+}
+
+// 每块16KB, 展开后在L1中完成激活
+static constexpr int64_t kPackedBlockSize = 4096;
+
+StatusCode ApplyPackedActivation(ActivationType act_type, const std::vector<sftensor>& inputs,
+                                 const std::vector<const HalfTensor*>& packed_inputs,
+                                 std::vector<sftensor>& outputs) {
+  CHECK(inputs.size() == outputs.size() && packed_inputs.size() == outputs.size())
+      << "The input and output tensor array size of the activation do not match";
+  ActivationKernel kernel = nullptr;
+  float (*scalar)(float) = nullptr;
+  SelectActivationKernel(act_type, utils::GetCpuIsa(), kernel, scalar);
+
+  for (uint32_t i = 0; i < outputs.size(); ++i) {
+    const sftensor& output = outputs.at(i);
+    CHECK(output != nullptr && !output->empty())
+        << "The output tensor array of the activation has an empty tensor " << i << " th";
+    const HalfTensor* packed_input = packed_inputs.at(i);
+    if (packed_input != nullptr) {
+      CHECK(packed_input->shapes() == output->shapes())
+          << "The input and output tensor shapes of the activation do not match " << i << " th";
+    } else {
+      CHECK(inputs.at(i) != nullptr && inputs.at(i)->size() == output->size())
+          << "The input and output tensor shapes of the activation do not match " << i << " th";
+    }
+
+    float* out_ptr = output->raw_ptr();
+    const int64_t size = static_cast<int64_t>(output->size());
+    const int64_t block_count = (size + kPackedBlockSize - 1) / kPackedBlockSize;
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(uint32_t(block_count)))
+    for (int64_t block = 0; block < block_count; ++block) {
+      const int64_t offset = block * kPackedBlockSize;
+      const int64_t block_size = std::min(kPackedBlockSize, size - offset);
+      const float* in_ptr = nullptr;
+      if (packed_input != nullptr) {
+        packed_input->UnpackSpan(offset, block_size, out_ptr + offset);
+        in_ptr = out_ptr + offset;
+      } else {
+        in_ptr = inputs.at(i)->raw_ptr() + offset;
+      }
+      ApplyActivationSpan(kernel, scalar, in_ptr, out_ptr + offset, block_size);
+    }
+  }
+  return StatusCode::kSuccess;
 }
 }  // namespace activation
-}  // namespace kuiper_infer
\ No newline at end of file
+}  // namespace kuiper_infer
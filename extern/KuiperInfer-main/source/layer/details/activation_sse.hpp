@@ -26,6 +26,9 @@
 #define KUIPER_INFER_INCLUDE_MATH_ARMA_SSE
 #include <armadillo>
 #include "data/tensor.hpp"
+#include "data/tensor_half.hpp"
+#include "status_code.hpp"
+#include "utils/cpu/cpu_features.hpp"
 #include "utils/math/fmath.hpp"
 namespace kuiper_infer {
 namespace activation {
@@ -40,8 +43,39 @@ enum class ActivationType {
 
 using ActivationFunc = std::function<void(sftensor, sftensor)>;
 
+/**
+ * @brief Gets the activation function for the instruction set of the CPU
+ *
+ * @param act_type Activation type
+ * @return Function computing output from input, input and output can be the same tensor
+ */
 ActivationFunc ApplySSEActivation(ActivationType act_type);
 
+/**
+ * @brief Gets the activation function for an instruction set
+ *
+ * @param act_type Activation type
+ * @param isa Instruction set of the kernel, has to be supported by the CPU
+ * @return Function computing output from input, input and output can be the same tensor
+ */
+ActivationFunc ApplySSEActivation(ActivationType act_type, utils::CpuIsa isa);
+
+/**
+ * @brief Applies an activation to inputs partly stored in 16 bits
+ *
+ * A 16-bit input is widened into its output one block at a time and the
+ * activation runs on the block in place while it is still in cache.
+ *
+ * @param act_type Activation type
+ * @param inputs Input tensors, ignored where packed_inputs is not nullptr
+ * @param packed_inputs 16-bit inputs, nullptr for the inputs in float
+ * @param outputs Allocated output tensors
+ * @return Status code
+ */
+StatusCode ApplyPackedActivation(ActivationType act_type, const std::vector<sftensor>& inputs,
+                                 const std::vector<const HalfTensor*>& packed_inputs,
+                                 std::vector<sftensor>& outputs);
+
 }  // namespace activation
 }  // namespace kuiper_infer
 #endif  // KUIPER_INFER_INCLUDE_MATH_ARMA_SSE
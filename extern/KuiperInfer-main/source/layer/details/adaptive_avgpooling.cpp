@@ -22,7 +22,9 @@
 // Created by fss on 22-11-12.
 #include "adaptive_avgpooling.hpp"
 #include <glog/logging.h>
+#include "data/tensor_half.hpp"
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 
@@ -58,7 +60,7 @@ StatusCode AdaptiveAveragePoolingLayer::Forward(
   }
 
   const uint32_t batch = inputs.size();
-#pragma omp parallel for num_threads(batch)
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch))
   for (uint32_t i = 0; i < batch; ++i) {
     const std::shared_ptr<Tensor<float>>& input_data = inputs.at(i);
     CHECK(input_data != nullptr && !input_data->empty())
@@ -94,29 +96,62 @@ StatusCode AdaptiveAveragePoolingLayer::Forward(
            "incorrectly sized tensor "
         << i << "th";
 
-    const uint32_t pooling_size = pooling_h * pooling_w;
     for (uint32_t ic = 0; ic < input_c; ++ic) {
-      const arma::fmat& input_channel = input_data->slice(ic);
-      arma::fmat& output_channel = output_data->slice(ic);
-      for (uint32_t c = 0; c < input_w - pooling_w + 1; c += stride_w) {
-        uint32_t output_col = uint32_t(c / stride_w);
-        for (uint32_t r = 0; r < input_h - pooling_h + 1; r += stride_h) {
-          uint32_t output_row = uint32_t(r / stride_h);
-          float mean_value = 0.f;
-          float* output_channel_ptr = output_channel.colptr(output_col);
-          for (uint32_t w = 0; w < pooling_w; ++w) {
-            const float* col_ptr = input_channel.colptr(c + w) + r;
-            for (uint32_t h = 0; h < pooling_h; ++h) {
-              float current_value = *(col_ptr + h);
-              mean_value = mean_value + current_value;
-            }
-          }
-          *(output_channel_ptr + output_row) = mean_value / float(pooling_size);
+      PoolChannel(input_data->raw_ptr(ic * input_h * input_w), input_h, input_w,
+                  output_data->raw_ptr(ic * output_h_ * output_w_));
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode AdaptiveAveragePoolingLayer::ForwardPacked(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    const std::vector<const HalfTensor*>& packed_inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  CHECK(packed_inputs.size() == outputs.size())
+      << "The input and output tensor array size of the adaptive pooling layer do not match";
+  for (uint32_t i = 0; i < outputs.size(); ++i) {
+    const std::shared_ptr<Tensor<float>>& output_data = outputs.at(i);
+    CHECK(output_data != nullptr && output_data->rows() == output_h_ &&
+          output_data->cols() == output_w_)
+        << "The output tensor array in the adaptive pooling layer has an "
+           "incorrectly sized tensor "
+        << i << "th";
+    const HalfTensor* packed_input = packed_inputs.at(i);
+    const std::vector<uint32_t> input_shapes =
+        packed_input != nullptr ? packed_input->shapes() : inputs.at(i)->shapes();
+    ForEachInputChannel(inputs.at(i), packed_input,
+                        [&](uint32_t channel, const float* input_channel) {
+                          PoolChannel(input_channel, input_shapes.at(1), input_shapes.at(2),
+                                      output_data->raw_ptr(channel * output_h_ * output_w_));
+                        });
+  }
+  return StatusCode::kSuccess;
+}
+
+void AdaptiveAveragePoolingLayer::PoolChannel(const float* input, uint32_t input_h,
+                                              uint32_t input_w, float* output) const {
+  const uint32_t stride_h = uint32_t(std::floor(input_h / output_h_));
+  const uint32_t stride_w = uint32_t(std::floor(input_w / output_w_));
+  const uint32_t pooling_h = (int32_t)input_h - (int32_t(output_h_) - 1) * int32_t(stride_h);
+  const uint32_t pooling_w = (int32_t)input_w - (int32_t(output_w_) - 1) * int32_t(stride_w);
+  const uint32_t pooling_size = pooling_h * pooling_w;
+  for (uint32_t c = 0; c < input_w - pooling_w + 1; c += stride_w) {
+    uint32_t output_col = uint32_t(c / stride_w);
+    float* output_channel_ptr = output + output_col * output_h_;
+    for (uint32_t r = 0; r < input_h - pooling_h + 1; r += stride_h) {
+      uint32_t output_row = uint32_t(r / stride_h);
+      float mean_value = 0.f;
+      for (uint32_t w = 0; w < pooling_w; ++w) {
+        const float* col_ptr = input + (c + w) * input_h + r;
+        for (uint32_t h = 0; h < pooling_h; ++h) {
+          float current_value = *(col_ptr + h);
+          mean_value = mean_value + current_value;
         }
       }
+      *(output_channel_ptr + output_row) = mean_value / float(pooling_size);
     }
   }
-  return StatusCode::kSuccess;
 }
 
 StatusCode AdaptiveAveragePoolingLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
@@ -32,10 +32,18 @@ class AdaptiveAveragePoolingLayer : public NonParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  bool is_packed_input_supported() const override { return true; }
+
+  StatusCode ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                           const std::vector<const HalfTensor*>& packed_inputs,
+                           std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
   static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                    std::shared_ptr<Layer<float>>& avg_layer);
 
  private:
+  void PoolChannel(const float* input, uint32_t input_h, uint32_t input_w, float* output) const;
+
   uint32_t output_h_ = 0;
   uint32_t output_w_ = 0;
 };
@@ -0,0 +1,597 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "attention.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/cpu_features.hpp"
+#include "utils/cpu/thread_budget.hpp"
+#include "utils/math/fmath.hpp"
+
+namespace kuiper_infer {
+
+#if KUIPER_X86_DISPATCH
+/**
+ * @brief Computes values[i] = exp(values[i] - row_max[i]) for i in [begin, end), 8 at a time
+ *
+ * @return First index that is not computed
+ */
+KUIPER_TARGET_AVX2 static uint32_t ExpShiftedAVX2(float* values, const float* row_max,
+                                                  uint32_t begin, uint32_t end) {
+  uint32_t i = begin;
+  for (; i + 7 < end; i += 8) {
+    const __m256 value =
+        _mm256_sub_ps(_mm256_loadu_ps(values + i), _mm256_loadu_ps(row_max + i));
+    _mm256_storeu_ps(values + i, fmath::exp_ps256(value));
+  }
+  return i;
+}
+#endif
+
+static void ExpShifted(float* values, const float* row_max, uint32_t begin, uint32_t end) {
+  uint32_t i = begin;
+#if KUIPER_X86_DISPATCH
+  static const bool use_avx2 = utils::GetCpuIsa() >= utils::CpuIsa::kAVX2;
+  if (use_avx2) {
+    i = ExpShiftedAVX2(values, row_max, begin, end);
+  }
+#endif
+  for (; i < end; ++i) {
+    values[i] = fmath::exp(values[i] - row_max[i]);
+  }
+}
+
+ScaledDotProductAttentionLayer::ScaledDotProductAttentionLayer(bool is_causal, float scale)
+    : NonParamLayer("ScaledDotProductAttention"), is_causal_(is_causal), scale_(scale) {}
+
+StatusCode ScaledDotProductAttentionLayer::Forward(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  return ForwardUnchecked(inputs, outputs);
+}
+
+StatusCode ScaledDotProductAttentionLayer::Check(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The input tensor array in the attention layer is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+
+  if (outputs.empty()) {
+    LOG(ERROR) << "The output tensor array in the attention layer is empty";
+    return StatusCode::kInferOutputsEmpty;
+  }
+
+  // 输入依次是查询, 键和值, 每个都有batch_size个张量
+  const uint32_t batch_size = outputs.size();
+  if (inputs.size() != batch_size * 3) {
+    LOG(ERROR) << "The input and output tensor array size of the attention layer do not match";
+    return StatusCode::kInferInOutDimMismatch;
+  }
+
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const std::shared_ptr<Tensor<float>>& query = inputs.at(i);
+    const std::shared_ptr<Tensor<float>>& key = inputs.at(i + batch_size);
+    const std::shared_ptr<Tensor<float>>& value = inputs.at(i + batch_size * 2);
+    CHECK(query != nullptr && !query->empty() && key != nullptr && !key->empty() &&
+          value != nullptr && !value->empty())
+        << "The input tensor array in the attention layer has an empty tensor " << i << " th";
+
+    if (key->channels() != query->channels() || value->channels() != query->channels()) {
+      LOG(ERROR) << "The head count of the query, key and value in the attention layer do "
+                    "not match "
+                 << i << " th";
+      return StatusCode::kInferInOutDimMismatch;
+    }
+
+    if (key->cols() != query->cols() || value->rows() != key->rows()) {
+      LOG(ERROR) << "The query, key and value shapes of the attention layer do not match " << i
+                 << " th";
+      return StatusCode::kInferInOutDimMismatch;
+    }
+
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(i);
+    if (output != nullptr && !output->empty()) {
+      CHECK(output->channels() == query->channels() && output->rows() == query->rows() &&
+            output->cols() == value->cols())
+          << "The output tensor shape of the attention layer is wrong " << i << " th";
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode ScaledDotProductAttentionLayer::ForwardUnchecked(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const uint32_t batch_size = outputs.size();
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const std::shared_ptr<Tensor<float>>& query = inputs.at(i);
+    const std::shared_ptr<Tensor<float>>& key = inputs.at(i + batch_size);
+    const std::shared_ptr<Tensor<float>>& value = inputs.at(i + batch_size * 2);
+    const uint32_t heads = query->channels();
+    const uint32_t query_len = query->rows();
+    const uint32_t head_dim = query->cols();
+    const uint32_t key_len = key->rows();
+    const uint32_t value_dim = value->cols();
+
+    std::shared_ptr<Tensor<float>> output = outputs.at(i);
+    if (output == nullptr || output->empty()) {
+      output = std::make_shared<Tensor<float>>(heads, query_len, value_dim);
+      outputs.at(i) = output;
+    }
+
+    ForwardHeads(query->raw_ptr(), key->raw_ptr(), value->raw_ptr(), output->raw_ptr(), heads,
+                 query_len, key_len, head_dim, value_dim);
+  }
+  return StatusCode::kSuccess;
+}
+
+void ScaledDotProductAttentionLayer::ForwardHeads(const float* query, const float* key,
+                                                  const float* value, float* output,
+                                                  uint32_t heads, uint32_t query_len,
+                                                  uint32_t key_len, uint32_t head_dim,
+                                                  uint32_t value_dim) const {
+  const float scale = scale_ != 0.f ? scale_ : 1.f / std::sqrt(float(head_dim));
+  const uint32_t query_tiles = (query_len + kQueryTile - 1) / kQueryTile;
+#pragma omp parallel for
+  for (uint32_t task = 0; task < heads * query_tiles; ++task) {
+    const uint32_t head = task / query_tiles;
+    const uint32_t query_begin = task % query_tiles * kQueryTile;
+    const uint32_t query_count = std::min(kQueryTile, query_len - query_begin);
+    AttentionTile(query + (size_t)head * query_len * head_dim,
+                  key + (size_t)head * key_len * head_dim,
+                  value + (size_t)head * key_len * value_dim,
+                  output + (size_t)head * query_len * value_dim, query_len, key_len, head_dim,
+                  value_dim, query_begin, query_count, scale);
+  }
+}
+
+void ScaledDotProductAttentionLayer::AttentionTile(const float* query, const float* key,
+                                                   const float* value, float* output,
+                                                   uint32_t query_len, uint32_t key_len,
+                                                   uint32_t head_dim, uint32_t value_dim,
+                                                   uint32_t query_begin, uint32_t query_count,
+                                                   float scale) const {
+  // 每个线程复用自己的缓冲区, 注意力矩阵每次只保存query_count x kKeyTile的一块
+  thread_local std::vector<float> query_tile;
+  thread_local std::vector<float> key_tile;
+  thread_local std::vector<float> value_tile;
+  thread_local std::vector<float> score_tile;
+  thread_local std::vector<float> output_tile;
+  thread_local std::vector<float> row_max;
+  thread_local std::vector<float> tile_max;
+  thread_local std::vector<float> row_sum;
+  thread_local std::vector<float> row_scale;
+  auto reserve = [](std::vector<float>& buffer, size_t size) {
+    if (buffer.size() < size) {
+      buffer.resize(size);
+    }
+  };
+  reserve(query_tile, (size_t)query_count * head_dim);
+  reserve(key_tile, (size_t)kKeyTile * head_dim);
+  reserve(value_tile, (size_t)kKeyTile * value_dim);
+  reserve(score_tile, (size_t)query_count * kKeyTile);
+  reserve(output_tile, (size_t)query_count * value_dim);
+  reserve(row_max, query_count);
+  reserve(tile_max, query_count);
+  reserve(row_sum, query_count);
+  reserve(row_scale, query_count);
+
+  // 缩放系数乘到查询上, 不必再缩放每个点积
+  for (uint32_t d = 0; d < head_dim; ++d) {
+    const float* query_col = query + (size_t)d * query_len + query_begin;
+    float* query_tile_col = query_tile.data() + (size_t)d * query_count;
+    for (uint32_t q = 0; q < query_count; ++q) {
+      query_tile_col[q] = query_col[q] * scale;
+    }
+  }
+  std::fill(output_tile.begin(), output_tile.begin() + (size_t)query_count * value_dim, 0.f);
+  std::fill(row_max.begin(), row_max.begin() + query_count, std::numeric_limits<float>::lowest());
+  std::fill(row_sum.begin(), row_sum.begin() + query_count, 0.f);
+
+  const arma::fmat query_matrix(query_tile.data(), query_count, head_dim, false, true);
+  arma::fmat output_matrix(output_tile.data(), query_count, value_dim, false, true);
+  // 因果注意力中第q个查询只能看到前q个键, 查询块之后的键可以直接跳过
+  const uint32_t key_end = is_causal_ ? std::min(key_len, query_begin + query_count) : key_len;
+  for (uint32_t key_begin = 0; key_begin < key_end; key_begin += kKeyTile) {
+    const uint32_t key_count = std::min(kKeyTile, key_end - key_begin);
+    for (uint32_t d = 0; d < head_dim; ++d) {
+      memcpy(key_tile.data() + (size_t)d * key_count, key + (size_t)d * key_len + key_begin,
+             key_count * sizeof(float));
+    }
+    for (uint32_t c = 0; c < value_dim; ++c) {
+      memcpy(value_tile.data() + (size_t)c * key_count, value + (size_t)c * key_len + key_begin,
+             key_count * sizeof(float));
+    }
+    const arma::fmat key_matrix(key_tile.data(), key_count, head_dim, false, true);
+    const arma::fmat value_matrix(value_tile.data(), key_count, value_dim, false, true);
+    arma::fmat score_matrix(score_tile.data(), query_count, key_count, false, true);
+    score_matrix = query_matrix * key_matrix.t();
+
+    // 第k个键只对该行及之后的查询可见
+    auto first_query = [&](uint32_t k) -> uint32_t {
+      if (!is_causal_ || key_begin + k <= query_begin) {
+        return 0;
+      }
+      return std::min(query_count, key_begin + k - query_begin);
+    };
+
+    std::copy(row_max.begin(), row_max.begin() + query_count, tile_max.begin());
+    for (uint32_t k = 0; k < key_count; ++k) {
+      const float* score_col = score_tile.data() + (size_t)k * query_count;
+      for (uint32_t q = first_query(k); q < query_count; ++q) {
+        tile_max[q] = std::max(tile_max[q], score_col[q]);
+      }
+    }
+
+    // 最大值变大后, 之前累加的和与输出按exp(旧最大值 - 新最大值)缩小
+    for (uint32_t q = 0; q < query_count; ++q) {
+      row_scale[q] = row_max[q] == std::numeric_limits<float>::lowest()
+                         ? 0.f
+                         : fmath::exp(row_max[q] - tile_max[q]);
+      row_sum[q] *= row_scale[q];
+      row_max[q] = tile_max[q];
+    }
+    for (uint32_t c = 0; c < value_dim; ++c) {
+      float* output_col = output_tile.data() + (size_t)c * query_count;
+      for (uint32_t q = 0; q < query_count; ++q) {
+        output_col[q] *= row_scale[q];
+      }
+    }
+
+    for (uint32_t k = 0; k < key_count; ++k) {
+      float* score_col = score_tile.data() + (size_t)k * query_count;
+      const uint32_t first = first_query(k);
+      std::fill(score_col, score_col + first, 0.f);
+      ExpShifted(score_col, row_max.data(), first, query_count);
+      for (uint32_t q = first; q < query_count; ++q) {
+        row_sum[q] += score_col[q];
+      }
+    }
+    output_matrix += score_matrix * value_matrix;
+  }
+
+  for (uint32_t c = 0; c < value_dim; ++c) {
+    const float* output_tile_col = output_tile.data() + (size_t)c * query_count;
+    float* output_col = output + (size_t)c * query_len + query_begin;
+    for (uint32_t q = 0; q < query_count; ++q) {
+      output_col[q] = output_tile_col[q] / row_sum[q];
+    }
+  }
+}
+
+StatusCode ScaledDotProductAttentionLayer::CreateInstance(
+    const std::shared_ptr<RuntimeOperator>& op, std::shared_ptr<Layer<float>>& attention_layer) {
+  CHECK(op != nullptr) << "Attention operator is nullptr";
+  if (op->input_operands_seq.size() != 3) {
+    LOG(ERROR) << "The attention layer needs the query, key and value inputs and does not "
+                  "support attention masks";
+    return StatusCode::kFunctionNotImplement;
+  }
+
+  const auto& params = op->params;
+  bool is_causal = false;
+  if (params.find("is_causal") != params.end()) {
+    auto causal_param = std::dynamic_pointer_cast<RuntimeParameterBool>(params.at("is_causal"));
+    if (!causal_param) {
+      LOG(ERROR) << "Can not find the is causal parameter";
+      return StatusCode::kParameterMissing;
+    }
+    is_causal = causal_param->value;
+  }
+
+  // scale为None时使用默认的缩放系数
+  float scale = 0.f;
+  if (params.find("scale") != params.end()) {
+    auto scale_param = std::dynamic_pointer_cast<RuntimeParameterFloat>(params.at("scale"));
+    if (scale_param) {
+      scale = scale_param->value;
+    }
+  }
+  attention_layer = std::make_shared<ScaledDotProductAttentionLayer>(is_causal, scale);
+  return StatusCode::kSuccess;
+}
+
+LayerRegistererWrapper kAttentionCreateInstance("F.scaled_dot_product_attention",
+                                                ScaledDotProductAttentionLayer::CreateInstance);
+
+MultiheadAttentionLayer::MultiheadAttentionLayer(uint32_t embed_dim, uint32_t num_heads,
+                                                 uint32_t kdim, uint32_t vdim, bool use_bias)
+    : ParamLayer("MultiheadAttention"),
+      embed_dim_(embed_dim),
+      num_heads_(num_heads),
+      kdim_(kdim),
+      vdim_(vdim),
+      use_bias_(use_bias) {
+  CHECK(num_heads_ > 0 && embed_dim_ % num_heads_ == 0)
+      << "The embed dim of the multi-head attention has to be divisible by the head count";
+  // 依次为查询, 键, 值和输出的投影
+  const uint32_t in_features[4] = {embed_dim_, kdim_, vdim_, embed_dim_};
+  for (uint32_t in_feature : in_features) {
+    this->weights_.push_back(std::make_shared<ftensor>(1, embed_dim_, in_feature));
+  }
+  if (use_bias_) {
+    this->InitBiasParam(4, 1, 1, embed_dim_);
+  }
+}
+
+StatusCode MultiheadAttentionLayer::Forward(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  return ForwardUnchecked(inputs, outputs);
+}
+
+StatusCode MultiheadAttentionLayer::Check(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The input tensor array in the multi-head attention layer is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+
+  if (outputs.empty()) {
+    LOG(ERROR) << "The output tensor array in the multi-head attention layer is empty";
+    return StatusCode::kInferOutputsEmpty;
+  }
+
+  // 输入是自注意力的一个操作数, 或者依次是查询, 键和值
+  const uint32_t batch_size = outputs.size();
+  if (inputs.size() != batch_size && inputs.size() != batch_size * 3) {
+    LOG(ERROR) << "The input and output tensor array size of the multi-head attention layer "
+                  "do not match";
+    return StatusCode::kInferInOutDimMismatch;
+  }
+
+  if (weights_.size() != 4 || (use_bias_ && bias_.size() != 4)) {
+    LOG(ERROR) << "The multi-head attention layer needs four projection weights";
+    return StatusCode::kInferParameterError;
+  }
+
+  const bool self_attention = inputs.size() == batch_size;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const std::shared_ptr<Tensor<float>>& query = inputs.at(i);
+    const std::shared_ptr<Tensor<float>>& key =
+        self_attention ? query : inputs.at(i + batch_size);
+    const std::shared_ptr<Tensor<float>>& value =
+        self_attention ? query : inputs.at(i + batch_size * 2);
+    CHECK(query != nullptr && !query->empty() && key != nullptr && !key->empty() &&
+          value != nullptr && !value->empty())
+        << "The input tensor array in the multi-head attention layer has an empty tensor " << i
+        << " th";
+
+    if (query->channels() != 1 || key->channels() != 1 || value->channels() != 1 ||
+        query->cols() != embed_dim_ || key->cols() != kdim_ || value->cols() != vdim_ ||
+        key->rows() != value->rows()) {
+      LOG(ERROR) << "The query, key and value shapes of the multi-head attention layer do not "
+                    "match "
+                 << i << " th";
+      return StatusCode::kInferInOutDimMismatch;
+    }
+
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(i);
+    if (output != nullptr && !output->empty()) {
+      CHECK(output->channels() == 1 && output->rows() == query->rows() &&
+            output->cols() == embed_dim_)
+          << "The output tensor shape of the multi-head attention layer is wrong " << i << " th";
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+void MultiheadAttentionLayer::Project(const sftensor& input, uint32_t index,
+                                      float* output) const {
+  const sftensor& weight = weights_.at(index);
+  const arma::fmat input_matrix(input->raw_ptr(), input->rows(), input->cols(), false, true);
+  const arma::fmat weight_matrix(weight->raw_ptr(), weight->rows(), weight->cols(), false, true);
+  arma::fmat output_matrix(output, input->rows(), embed_dim_, false, true);
+  output_matrix = input_matrix * weight_matrix.t();
+  if (use_bias_) {
+    const arma::fmat& bias = bias_.at(index)->slice(0);
+    for (uint32_t row = 0; row < output_matrix.n_rows; ++row) {
+      output_matrix.row(row) += bias;
+    }
+  }
+}
+
+StatusCode MultiheadAttentionLayer::ForwardUnchecked(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const uint32_t batch_size = outputs.size();
+  const bool self_attention = inputs.size() == batch_size;
+  const uint32_t head_dim = embed_dim_ / num_heads_;
+  // 和AttentionTile一样复用调用线程的投影和输出缓冲区, 不为每次调用分配张量
+  thread_local std::vector<float> query_heads;
+  thread_local std::vector<float> key_heads;
+  thread_local std::vector<float> value_heads;
+  thread_local std::vector<float> head_outputs;
+  // 注意力核在头和查询块上并行, 批次依次执行
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const std::shared_ptr<Tensor<float>>& query = inputs.at(i);
+    const std::shared_ptr<Tensor<float>>& key =
+        self_attention ? query : inputs.at(i + batch_size);
+    const std::shared_ptr<Tensor<float>>& value =
+        self_attention ? query : inputs.at(i + batch_size * 2);
+    const uint32_t query_len = query->rows();
+    const uint32_t key_len = key->rows();
+
+    // 投影后的rows x embed_dim矩阵按列存储, 正好是每个头一个通道的张量
+    if (query_heads.size() < (size_t)query_len * embed_dim_) {
+      query_heads.resize((size_t)query_len * embed_dim_);
+      head_outputs.resize((size_t)query_len * embed_dim_);
+    }
+    if (key_heads.size() < (size_t)key_len * embed_dim_) {
+      key_heads.resize((size_t)key_len * embed_dim_);
+      value_heads.resize((size_t)key_len * embed_dim_);
+    }
+    Project(query, 0, query_heads.data());
+    Project(key, 1, key_heads.data());
+    Project(value, 2, value_heads.data());
+    attention_.ForwardHeads(query_heads.data(), key_heads.data(), value_heads.data(),
+                            head_outputs.data(), num_heads_, query_len, key_len, head_dim,
+                            head_dim);
+
+    std::shared_ptr<Tensor<float>> output = outputs.at(i);
+    if (output == nullptr || output->empty()) {
+      output = std::make_shared<Tensor<float>>(1, query_len, embed_dim_);
+      outputs.at(i) = output;
+    }
+    // 各头的输出已经按列拼接, 直接做输出投影
+    const arma::fmat concat(head_outputs.data(), query_len, embed_dim_, false, true);
+    const sftensor& out_weight = weights_.at(3);
+    const arma::fmat out_weight_matrix(out_weight->raw_ptr(), embed_dim_, embed_dim_, false, true);
+    arma::fmat& result = output->slice(0);
+    result = concat * out_weight_matrix.t();
+    if (use_bias_) {
+      const arma::fmat& bias = bias_.at(3)->slice(0);
+      for (uint32_t row = 0; row < result.n_rows; ++row) {
+        result.row(row) += bias;
+      }
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode MultiheadAttentionLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                                   std::shared_ptr<Layer<float>>& attention_layer) {
+  CHECK(op != nullptr) << "Multi-head attention operator is nullptr";
+  if (op->input_operands_seq.size() != 1 && op->input_operands_seq.size() != 3) {
+    LOG(ERROR) << "The multi-head attention layer needs the query, key and value inputs and "
+                  "does not support attention masks";
+    return StatusCode::kFunctionNotImplement;
+  }
+
+  const auto& params = op->params;
+  auto get_int = [&params](const std::string& name, int32_t& value) {
+    if (params.find(name) == params.end()) {
+      return false;
+    }
+    auto int_param = std::dynamic_pointer_cast<RuntimeParameterInt>(params.at(name));
+    if (!int_param) {
+      return false;
+    }
+    value = int_param->value;
+    return true;
+  };
+  auto get_bool = [&params](const std::string& name, bool& value) {
+    if (params.find(name) == params.end()) {
+      return false;
+    }
+    auto bool_param = std::dynamic_pointer_cast<RuntimeParameterBool>(params.at(name));
+    if (!bool_param) {
+      return false;
+    }
+    value = bool_param->value;
+    return true;
+  };
+
+  int32_t embed_dim = 0;
+  int32_t num_heads = 0;
+  if (!get_int("embed_dim", embed_dim) || !get_int("num_heads", num_heads)) {
+    LOG(ERROR) << "Can not find the embed dim or num heads parameter";
+    return StatusCode::kParameterMissing;
+  }
+  if (embed_dim <= 0 || num_heads <= 0 || embed_dim % num_heads != 0) {
+    LOG(ERROR) << "The embed dim has to be divisible by the head count";
+    return StatusCode::kInferParameterError;
+  }
+  int32_t kdim = embed_dim;
+  int32_t vdim = embed_dim;
+  get_int("kdim", kdim);
+  get_int("vdim", vdim);
+
+  // 运行时的第一维是批次, 只支持batch_first
+  bool batch_first = false;
+  bool add_bias_kv = false;
+  bool add_zero_attn = false;
+  get_bool("batch_first", batch_first);
+  get_bool("add_bias_kv", add_bias_kv);
+  get_bool("add_zero_attn", add_zero_attn);
+  if (!batch_first || add_bias_kv || add_zero_attn) {
+    LOG(ERROR) << "The multi-head attention layer only supports batch_first without "
+                  "add_bias_kv and add_zero_attn";
+    return StatusCode::kFunctionNotImplement;
+  }
+
+  const auto& attrs = op->attribute;
+  const bool use_bias = attrs.find("in_proj_bias") != attrs.end();
+  if (attrs.find("out_proj.weight") == attrs.end() ||
+      (use_bias && attrs.find("out_proj.bias") == attrs.end())) {
+    LOG(ERROR) << "Can not find the output projection attribute";
+    return StatusCode::kAttributeMissing;
+  }
+
+  // 维度相同时查询, 键和值的投影拼接在in_proj_weight中
+  std::vector<std::vector<float>> weights;
+  if (attrs.find("in_proj_weight") != attrs.end()) {
+    const std::vector<float>& in_proj_weight = attrs.at("in_proj_weight")->get<float>();
+    const size_t weight_size = size_t(embed_dim) * embed_dim;
+    CHECK_EQ(in_proj_weight.size(), weight_size * 3);
+    for (uint32_t i = 0; i < 3; ++i) {
+      weights.emplace_back(in_proj_weight.begin() + i * weight_size,
+                           in_proj_weight.begin() + (i + 1) * weight_size);
+    }
+  } else {
+    for (const std::string name : {"q_proj_weight", "k_proj_weight", "v_proj_weight"}) {
+      if (attrs.find(name) == attrs.end()) {
+        LOG(ERROR) << "Can not find the " << name << " attribute";
+        return StatusCode::kAttributeMissing;
+      }
+      weights.push_back(attrs.at(name)->get<float>());
+    }
+  }
+  weights.push_back(attrs.at("out_proj.weight")->get<float>());
+
+  auto layer = std::make_shared<MultiheadAttentionLayer>(embed_dim, num_heads, kdim, vdim,
+                                                         use_bias);
+  for (uint32_t i = 0; i < weights.size(); ++i) {
+    layer->weights_.at(i)->Fill(weights.at(i));
+  }
+  if (use_bias) {
+    const std::vector<float>& in_proj_bias = attrs.at("in_proj_bias")->get<float>();
+    CHECK_EQ(in_proj_bias.size(), size_t(embed_dim) * 3);
+    for (uint32_t i = 0; i < 3; ++i) {
+      layer->bias_.at(i)->Fill(std::vector<float>(in_proj_bias.begin() + i * embed_dim,
+                                                  in_proj_bias.begin() + (i + 1) * embed_dim));
+    }
+    layer->bias_.at(3)->Fill(attrs.at("out_proj.bias")->get<float>());
+  }
+  attention_layer = layer;
+  return StatusCode::kSuccess;
+}
+
+LayerRegistererWrapper kMultiheadAttentionCreateInstance("nn.MultiheadAttention",
+                                                         MultiheadAttentionLayer::CreateInstance);
+
+}  // namespace kuiper_infer
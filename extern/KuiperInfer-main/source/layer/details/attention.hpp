@@ -0,0 +1,147 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_SOURCE_LAYER_DETAILS_ATTENTION_HPP_
+#define KUIPER_INFER_SOURCE_LAYER_DETAILS_ATTENTION_HPP_
+#include "layer/abstract/non_param_layer.hpp"
+#include "layer/abstract/param_layer.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief Fused scaled dot-product attention like F.scaled_dot_product_attention
+ *
+ * The query, key and value inputs have one channel per head and one row per token. Each
+ * thread takes a tile of queries of one head, multiplies it with tiles of keys, updates
+ * the running row maximum and sum of the softmax and accumulates the product with the
+ * value tile, so the whole attention matrix is never materialized.
+ */
+class ScaledDotProductAttentionLayer : public NonParamLayer {
+ public:
+  /// 每个线程处理的查询行数和每次读取的键行数
+  static constexpr uint32_t kQueryTile = 64;
+  static constexpr uint32_t kKeyTile = 64;
+
+  /**
+   * @param is_causal Query i only attends to the keys up to i
+   * @param scale Factor of the dot products, 1 / sqrt(head dimension) if zero
+   */
+  explicit ScaledDotProductAttentionLayer(bool is_causal = false, float scale = 0.f);
+
+  StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  StatusCode Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const override;
+
+  StatusCode ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                              std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                   std::shared_ptr<Layer<float>>& attention_layer);
+
+  /**
+   * @brief Computes the attention of every head of one sequence, in parallel over the
+   * heads and the query tiles
+   *
+   * The buffers are in the tensor layout with one channel per head, so callers can pass
+   * their own scratch memory instead of tensors.
+   *
+   * @param query heads x query_len x head_dim values
+   * @param key heads x key_len x head_dim values
+   * @param value heads x key_len x value_dim values
+   * @param output heads x query_len x value_dim values
+   */
+  void ForwardHeads(const float* query, const float* key, const float* value, float* output,
+                    uint32_t heads, uint32_t query_len, uint32_t key_len, uint32_t head_dim,
+                    uint32_t value_dim) const;
+
+ private:
+  /**
+   * @brief Computes the attention output of query rows [query_begin, query_begin +
+   * query_count) of one head
+   *
+   * @param query Column-major query_len x head_dim matrix of the head
+   * @param key Column-major key_len x head_dim matrix of the head
+   * @param value Column-major key_len x value_dim matrix of the head
+   * @param output Column-major query_len x value_dim matrix of the head
+   */
+  void AttentionTile(const float* query, const float* key, const float* value, float* output,
+                     uint32_t query_len, uint32_t key_len, uint32_t head_dim,
+                     uint32_t value_dim, uint32_t query_begin, uint32_t query_count,
+                     float scale) const;
+
+ private:
+  bool is_causal_ = false;
+  float scale_ = 0.f;
+};
+
+/**
+ * @brief Multi-head attention like nn.MultiheadAttention with batch_first
+ *
+ * The inputs and the output have one row per token and one column per feature.
+ * The projected query, key and value of a sequence are stored as one tensor with a
+ * channel per head, which is the same memory as the projected matrix, so the heads
+ * run through the fused ScaledDotProductAttentionLayer without being copied apart.
+ * The weights are the query, key, value and output projections, each out x in.
+ */
+class MultiheadAttentionLayer : public ParamLayer {
+ public:
+  /**
+   * @param embed_dim Features of the query and the output
+   * @param num_heads Number of heads, has to divide embed_dim
+   * @param kdim Features of the key
+   * @param vdim Features of the value
+   * @param use_bias The projections add a bias
+   */
+  explicit MultiheadAttentionLayer(uint32_t embed_dim, uint32_t num_heads, uint32_t kdim,
+                                   uint32_t vdim, bool use_bias);
+
+  StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  StatusCode Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const override;
+
+  StatusCode ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                              std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                   std::shared_ptr<Layer<float>>& attention_layer);
+
+ private:
+  /**
+   * @brief Computes output = input * weight^T + bias of the projection index
+   *
+   * @param output Column-major rows x embed_dim matrix
+   */
+  void Project(const sftensor& input, uint32_t index, float* output) const;
+
+  uint32_t embed_dim_ = 0;
+  uint32_t num_heads_ = 1;
+  uint32_t kdim_ = 0;
+  uint32_t vdim_ = 0;
+  bool use_bias_ = true;
+  ScaledDotProductAttentionLayer attention_;
+};
+}  // namespace kuiper_infer
+
+#endif  // KUIPER_INFER_SOURCE_LAYER_DETAILS_ATTENTION_HPP_
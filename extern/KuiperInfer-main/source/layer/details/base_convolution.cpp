@@ -26,6 +26,7 @@
 #include "convolution.hpp"
 #include "deconvolution.hpp"
 #include "status_code.hpp"
+#include "utils/cpu/thread_budget.hpp"
 namespace kuiper_infer {
 BaseConvolutionLayer::BaseConvolutionLayer(ConvType conv_type, uint32_t output_channel,
                                            uint32_t in_channel, uint32_t kernel_h,
@@ -74,8 +75,6 @@ BaseConvolutionLayer::BaseConvolutionLayer(ConvType conv_type, uint32_t output_c
   }
 }
 
-void BaseConvolutionLayer::InitIm2ColWeight() {}
-
 void BaseConvolutionLayer::AddBias(arma::fmat& output, uint32_t bias_index) const {
   if (!this->bias_.empty() && this->use_bias_) {
     std::shared_ptr<Tensor<float>> bias;
@@ -91,6 +90,16 @@ void BaseConvolutionLayer::AddBias(arma::fmat& output, uint32_t bias_index) cons
 
 StatusCode BaseConvolutionLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                                          std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  return ForwardUnchecked(inputs, outputs);
+}
+
+StatusCode BaseConvolutionLayer::Check(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
   if (inputs.empty()) {
     LOG(ERROR) << "The input tensor array in the convolution layer is empty";
     return StatusCode::kInferInputsEmpty;
@@ -118,7 +127,7 @@ StatusCode BaseConvolutionLayer::Forward(const std::vector<std::shared_ptr<Tenso
     return StatusCode::kInferParameterError;
   }
 
-  if (!stride_h_ || !stride_h_) {
+  if (!stride_h_ || !stride_w_) {
     LOG(ERROR) << "The stride in the convolution layer should be greater "
                   "than zero";
     return StatusCode::kInferParameterError;
@@ -159,14 +168,7 @@ StatusCode BaseConvolutionLayer::Forward(const std::vector<std::shared_ptr<Tenso
     CHECK(kernel->channels() == kernel_channel);
   }
 
-  if (this->kernel_matrix_arr_.empty()) {
-    InitIm2ColWeight();
-  }
-  const uint32_t batch_size = inputs.size();
-  const uint32_t kernel_count_group = kernel_count / groups_;
-
-#pragma omp parallel for num_threads(batch_size)
-  for (uint32_t i = 0; i < batch_size; ++i) {
+  for (uint32_t i = 0; i < inputs.size(); ++i) {
     const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
         << "The input tensor array in the convolution layer has an empty  "
@@ -182,27 +184,52 @@ StatusCode BaseConvolutionLayer::Forward(const std::vector<std::shared_ptr<Tenso
     CHECK(output_h > 0 && output_w > 0)
         << "The size of the output tensor should be greater than zero " << i << " th";
 
+    const std::shared_ptr<Tensor<float>>& output_tensor = outputs.at(i);
+    if (output_tensor != nullptr && !output_tensor->empty()) {
+      CHECK(output_tensor->rows() == output_h && output_tensor->cols() == output_w &&
+            output_tensor->channels() == kernel_count)
+          << "The output tensor array in the convolution layer has an "
+             "incorrectly sized tensor "
+          << i << "th";
+    }
+
+    if (groups_ != 1) {
+      CHECK(kernel_count % groups_ == 0);
+      CHECK(input_c % groups_ == 0);
+    }
+    const uint32_t channels_per_group = input_c / groups_;
+    CHECK(channels_per_group == kernel_channel) << "The number of channel for the kernel "
+                                                   "matrix and input tensor do not match";
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode BaseConvolutionLayer::ForwardUnchecked(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const uint32_t kernel_count = this->weights_.size();
+  const uint32_t kernel_h = this->weights_.at(0)->rows();
+  const uint32_t kernel_w = this->weights_.at(0)->cols();
+  const uint32_t batch_size = inputs.size();
+  const uint32_t kernel_count_group = kernel_count / groups_;
+
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
+    const uint32_t input_h = input->rows();
+    const uint32_t input_w = input->cols();
+    const uint32_t input_c = input->channels();
+    const auto [output_h, output_w] = ComputeOutputSize(input_h, input_w, kernel_h, kernel_w);
+
     std::shared_ptr<Tensor<float>> output_tensor = outputs.at(i);
     if (output_tensor == nullptr || output_tensor->empty()) {
       output_tensor = std::make_shared<Tensor<float>>(kernel_count, output_h, output_w);
       outputs.at(i) = output_tensor;
     }
 
-    CHECK(output_tensor->rows() == output_h && output_tensor->cols() == output_w &&
-          output_tensor->channels() == kernel_count)
-        << "The output tensor array in the convolution layer has an "
-           "incorrectly sized tensor "
-        << i << "th";
-
+    const uint32_t channels_per_group = input_c / groups_;
 #pragma omp parallel for if (groups_ > 1)
     for (uint32_t group = 0; group < groups_; ++group) {
-      if (groups_ != 1) {
-        CHECK(kernel_count % groups_ == 0);
-        CHECK(input_c % groups_ == 0);
-      }
-      const uint32_t channels_per_group = input_c / groups_;
-      CHECK(channels_per_group == kernel_channel) << "The number of channel for the kernel "
-                                                     "matrix and input tensor do not match";
       ComputeOutput(input, output_tensor, kernel_h, kernel_w, kernel_count_group, input_h, input_w,
                     channels_per_group, output_h, output_w, group);
     }
@@ -414,12 +441,8 @@ StatusCode BaseConvolutionLayer::CreateInstance(const std::shared_ptr<RuntimeOpe
   }
 
   const std::vector<float>& weight_values = weight->get<float>();
+  // 普通卷积在set_weights中展开权重矩阵
   conv_layer->set_weights(weight_values);
-
-  auto conv_layer_derived = std::dynamic_pointer_cast<BaseConvolutionLayer>(conv_layer);
-  CHECK(conv_layer_derived != nullptr);
-  conv_layer_derived->InitIm2ColWeight();
-
   return StatusCode::kSuccess;
 }
 
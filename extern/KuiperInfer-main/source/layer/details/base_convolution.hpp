@@ -48,6 +48,12 @@ class BaseConvolutionLayer : public ParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  StatusCode Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const override;
+
+  StatusCode ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                              std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
  private:
   virtual void ComputeOutput(sftensor input, sftensor output_tensor, uint32_t kernel_h,
                              uint32_t kernel_w, uint32_t kernel_count_group, uint32_t input_h,
@@ -58,8 +64,6 @@ class BaseConvolutionLayer : public ParamLayer {
                                                           uint32_t kernel_h,
                                                           uint32_t kernel_w) const = 0;
 
-  virtual void InitIm2ColWeight();
-
  protected:
   void AddBias(arma::fmat& output, uint32_t bias_index) const;
 
@@ -79,7 +83,11 @@ class BaseConvolutionLayer : public ParamLayer {
   uint32_t dilation_w_ = 1;
 
   ConvType conv_type_ = ConvType::kOpConvUnknown;
-  std::vector<arma::frowvec> kernel_matrix_arr_;
+  // 卷积的每组权重矩阵, 大小为(channels_per_group * kernel_h * kernel_w) x kernel_count_group
+  std::vector<arma::fmat> kernel_matrix_arr_;
+
+  // 每个NUMA节点一份kernel_matrix_arr_的副本, 为空时所有线程读取kernel_matrix_arr_
+  std::vector<std::vector<arma::fmat>> kernel_matrix_replicas_;
 };
 }  // namespace kuiper_infer
 #endif  // KUIPER_INFER_SOURCE_LAYER_DETAILS_BASE_CONVOLUTION_H
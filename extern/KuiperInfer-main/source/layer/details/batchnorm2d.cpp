@@ -23,11 +23,22 @@
 #include "batchnorm2d.hpp"
 #include "layer/abstract/layer_factory.hpp"
 #include "runtime/runtime_ir.hpp"
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 
 StatusCode BatchNorm2dLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  return ForwardUnchecked(inputs, outputs);
+}
+
+StatusCode BatchNorm2dLayer::Check(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
   if (inputs.empty()) {
     LOG(ERROR) << "The input tensor array in the batchnorm2d layer is empty";
     return StatusCode::kInferInputsEmpty;
@@ -63,33 +74,48 @@ StatusCode BatchNorm2dLayer::Forward(const std::vector<std::shared_ptr<Tensor<fl
                   "weight and affine bias";
     return StatusCode::kInferParameterError;
   }
-  const uint32_t batch_size = inputs.size();
-#pragma omp parallel for num_threads(batch_size)
-  for (uint32_t b = 0; b < batch_size; ++b) {
+
+  for (uint32_t i = 0; i < mean_value_size; ++i) {
+    CHECK(weights_.at(i)->size() == 1 && bias_.at(i)->size() == 1);
+  }
+
+  for (uint32_t b = 0; b < inputs.size(); ++b) {
     const auto& input = inputs.at(b);
     CHECK(input != nullptr && !input->empty())
         << "The input tensor array in the batchnorm2d layer has an "
            "empty tensor "
         << b << " th";
 
+    const auto& output = outputs.at(b);
+    if (output != nullptr && !output->empty()) {
+      CHECK(output->shapes() == input->shapes())
+          << "The input and output tensor shapes of the batchnorm2d "
+             "layer do not match "
+          << b << " th";
+    }
+    CHECK(input->channels() >= mean_value_size)
+        << "In the batchnorm2d layer, too few channels for input tensor " << b << " th";
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode BatchNorm2dLayer::ForwardUnchecked(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const uint32_t mean_value_size = this->weights_.size();
+  const uint32_t batch_size = inputs.size();
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
+  for (uint32_t b = 0; b < batch_size; ++b) {
+    const auto& input = inputs.at(b);
     std::shared_ptr<Tensor<float>> output = outputs.at(b);
     if (output == nullptr || output->empty()) {
       output = std::make_shared<Tensor<float>>(input->shapes());
       outputs.at(b) = output;
     }
 
-    CHECK(output->shapes() == input->shapes())
-        << "The input and output tensor shapes of the batchnorm2d "
-           "layer do not match "
-        << b << " th";
-
     for (uint32_t i = 0; i < mean_value_size; ++i) {
-      CHECK(weights_.at(i)->size() == 1 && bias_.at(i)->size() == 1);
       const float mean_value = weights_.at(i)->index(0);
       const float var_value = bias_.at(i)->index(0);
-      CHECK(input->channels() > i)
-          << "In the batchnorm2d layer, too few channels for input tensor " << b << " th";
-
       const float var_value_ = std::sqrt(var_value + eps_);
       output->slice(i) =
           ((input->slice(i) - mean_value) / var_value_) * affine_weight_.at(i) + affine_bias_.at(i);
@@ -0,0 +1,198 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "block_sparse.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include "utils/cpu/cpu_features.hpp"
+#if KUIPER_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace kuiper_infer {
+using Matrix = BlockSparseMatrix;
+
+#if KUIPER_X86_DISPATCH
+/**
+ * @brief Computes the output columns of one block row for the first rows divisible by 8
+ *
+ * Every step keeps a 16 x kBlockRows output tile in registers and reads one input
+ * column per input feature of the stored blocks.
+ *
+ * @return Number of rows computed
+ */
+KUIPER_TARGET_AVX2 static uint32_t MultiplyBlockRowAVX2(
+    const float* input, uint32_t rows, uint32_t input_features, const uint32_t* block_cols,
+    const float* block_values, uint32_t block_count, uint32_t output_count, float* output) {
+  uint32_t row = 0;
+  for (; row + 15 < rows; row += 16) {
+    __m256 sums0[Matrix::kBlockRows];
+    __m256 sums1[Matrix::kBlockRows];
+    for (uint32_t n = 0; n < Matrix::kBlockRows; ++n) {
+      sums0[n] = _mm256_setzero_ps();
+      sums1[n] = _mm256_setzero_ps();
+    }
+    for (uint32_t block = 0; block < block_count; ++block) {
+      const uint32_t k_begin = block_cols[block] * Matrix::kBlockCols;
+      const uint32_t k_count = std::min(Matrix::kBlockCols, input_features - k_begin);
+      const float* values = block_values + block * Matrix::kBlockCols * Matrix::kBlockRows;
+      for (uint32_t k = 0; k < k_count; ++k) {
+        const float* input_col = input + (size_t)(k_begin + k) * rows + row;
+        const __m256 input0 = _mm256_loadu_ps(input_col);
+        const __m256 input1 = _mm256_loadu_ps(input_col + 8);
+        for (uint32_t n = 0; n < Matrix::kBlockRows; ++n) {
+          const __m256 value = _mm256_broadcast_ss(values + k * Matrix::kBlockRows + n);
+          sums0[n] = _mm256_fmadd_ps(input0, value, sums0[n]);
+          sums1[n] = _mm256_fmadd_ps(input1, value, sums1[n]);
+        }
+      }
+    }
+    for (uint32_t n = 0; n < output_count; ++n) {
+      _mm256_storeu_ps(output + (size_t)n * rows + row, sums0[n]);
+      _mm256_storeu_ps(output + (size_t)n * rows + row + 8, sums1[n]);
+    }
+  }
+
+  for (; row + 7 < rows; row += 8) {
+    __m256 sums[Matrix::kBlockRows];
+    for (uint32_t n = 0; n < Matrix::kBlockRows; ++n) {
+      sums[n] = _mm256_setzero_ps();
+    }
+    for (uint32_t block = 0; block < block_count; ++block) {
+      const uint32_t k_begin = block_cols[block] * Matrix::kBlockCols;
+      const uint32_t k_count = std::min(Matrix::kBlockCols, input_features - k_begin);
+      const float* values = block_values + block * Matrix::kBlockCols * Matrix::kBlockRows;
+      for (uint32_t k = 0; k < k_count; ++k) {
+        const __m256 input0 = _mm256_loadu_ps(input + (size_t)(k_begin + k) * rows + row);
+        for (uint32_t n = 0; n < Matrix::kBlockRows; ++n) {
+          const __m256 value = _mm256_broadcast_ss(values + k * Matrix::kBlockRows + n);
+          sums[n] = _mm256_fmadd_ps(input0, value, sums[n]);
+        }
+      }
+    }
+    for (uint32_t n = 0; n < output_count; ++n) {
+      _mm256_storeu_ps(output + (size_t)n * rows + row, sums[n]);
+    }
+  }
+  return row;
+}
+#endif
+
+std::shared_ptr<BlockSparseMatrix> BlockSparseMatrix::Create(const arma::fmat& matrix,
+                                                             float max_density) {
+  CHECK(!matrix.empty()) << "The weight matrix is empty";
+  const uint32_t input_features = matrix.n_rows;
+  const uint32_t output_features = matrix.n_cols;
+  const uint32_t block_row_count = (output_features + kBlockRows - 1) / kBlockRows;
+  const uint32_t block_col_count = (input_features + kBlockCols - 1) / kBlockCols;
+
+  auto sparse_matrix = std::make_shared<BlockSparseMatrix>();
+  sparse_matrix->input_features_ = input_features;
+  sparse_matrix->output_features_ = output_features;
+  sparse_matrix->block_row_offsets_.push_back(0);
+  for (uint32_t block_row = 0; block_row < block_row_count; ++block_row) {
+    const uint32_t n_begin = block_row * kBlockRows;
+    const uint32_t n_count = std::min(kBlockRows, output_features - n_begin);
+    for (uint32_t block_col = 0; block_col < block_col_count; ++block_col) {
+      const uint32_t k_begin = block_col * kBlockCols;
+      const uint32_t k_count = std::min(kBlockCols, input_features - k_begin);
+      // 边缘的块用0补齐
+      float values[kBlockCols * kBlockRows] = {0.f};
+      bool zero_block = true;
+      for (uint32_t n = 0; n < n_count; ++n) {
+        for (uint32_t k = 0; k < k_count; ++k) {
+          const float value = matrix.at(k_begin + k, n_begin + n);
+          values[k * kBlockRows + n] = value;
+          zero_block = zero_block && value == 0.f;
+        }
+      }
+      if (!zero_block) {
+        sparse_matrix->block_cols_.push_back(block_col);
+        sparse_matrix->block_values_.insert(sparse_matrix->block_values_.end(), values,
+                                            values + kBlockCols * kBlockRows);
+      }
+    }
+    sparse_matrix->block_row_offsets_.push_back(uint32_t(sparse_matrix->block_cols_.size()));
+  }
+
+  sparse_matrix->density_ =
+      float(sparse_matrix->block_cols_.size()) / float(block_row_count * block_col_count);
+  if (sparse_matrix->density_ > max_density) {
+    return nullptr;
+  }
+  return sparse_matrix;
+}
+
+void BlockSparseMatrix::Multiply(const float* input, uint32_t rows, float* output) const {
+  CHECK(input != nullptr && output != nullptr);
+  const uint32_t block_row_count = uint32_t(block_row_offsets_.size()) - 1;
+#if KUIPER_X86_DISPATCH
+  static const bool use_avx2 = utils::GetCpuIsa() >= utils::CpuIsa::kAVX2;
+#endif
+
+#pragma omp parallel for
+  for (uint32_t block_row = 0; block_row < block_row_count; ++block_row) {
+    const uint32_t n_begin = block_row * kBlockRows;
+    const uint32_t n_count = std::min(kBlockRows, output_features_ - n_begin);
+    const uint32_t block_begin = block_row_offsets_.at(block_row);
+    const uint32_t block_count = block_row_offsets_.at(block_row + 1) - block_begin;
+    float* output_block = output + (size_t)n_begin * rows;
+
+    uint32_t row_begin = 0;
+#if KUIPER_X86_DISPATCH
+    if (use_avx2) {
+      row_begin = MultiplyBlockRowAVX2(input, rows, input_features_,
+                                       block_cols_.data() + block_begin,
+                                       block_values_.data() + (size_t)block_begin * kBlockCols *
+                                                                  kBlockRows,
+                                       block_count, n_count, output_block);
+    }
+#endif
+    if (row_begin == rows) {
+      continue;
+    }
+
+    // 剩余的行按输出列做向量累加
+    for (uint32_t n = 0; n < n_count; ++n) {
+      std::fill(output_block + (size_t)n * rows + row_begin, output_block + (size_t)(n + 1) * rows,
+                0.f);
+    }
+    for (uint32_t block = block_begin; block < block_begin + block_count; ++block) {
+      const uint32_t k_begin = block_cols_.at(block) * kBlockCols;
+      const uint32_t k_count = std::min(kBlockCols, input_features_ - k_begin);
+      const float* values = block_values_.data() + (size_t)block * kBlockCols * kBlockRows;
+      for (uint32_t k = 0; k < k_count; ++k) {
+        const float* input_col = input + (size_t)(k_begin + k) * rows;
+        for (uint32_t n = 0; n < n_count; ++n) {
+          const float value = values[k * kBlockRows + n];
+          if (value == 0.f) {
+            continue;
+          }
+          float* output_col = output_block + (size_t)n * rows;
+          for (uint32_t row = row_begin; row < rows; ++row) {
+            output_col[row] += value * input_col[row];
+          }
+        }
+      }
+    }
+  }
+}
+}  // namespace kuiper_infer
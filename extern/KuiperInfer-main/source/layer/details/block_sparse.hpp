@@ -0,0 +1,92 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_SOURCE_LAYER_DETAILS_BLOCK_SPARSE_HPP_
+#define KUIPER_INFER_SOURCE_LAYER_DETAILS_BLOCK_SPARSE_HPP_
+#include <armadillo>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace kuiper_infer {
+
+/**
+ * @brief Pruned weight matrix in blocked CSR format
+ *
+ * The weight is the right operand B (K x N) of output = input * B, one column
+ * per output channel as in the im2col kernel matrix of a convolution. It is
+ * stored transposed, as blocks of kBlockRows output channels x kBlockCols
+ * input features, and only the blocks holding a non-zero value are kept, so
+ * the multiplication skips the pruned blocks.
+ */
+class BlockSparseMatrix {
+ public:
+  static constexpr uint32_t kBlockRows = 4;
+  static constexpr uint32_t kBlockCols = 4;
+
+  /// 非零块的比例超过该值时, 稠密的矩阵乘法更快
+  static constexpr float kMaxDensity = 0.5f;
+
+  /**
+   * @brief Converts a dense weight matrix if enough of its blocks are zero
+   *
+   * @param matrix Dense K x N weight matrix
+   * @param max_density Largest share of non-zero blocks to convert
+   * @return Block sparse matrix, nullptr if the matrix is denser than max_density
+   */
+  static std::shared_ptr<BlockSparseMatrix> Create(const arma::fmat& matrix,
+                                                   float max_density = kMaxDensity);
+
+  /**
+   * @brief Computes output = input * B
+   *
+   * @param input Column-major rows x K matrix
+   * @param rows Number of rows of the input and the output
+   * @param output Column-major rows x N matrix, overwritten
+   */
+  void Multiply(const float* input, uint32_t rows, float* output) const;
+
+  uint32_t input_features() const { return input_features_; }
+
+  uint32_t output_features() const { return output_features_; }
+
+  /**
+   * @brief Gets the share of the stored blocks among all blocks
+   */
+  float density() const { return density_; }
+
+ private:
+  uint32_t input_features_ = 0;
+  uint32_t output_features_ = 0;
+  float density_ = 0.f;
+
+  /// Blocks of block row i are block_row_offsets_[i] to block_row_offsets_[i + 1] - 1
+  std::vector<uint32_t> block_row_offsets_;
+
+  /// Block column (input features / kBlockCols) of every stored block
+  std::vector<uint32_t> block_cols_;
+
+  /// kBlockCols x kBlockRows values of every stored block, output channels contiguous
+  std::vector<float> block_values_;
+};
+
+}  // namespace kuiper_infer
+#endif  // KUIPER_INFER_SOURCE_LAYER_DETAILS_BLOCK_SPARSE_HPP_
@@ -21,12 +21,23 @@
 
 // Created by fss on 22-12-25.
 #include "cat.hpp"
+#include "data/tensor_half.hpp"
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
 namespace kuiper_infer {
 CatLayer::CatLayer(int32_t dim) : NonParamLayer("cat"), dim_(dim) {}
 
 StatusCode CatLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                              std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  return ForwardUnchecked(inputs, outputs);
+}
+
+StatusCode CatLayer::Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                           const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
   if (inputs.empty()) {
     LOG(ERROR) << "The input tensor array in the cat layer is empty";
     return StatusCode::kInferInputsEmpty;
@@ -48,34 +59,53 @@ StatusCode CatLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
     return StatusCode::kInferInOutDimMismatch;
   }
 
-  const uint32_t packet_size = inputs.size() / output_size;
-#pragma omp parallel for num_threads(outputs.size())
-  for (uint32_t i = 0; i < outputs.size(); ++i) {
-    uint32_t start_channel = 0;
-    std::shared_ptr<Tensor<float>> output = outputs.at(i);
+  for (uint32_t i = 0; i < output_size; ++i) {
+    uint32_t out_channels = 0;
     for (uint32_t j = i; j < inputs.size(); j += output_size) {
       const std::shared_ptr<Tensor<float>>& input = inputs.at(j);
       CHECK(input != nullptr && !input->empty()) << "The input tensor array in the cat layer has "
                                                     "an empty tensor "
                                                  << j << " th";
-      uint32_t in_rows = input->rows();
-      uint32_t in_cols = input->cols();
-      const uint32_t in_channels = input->channels();
-      CHECK(in_rows == input->rows() && in_cols == input->cols())
+      CHECK(input->rows() == inputs.at(i)->rows() && input->cols() == inputs.at(i)->cols())
           << "The input tensor array in the cat layer "
              "has an incorrectly sized tensor "
           << j << " th";
+      out_channels += input->channels();
+    }
 
-      if (output == nullptr || output->empty()) {
-        output = std::make_shared<Tensor<float>>(in_channels * packet_size, in_rows, in_cols);
-        outputs.at(i) = output;
-      }
-      CHECK(output->channels() == in_channels * packet_size && output->rows() == in_rows &&
-            output->cols() == in_cols)
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(i);
+    if (output != nullptr && !output->empty()) {
+      CHECK(output->channels() == out_channels && output->rows() == inputs.at(i)->rows() &&
+            output->cols() == inputs.at(i)->cols())
           << "The output tensor array in the cat layer "
              "has an incorrectly sized tensor "
           << i << " th";
-      const uint32_t plane_size = in_rows * in_cols;
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode CatLayer::ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const uint32_t output_size = outputs.size();
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(output_size))
+  for (uint32_t i = 0; i < outputs.size(); ++i) {
+    std::shared_ptr<Tensor<float>> output = outputs.at(i);
+    if (output == nullptr || output->empty()) {
+      uint32_t out_channels = 0;
+      for (uint32_t j = i; j < inputs.size(); j += output_size) {
+        out_channels += inputs.at(j)->channels();
+      }
+      output = std::make_shared<Tensor<float>>(out_channels, inputs.at(i)->rows(),
+                                               inputs.at(i)->cols());
+      outputs.at(i) = output;
+    }
+
+    uint32_t start_channel = 0;
+    for (uint32_t j = i; j < inputs.size(); j += output_size) {
+      const std::shared_ptr<Tensor<float>>& input = inputs.at(j);
+      const uint32_t in_channels = input->channels();
+      const uint32_t plane_size = input->rows() * input->cols();
       memcpy(output->raw_ptr(start_channel * plane_size), input->raw_ptr(),
              sizeof(float) * plane_size * in_channels);
       start_channel += input->channels();
@@ -84,6 +114,39 @@ StatusCode CatLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
   return StatusCode::kSuccess;
 }
 
+StatusCode CatLayer::ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                   const std::vector<const HalfTensor*>& packed_inputs,
+                                   std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  CHECK(packed_inputs.size() == inputs.size())
+      << "The packed and float input tensor array size of the cat layer do not match";
+  const uint32_t output_size = outputs.size();
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(output_size))
+  for (uint32_t i = 0; i < output_size; ++i) {
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(i);
+    CHECK(output != nullptr && !output->empty())
+        << "The output tensor array in the cat layer has an empty tensor " << i << " th";
+    const uint32_t plane_size = output->rows() * output->cols();
+    uint32_t start_channel = 0;
+    for (uint32_t j = i; j < inputs.size(); j += output_size) {
+      // 16位输入直接展开到输出的通道中
+      const HalfTensor* packed_input = packed_inputs.at(j);
+      float* output_ptr = output->raw_ptr(start_channel * plane_size);
+      if (packed_input != nullptr) {
+        packed_input->Unpack(output_ptr);
+        start_channel += packed_input->channels();
+      } else {
+        const std::shared_ptr<Tensor<float>>& input = inputs.at(j);
+        memcpy(output_ptr, input->raw_ptr(), sizeof(float) * input->size());
+        start_channel += input->channels();
+      }
+    }
+    CHECK(start_channel == output->channels())
+        << "The output tensor array in the cat layer has an incorrectly sized tensor " << i
+        << " th";
+  }
+  return StatusCode::kSuccess;
+}
+
 StatusCode CatLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                     std::shared_ptr<Layer<float>>& cat_layer) {
   CHECK(op != nullptr) << "Cat operator is nullptr";
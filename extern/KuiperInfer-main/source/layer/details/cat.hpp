@@ -32,6 +32,18 @@ class CatLayer : public NonParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  StatusCode Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const override;
+
+  StatusCode ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                              std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  bool is_packed_input_supported() const override { return true; }
+
+  StatusCode ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                           const std::vector<const HalfTensor*>& packed_inputs,
+                           std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
   static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                    std::shared_ptr<Layer<float>>& cat_layer);
 
@@ -23,13 +23,31 @@
 
 #include "convolution.hpp"
 #include <glog/logging.h>
+#include <algorithm>
+#include <sstream>
 #include "layer/abstract/layer_factory.hpp"
 #include "runtime/runtime_ir.hpp"
 #include "tick.hpp"
+#include "utils/cpu/numa.hpp"
 #include "utils/math/fmath.hpp"
 
 namespace kuiper_infer {
 
+struct ConvTuningChoice {
+  const char* name;
+  ConvAlgorithm algorithm;
+  uint32_t tile_bytes;
+};
+
+// 自动调优时计时的实现, 只适用于1x1卷积的实现放在最后
+static const ConvTuningChoice kConvTuningChoices[] = {
+    {"im2col_gemm_64k", ConvAlgorithm::kIm2ColGemm, 64 * 1024},
+    {"im2col_gemm_256k", ConvAlgorithm::kIm2ColGemm, 256 * 1024},
+    {"im2col_gemm_1m", ConvAlgorithm::kIm2ColGemm, 1024 * 1024},
+    {"direct", ConvAlgorithm::kDirect, 0},
+    {"gemm_1x1", ConvAlgorithm::kGemm1x1, 0},
+};
+
 void ConvolutionLayer::InitIm2ColWeight() {
   const uint32_t kernel_count = this->weights_.size();
   CHECK(kernel_count > 0) << "kernel count must greater than zero";
@@ -47,28 +65,95 @@ void ConvolutionLayer::InitIm2ColWeight() {
     CHECK(kernel->channels() == kernel_c);
   }
 
-  std::vector<arma::frowvec> kernel_matrix_arr(kernel_count);
-  arma::frowvec kernel_matrix_c(row_len * kernel_c);
-  for (uint32_t k = 0; k < kernel_count; ++k) {
-    const std::shared_ptr<Tensor<float>>& kernel = this->weights_.at(k);
-    for (uint32_t ic = 0; ic < kernel->channels(); ++ic) {
-      memcpy(kernel_matrix_c.memptr() + row_len * ic, kernel->matrix_raw_ptr(ic),
-             row_len * sizeof(float));
+  CHECK(kernel_count % groups_ == 0)
+      << "The number of kernel matrix and the number of groups do not match";
+  const uint32_t kernel_count_group = kernel_count / groups_;
+  // 每组一个权重矩阵, 第k列是该组第k个卷积核按im2col的顺序展开后的权重
+  std::vector<arma::fmat> kernel_matrix_arr(groups_);
+  for (uint32_t g = 0; g < groups_; ++g) {
+    arma::fmat kernel_matrix(row_len * kernel_c, kernel_count_group);
+    for (uint32_t k = 0; k < kernel_count_group; ++k) {
+      const std::shared_ptr<Tensor<float>>& kernel = this->weights_.at(g * kernel_count_group + k);
+      for (uint32_t ic = 0; ic < kernel->channels(); ++ic) {
+        memcpy(kernel_matrix.colptr(k) + row_len * ic, kernel->matrix_raw_ptr(ic),
+               row_len * sizeof(float));
+      }
     }
-    kernel_matrix_arr.at(k) = kernel_matrix_c;
+    kernel_matrix_arr.at(g) = std::move(kernel_matrix);
   }
 
-  if (!kernel_matrix_arr.empty()) {
-    if (groups_ == 1) {
-      CHECK(kernel_matrix_arr.size() == kernel_count / groups_)
-          << "The number of kernel matrix and kernel_count_group do not match";
-    } else {
-      CHECK(kernel_matrix_arr.size() == kernel_count)
-          << "The number of kernel matrix and kernel_count do not match";
+  // 剪枝后的权重有足够多的零块时, 改用块稀疏的矩阵乘法
+  std::vector<std::shared_ptr<BlockSparseMatrix>> sparse_kernel_arr(groups_);
+  for (uint32_t g = 0; g < groups_; ++g) {
+    sparse_kernel_arr.at(g) = BlockSparseMatrix::Create(kernel_matrix_arr.at(g));
+  }
+  this->kernel_matrix_arr_ = std::move(kernel_matrix_arr);
+  this->sparse_kernel_arr_ = std::move(sparse_kernel_arr);
+}
+
+void ConvolutionLayer::InitBiasValues() {
+  const uint32_t kernel_count = this->weights_.size();
+  CHECK(kernel_count > 0 && kernel_count % groups_ == 0)
+      << "The number of kernel matrix and the number of groups do not match";
+  const uint32_t kernel_count_group = kernel_count / groups_;
+  // 每组一个偏置数组, 不使用偏置时全为零
+  std::vector<std::vector<float>> bias_values_arr(groups_,
+                                                  std::vector<float>(kernel_count_group, 0.f));
+  if (!this->bias_.empty() && this->use_bias_) {
+    CHECK(this->bias_.size() == kernel_count)
+        << "The number of kernel matrix and bias matrix do not match";
+    for (uint32_t g = 0; g < groups_; ++g) {
+      for (uint32_t k = 0; k < kernel_count_group; ++k) {
+        const std::shared_ptr<Tensor<float>>& bias = this->bias_.at(g * kernel_count_group + k);
+        CHECK(bias != nullptr && !bias->empty()) << "Bias tensor is empty or nullptr";
+        bias_values_arr.at(g).at(k) = bias->index(0);
+      }
     }
   }
+  this->bias_values_arr_ = std::move(bias_values_arr);
+}
 
-  this->kernel_matrix_arr_ = std::move(kernel_matrix_arr);
+StatusCode ConvolutionLayer::Check(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
+  const StatusCode status = BaseConvolutionLayer::Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+
+  const uint32_t kernel_h = this->weights_.at(0)->rows();
+  const uint32_t kernel_w = this->weights_.at(0)->cols();
+  const uint32_t kernel_size = this->weights_.at(0)->channels() * kernel_h * kernel_w;
+  const uint32_t kernel_count_group = this->weights_.size() / groups_;
+  if (this->kernel_matrix_arr_.size() != groups_ || this->sparse_kernel_arr_.size() != groups_ ||
+      this->bias_values_arr_.size() != groups_) {
+    LOG(ERROR) << "The kernel matrix and bias of every group in the convolution layer should be "
+                  "prepared when the weights are set";
+    return StatusCode::kInferParameterError;
+  }
+
+  for (uint32_t group = 0; group < groups_; ++group) {
+    const arma::fmat& kernel_matrix = this->kernel_matrix_arr_.at(group);
+    if (kernel_matrix.n_rows != kernel_size || kernel_matrix.n_cols != kernel_count_group ||
+        this->bias_values_arr_.at(group).size() != kernel_count_group) {
+      LOG(ERROR) << "The kernel matrix or bias of the convolution layer has a wrong size in group "
+                 << group;
+      return StatusCode::kInferParameterError;
+    }
+  }
+
+  for (const std::vector<arma::fmat>& kernel_matrix_arr : this->kernel_matrix_replicas_) {
+    if (kernel_matrix_arr.size() != groups_) {
+      LOG(ERROR) << "The replicated kernel matrices of the convolution layer do not match";
+      return StatusCode::kInferParameterError;
+    }
+  }
+
+  if (algorithm_ == ConvAlgorithm::kGemm1x1 && !IsPointwise(kernel_h, kernel_w)) {
+    LOG(ERROR) << "The 1x1 algorithm only supports 1x1 convolutions without stride and padding";
+    return StatusCode::kInferParameterError;
+  }
+  return StatusCode::kSuccess;
 }
 
 void ConvolutionLayer::ComputeOutput(sftensor input, sftensor output_tensor, uint32_t kernel_h,
@@ -76,65 +161,182 @@ void ConvolutionLayer::ComputeOutput(sftensor input, sftensor output_tensor, uin
                                      uint32_t input_h, uint32_t input_w,
                                      uint32_t channels_per_group, uint32_t output_h,
                                      uint32_t output_w, uint32_t group) const {
-  const arma::fmat& input_matrix =
-      ConvIm2Col(input, kernel_h, kernel_w, input_h, input_w, channels_per_group, output_h,
-                 output_w, group, kernel_h * kernel_w, output_h * output_w);
+  // 输入, 权重矩阵和偏置都已在Check和设置权重时检查过, 这里只读取准备好的状态
+  const uint32_t output_size = output_h * output_w;
+  const uint32_t kernel_size = channels_per_group * kernel_h * kernel_w;
+  // 优先读取当前线程所在NUMA节点上的权重副本
+  const uint32_t numa_node = utils::GetCurrentNumaNode();
+  const arma::fmat& kernel_matrix = numa_node < this->kernel_matrix_replicas_.size()
+                                        ? this->kernel_matrix_replicas_.at(numa_node).at(group)
+                                        : this->kernel_matrix_arr_.at(group);
+  const BlockSparseMatrix* sparse_kernel = this->sparse_kernel_arr_.at(group).get();
+  const std::vector<float>& bias_values = this->bias_values_arr_.at(group);
+
+  // 输出的每个通道按列优先连续存储, 整组输出可以看作output_size x kernel_count_group的矩阵
+  float* output_ptr = output_tensor->matrix_raw_ptr(group * kernel_count_group);
+  float* input_ptr = input->matrix_raw_ptr(group * channels_per_group);
+  if (algorithm_ == ConvAlgorithm::kDirect) {
+    ConvDirect(input_ptr, output_ptr, kernel_matrix, bias_values, kernel_h, kernel_w, input_h,
+               input_w, channels_per_group, output_h, output_w);
+    return;
+  }
+
+  if (algorithm_ == ConvAlgorithm::kGemm1x1) {
+    // 1x1卷积的输入本身就是output_size x channels的矩阵, 无需展开
+    const arma::fmat input_matrix(input_ptr, output_size, channels_per_group, false, true);
+    arma::fmat output(output_ptr, output_size, kernel_count_group, false, true);
+    if (sparse_kernel != nullptr) {
+      sparse_kernel->Multiply(input_ptr, output_size, output_ptr);
+    } else {
+      output = input_matrix * kernel_matrix;
+    }
+    for (uint32_t k = 0; k < kernel_count_group; ++k) {
+      if (bias_values.at(k) != 0.f) {
+        output.col(k) += bias_values.at(k);
+      }
+    }
+    return;
+  }
+
+  uint32_t tile_cols = im2col_tile_bytes_ / (kernel_size * sizeof(float));
+  tile_cols = std::max(8u, tile_cols / 8 * 8);
+  tile_cols = std::min(tile_cols, output_size);
+  const uint32_t tile_count = (output_size + tile_cols - 1) / tile_cols;
+
 #pragma omp parallel for
-  for (uint32_t k = 0; k < kernel_count_group; ++k) {
-    ConvGemmBias(input_matrix, output_tensor, group, k, kernel_count_group, output_h, output_w);
+  for (uint32_t tile = 0; tile < tile_count; ++tile) {
+    // 每个线程复用自己的打包缓冲区, 不再为整张图像分配im2col矩阵
+    thread_local std::vector<float> tile_buffer;
+    thread_local std::vector<float> tile_output_buffer;
+    const uint32_t tile_start = tile * tile_cols;
+    const uint32_t tile_rows = std::min(tile_cols, output_size - tile_start);
+    if (tile_buffer.size() < (size_t)tile_rows * kernel_size) {
+      tile_buffer.resize((size_t)tile_rows * kernel_size);
+    }
+    if (tile_output_buffer.size() < (size_t)tile_rows * kernel_count_group) {
+      tile_output_buffer.resize((size_t)tile_rows * kernel_count_group);
+    }
+
+    ConvIm2ColTile(input_ptr, kernel_h, kernel_w, input_h, input_w, channels_per_group, output_h,
+                   tile_start, tile_rows, tile_buffer.data());
+    const arma::fmat tile_matrix(tile_buffer.data(), tile_rows, kernel_size, false, true);
+    arma::fmat tile_output(tile_output_buffer.data(), tile_rows, kernel_count_group, false, true);
+    if (sparse_kernel != nullptr) {
+      sparse_kernel->Multiply(tile_buffer.data(), tile_rows, tile_output_buffer.data());
+    } else {
+      tile_output = tile_matrix * kernel_matrix;
+    }
+
+    for (uint32_t k = 0; k < kernel_count_group; ++k) {
+      const float bias_value = bias_values.at(k);
+      const float* tile_output_ptr = tile_output.colptr(k);
+      float* output_channel_ptr = output_ptr + (size_t)k * output_size + tile_start;
+      for (uint32_t i = 0; i < tile_rows; ++i) {
+        output_channel_ptr[i] = tile_output_ptr[i] + bias_value;
+      }
+    }
   }
 }
 
-arma::fmat ConvolutionLayer::ConvIm2Col(sftensor input, uint32_t kernel_h, uint32_t kernel_w,
-                                        uint32_t input_h, uint32_t input_w,
-                                        uint32_t channels_per_group, uint32_t output_h,
-                                        uint32_t output_w, uint32_t group, uint32_t row_len,
-                                        uint32_t col_len) const {
-  CHECK(input && !input->empty());
-  const float padding_value = 0.f;
-  arma::fmat input_matrix(channels_per_group * row_len, col_len);
+void ConvolutionLayer::ConvDirect(const float* input_ptr, float* output_ptr,
+                                  const arma::fmat& kernel_matrix,
+                                  const std::vector<float>& bias_values, uint32_t kernel_h,
+                                  uint32_t kernel_w, uint32_t input_h, uint32_t input_w,
+                                  uint32_t channels_per_group, uint32_t output_h,
+                                  uint32_t output_w) const {
+  const uint32_t kernel_count_group = kernel_matrix.n_cols;
+  const uint32_t output_size = output_h * output_w;
+  const int32_t stride_h = (int32_t)stride_h_;
 
 #pragma omp parallel for
-  for (uint32_t ic = 0; ic < channels_per_group; ++ic) {
-    float* input_channel_ptr = input->matrix_raw_ptr(ic + group * channels_per_group);
-    uint32_t current_col = 0;
-    uint32_t channel_row = ic * row_len;
-    for (uint32_t w = 0, iw = 0; w < output_w; ++w, iw += stride_w_) {
-      for (uint32_t r = 0, ih = 0; r < output_h; ++r, ih += stride_h_) {
-        float* input_matrix_ptr = input_matrix.colptr(current_col) + channel_row;
-        current_col += 1;
-        for (uint32_t kw = 0; kw < kernel_w * dilation_w_; kw += dilation_w_) {
-          const uint32_t region_w = input_h * (iw + kw - padding_w_);
-          for (uint32_t kh = 0; kh < kernel_h * dilation_h_; kh += dilation_h_) {
-            if ((kh + ih >= padding_h_ && kw + iw >= padding_w_) &&
-                (kh + ih < input_h + padding_h_ && kw + iw < input_w + padding_w_)) {
-              float* region_ptr = input_channel_ptr + region_w + (ih + kh - padding_h_);
-              *(input_matrix_ptr++) = *region_ptr;
-            } else {
-              *(input_matrix_ptr++) = padding_value;  // only support zero mode
+  for (uint32_t k = 0; k < kernel_count_group; ++k) {
+    float* output_channel_ptr = output_ptr + (size_t)k * output_size;
+    std::fill(output_channel_ptr, output_channel_ptr + output_size, bias_values.at(k));
+    // 权重按im2col的顺序排列, 下标为(ic * kernel_w + kw) * kernel_h + kh
+    const float* weight_ptr = kernel_matrix.colptr(k);
+    for (uint32_t ic = 0; ic < channels_per_group; ++ic) {
+      const float* input_channel_ptr = input_ptr + (size_t)ic * input_h * input_w;
+      for (uint32_t kw = 0; kw < kernel_w; ++kw) {
+        for (uint32_t kh = 0; kh < kernel_h; ++kh) {
+          const float weight = weight_ptr[(ic * kernel_w + kw) * kernel_h + kh];
+          // 和im2col相同, 只累加输入行落在输入范围内的输出行[oh_begin, oh_end)
+          const int32_t offset_h = (int32_t)(kh * dilation_h_) - (int32_t)padding_h_;
+          const int32_t oh_begin = offset_h >= 0 ? 0 : (-offset_h + stride_h - 1) / stride_h;
+          const int32_t oh_end = std::min(
+              (int32_t)output_h,
+              offset_h >= (int32_t)input_h ? 0 : ((int32_t)input_h - 1 - offset_h) / stride_h + 1);
+          if (oh_begin >= oh_end) {
+            continue;
+          }
+          for (uint32_t ow = 0; ow < output_w; ++ow) {
+            const int32_t iw = (int32_t)(ow * stride_w_ + kw * dilation_w_) - (int32_t)padding_w_;
+            if (iw < 0 || iw >= (int32_t)input_w) {
+              continue;
+            }
+            const float* input_col_ptr = input_channel_ptr + (size_t)iw * input_h + offset_h;
+            float* output_col_ptr = output_channel_ptr + (size_t)ow * output_h;
+            for (int32_t oh = oh_begin; oh < oh_end; ++oh) {
+              output_col_ptr[oh] += weight * input_col_ptr[oh * stride_h];
             }
           }
         }
       }
     }
   }
-  return input_matrix;
 }
 
-void ConvolutionLayer::ConvGemmBias(const arma::fmat& input_matrix, sftensor output_tensor,
-                                    uint32_t group, uint32_t kernel_index,
-                                    uint32_t kernel_count_group, uint32_t output_h,
-                                    uint32_t output_w) const {
-  CHECK(!input_matrix.empty());
-  CHECK(output_tensor && !output_tensor->empty());
-
-  kernel_index = kernel_index + group * kernel_count_group;
-  const arma::frowvec& kernel = this->kernel_matrix_arr_.at(kernel_index);
-
-  arma::fmat output(output_tensor->matrix_raw_ptr(kernel_index), output_h, output_w, false, true);
-  output = kernel * input_matrix;
+void ConvolutionLayer::ConvIm2ColTile(const float* input_ptr, uint32_t kernel_h,
+                                      uint32_t kernel_w, uint32_t input_h, uint32_t input_w,
+                                      uint32_t channels_per_group, uint32_t output_h,
+                                      uint32_t tile_start, uint32_t tile_rows,
+                                      float* tile_ptr) const {
+  const int32_t stride_h = (int32_t)stride_h_;
+  for (uint32_t ic = 0; ic < channels_per_group; ++ic) {
+    const float* input_channel_ptr = input_ptr + (size_t)ic * input_h * input_w;
+    for (uint32_t kw = 0; kw < kernel_w; ++kw) {
+      for (uint32_t kh = 0; kh < kernel_h; ++kh) {
+        float* tile_col_ptr = tile_ptr + (size_t)((ic * kernel_w + kw) * kernel_h + kh) * tile_rows;
+        // 输入行ih = oh * stride_h + offset_h, 计算落在输入范围内的输出行[oh_begin, oh_end)
+        const int32_t offset_h = (int32_t)(kh * dilation_h_) - (int32_t)padding_h_;
+        const int32_t oh_begin = offset_h >= 0 ? 0 : (-offset_h + stride_h - 1) / stride_h;
+        const int32_t oh_end =
+            offset_h >= (int32_t)input_h ? 0 : ((int32_t)input_h - 1 - offset_h) / stride_h + 1;
 
-  return AddBias(output, kernel_index);
+        uint32_t index = 0;
+        uint32_t oh = tile_start % output_h;
+        uint32_t ow = tile_start / output_h;
+        while (index < tile_rows) {
+          // 同一输出列中的连续位置
+          const uint32_t run = std::min(output_h - oh, tile_rows - index);
+          float* run_ptr = tile_col_ptr + index;
+          const int32_t iw =
+              (int32_t)(ow * stride_w_ + kw * dilation_w_) - (int32_t)padding_w_;
+          const int32_t valid_begin = std::max((int32_t)oh, oh_begin);
+          const int32_t valid_end = std::min((int32_t)(oh + run), oh_end);
+          if (iw < 0 || iw >= (int32_t)input_w || valid_begin >= valid_end) {
+            std::fill(run_ptr, run_ptr + run, 0.f);
+          } else {
+            const float* input_col_ptr = input_channel_ptr + (size_t)iw * input_h;
+            std::fill(run_ptr, run_ptr + (valid_begin - (int32_t)oh), 0.f);
+            float* valid_ptr = run_ptr + (valid_begin - (int32_t)oh);
+            const int32_t valid_count = valid_end - valid_begin;
+            const float* input_row_ptr = input_col_ptr + valid_begin * stride_h + offset_h;
+            if (stride_h == 1) {
+              memcpy(valid_ptr, input_row_ptr, valid_count * sizeof(float));
+            } else {
+              for (int32_t i = 0; i < valid_count; ++i) {
+                valid_ptr[i] = input_row_ptr[i * stride_h];
+              }
+            }
+            std::fill(valid_ptr + valid_count, run_ptr + run, 0.f);
+          }
+          index += run;
+          oh = 0;
+          ow += 1;
+        }
+      }
+    }
+  }
 }
 
 std::pair<uint32_t, uint32_t> ConvolutionLayer::ComputeOutputSize(const uint32_t input_h,
@@ -152,6 +354,125 @@ std::pair<uint32_t, uint32_t> ConvolutionLayer::ComputeOutputSize(const uint32_t
   return {output_h, output_w};
 }
 
+bool ConvolutionLayer::GetTileWindow(TileWindow& window) const {
+  if (this->weights_.empty()) {
+    return false;
+  }
+  window.kernel_h = this->weights_.at(0)->rows();
+  window.kernel_w = this->weights_.at(0)->cols();
+  window.stride_h = stride_h_;
+  window.stride_w = stride_w_;
+  window.padding_h = padding_h_;
+  window.padding_w = padding_w_;
+  window.dilation_h = dilation_h_;
+  window.dilation_w = dilation_w_;
+  window.padding_value = 0.f;
+  return true;
+}
+
+std::shared_ptr<Layer<float>> ConvolutionLayer::CreateTileLayer() const {
+  CHECK(!this->weights_.empty()) << "The convolution layer has no weights";
+  const sftensor& kernel = this->weights_.at(0);
+  const uint32_t kernel_count = this->weights_.size();
+  auto tile_layer = std::make_shared<ConvolutionLayer>(
+      kernel_count, kernel->channels() * groups_, kernel->rows(), kernel->cols(), 0, 0, stride_h_,
+      stride_w_, groups_, use_bias_, 0, 0, dilation_h_, dilation_w_);
+  // 共享权重, 并提前展开权重矩阵, 使多个线程可以同时调用tile_layer的Forward
+  tile_layer->weights_ = this->weights_;
+  tile_layer->bias_ = this->bias_;
+  tile_layer->kernel_matrix_arr_ = this->kernel_matrix_arr_;
+  tile_layer->sparse_kernel_arr_ = this->sparse_kernel_arr_;
+  tile_layer->bias_values_arr_ = this->bias_values_arr_;
+  tile_layer->kernel_matrix_replicas_ = this->kernel_matrix_replicas_;
+  tile_layer->algorithm_ = this->algorithm_;
+  tile_layer->im2col_tile_bytes_ = this->im2col_tile_bytes_;
+  return tile_layer;
+}
+
+std::string ConvolutionLayer::tuning_signature() const {
+  if (this->weights_.empty()) {
+    return "";
+  }
+  const sftensor& kernel = this->weights_.at(0);
+  std::stringstream signature;
+  signature << "conv k" << this->weights_.size() << " c" << kernel->channels() * groups_ << " "
+            << kernel->rows() << "x" << kernel->cols() << " s" << stride_h_ << "x" << stride_w_
+            << " p" << padding_h_ << "x" << padding_w_ << " d" << dilation_h_ << "x"
+            << dilation_w_ << " g" << groups_;
+  return signature.str();
+}
+
+std::vector<std::string> ConvolutionLayer::tuning_choices() const {
+  std::vector<std::string> choices;
+  if (this->weights_.empty()) {
+    return choices;
+  }
+  const sftensor& kernel = this->weights_.at(0);
+  for (const ConvTuningChoice& choice : kConvTuningChoices) {
+    if (choice.algorithm != ConvAlgorithm::kGemm1x1 ||
+        IsPointwise(kernel->rows(), kernel->cols())) {
+      choices.emplace_back(choice.name);
+    }
+  }
+  return choices;
+}
+
+void ConvolutionLayer::set_tuning_choice(uint32_t choice) {
+  CHECK_LT(choice, tuning_choices().size());
+  const ConvTuningChoice& tuning_choice = kConvTuningChoices[choice];
+  set_algorithm(tuning_choice.algorithm,
+                tuning_choice.tile_bytes > 0 ? tuning_choice.tile_bytes : kIm2ColTileBytes);
+}
+
+void ConvolutionLayer::set_algorithm(ConvAlgorithm algorithm, uint32_t tile_bytes) {
+  CHECK_GT(tile_bytes, 0);
+  this->algorithm_ = algorithm;
+  this->im2col_tile_bytes_ = tile_bytes;
+}
+
+void ConvolutionLayer::set_bias(const std::vector<float>& bias) {
+  ParamLayer::set_bias(bias);
+  InitBiasValues();
+}
+
+void ConvolutionLayer::set_bias(const std::vector<std::shared_ptr<Tensor<float>>>& bias) {
+  ParamLayer::set_bias(bias);
+  InitBiasValues();
+}
+
+void ConvolutionLayer::set_weights(const std::vector<float>& weights) {
+  ParamLayer::set_weights(weights);
+  ResetDerivedWeights();
+}
+
+void ConvolutionLayer::set_weights(const std::vector<std::shared_ptr<Tensor<float>>>& weights) {
+  ParamLayer::set_weights(weights);
+  ResetDerivedWeights();
+}
+
+void ConvolutionLayer::ResetDerivedWeights() {
+  // 替换权重时重新展开权重矩阵并检测块稀疏, 已有的NUMA副本也按新权重重建
+  InitIm2ColWeight();
+  if (!this->kernel_matrix_replicas_.empty()) {
+    ReplicateWeights();
+  }
+}
+
+void ConvolutionLayer::ReplicateWeights() {
+  this->kernel_matrix_replicas_.clear();
+  const uint32_t node_count = utils::GetNumaTopology().node_count();
+  if (node_count <= 1) {
+    return;
+  }
+  for (uint32_t node = 0; node < node_count; ++node) {
+    std::vector<arma::fmat> kernel_matrix_arr = this->kernel_matrix_arr_;
+    for (arma::fmat& kernel_matrix : kernel_matrix_arr) {
+      utils::MoveToNumaNode(kernel_matrix.memptr(), kernel_matrix.n_elem * sizeof(float), node);
+    }
+    this->kernel_matrix_replicas_.push_back(std::move(kernel_matrix_arr));
+  }
+}
+
 LayerRegistererWrapper kConvCreateInstance("nn.Conv2d", BaseConvolutionLayer::CreateInstance);
 
 }  // namespace kuiper_infer
\ No newline at end of file
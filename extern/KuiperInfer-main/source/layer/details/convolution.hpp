@@ -24,12 +24,22 @@
 #ifndef KUIPER_INFER_SOURCE_LAYER_CONVOLUTION_HPP_
 #define KUIPER_INFER_SOURCE_LAYER_CONVOLUTION_HPP_
 #include "base_convolution.hpp"
+#include "block_sparse.hpp"
 #include "layer/abstract/param_layer.hpp"
 
 namespace kuiper_infer {
 
+enum class ConvAlgorithm {
+  kIm2ColGemm = 0,  // 分块展开im2col后做矩阵乘法
+  kGemm1x1 = 1,     // 1x1卷积的输入直接做矩阵乘法
+  kDirect = 2,      // 直接卷积, 适合通道数很少的卷积
+};
+
 class ConvolutionLayer : public BaseConvolutionLayer {
  public:
+  /// 每个线程打包的im2col块的默认大小, 保证块和部分权重可以放入L2缓存
+  static constexpr uint32_t kIm2ColTileBytes = 256 * 1024;
+
   explicit ConvolutionLayer(uint32_t output_channel, uint32_t in_channel, uint32_t kernel_h,
                             uint32_t kernel_w, uint32_t padding_h, uint32_t padding_w,
                             uint32_t stride_h, uint32_t stride_w, uint32_t groups,
@@ -38,10 +48,87 @@ class ConvolutionLayer : public BaseConvolutionLayer {
                             uint32_t dilation_w = 1)
       : BaseConvolutionLayer(ConvType::kOpConv, output_channel, in_channel, kernel_h, kernel_w,
                              padding_h, padding_w, stride_h, stride_w, groups, use_bias,
-                             output_padding_h, output_padding_w, dilation_h, dilation_w) {}
+                             output_padding_h, output_padding_w, dilation_h, dilation_w) {
+    if (IsPointwise(kernel_h, kernel_w)) {
+      algorithm_ = ConvAlgorithm::kGemm1x1;
+    }
+    // Forward只读取展开后的权重矩阵和偏置, 构造和设置权重时建立
+    InitIm2ColWeight();
+    InitBiasValues();
+  }
+
+  StatusCode Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const override;
+
+  void set_weights(const std::vector<float>& weights) override;
+
+  void set_weights(const std::vector<std::shared_ptr<Tensor<float>>>& weights) override;
+
+  void set_bias(const std::vector<float>& bias) override;
+
+  void set_bias(const std::vector<std::shared_ptr<Tensor<float>>>& bias) override;
+
+  bool GetTileWindow(TileWindow& window) const override;
+
+  std::shared_ptr<Layer<float>> CreateTileLayer() const override;
+
+  void ReplicateWeights() override;
+
+  std::string tuning_signature() const override;
+
+  std::vector<std::string> tuning_choices() const override;
+
+  void set_tuning_choice(uint32_t choice) override;
+
+  /**
+   * @brief Sets the algorithm used by Forward
+   *
+   * @param algorithm Convolution algorithm, kGemm1x1 only for 1x1 convolutions without
+   * stride and padding
+   * @param tile_bytes Size of the im2col tile packed by each thread for kIm2ColGemm
+   */
+  void set_algorithm(ConvAlgorithm algorithm, uint32_t tile_bytes = kIm2ColTileBytes);
+
+  ConvAlgorithm algorithm() const { return algorithm_; }
+
+  /**
+   * @brief Checks whether a group of the kernel matrix is stored in blocked CSR format
+   *
+   * Pruned weights with enough zero blocks skip the zero blocks in the im2col and 1x1
+   * algorithms.
+   */
+  bool block_sparse(uint32_t group = 0) const {
+    return group < sparse_kernel_arr_.size() && sparse_kernel_arr_.at(group) != nullptr;
+  }
 
  private:
-  void InitIm2ColWeight() override;
+  bool IsPointwise(uint32_t kernel_h, uint32_t kernel_w) const {
+    return kernel_h == 1 && kernel_w == 1 && stride_h_ == 1 && stride_w_ == 1 &&
+           padding_h_ == 0 && padding_w_ == 0;
+  }
+
+  /**
+   * @brief Computes one group of the output by sliding the kernels over the input
+   *
+   * @param input_ptr First input channel of the group
+   * @param output_ptr First output channel of the group
+   */
+  void ConvDirect(const float* input_ptr, float* output_ptr, const arma::fmat& kernel_matrix,
+                  const std::vector<float>& bias_values, uint32_t kernel_h, uint32_t kernel_w,
+                  uint32_t input_h, uint32_t input_w, uint32_t channels_per_group,
+                  uint32_t output_h, uint32_t output_w) const;
+
+  void InitIm2ColWeight();
+
+  /**
+   * @brief Copies the bias of every group into the arrays read by Forward
+   */
+  void InitBiasValues();
+
+  /**
+   * @brief Rebuilds the kernel matrices derived from the weights after they have been replaced
+   */
+  void ResetDerivedWeights();
 
   void ComputeOutput(sftensor input, sftensor output_tensor, uint32_t kernel_h, uint32_t kernel_w,
                      uint32_t kernel_count_group, uint32_t input_h, uint32_t input_w,
@@ -52,14 +139,29 @@ class ConvolutionLayer : public BaseConvolutionLayer {
                                                   uint32_t kernel_h,
                                                   uint32_t kernel_w) const override;
 
-  void ConvGemmBias(const arma::fmat& input_matrix, sftensor output_tensor, uint32_t group,
-                    uint32_t kernel_index, uint32_t kernel_count_group, uint32_t output_h,
-                    uint32_t output_w) const;
+  /**
+   * @brief Gathers a tile of the im2col matrix without materializing the whole matrix
+   *
+   * The tile has tile_rows output positions starting at tile_start (column-major over the
+   * output), and one column for every channel and kernel position of the group.
+   *
+   * @param input_ptr First input channel of the group
+   * @param tile_ptr Column-major tile of tile_rows x (channels_per_group * kernel_h * kernel_w)
+   */
+  void ConvIm2ColTile(const float* input_ptr, uint32_t kernel_h, uint32_t kernel_w,
+                      uint32_t input_h, uint32_t input_w, uint32_t channels_per_group,
+                      uint32_t output_h, uint32_t tile_start, uint32_t tile_rows,
+                      float* tile_ptr) const;
+
+ private:
+  ConvAlgorithm algorithm_ = ConvAlgorithm::kIm2ColGemm;
+  uint32_t im2col_tile_bytes_ = kIm2ColTileBytes;
+
+  /// 每组一个块稀疏的权重矩阵, 非零块太多的组为空
+  std::vector<std::shared_ptr<BlockSparseMatrix>> sparse_kernel_arr_;
 
-  arma::fmat ConvIm2Col(sftensor input, uint32_t kernel_h, uint32_t kernel_w, uint32_t input_h,
-                        uint32_t input_w, uint32_t channels_per_group, uint32_t output_h,
-                        uint32_t output_w, uint32_t group, uint32_t row_len,
-                        uint32_t col_len) const;
+  /// 每组一个偏置数组, 长度为kernel_count_group
+  std::vector<std::vector<float>> bias_values_arr_;
 };
 
 }  // namespace kuiper_infer
@@ -25,6 +25,7 @@
 #include <stack>
 #include "data/tensor_util.hpp"
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 ExpressionLayer::ExpressionLayer(std::string statement)
@@ -87,16 +88,23 @@ StatusCode ExpressionLayer::Forward(const std::vector<std::shared_ptr<Tensor<flo
           << batch_size;
       op_stack.pop();
 
+      // 最后一个运算直接写入已经分配好的输出张量
+      const bool is_root = std::next(iter) == tokens.rend();
       std::vector<std::shared_ptr<Tensor<float>>> output_token_nodes(batch_size);
-      if (current_token.token_type == TokenType::TokenAdd) {
-#pragma omp parallel for num_threads(batch_size)
-        for (uint32_t i = 0; i < batch_size; ++i) {
-          output_token_nodes.at(i) = TensorElementAdd(input_node1.at(i), input_node2.at(i));
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
+      for (uint32_t i = 0; i < batch_size; ++i) {
+        const sftensor& output = outputs.at(i);
+        if (is_root && output != nullptr && !output->empty() &&
+            output->shapes() == TensorBroadcastShapes(input_node1.at(i), input_node2.at(i))) {
+          output_token_nodes.at(i) = output;
+        } else {
+          output_token_nodes.at(i) = TensorCreate<float>(
+              TensorBroadcastShapes(input_node1.at(i), input_node2.at(i)));
         }
-      } else {
-#pragma omp parallel for num_threads(batch_size)
-        for (uint32_t i = 0; i < batch_size; ++i) {
-          output_token_nodes.at(i) = TensorElementMultiply(input_node1.at(i), input_node2.at(i));
+        if (current_token.token_type == TokenType::TokenAdd) {
+          TensorElementAdd(input_node1.at(i), input_node2.at(i), output_token_nodes.at(i));
+        } else {
+          TensorElementMultiply(input_node1.at(i), input_node2.at(i), output_token_nodes.at(i));
         }
       }
       op_stack.push(output_token_nodes);
@@ -23,6 +23,7 @@
 #include "hardsigmoid.hpp"
 #include "activation_sse.hpp"
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 HardSigmoid::HardSigmoid() : NonParamLayer("HardSigmoid") {}
@@ -49,7 +50,7 @@ StatusCode HardSigmoid::Forward(const std::vector<std::shared_ptr<Tensor<float>>
   ActivationFunc hardsigmoid_function = ApplySSEActivation(ActivationType::kActivationHardSigmoid);
 
   const uint32_t batch = inputs.size();
-#pragma omp parallel for num_threads(batch)
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch))
   for (uint32_t i = 0; i < batch; ++i) {
     const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
@@ -72,6 +73,14 @@ StatusCode HardSigmoid::Forward(const std::vector<std::shared_ptr<Tensor<float>>
   return StatusCode::kSuccess;
 }
 
+StatusCode HardSigmoid::ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                      const std::vector<const HalfTensor*>& packed_inputs,
+                                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  using namespace activation;
+  return ApplyPackedActivation(ActivationType::kActivationHardSigmoid, inputs, packed_inputs,
+                               outputs);
+}
+
 StatusCode HardSigmoid::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                        std::shared_ptr<Layer<float>>& hardsigmoid_layer) {
   CHECK(op != nullptr) << "HardSigmoid operator is nullptr";
@@ -23,6 +23,7 @@
 #include "hardswish.hpp"
 #include "activation_sse.hpp"
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 HardSwishLayer::HardSwishLayer() : NonParamLayer("HardSwish") {}
@@ -49,7 +50,7 @@ StatusCode HardSwishLayer::Forward(const std::vector<std::shared_ptr<Tensor<floa
   ActivationFunc hardswish_function = ApplySSEActivation(ActivationType::kActivationHardSwish);
 
   const uint32_t batch = inputs.size();
-#pragma omp parallel for num_threads(batch)
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch))
   for (uint32_t i = 0; i < batch; ++i) {
     const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
@@ -71,6 +72,14 @@ StatusCode HardSwishLayer::Forward(const std::vector<std::shared_ptr<Tensor<floa
   return StatusCode::kSuccess;
 }
 
+StatusCode HardSwishLayer::ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                         const std::vector<const HalfTensor*>& packed_inputs,
+                                         std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  using namespace activation;
+  return ApplyPackedActivation(ActivationType::kActivationHardSwish, inputs, packed_inputs,
+                               outputs);
+}
+
 StatusCode HardSwishLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                           std::shared_ptr<Layer<float>>& hardswish_layer) {
   CHECK(op != nullptr) << "HardSwishLayer operator is nullptr";
@@ -34,6 +34,19 @@ class HardSwishLayer : public NonParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  bool is_inplace_supported() const override { return true; }
+
+  bool is_packed_input_supported() const override { return true; }
+
+  StatusCode ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                           const std::vector<const HalfTensor*>& packed_inputs,
+                           std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  bool GetTileWindow(TileWindow& window) const override {
+    window = TileWindow();
+    return true;
+  }
+
   static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                    std::shared_ptr<Layer<float>>& hardswish_layer);
 };
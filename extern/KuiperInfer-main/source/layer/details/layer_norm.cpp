@@ -0,0 +1,390 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "layer_norm.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/cpu_features.hpp"
+#include "utils/cpu/thread_budget.hpp"
+#if KUIPER_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace kuiper_infer {
+
+// 沿最后一维归一化时, 每个线程处理的行数
+static constexpr uint32_t kLayerNormRowBlock = 64;
+
+#if KUIPER_X86_DISPATCH
+/**
+ * @brief Normalizes rows [row_begin, row_end) of a column-major rows x cols matrix over its
+ * columns, 8 rows per vector
+ *
+ * @return First row that is not normalized
+ */
+KUIPER_TARGET_AVX2 static uint32_t LayerNormRowsAVX2(const float* input, float* output,
+                                                     uint32_t rows, uint32_t cols,
+                                                     uint32_t row_begin, uint32_t row_end,
+                                                     float eps, const float* weight,
+                                                     const float* bias) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.f);
+  const __m256 inv_cols = _mm256_set1_ps(1.f / float(cols));
+  const __m256 eps_vec = _mm256_set1_ps(eps);
+  uint32_t row = row_begin;
+  for (; row + 7 < row_end; row += 8) {
+    // 减去第一列后再累加, 一次遍历同时得到均值和方差, 并减少舍入误差
+    const __m256 shift = _mm256_loadu_ps(input + row);
+    __m256 sum = zero;
+    __m256 sum_sq = zero;
+    for (uint32_t col = 0; col < cols; ++col) {
+      const __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(input + (size_t)col * rows + row), shift);
+      sum = _mm256_add_ps(sum, diff);
+      sum_sq = _mm256_fmadd_ps(diff, diff, sum_sq);
+    }
+    const __m256 mean_shift = _mm256_mul_ps(sum, inv_cols);
+    const __m256 var = _mm256_max_ps(
+        _mm256_fnmadd_ps(mean_shift, mean_shift, _mm256_mul_ps(sum_sq, inv_cols)), zero);
+    const __m256 rstd = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(var, eps_vec)));
+    const __m256 mean = _mm256_add_ps(shift, mean_shift);
+
+    for (uint32_t col = 0; col < cols; ++col) {
+      const size_t index = (size_t)col * rows + row;
+      __m256 value = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(input + index), mean), rstd);
+      if (weight != nullptr) {
+        value = _mm256_mul_ps(value, _mm256_set1_ps(weight[col]));
+      }
+      if (bias != nullptr) {
+        value = _mm256_add_ps(value, _mm256_set1_ps(bias[col]));
+      }
+      _mm256_storeu_ps(output + index, value);
+    }
+  }
+  return row;
+}
+
+/**
+ * @brief Accumulates input[i] - shift and its square over the first elements divisible by 8
+ *
+ * @return Number of accumulated elements
+ */
+KUIPER_TARGET_AVX2 static size_t ShiftedSumsAVX2(const float* input, size_t size, float shift,
+                                                 float& sum, float& sum_sq) {
+  const __m256 shift_vec = _mm256_set1_ps(shift);
+  __m256 sum_vec = _mm256_setzero_ps();
+  __m256 sum_sq_vec = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 7 < size; i += 8) {
+    const __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(input + i), shift_vec);
+    sum_vec = _mm256_add_ps(sum_vec, diff);
+    sum_sq_vec = _mm256_fmadd_ps(diff, diff, sum_sq_vec);
+  }
+  float sums[8];
+  float sums_sq[8];
+  _mm256_storeu_ps(sums, sum_vec);
+  _mm256_storeu_ps(sums_sq, sum_sq_vec);
+  for (uint32_t lane = 0; lane < 8; ++lane) {
+    sum += sums[lane];
+    sum_sq += sums_sq[lane];
+  }
+  return i;
+}
+#endif
+
+LayerNormLayer::LayerNormLayer(std::vector<int32_t> normalized_shape, float eps,
+                               std::vector<float> affine_weight, std::vector<float> affine_bias)
+    : ParamLayer("LayerNorm"),
+      normalized_shape_(std::move(normalized_shape)),
+      eps_(eps),
+      affine_weight_(std::move(affine_weight)),
+      affine_bias_(std::move(affine_bias)) {}
+
+StatusCode LayerNormLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                   std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  return ForwardUnchecked(inputs, outputs);
+}
+
+StatusCode LayerNormLayer::Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                 const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The input tensor array in the layer norm layer is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+
+  if (outputs.empty()) {
+    LOG(ERROR) << "The output tensor array in the layer norm layer is empty";
+    return StatusCode::kInferOutputsEmpty;
+  }
+
+  if (inputs.size() != outputs.size()) {
+    LOG(ERROR) << "The input and output tensor array size of the layer norm "
+                  "layer do not match";
+    return StatusCode::kInferInOutDimMismatch;
+  }
+
+  if (normalized_shape_.empty() || normalized_shape_.size() > 3) {
+    LOG(ERROR) << "The layer norm layer only supports normalizing one to three dimensions";
+    return StatusCode::kInferParameterError;
+  }
+
+  const size_t normalized_size = std::accumulate(
+      normalized_shape_.begin(), normalized_shape_.end(), size_t(1), std::multiplies<size_t>());
+  if ((!affine_weight_.empty() && affine_weight_.size() != normalized_size) ||
+      (!affine_bias_.empty() && affine_bias_.size() != normalized_size)) {
+    LOG(ERROR) << "The affine weight and bias size of the layer norm layer do not match the "
+                  "normalized shape";
+    return StatusCode::kInferParameterError;
+  }
+
+  for (uint32_t i = 0; i < inputs.size(); ++i) {
+    const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
+    CHECK(input != nullptr && !input->empty())
+        << "The input tensor array in the layer norm layer has an empty tensor " << i << " th";
+
+    // 归一化的维度是输入的最后几维
+    const std::vector<uint32_t>& raw_shapes = input->raw_shapes();
+    if (raw_shapes.size() < normalized_shape_.size() ||
+        !std::equal(normalized_shape_.begin(), normalized_shape_.end(),
+                    raw_shapes.end() - normalized_shape_.size())) {
+      LOG(ERROR) << "The trailing dimensions of the input tensor do not match the normalized "
+                    "shape of the layer norm layer "
+                 << i << " th";
+      return StatusCode::kInferInOutDimMismatch;
+    }
+
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(i);
+    if (output != nullptr && !output->empty()) {
+      CHECK(output->shapes() == input->shapes())
+          << "The input and output tensor shapes of the layer norm layer do not match " << i
+          << " th";
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode LayerNormLayer::ForwardUnchecked(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const uint32_t normalized_dims = normalized_shape_.size();
+  const uint32_t batch_size = inputs.size();
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
+    std::shared_ptr<Tensor<float>> output = outputs.at(i);
+    if (output == nullptr || output->empty()) {
+      output = std::make_shared<Tensor<float>>(input->shapes());
+      outputs.at(i) = output;
+    }
+
+    const uint32_t channels = input->channels();
+    const uint32_t rows = input->rows();
+    const uint32_t cols = input->cols();
+    const size_t plane_size = (size_t)rows * cols;
+    const float* input_ptr = input->raw_ptr();
+    float* output_ptr = output->raw_ptr();
+    if (normalized_dims == 1) {
+      // 每一行是一组, 按行分块并行
+      const uint32_t row_blocks = (rows + kLayerNormRowBlock - 1) / kLayerNormRowBlock;
+#pragma omp parallel for
+      for (uint32_t task = 0; task < channels * row_blocks; ++task) {
+        const uint32_t channel = task / row_blocks;
+        const uint32_t row_begin = task % row_blocks * kLayerNormRowBlock;
+        const uint32_t row_end = std::min(rows, row_begin + kLayerNormRowBlock);
+        NormalizeRows(input_ptr + channel * plane_size, output_ptr + channel * plane_size, rows,
+                      cols, row_begin, row_end);
+      }
+    } else {
+      // 每个通道或整个张量是一组, 组内的数据连续存放
+      const uint32_t group_channels = normalized_dims == 3 ? channels : 1;
+      const uint32_t group_count = channels / group_channels;
+#pragma omp parallel for
+      for (uint32_t group = 0; group < group_count; ++group) {
+        const size_t offset = (size_t)group * group_channels * plane_size;
+        NormalizeGroup(input_ptr + offset, output_ptr + offset, group_channels, rows, cols);
+      }
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+void LayerNormLayer::NormalizeRows(const float* input, float* output, uint32_t rows,
+                                   uint32_t cols, uint32_t row_begin, uint32_t row_end) const {
+  const float* weight = affine_weight_.empty() ? nullptr : affine_weight_.data();
+  const float* bias = affine_bias_.empty() ? nullptr : affine_bias_.data();
+  uint32_t row = row_begin;
+#if KUIPER_X86_DISPATCH
+  static const bool use_avx2 = utils::GetCpuIsa() >= utils::CpuIsa::kAVX2;
+  if (use_avx2) {
+    row = LayerNormRowsAVX2(input, output, rows, cols, row_begin, row_end, eps_, weight, bias);
+  }
+#endif
+  for (; row < row_end; ++row) {
+    const float shift = input[row];
+    float sum = 0.f;
+    float sum_sq = 0.f;
+    for (uint32_t col = 0; col < cols; ++col) {
+      const float diff = input[(size_t)col * rows + row] - shift;
+      sum += diff;
+      sum_sq += diff * diff;
+    }
+    const float mean_shift = sum / float(cols);
+    const float var = std::max(sum_sq / float(cols) - mean_shift * mean_shift, 0.f);
+    const float rstd = 1.f / std::sqrt(var + eps_);
+    const float mean = shift + mean_shift;
+    for (uint32_t col = 0; col < cols; ++col) {
+      const size_t index = (size_t)col * rows + row;
+      float value = (input[index] - mean) * rstd;
+      if (weight != nullptr) {
+        value *= weight[col];
+      }
+      if (bias != nullptr) {
+        value += bias[col];
+      }
+      output[index] = value;
+    }
+  }
+}
+
+void LayerNormLayer::NormalizeGroup(const float* input, float* output, uint32_t channels,
+                                    uint32_t rows, uint32_t cols) const {
+  const size_t size = (size_t)channels * rows * cols;
+  const float shift = input[0];
+  float sum = 0.f;
+  float sum_sq = 0.f;
+  size_t i = 0;
+#if KUIPER_X86_DISPATCH
+  static const bool use_avx2 = utils::GetCpuIsa() >= utils::CpuIsa::kAVX2;
+  if (use_avx2) {
+    i = ShiftedSumsAVX2(input, size, shift, sum, sum_sq);
+  }
+#endif
+  for (; i < size; ++i) {
+    const float diff = input[i] - shift;
+    sum += diff;
+    sum_sq += diff * diff;
+  }
+  const float mean_shift = sum / float(size);
+  const float var = std::max(sum_sq / float(size) - mean_shift * mean_shift, 0.f);
+  const float rstd = 1.f / std::sqrt(var + eps_);
+  const float mean = shift + mean_shift;
+  if (affine_weight_.empty() && affine_bias_.empty()) {
+    for (i = 0; i < size; ++i) {
+      output[i] = (input[i] - mean) * rstd;
+    }
+    return;
+  }
+
+  // 仿射参数按行优先排列, 张量按列优先存放
+  for (uint32_t c = 0; c < channels; ++c) {
+    for (uint32_t col = 0; col < cols; ++col) {
+      for (uint32_t row = 0; row < rows; ++row) {
+        const size_t index = ((size_t)c * cols + col) * rows + row;
+        const size_t affine_index = ((size_t)c * rows + row) * cols + col;
+        float value = (input[index] - mean) * rstd;
+        if (!affine_weight_.empty()) {
+          value *= affine_weight_.at(affine_index);
+        }
+        if (!affine_bias_.empty()) {
+          value += affine_bias_.at(affine_index);
+        }
+        output[index] = value;
+      }
+    }
+  }
+}
+
+StatusCode LayerNormLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                          std::shared_ptr<Layer<float>>& layer_norm_layer) {
+  CHECK(op != nullptr) << "LayerNorm operator is nullptr";
+  const auto& params = op->params;
+  CHECK(!params.empty()) << "Operator parameter is empty";
+
+  if (op->input_operands_seq.size() > 1) {
+    LOG(ERROR) << "The layer norm layer does not support weight and bias inputs";
+    return StatusCode::kAttributeMissing;
+  }
+
+  if (params.find("normalized_shape") == params.end()) {
+    LOG(ERROR) << "Can not find the normalized shape parameter";
+    return StatusCode::kParameterMissing;
+  }
+
+  auto normalized_shape =
+      std::dynamic_pointer_cast<RuntimeParameterIntArray>(params.at("normalized_shape"));
+  if (!normalized_shape) {
+    LOG(ERROR) << "Can not find the normalized shape parameter";
+    return StatusCode::kParameterMissing;
+  }
+
+  if (params.find("eps") == params.end()) {
+    LOG(ERROR) << "Can not find the eps parameter";
+    return StatusCode::kParameterMissing;
+  }
+
+  auto eps = std::dynamic_pointer_cast<RuntimeParameterFloat>(params.at("eps"));
+  if (!eps) {
+    LOG(ERROR) << "Can not find the eps parameter";
+    return StatusCode::kParameterMissing;
+  }
+
+  // nn.LayerNorm的仿射参数保存在属性中, F.layer_norm没有仿射参数
+  bool elementwise_affine = false;
+  if (params.find("elementwise_affine") != params.end()) {
+    auto affine_param =
+        std::dynamic_pointer_cast<RuntimeParameterBool>(params.at("elementwise_affine"));
+    if (!affine_param) {
+      LOG(ERROR) << "Can not find the elementwise affine parameter";
+      return StatusCode::kParameterMissing;
+    }
+    elementwise_affine = affine_param->value;
+  }
+
+  std::vector<float> affine_weight;
+  std::vector<float> affine_bias;
+  if (elementwise_affine) {
+    const auto& attrs = op->attribute;
+    if (attrs.find("weight") == attrs.end()) {
+      LOG(ERROR) << "Can not find the affine weight attribute";
+      return StatusCode::kAttributeMissing;
+    }
+    affine_weight = attrs.at("weight")->get<float>();
+    if (attrs.find("bias") != attrs.end()) {
+      affine_bias = attrs.at("bias")->get<float>();
+    }
+  }
+
+  layer_norm_layer = std::make_shared<LayerNormLayer>(normalized_shape->value, eps->value,
+                                                      affine_weight, affine_bias);
+  return StatusCode::kSuccess;
+}
+
+LayerRegistererWrapper kLayerNormCreateInstanceNN("nn.LayerNorm",
+                                                  LayerNormLayer::CreateInstance);
+LayerRegistererWrapper kLayerNormCreateInstanceF("F.layer_norm", LayerNormLayer::CreateInstance);
+
+}  // namespace kuiper_infer
@@ -0,0 +1,73 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef KUIPER_INFER_SOURCE_LAYER_DETAILS_LAYER_NORM_HPP_
+#define KUIPER_INFER_SOURCE_LAYER_DETAILS_LAYER_NORM_HPP_
+#include "layer/abstract/param_layer.hpp"
+#include "runtime/runtime_op.hpp"
+
+namespace kuiper_infer {
+
+/**
+ * @brief Layer normalization over the trailing dimensions given by normalized_shape
+ *
+ * The mean and the variance of every normalized group are computed in one pass over the
+ * input; normalizing over the last dimension handles 8 rows per AVX2 vector.
+ */
+class LayerNormLayer : public ParamLayer {
+ public:
+  /**
+   * @param normalized_shape Trailing dimensions to normalize over, at most three
+   * @param affine_weight Row-major element-wise scale of normalized_shape, empty for none
+   * @param affine_bias Row-major element-wise shift of normalized_shape, empty for none
+   */
+  explicit LayerNormLayer(std::vector<int32_t> normalized_shape, float eps,
+                          std::vector<float> affine_weight = {},
+                          std::vector<float> affine_bias = {});
+
+  StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  StatusCode Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const override;
+
+  StatusCode ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                              std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                   std::shared_ptr<Layer<float>>& layer_norm_layer);
+
+ private:
+  void NormalizeRows(const float* input, float* output, uint32_t rows, uint32_t cols,
+                     uint32_t row_begin, uint32_t row_end) const;
+
+  void NormalizeGroup(const float* input, float* output, uint32_t channels, uint32_t rows,
+                      uint32_t cols) const;
+
+ private:
+  std::vector<int32_t> normalized_shape_;
+  float eps_ = 1e-5f;
+  std::vector<float> affine_weight_;
+  std::vector<float> affine_bias_;
+};
+}  // namespace kuiper_infer
+
+#endif  // KUIPER_INFER_SOURCE_LAYER_DETAILS_LAYER_NORM_HPP_
@@ -24,6 +24,8 @@
 #include "linear.hpp"
 #include <glog/logging.h>
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/numa.hpp"
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 
@@ -42,6 +44,15 @@ LinearLayer::LinearLayer(int32_t in_features, int32_t out_features, bool use_bia
 
 StatusCode LinearLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                                 std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  return ForwardUnchecked(inputs, outputs);
+}
+
+StatusCode LinearLayer::Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                              const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
   if (inputs.empty()) {
     LOG(ERROR) << "The input tensor array in the linear layer is empty";
     return StatusCode::kInferInputsEmpty;
@@ -78,13 +89,18 @@ StatusCode LinearLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>
     return StatusCode::kInferParameterError;
   }
 
-  uint32_t batch = inputs.size();
   const std::shared_ptr<Tensor<float>>& weight = weights_.front();
-  arma::fmat weight_data(weight->raw_ptr(), out_features_, in_features_, false, true);
-  const arma::fmat& weight_data_t = weight_data.t();
+  CHECK(weight->rows() == out_features_)
+      << "The row of weight tensor should be same to output_features_";
+  CHECK(weight->cols() == in_features_)
+      << "The col of weight tensor should be same to input_features_";
+  if (use_bias_) {
+    const auto& bias_data = bias_.front()->data();
+    CHECK(!bias_data.empty() && bias_data.n_slices == 1 && bias_data.n_cols == out_features_)
+        << "The col of bias tensor is not same to output_features_";
+  }
 
-#pragma omp parallel for num_threads(batch)
-  for (uint32_t i = 0; i < batch; ++i) {
+  for (uint32_t i = 0; i < inputs.size(); ++i) {
     const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
         << "The input tensor array in the linear layer has an empty tensor " << i << " th";
@@ -92,18 +108,13 @@ StatusCode LinearLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>
 
     const uint32_t feature_dims = input_shapes.at(1);
     const uint32_t in_features = input_shapes.at(2);
-    CHECK(weight_data.n_rows == out_features_)
-        << "The row of weight tensor should be same to output_features_";
-    CHECK(weight_data.n_cols == in_features && in_features == in_features_)
+    CHECK(in_features == in_features_)
         << "The col of weight tensor should be same to input_features_";
 
-    arma::fmat input_vec((float*)input->raw_ptr(), feature_dims, in_features_, false, true);
-    std::shared_ptr<Tensor<float>> output = outputs.at(i);
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(i);
     if (output == nullptr || output->empty()) {
-      output = std::make_shared<Tensor<float>>(1, out_features_, feature_dims);
-      outputs.at(i) = output;
+      continue;
     }
-
     CHECK(output->channels() == 1 && output->rows() == feature_dims &&
           output->cols() == out_features_)
         << "The row of output tensor should be same to feature_dims_ and the "
@@ -118,17 +129,43 @@ StatusCode LinearLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>
     } else {
       LOG(FATAL) << "The shape of output tensor need be equal to one or two";
     }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode LinearLayer::ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                         std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  uint32_t batch = inputs.size();
+  const std::shared_ptr<Tensor<float>>& weight = weights_.front();
+  arma::fmat weight_data(weight->raw_ptr(), out_features_, in_features_, false, true);
+  arma::fmat weight_data_t;
+  if (weight_t_replicas_.empty() && sparse_weight_ == nullptr) {
+    weight_data_t = weight_data.t();
+  }
+
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch))
+  for (uint32_t i = 0; i < batch; ++i) {
+    const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
+    const uint32_t feature_dims = input->shapes().at(1);
+    arma::fmat input_vec((float*)input->raw_ptr(), feature_dims, in_features_, false, true);
+    std::shared_ptr<Tensor<float>> output = outputs.at(i);
+    if (output == nullptr || output->empty()) {
+      output = std::make_shared<Tensor<float>>(1, feature_dims, out_features_);
+      outputs.at(i) = output;
+    }
 
     arma::fmat& result = output->slice(0);
-    result = input_vec * weight_data_t;
+    if (sparse_weight_ != nullptr) {
+      sparse_weight_->Multiply(input_vec.memptr(), feature_dims, result.memptr());
+    } else {
+      // 有权重副本时读取当前线程所在NUMA节点上的副本
+      const arma::fmat& weight_t = weight_t_replicas_.empty()
+                                       ? weight_data_t
+                                       : weight_t_replicas_.at(utils::GetCurrentNumaNode());
+      result = input_vec * weight_t;
+    }
     if (use_bias_) {
-      CHECK(!this->bias_.empty() && this->bias_.size() == 1)
-          << "The bias tensor is empty, but use_bias is true";
-
-      const auto& bias_data = bias_.front()->data();
-      CHECK(!bias_data.empty() && bias_data.n_slices == 1 && bias_data.n_cols == out_features_)
-          << "The col of bias tensor is not same to output_features_";
-      const auto& bias_tensor = bias_data.slice(0);
+      const auto& bias_tensor = bias_.front()->data().slice(0);
 #pragma omp parallel for
       for (uint32_t row = 0; row < result.n_rows; ++row) {
         result.row(row) += bias_tensor;
@@ -138,6 +175,46 @@ StatusCode LinearLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>
   return StatusCode::kSuccess;
 }
 
+void LinearLayer::InitSparseWeight() {
+  CHECK(weights_.size() == 1) << "Need one weight tensor in the linear layer";
+  const std::shared_ptr<Tensor<float>>& weight = weights_.front();
+  arma::fmat weight_data(weight->raw_ptr(), out_features_, in_features_, false, true);
+  sparse_weight_ = BlockSparseMatrix::Create(weight_data.t());
+}
+
+void LinearLayer::set_weights(const std::vector<float>& weights) {
+  ParamLayer::set_weights(weights);
+  ResetDerivedWeights();
+}
+
+void LinearLayer::set_weights(const std::vector<std::shared_ptr<Tensor<float>>>& weights) {
+  ParamLayer::set_weights(weights);
+  ResetDerivedWeights();
+}
+
+void LinearLayer::ResetDerivedWeights() {
+  // 在替换权重时重建块稀疏权重, Forward只读取已经建好的权重
+  InitSparseWeight();
+  if (!weight_t_replicas_.empty()) {
+    ReplicateWeights();
+  }
+}
+
+void LinearLayer::ReplicateWeights() {
+  weight_t_replicas_.clear();
+  const uint32_t node_count = utils::GetNumaTopology().node_count();
+  if (node_count <= 1 || weights_.size() != 1) {
+    return;
+  }
+  const std::shared_ptr<Tensor<float>>& weight = weights_.front();
+  arma::fmat weight_data(weight->raw_ptr(), out_features_, in_features_, false, true);
+  for (uint32_t node = 0; node < node_count; ++node) {
+    arma::fmat weight_t = weight_data.t();
+    utils::MoveToNumaNode(weight_t.memptr(), weight_t.n_elem * sizeof(float), node);
+    weight_t_replicas_.push_back(std::move(weight_t));
+  }
+}
+
 StatusCode LinearLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                        std::shared_ptr<Layer<float>>& linear_layer) {
   CHECK(op != nullptr) << "Linear operator is nullptr";
@@ -179,13 +256,14 @@ StatusCode LinearLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& o
   int32_t in_features = shapes.at(1);
   const bool use_bias = use_bias_param->value;
 
-  linear_layer = std::make_shared<LinearLayer>(in_features, out_features, use_bias);
+  auto linear_layer_derived = std::make_shared<LinearLayer>(in_features, out_features, use_bias);
   if (use_bias) {
-    linear_layer->set_bias(bias->get<float>());
+    linear_layer_derived->set_bias(bias->get<float>());
   }
 
   // load weights
-  linear_layer->set_weights(weight->get<float>());
+  linear_layer_derived->set_weights(weight->get<float>());
+  linear_layer = linear_layer_derived;
   return StatusCode::kSuccess;
 }
 
@@ -23,6 +23,7 @@
 
 #ifndef KUIPER_INFER_SOURCE_LAYER_LINEAR_HPP_
 #define KUIPER_INFER_SOURCE_LAYER_LINEAR_HPP_
+#include "block_sparse.hpp"
 #include "layer/abstract/layer.hpp"
 #include "layer/abstract/param_layer.hpp"
 
@@ -36,13 +37,48 @@ class LinearLayer : public ParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  StatusCode Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const override;
+
+  StatusCode ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                              std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  void ReplicateWeights() override;
+
+  void set_weights(const std::vector<float>& weights) override;
+
+  void set_weights(const std::vector<std::shared_ptr<Tensor<float>>>& weights) override;
+
+  /**
+   * @brief Checks whether the weight is stored in blocked CSR format
+   *
+   * Pruned weights with enough zero blocks skip the zero blocks in Forward.
+   */
+  bool block_sparse() const { return sparse_weight_ != nullptr; }
+
   static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                    std::shared_ptr<Layer<float>>& linear_layer);
 
  private:
+  /**
+   * @brief Converts the transposed weight to blocked CSR format if enough of its blocks are zero
+   */
+  void InitSparseWeight();
+
+  /**
+   * @brief Rebuilds the copies derived from the weight after it has been replaced
+   */
+  void ResetDerivedWeights();
+
   int32_t in_features_ = 0;
   int32_t out_features_ = 0;
   bool use_bias_ = false;
+
+  // 每个NUMA节点一份转置后的权重, 为空时每次Forward重新转置
+  std::vector<arma::fmat> weight_t_replicas_;
+
+  // 剪枝后的权重有足够多的零块时使用的块稀疏权重, 在set_weights时建立
+  std::shared_ptr<BlockSparseMatrix> sparse_weight_;
 };
 }  // namespace kuiper_infer
 
@@ -0,0 +1,178 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "matmul.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
+
+namespace kuiper_infer {
+
+struct MatMulShape {
+  uint32_t channels = 0;
+  uint32_t rows = 0;
+  uint32_t cols = 0;
+  bool vector = false;
+};
+
+// 一维的左操作数是行向量, 一维的右操作数是列向量
+static MatMulShape GetMatMulShape(const std::shared_ptr<Tensor<float>>& tensor, bool right) {
+  MatMulShape shape;
+  if (tensor->raw_shapes().size() == 1) {
+    shape.channels = 1;
+    shape.rows = right ? tensor->size() : 1;
+    shape.cols = right ? 1 : tensor->size();
+    shape.vector = true;
+  } else {
+    shape.channels = tensor->channels();
+    shape.rows = tensor->rows();
+    shape.cols = tensor->cols();
+  }
+  return shape;
+}
+
+MatMulLayer::MatMulLayer() : NonParamLayer("MatMul") {}
+
+StatusCode MatMulLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  return ForwardUnchecked(inputs, outputs);
+}
+
+StatusCode MatMulLayer::Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                              const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The input tensor array in the matmul layer is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+
+  if (outputs.empty()) {
+    LOG(ERROR) << "The output tensor array in the matmul layer is empty";
+    return StatusCode::kInferOutputsEmpty;
+  }
+
+  // 前一半是左操作数, 后一半是右操作数
+  const uint32_t batch_size = outputs.size();
+  if (inputs.size() != batch_size * 2) {
+    LOG(ERROR) << "The input and output tensor array size of the matmul layer do not match";
+    return StatusCode::kInferInOutDimMismatch;
+  }
+
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const std::shared_ptr<Tensor<float>>& input1 = inputs.at(i);
+    const std::shared_ptr<Tensor<float>>& input2 = inputs.at(i + batch_size);
+    CHECK(input1 != nullptr && !input1->empty() && input2 != nullptr && !input2->empty())
+        << "The input tensor array in the matmul layer has an empty tensor " << i << " th";
+
+    const MatMulShape shape1 = GetMatMulShape(input1, false);
+    const MatMulShape shape2 = GetMatMulShape(input2, true);
+    if (shape1.cols != shape2.rows) {
+      LOG(ERROR) << "The inner dimensions of the matmul layer inputs do not match " << i
+                 << " th";
+      return StatusCode::kInferInOutDimMismatch;
+    }
+
+    if (shape1.channels != shape2.channels && shape1.channels != 1 && shape2.channels != 1) {
+      LOG(ERROR) << "The batch dimensions of the matmul layer inputs can not be broadcast " << i
+                 << " th";
+      return StatusCode::kInferInOutDimMismatch;
+    }
+
+    if ((shape1.vector && shape2.channels != 1) || (shape2.vector && shape1.channels != 1)) {
+      LOG(ERROR) << "The matmul layer only supports a vector input with a single matrix " << i
+                 << " th";
+      return StatusCode::kInferParameterError;
+    }
+
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(i);
+    if (output == nullptr || output->empty()) {
+      continue;
+    }
+    const uint32_t channels = std::max(shape1.channels, shape2.channels);
+    if (shape1.vector || shape2.vector) {
+      CHECK(output->size() == shape1.rows * shape2.cols)
+          << "The output tensor size of the matmul layer is wrong " << i << " th";
+    } else {
+      CHECK(output->channels() == channels && output->rows() == shape1.rows &&
+            output->cols() == shape2.cols)
+          << "The output tensor shape of the matmul layer is wrong " << i << " th";
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode MatMulLayer::ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                         std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const uint32_t batch_size = outputs.size();
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    const std::shared_ptr<Tensor<float>>& input1 = inputs.at(i);
+    const std::shared_ptr<Tensor<float>>& input2 = inputs.at(i + batch_size);
+    const MatMulShape shape1 = GetMatMulShape(input1, false);
+    const MatMulShape shape2 = GetMatMulShape(input2, true);
+    const uint32_t channels = std::max(shape1.channels, shape2.channels);
+    const uint32_t rows = shape1.rows;
+    const uint32_t cols = shape2.cols;
+    const uint32_t inner = shape1.cols;
+
+    std::shared_ptr<Tensor<float>> output = outputs.at(i);
+    if (output == nullptr || output->empty()) {
+      if (shape1.vector || shape2.vector) {
+        output = std::make_shared<Tensor<float>>(rows * cols);
+      } else {
+        output = std::make_shared<Tensor<float>>(channels, rows, cols);
+      }
+      outputs.at(i) = output;
+    }
+
+    // 张量的每个通道按列优先存放, 可以直接看作矩阵
+#pragma omp parallel for if (channels > 1)
+    for (uint32_t c = 0; c < channels; ++c) {
+      const size_t offset1 = shape1.channels == 1 ? 0 : (size_t)c * rows * inner;
+      const size_t offset2 = shape2.channels == 1 ? 0 : (size_t)c * inner * cols;
+      const arma::fmat matrix1(input1->raw_ptr() + offset1, rows, inner, false, true);
+      const arma::fmat matrix2(input2->raw_ptr() + offset2, inner, cols, false, true);
+      arma::fmat result(output->raw_ptr() + (size_t)c * rows * cols, rows, cols, false, true);
+      result = matrix1 * matrix2;
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode MatMulLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
+                                       std::shared_ptr<Layer<float>>& matmul_layer) {
+  CHECK(op != nullptr) << "MatMul operator is nullptr";
+  if (op->input_operands_seq.size() != 2) {
+    LOG(ERROR) << "The matmul layer needs two inputs";
+    return StatusCode::kInferInputsEmpty;
+  }
+  matmul_layer = std::make_shared<MatMulLayer>();
+  return StatusCode::kSuccess;
+}
+
+LayerRegistererWrapper kMatMulCreateInstance("torch.matmul", MatMulLayer::CreateInstance);
+LayerRegistererWrapper kBmmCreateInstance("torch.bmm", MatMulLayer::CreateInstance);
+
+}  // namespace kuiper_infer
@@ -22,9 +22,11 @@
 // Created by fss on 22-11-18.
 
 #include "maxpooling.hpp"
+#include "data/tensor_half.hpp"
 #include "data/tensor_util.hpp"
 #include "layer/abstract/layer_factory.hpp"
 #include "runtime/runtime_ir.hpp"
+#include "utils/cpu/thread_budget.hpp"
 namespace kuiper_infer {
 
 MaxPoolingLayer::MaxPoolingLayer(uint32_t padding_h, uint32_t padding_w, uint32_t pooling_size_h,
@@ -44,6 +46,16 @@ MaxPoolingLayer::MaxPoolingLayer(uint32_t padding_h, uint32_t padding_w, uint32_
 
 StatusCode MaxPoolingLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                                     std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  return ForwardUnchecked(inputs, outputs);
+}
+
+StatusCode MaxPoolingLayer::Check(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
   if (inputs.empty()) {
     LOG(ERROR) << "The input tensor array in the maxpooling layer is empty";
     return StatusCode::kInferInputsEmpty;
@@ -72,18 +84,43 @@ StatusCode MaxPoolingLayer::Forward(const std::vector<std::shared_ptr<Tensor<flo
     return StatusCode::kInferParameterError;
   }
 
-  const uint32_t batch = inputs.size();
-  const uint32_t pooling_h = pooling_size_h_;
-  const uint32_t pooling_w = pooling_size_w_;
-
-#pragma omp parallel for num_threads(batch)
-  for (uint32_t i = 0; i < batch; ++i) {
+  for (uint32_t i = 0; i < inputs.size(); ++i) {
     const std::shared_ptr<Tensor<float>>& input_data = inputs.at(i);
     CHECK(input_data != nullptr && !input_data->empty())
         << "The input tensor array in the max pooling layer has an "
            "empty tensor "
         << i << "th";
 
+    const uint32_t input_padded_h = input_data->rows() + 2 * padding_h_;
+    const uint32_t input_padded_w = input_data->cols() + 2 * padding_w_;
+    CHECK(input_padded_h >= pooling_size_h_ && input_padded_w >= pooling_size_w_)
+        << "The input tensor in the max pooling layer is smaller than the pooling window " << i
+        << "th";
+
+    const uint32_t output_h = (input_padded_h - pooling_size_h_) / stride_h_ + 1;
+    const uint32_t output_w = (input_padded_w - pooling_size_w_) / stride_w_ + 1;
+    const std::shared_ptr<Tensor<float>>& output_data = outputs.at(i);
+    if (output_data != nullptr && !output_data->empty()) {
+      CHECK(output_data->rows() == output_h && output_data->cols() == output_w &&
+            output_data->channels() == input_data->channels())
+          << "The output tensor array in the max pooling layer "
+             "has an incorrectly sized tensor "
+          << i << "th";
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode MaxPoolingLayer::ForwardUnchecked(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const uint32_t batch = inputs.size();
+  const uint32_t pooling_h = pooling_size_h_;
+  const uint32_t pooling_w = pooling_size_w_;
+
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch))
+  for (uint32_t i = 0; i < batch; ++i) {
+    const std::shared_ptr<Tensor<float>>& input_data = inputs.at(i);
     const uint32_t input_h = input_data->rows();
     const uint32_t input_w = input_data->cols();
     const uint32_t input_padded_h = input_data->rows() + 2 * padding_h_;
@@ -102,40 +139,84 @@ StatusCode MaxPoolingLayer::Forward(const std::vector<std::shared_ptr<Tensor<flo
       outputs.at(i) = output_data;
     }
 
-    CHECK(output_data->rows() == output_h && output_data->cols() == output_w &&
-          output_data->channels() == input_c)
-        << "The output tensor array in the max pooling layer "
-           "has an incorrectly sized tensor "
-        << i << "th";
-
     for (uint32_t ic = 0; ic < input_c; ++ic) {
-      const arma::fmat& input_channel = input_data->slice(ic);
-      arma::fmat& output_channel = output_data->slice(ic);
-      for (uint32_t c = 0; c < input_padded_w - pooling_w + 1; c += stride_w_) {
-        uint32_t output_col = uint32_t(c / stride_w_);
-        for (uint32_t r = 0; r < input_padded_h - pooling_h + 1; r += stride_h_) {
-          uint32_t output_row = uint32_t(r / stride_h_);
-          float* output_channel_ptr = output_channel.colptr(output_col);
-          float max_value = std::numeric_limits<float>::lowest();
-          for (uint32_t w = 0; w < pooling_w; ++w) {
-            const float* col_ptr = input_channel.colptr(c + w - padding_w_) + r;
-            for (uint32_t h = 0; h < pooling_h; ++h) {
-              float current_value = 0.f;
-              if ((h + r >= padding_h_ && w + c >= padding_w_) &&
-                  (h + r < input_h + padding_h_ && w + c < input_w + padding_w_)) {
-                current_value = *(col_ptr + h - padding_h_);
-              } else {
-                current_value = std::numeric_limits<float>::lowest();
-              }
-              max_value = std::max(max_value, current_value);
-            }
+      PoolChannel(input_data->raw_ptr(ic * input_h * input_w), input_h, input_w,
+                  output_data->raw_ptr(ic * output_h * output_w), output_h);
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode MaxPoolingLayer::ForwardPacked(
+    const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+    const std::vector<const HalfTensor*>& packed_inputs,
+    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  CHECK(packed_inputs.size() == outputs.size())
+      << "The input and output tensor array size of the maxpooling layer do not match";
+  for (uint32_t i = 0; i < outputs.size(); ++i) {
+    const std::shared_ptr<Tensor<float>>& output_data = outputs.at(i);
+    CHECK(output_data != nullptr && !output_data->empty())
+        << "The output tensor array in the max pooling layer has an empty tensor " << i << "th";
+    const HalfTensor* packed_input = packed_inputs.at(i);
+    const std::vector<uint32_t> input_shapes =
+        packed_input != nullptr ? packed_input->shapes() : inputs.at(i)->shapes();
+    const uint32_t output_h = output_data->rows();
+    const uint32_t output_plane = output_h * output_data->cols();
+    ForEachInputChannel(inputs.at(i), packed_input,
+                        [&](uint32_t channel, const float* input_channel) {
+                          PoolChannel(input_channel, input_shapes.at(1), input_shapes.at(2),
+                                      output_data->raw_ptr(channel * output_plane), output_h);
+                        });
+  }
+  return StatusCode::kSuccess;
+}
+
+void MaxPoolingLayer::PoolChannel(const float* input, uint32_t input_h, uint32_t input_w,
+                                  float* output, uint32_t output_h) const {
+  const uint32_t pooling_h = pooling_size_h_;
+  const uint32_t pooling_w = pooling_size_w_;
+  const uint32_t input_padded_h = input_h + 2 * padding_h_;
+  const uint32_t input_padded_w = input_w + 2 * padding_w_;
+  for (uint32_t c = 0; c < input_padded_w - pooling_w + 1; c += stride_w_) {
+    uint32_t output_col = uint32_t(c / stride_w_);
+    float* output_channel_ptr = output + output_col * output_h;
+    for (uint32_t r = 0; r < input_padded_h - pooling_h + 1; r += stride_h_) {
+      uint32_t output_row = uint32_t(r / stride_h_);
+      float max_value = std::numeric_limits<float>::lowest();
+      for (uint32_t w = 0; w < pooling_w; ++w) {
+        for (uint32_t h = 0; h < pooling_h; ++h) {
+          float current_value = 0.f;
+          if ((h + r >= padding_h_ && w + c >= padding_w_) &&
+              (h + r < input_h + padding_h_ && w + c < input_w + padding_w_)) {
+            current_value = input[(c + w - padding_w_) * input_h + r + h - padding_h_];
+          } else {
+            current_value = std::numeric_limits<float>::lowest();
           }
-          *(output_channel_ptr + output_row) = max_value;
+          max_value = std::max(max_value, current_value);
         }
       }
+      *(output_channel_ptr + output_row) = max_value;
     }
   }
-  return StatusCode::kSuccess;
+}
+
+bool MaxPoolingLayer::GetTileWindow(TileWindow& window) const {
+  window.kernel_h = pooling_size_h_;
+  window.kernel_w = pooling_size_w_;
+  window.stride_h = stride_h_;
+  window.stride_w = stride_w_;
+  window.padding_h = padding_h_;
+  window.padding_w = padding_w_;
+  window.dilation_h = 1;
+  window.dilation_w = 1;
+  // 池化的填充值不参与最大值的比较
+  window.padding_value = std::numeric_limits<float>::lowest();
+  return true;
+}
+
+std::shared_ptr<Layer<float>> MaxPoolingLayer::CreateTileLayer() const {
+  return std::make_shared<MaxPoolingLayer>(0, 0, pooling_size_h_, pooling_size_w_, stride_h_,
+                                           stride_w_);
 }
 
 StatusCode MaxPoolingLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
@@ -33,10 +33,29 @@ class MaxPoolingLayer : public NonParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  StatusCode Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                   const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const override;
+
+  StatusCode ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                              std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  bool is_packed_input_supported() const override { return true; }
+
+  StatusCode ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                           const std::vector<const HalfTensor*>& packed_inputs,
+                           std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
+  bool GetTileWindow(TileWindow& window) const override;
+
+  std::shared_ptr<Layer<float>> CreateTileLayer() const override;
+
   static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                    std::shared_ptr<Layer<float>>& max_layer);
 
  private:
+  void PoolChannel(const float* input, uint32_t input_h, uint32_t input_w, float* output,
+                   uint32_t output_h) const;
+
   uint32_t padding_h_ = 0;
   uint32_t padding_w_ = 0;
   uint32_t pooling_size_h_ = 0;
@@ -23,6 +23,7 @@
 #include "relu.hpp"
 #include "activation_sse.hpp"
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 StatusCode ReluLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
@@ -47,7 +48,7 @@ StatusCode ReluLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
   ActivationFunc relu_function = ApplySSEActivation(ActivationType::kActivationRelu);
 
   const uint32_t batch_size = inputs.size();
-#pragma omp parallel for num_threads(batch_size)
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
   for (uint32_t i = 0; i < batch_size; ++i) {
     const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
@@ -64,6 +65,14 @@ StatusCode ReluLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
   }
   return StatusCode::kSuccess;
 }
+
+StatusCode ReluLayer::ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                    const std::vector<const HalfTensor*>& packed_inputs,
+                                    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  using namespace activation;
+  return ApplyPackedActivation(ActivationType::kActivationRelu, inputs, packed_inputs, outputs);
+}
+
 StatusCode ReluLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                      std::shared_ptr<Layer<float>>& relu_layer) {
   CHECK(op != nullptr) << "Relu operator is nullptr";
@@ -25,6 +25,7 @@
 #include <glog/logging.h>
 #include "activation_sse.hpp"
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 
@@ -49,7 +50,7 @@ StatusCode SigmoidLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>
   ActivationFunc sigmoid_function = ApplySSEActivation(ActivationType::kActivationSigmoid);
 
   const uint32_t batch_size = inputs.size();
-#pragma omp parallel for num_threads(batch_size)
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
   for (uint32_t i = 0; i < batch_size; ++i) {
     const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
@@ -70,6 +71,13 @@ StatusCode SigmoidLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>
   return StatusCode::kSuccess;
 }
 
+StatusCode SigmoidLayer::ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                       const std::vector<const HalfTensor*>& packed_inputs,
+                                       std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  using namespace activation;
+  return ApplyPackedActivation(ActivationType::kActivationSigmoid, inputs, packed_inputs, outputs);
+}
+
 StatusCode SigmoidLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                         std::shared_ptr<Layer<float>>& sigmoid_layer) {
   CHECK(op != nullptr) << "Sigmoid operator is nullptr";
@@ -25,6 +25,7 @@
 #include "activation_sse.hpp"
 #include "layer/abstract/layer_factory.hpp"
 #include "tick.hpp"
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 
@@ -52,7 +53,7 @@ StatusCode SiLULayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
   ActivationFunc silu_function = ApplySSEActivation(ActivationType::kActivationSilu);
 
   const uint32_t batch_size = inputs.size();
-#pragma omp parallel for num_threads(batch_size)
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
   for (uint32_t i = 0; i < batch_size; ++i) {
     const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
@@ -71,6 +72,13 @@ StatusCode SiLULayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
   return StatusCode::kSuccess;
 }
 
+StatusCode SiLULayer::ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                    const std::vector<const HalfTensor*>& packed_inputs,
+                                    std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  using namespace activation;
+  return ApplyPackedActivation(ActivationType::kActivationSilu, inputs, packed_inputs, outputs);
+}
+
 StatusCode SiLULayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                      std::shared_ptr<Layer<float>>& silu_layer) {
   CHECK(op != nullptr) << "SiLU operator is nullptr";
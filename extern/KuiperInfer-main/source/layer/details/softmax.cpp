@@ -26,6 +26,7 @@
 #include <numeric>
 #include "data/tensor_util.hpp"
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
 #include "utils/math/fmath.hpp"
 namespace kuiper_infer {
 
@@ -50,7 +51,7 @@ StatusCode SoftmaxLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>
   }
 
   const uint32_t batch_size = inputs.size();
-#pragma omp parallel for num_threads(batch_size)
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
   for (uint32_t i = 0; i < batch_size; ++i) {
     const std::shared_ptr<Tensor<float>>& input = inputs.at(i);
     CHECK(input != nullptr && !input->empty())
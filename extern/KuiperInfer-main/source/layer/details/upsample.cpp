@@ -22,7 +22,9 @@
 // Created by fss on 22-12-25.
 #include "upsample.hpp"
 #include <cmath>
+#include "data/tensor_half.hpp"
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
 namespace kuiper_infer {
 
 static void CalcIndexAndLambda(int32_t input_size, int32_t output_size, float div_scale,
@@ -83,7 +85,7 @@ StatusCode UpSampleLayer::Forward(const std::vector<std::shared_ptr<Tensor<float
   }
 
   const uint32_t batch_size = inputs.size();
-#pragma omp parallel for num_threads(batch_size)
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
   for (uint32_t i = 0; i < batch_size; ++i) {
     const arma::fcube& input_data = inputs.at(i)->data();
     LOG_IF(FATAL, input_data.empty())
@@ -111,89 +113,104 @@ StatusCode UpSampleLayer::Forward(const std::vector<std::shared_ptr<Tensor<float
         << i << "th";
 
     const uint32_t channels = input_data.n_slices;
-    if (mode_ == UpSampleMode::kModeNearest) {
 #pragma omp parallel for
-      for (uint32_t c = 0; c < channels; ++c) {
-        const arma::fmat& input_channel = input_data.slice(c);
-        arma::fmat& output_channel = output_data.slice(c);
-
-        const uint32_t input_w = input_channel.n_cols;
-        const uint32_t input_h = input_channel.n_rows;
-        const uint32_t output_w = output_channel.n_cols;
-        const uint32_t output_h = output_channel.n_rows;
-        for (uint32_t w = 0; w < input_w; ++w) {
-          const float* input_col_ptr = input_channel.colptr(w);
-          const uint32_t scaled_w = w * static_cast<uint32_t>(scale_w_);
-          for (uint32_t sw = 0; sw < static_cast<uint32_t>(scale_w_); ++sw) {
-            if (scaled_w + sw >= output_w) {
-              continue;
-            }
-            float* output_col_ptr = output_channel.colptr(scaled_w + sw);
-            for (uint32_t h = 0; h < input_h; ++h) {
-              const uint32_t scaled_h = h * static_cast<uint32_t>(scale_h_);
-              float* output_ptr = output_col_ptr + scaled_h;
-              float input_value = *(input_col_ptr + h);
-              for (uint32_t sh = 0; sh < static_cast<uint32_t>(scale_h_); ++sh) {
-                if (scaled_h + sh < output_h) {
-                  *(output_ptr + sh) = input_value;
-                }
-              }
+    for (uint32_t c = 0; c < channels; ++c) {
+      const arma::fmat& input_channel = input_data.slice(c);
+      arma::fmat& output_channel = output_data.slice(c);
+      UpSampleChannel(input_channel.memptr(), input_channel.n_rows, input_channel.n_cols,
+                      output_channel.memptr(), output_channel.n_rows, output_channel.n_cols);
+    }
+  }
+  return StatusCode::kSuccess;
+}
+
+StatusCode UpSampleLayer::ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                        const std::vector<const HalfTensor*>& packed_inputs,
+                                        std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  CHECK(packed_inputs.size() == outputs.size())
+      << "The input and output tensor array size of the upsample layer do not match";
+  for (uint32_t i = 0; i < outputs.size(); ++i) {
+    const std::shared_ptr<Tensor<float>>& output = outputs.at(i);
+    CHECK(output != nullptr && !output->empty())
+        << "The output tensor array in the upsample layer has an empty tensor " << i << "th";
+    const HalfTensor* packed_input = packed_inputs.at(i);
+    const std::vector<uint32_t> input_shapes =
+        packed_input != nullptr ? packed_input->shapes() : inputs.at(i)->shapes();
+    const uint32_t output_h = output->rows();
+    const uint32_t output_w = output->cols();
+    ForEachInputChannel(inputs.at(i), packed_input,
+                        [&](uint32_t channel, const float* input_channel) {
+                          UpSampleChannel(input_channel, input_shapes.at(1), input_shapes.at(2),
+                                          output->raw_ptr(channel * output_h * output_w),
+                                          output_h, output_w);
+                        });
+  }
+  return StatusCode::kSuccess;
+}
+
+void UpSampleLayer::UpSampleChannel(const float* input, uint32_t input_h, uint32_t input_w,
+                                    float* output, uint32_t output_h, uint32_t output_w) const {
+  if (mode_ == UpSampleMode::kModeNearest) {
+    for (uint32_t w = 0; w < input_w; ++w) {
+      const float* input_col_ptr = input + w * input_h;
+      const uint32_t scaled_w = w * static_cast<uint32_t>(scale_w_);
+      for (uint32_t sw = 0; sw < static_cast<uint32_t>(scale_w_); ++sw) {
+        if (scaled_w + sw >= output_w) {
+          continue;
+        }
+        float* output_col_ptr = output + (scaled_w + sw) * output_h;
+        for (uint32_t h = 0; h < input_h; ++h) {
+          const uint32_t scaled_h = h * static_cast<uint32_t>(scale_h_);
+          float* output_ptr = output_col_ptr + scaled_h;
+          float input_value = *(input_col_ptr + h);
+          for (uint32_t sh = 0; sh < static_cast<uint32_t>(scale_h_); ++sh) {
+            if (scaled_h + sh < output_h) {
+              *(output_ptr + sh) = input_value;
             }
           }
         }
       }
+    }
+  } else {
+    float div_scale_h = 1.f;
+    float div_scale_w = 1.f;
+    if (!is_align_corner_) {
+      div_scale_h = 1.f / scale_h_;
+      div_scale_w = 1.f / scale_w_;
     } else {
-#pragma omp parallel for
-      for (uint32_t c = 0; c < channels; ++c) {
-        const arma::fmat& input_channel = input_data.slice(c);
-        arma::fmat& output_channel = output_data.slice(c);
-
-        const uint32_t input_w = input_channel.n_cols;
-        const uint32_t input_h = input_channel.n_rows;
-        const uint32_t output_w = output_channel.n_cols;
-        const uint32_t output_h = output_channel.n_rows;
-        float div_scale_h = 1.f;
-        float div_scale_w = 1.f;
-        if (!is_align_corner_) {
-          div_scale_h = 1.f / scale_h_;
-          div_scale_w = 1.f / scale_w_;
-        } else {
-          CHECK(input_h > 0 && input_w > 0);
-          CHECK(output_h > 0 && output_w > 0);
-
-          div_scale_h = static_cast<float>(input_h - 1) / static_cast<float>(output_h - 1);
-          div_scale_w = static_cast<float>(input_w - 1) / static_cast<float>(output_w - 1);
-        }
-        for (uint32_t w = 0; w < output_w; ++w) {
-          float w0_lambda = 0.f;
-          float w1_lambda = 0.f;
-          int32_t input_w0 = 0;
-          int32_t input_w1 = 0;
-          float* output_ptr = output_channel.colptr(w);
-          CalcIndexAndLambda(static_cast<int32_t>(input_w), static_cast<int32_t>(output_w),
-                             div_scale_w, static_cast<int32_t>(w), w0_lambda, w1_lambda, input_w0,
-                             input_w1, is_align_corner_);
-          const float* input_ptr0 = input_channel.colptr(input_w0);
-          const float* input_ptr1 = input_channel.colptr(input_w1);
-          for (uint32_t h = 0; h < output_h; ++h) {
-            float h0_lambda = 0.f;
-            float h1_lambda = 0.f;
-            int32_t input_h0 = 0;
-            int32_t input_h1 = 0;
-            CalcIndexAndLambda(static_cast<int32_t>(input_h), static_cast<int32_t>(output_h),
-                               div_scale_h, static_cast<int32_t>(h), h0_lambda, h1_lambda, input_h0,
-                               input_h1, is_align_corner_);
-
-            *(output_ptr + h) = h0_lambda * w0_lambda * (*(input_ptr0 + input_h0)) +
-                                h0_lambda * w1_lambda * (*(input_ptr1 + input_h0)) +
-                                h1_lambda * w0_lambda * (*(input_ptr0 + input_h1)) +
-                                h1_lambda * w1_lambda * (*(input_ptr1 + input_h1));
-          }
-        }
+      CHECK(input_h > 0 && input_w > 0);
+      CHECK(output_h > 0 && output_w > 0);
+
+      div_scale_h = static_cast<float>(input_h - 1) / static_cast<float>(output_h - 1);
+      div_scale_w = static_cast<float>(input_w - 1) / static_cast<float>(output_w - 1);
+    }
+    for (uint32_t w = 0; w < output_w; ++w) {
+      float w0_lambda = 0.f;
+      float w1_lambda = 0.f;
+      int32_t input_w0 = 0;
+      int32_t input_w1 = 0;
+      float* output_ptr = output + w * output_h;
+      CalcIndexAndLambda(static_cast<int32_t>(input_w), static_cast<int32_t>(output_w),
+                         div_scale_w, static_cast<int32_t>(w), w0_lambda, w1_lambda, input_w0,
+                         input_w1, is_align_corner_);
+      const float* input_ptr0 = input + input_w0 * input_h;
+      const float* input_ptr1 = input + input_w1 * input_h;
+      for (uint32_t h = 0; h < output_h; ++h) {
+        float h0_lambda = 0.f;
+        float h1_lambda = 0.f;
+        int32_t input_h0 = 0;
+        int32_t input_h1 = 0;
+        CalcIndexAndLambda(static_cast<int32_t>(input_h), static_cast<int32_t>(output_h),
+                           div_scale_h, static_cast<int32_t>(h), h0_lambda, h1_lambda, input_h0,
+                           input_h1, is_align_corner_);
+
+        *(output_ptr + h) = h0_lambda * w0_lambda * (*(input_ptr0 + input_h0)) +
+                            h0_lambda * w1_lambda * (*(input_ptr1 + input_h0)) +
+                            h1_lambda * w0_lambda * (*(input_ptr0 + input_h1)) +
+                            h1_lambda * w1_lambda * (*(input_ptr1 + input_h1));
       }
     }
   }
-  return StatusCode::kSuccess;
 }
 
 StatusCode UpSampleLayer::CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
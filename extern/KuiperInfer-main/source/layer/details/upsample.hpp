@@ -40,10 +40,19 @@ class UpSampleLayer : public NonParamLayer {
   StatusCode Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                      std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
 
+  bool is_packed_input_supported() const override { return true; }
+
+  StatusCode ForwardPacked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                           const std::vector<const HalfTensor*>& packed_inputs,
+                           std::vector<std::shared_ptr<Tensor<float>>>& outputs) override;
+
   static StatusCode CreateInstance(const std::shared_ptr<RuntimeOperator>& op,
                                    std::shared_ptr<Layer<float>>& upsample_layer);
 
  private:
+  void UpSampleChannel(const float* input, uint32_t input_h, uint32_t input_w, float* output,
+                       uint32_t output_h, uint32_t output_w) const;
+
   float scale_h_ = 1.f;
   float scale_w_ = 1.f;
   bool is_align_corner_ = false;
@@ -30,6 +30,15 @@ namespace kuiper_infer {
 
 StatusCode ViewLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
                               std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  const StatusCode status = Check(inputs, outputs);
+  if (status != StatusCode::kSuccess) {
+    return status;
+  }
+  return ForwardUnchecked(inputs, outputs);
+}
+
+StatusCode ViewLayer::Check(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                            const std::vector<std::shared_ptr<Tensor<float>>>& outputs) const {
   if (inputs.empty()) {
     LOG(ERROR) << "The input tensor array in the view layer is empty";
     return StatusCode::kInferInputsEmpty;
@@ -60,7 +69,6 @@ StatusCode ViewLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
     // 检查形状中-1的数量，最多只可以存在一个
     size_t current_size = 1;
     int32_t dynamic_index = -1;
-    std::vector<uint32_t> shapes;
     const size_t total_size = input_data->size();
     for (uint32_t j = 1; j < shapes_.size(); ++j) {
       CHECK(shapes_.at(j) == -1 || shapes_.at(j) > 0);
@@ -70,7 +78,6 @@ StatusCode ViewLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
         dynamic_index = static_cast<int32_t>(j);
       } else {
         current_size *= shapes_.at(j);
-        shapes.push_back(shapes_.at(j));
       }
     }
 
@@ -79,14 +86,36 @@ StatusCode ViewLayer::Forward(const std::vector<std::shared_ptr<Tensor<float>>>&
            "dimension";
     if (dynamic_index != -1) {
       CHECK(total_size >= current_size);
-      shapes.push_back(uint32_t(total_size / current_size));
+    } else {
+      CHECK(total_size == current_size)
+          << "The shape parameter in the view layer does not match the input tensor " << i
+          << " th";
     }
+  }
+  return StatusCode::kSuccess;
+}
 
-    std::shared_ptr<Tensor<float>> output_data = outputs.at(i);
-    output_data = TensorClone(input_data);
-    CHECK(input_data->size() == output_data->size());
-    outputs.at(i) = output_data;
+StatusCode ViewLayer::ForwardUnchecked(const std::vector<std::shared_ptr<Tensor<float>>>& inputs,
+                                       std::vector<std::shared_ptr<Tensor<float>>>& outputs) {
+  for (uint32_t i = 0; i < inputs.size(); ++i) {
+    const std::shared_ptr<Tensor<float>>& input_data = inputs.at(i);
+    size_t current_size = 1;
+    bool has_dynamic = false;
+    std::vector<uint32_t> shapes;
+    for (uint32_t j = 1; j < shapes_.size(); ++j) {
+      if (shapes_.at(j) == -1) {
+        has_dynamic = true;
+      } else {
+        current_size *= shapes_.at(j);
+        shapes.push_back(shapes_.at(j));
+      }
+    }
+    if (has_dynamic) {
+      shapes.push_back(uint32_t(input_data->size() / current_size));
+    }
 
+    std::shared_ptr<Tensor<float>> output_data = TensorClone(input_data);
+    outputs.at(i) = output_data;
     output_data->Reshape(shapes, true);
   }
   return StatusCode::kSuccess;
@@ -24,6 +24,7 @@
 #include "activation_sse.hpp"
 #include "data/tensor_util.hpp"
 #include "layer/abstract/layer_factory.hpp"
+#include "utils/cpu/thread_budget.hpp"
 
 namespace kuiper_infer {
 
@@ -116,7 +117,7 @@ StatusCode YoloDetectLayer::Forward(const std::vector<std::shared_ptr<Tensor<flo
         TensorCreate<float>(batch_size, stages * nx * ny, uint32_t(num_classes_ + 5));
     stage_tensors.push_back(stages_tensor);
 
-#pragma omp parallel for num_threads(batch_size)
+#pragma omp parallel for num_threads(utils::ParallelTeamSize(batch_size))
     for (uint32_t b = 0; b < batch_size; ++b) {
       const std::shared_ptr<Tensor<float>>& input = stage_output.at(b);
       CHECK(input != nullptr && !input->empty());
@@ -0,0 +1,170 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "runtime/inference_queue.hpp"
+#include <algorithm>
+#include <utility>
+#include "data/tensor_util.hpp"
+
+namespace kuiper_infer {
+InferenceQueue::InferenceQueue(std::shared_ptr<RuntimeGraph> graph, std::string input_name,
+                               std::string output_name, uint32_t max_batch_size,
+                               std::chrono::microseconds max_wait_time)
+    : graph_(std::move(graph)),
+      input_name_(std::move(input_name)),
+      output_name_(std::move(output_name)),
+      max_batch_size_(max_batch_size),
+      max_wait_time_(max_wait_time) {
+  CHECK(graph_ != nullptr) << "The runtime graph of the inference queue is empty";
+  CHECK_GT(max_batch_size_, 0);
+  graph_->Build();
+
+  latencies_.reserve(kLatencyWindow);
+  batch_histogram_.resize(max_batch_size_ + 1);
+  worker_ = std::thread(&InferenceQueue::WorkerLoop, this);
+}
+
+InferenceQueue::~InferenceQueue() { Stop(); }
+
+std::future<sftensor> InferenceQueue::Submit(sftensor input) {
+  CHECK(input != nullptr && !input->empty()) << "The input tensor of the request is empty";
+  Request request;
+  request.input = std::move(input);
+  request.submit_time = std::chrono::steady_clock::now();
+  std::future<sftensor> output = request.output.get_future();
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    CHECK(!stopped_) << "Submit a request to a stopped inference queue";
+    requests_.push_back(std::move(request));
+  }
+  queue_cond_.notify_one();
+  return output;
+}
+
+void InferenceQueue::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (stopped_) {
+      return;
+    }
+    stopped_ = true;
+  }
+  queue_cond_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void InferenceQueue::WorkerLoop() {
+  std::vector<Request> batch;
+  batch.reserve(max_batch_size_);
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_cond_.wait(lock, [this] { return stopped_ || !requests_.empty(); });
+      if (requests_.empty()) {
+        // stopped and drained
+        return;
+      }
+
+      // 等待批次填满或者最早的请求超时
+      const auto deadline = requests_.front().submit_time + max_wait_time_;
+      queue_cond_.wait_until(lock, deadline,
+                             [this] { return stopped_ || requests_.size() >= max_batch_size_; });
+
+      const size_t batch_size = std::min<size_t>(requests_.size(), max_batch_size_);
+      for (size_t i = 0; i < batch_size; ++i) {
+        batch.push_back(std::move(requests_.front()));
+        requests_.pop_front();
+      }
+    }
+    ForwardBatch(batch);
+    batch.clear();
+  }
+}
+
+void InferenceQueue::ForwardBatch(std::vector<Request>& batch) {
+  CHECK(!batch.empty() && batch.size() <= max_batch_size_);
+  std::vector<sftensor> inputs;
+  inputs.reserve(max_batch_size_);
+  for (const Request& request : batch) {
+    inputs.push_back(request.input);
+  }
+  // 图的批次大小是固定的，不足的部分用最后一个输入补齐
+  while (inputs.size() < max_batch_size_) {
+    inputs.push_back(batch.back().input);
+  }
+
+  graph_->set_inputs(input_name_, inputs);
+  graph_->Forward(false);
+  const std::vector<sftensor>& outputs = graph_->get_outputs(output_name_);
+  CHECK_EQ(outputs.size(), max_batch_size_)
+      << "The output batch size of the graph is not equal to the max batch size";
+
+  const auto finish_time = std::chrono::steady_clock::now();
+  std::vector<double> batch_latencies;
+  batch_latencies.reserve(batch.size());
+  for (size_t i = 0; i < batch.size(); ++i) {
+    // 图的输出空间会在下一次Forward中被复用，所以需要拷贝一份
+    batch.at(i).output.set_value(TensorClone(outputs.at(i)));
+    batch_latencies.push_back(std::chrono::duration<double, std::milli>(
+                                  finish_time - batch.at(i).submit_time)
+                                  .count());
+  }
+
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  batch_count_ += 1;
+  request_count_ += batch.size();
+  batch_histogram_.at(batch.size()) += 1;
+  for (double latency : batch_latencies) {
+    if (latencies_.size() < kLatencyWindow) {
+      latencies_.push_back(latency);
+    } else {
+      latencies_.at(latency_pos_) = latency;
+      latency_pos_ = (latency_pos_ + 1) % kLatencyWindow;
+    }
+  }
+}
+
+InferenceQueueStatistics InferenceQueue::statistics() const {
+  InferenceQueueStatistics statistics;
+  std::vector<double> latencies;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    statistics.request_count = request_count_;
+    statistics.batch_count = batch_count_;
+    statistics.batch_histogram = batch_histogram_;
+    latencies = latencies_;
+  }
+
+  if (!latencies.empty()) {
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+      const size_t index = static_cast<size_t>(p * double(latencies.size() - 1) + 0.5);
+      return latencies.at(std::min(index, latencies.size() - 1));
+    };
+    statistics.latency_p50 = percentile(0.50);
+    statistics.latency_p90 = percentile(0.90);
+    statistics.latency_p99 = percentile(0.99);
+  }
+  return statistics;
+}
+}  // namespace kuiper_infer
@@ -0,0 +1,252 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "runtime/model_manager.hpp"
+#include <glog/logging.h>
+#include <omp.h>
+#include <algorithm>
+#include <utility>
+#include "data/tensor_util.hpp"
+
+namespace kuiper_infer {
+ModelManager::ModelManager(uint32_t worker_count, uint32_t thread_count)
+    : worker_count_(worker_count), thread_count_(thread_count) {
+  CHECK_GT(worker_count_, 0);
+  if (thread_count_ == 0) {
+    thread_count_ = uint32_t(omp_get_max_threads());
+  }
+  start_time_ = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < worker_count_; ++i) {
+    workers_.emplace_back(&ModelManager::WorkerLoop, this);
+  }
+}
+
+ModelManager::~ModelManager() { Stop(); }
+
+void ModelManager::AddModel(const std::string& model_name, std::shared_ptr<RuntimeGraph> graph,
+                            std::string input_name, std::string output_name, int32_t priority) {
+  CHECK(graph != nullptr) << "The runtime graph of the model " << model_name << " is empty";
+  graph->Build();
+
+  auto model = std::make_unique<Model>();
+  model->graph = std::move(graph);
+  model->input_name = std::move(input_name);
+  model->output_name = std::move(output_name);
+  model->priority = priority;
+
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  CHECK(models_.find(model_name) == models_.end())
+      << "The model " << model_name << " has been added already";
+  models_.emplace(model_name, std::move(model));
+}
+
+void ModelManager::LoadModel(const std::string& model_name, const std::string& param_path,
+                             const std::string& bin_path, std::string input_name,
+                             std::string output_name, int32_t priority) {
+  AddModel(model_name, std::make_shared<RuntimeGraph>(param_path, bin_path),
+           std::move(input_name), std::move(output_name), priority);
+}
+
+std::future<std::vector<sftensor>> ModelManager::Submit(
+    const std::string& model_name, std::vector<sftensor> inputs,
+    std::chrono::steady_clock::time_point deadline) {
+  CHECK(!inputs.empty()) << "The inputs of the request are empty";
+  Request request;
+  request.inputs = std::move(inputs);
+  request.submit_time = std::chrono::steady_clock::now();
+  request.deadline = deadline;
+  std::future<std::vector<sftensor>> outputs = request.outputs.get_future();
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    CHECK(!stopped_) << "Submit a request to a stopped model manager";
+    auto model_iter = models_.find(model_name);
+    CHECK(model_iter != models_.end()) << "Can not find the model " << model_name;
+    model_iter->second->requests.push_back(std::move(request));
+  }
+  queue_cond_.notify_one();
+  return outputs;
+}
+
+void ModelManager::Pause() {
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  paused_ = true;
+}
+
+void ModelManager::Resume() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    paused_ = false;
+  }
+  queue_cond_.notify_all();
+}
+
+void ModelManager::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (stopped_) {
+      return;
+    }
+    stopped_ = true;
+    // 停止前需要执行完暂停时排队的请求
+    paused_ = false;
+  }
+  queue_cond_.notify_all();
+  for (std::thread& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+ModelManager::Model* ModelManager::PickModel() {
+  Model* picked = nullptr;
+  const Request* picked_request = nullptr;
+  for (const auto& [model_name, model] : models_) {
+    if (model->running || (model->active == nullptr && model->requests.empty())) {
+      continue;
+    }
+    // 正在执行的请求优先于排队的请求, 否则按优先级, 截止时间和提交时间选择
+    const Request* request =
+        model->active != nullptr ? model->active.get() : &*NextRequest(model.get());
+    if (picked == nullptr || model->priority > picked->priority ||
+        (model->priority == picked->priority &&
+         (request->deadline < picked_request->deadline ||
+          (request->deadline == picked_request->deadline &&
+           request->submit_time < picked_request->submit_time)))) {
+      picked = model.get();
+      picked_request = request;
+    }
+  }
+  return picked;
+}
+
+std::deque<ModelManager::Request>::iterator ModelManager::NextRequest(Model* model) {
+  CHECK(model != nullptr && !model->requests.empty());
+  // min_element返回第一个最小值, 截止时间相同时即为最早提交的请求
+  return std::min_element(model->requests.begin(), model->requests.end(),
+                          [](const Request& request1, const Request& request2) {
+                            return request1.deadline < request2.deadline;
+                          });
+}
+
+bool ModelManager::RunStep(Model* model) {
+  CHECK(model != nullptr && model->active != nullptr);
+  RuntimeGraph& graph = *model->graph;
+  Request& request = *model->active;
+  if (model->next_step == 0) {
+    graph.set_inputs(model->input_name, request.inputs);
+  }
+  graph.ForwardStep(model->next_step);
+  model->next_step += 1;
+  if (model->next_step < graph.execution_step_count()) {
+    return false;
+  }
+
+  // 图的输出空间会在下一次请求中被复用，所以需要拷贝一份
+  const std::vector<sftensor>& outputs = graph.get_outputs(model->output_name);
+  std::vector<sftensor> output_copies;
+  output_copies.reserve(outputs.size());
+  for (const sftensor& output : outputs) {
+    output_copies.push_back(TensorClone(output));
+  }
+  request.outputs.set_value(std::move(output_copies));
+  return true;
+}
+
+void ModelManager::WorkerLoop() {
+  // 所有工作线程的OpenMP线程数之和等于线程池的大小,
+  // 各层的批次循环通过ParallelTeamSize不超过这个预算
+  omp_set_num_threads(int(std::max(1u, thread_count_ / worker_count_)));
+  while (true) {
+    Model* model = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_cond_.wait(lock, [this, &model] {
+        model = paused_ ? nullptr : PickModel();
+        if (model != nullptr || !stopped_) {
+          return model != nullptr;
+        }
+        // 停止后等待其他工作线程执行完剩余的请求
+        return std::all_of(models_.begin(), models_.end(), [](const auto& model_pair) {
+          return model_pair.second->active == nullptr && model_pair.second->requests.empty();
+        });
+      });
+      if (model == nullptr) {
+        // stopped and drained
+        return;
+      }
+      if (model->active == nullptr) {
+        auto request_iter = NextRequest(model);
+        model->active = std::make_unique<Request>(std::move(*request_iter));
+        model->requests.erase(request_iter);
+        model->next_step = 0;
+      }
+      model->running = true;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+    const bool finished = RunStep(model);
+    const auto finish_time = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      model->running = false;
+      model->step_count += 1;
+      model->busy_time +=
+          std::chrono::duration<double, std::milli>(finish_time - start_time).count();
+      if (finished) {
+        model->request_count += 1;
+        model->latency_sum += std::chrono::duration<double, std::milli>(
+                                  finish_time - model->active->submit_time)
+                                  .count();
+        if (finish_time > model->active->deadline) {
+          model->deadline_miss_count += 1;
+        }
+        model->last_finish_time = finish_time;
+        model->active.reset();
+      }
+    }
+    queue_cond_.notify_all();
+  }
+}
+
+ModelStatistics ModelManager::statistics(const std::string& model_name) const {
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  auto model_iter = models_.find(model_name);
+  CHECK(model_iter != models_.end()) << "Can not find the model " << model_name;
+  const Model& model = *model_iter->second;
+
+  ModelStatistics statistics;
+  statistics.request_count = model.request_count;
+  statistics.deadline_miss_count = model.deadline_miss_count;
+  statistics.step_count = model.step_count;
+  statistics.busy_time = model.busy_time;
+  statistics.last_finish_time = model.last_finish_time;
+  const double elapsed_time = std::chrono::duration<double, std::milli>(now - start_time_).count();
+  if (elapsed_time > 0.) {
+    statistics.utilization = model.busy_time / (elapsed_time * worker_count_);
+  }
+  if (model.request_count > 0) {
+    statistics.latency_mean = model.latency_sum / double(model.request_count);
+  }
+  return statistics;
+}
+}  // namespace kuiper_infer
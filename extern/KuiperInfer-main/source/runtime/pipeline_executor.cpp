@@ -0,0 +1,269 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "runtime/pipeline_executor.hpp"
+#include <glog/logging.h>
+#include <omp.h>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include "utils/cpu/numa.hpp"
+
+namespace kuiper_infer {
+// 先让出CPU, 等待较久后再休眠, 避免空转占满阶段的核心
+static void Backoff(uint32_t& spin_count) {
+  if (spin_count < 64) {
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  spin_count += 1;
+}
+
+PipelineExecutor::PipelineExecutor(std::shared_ptr<RuntimeGraph> graph, std::string input_name,
+                                   std::string output_name,
+                                   const std::vector<sftensor>& sample_inputs,
+                                   uint32_t stage_count, uint32_t threads_per_stage,
+                                   uint32_t queue_capacity)
+    : graph_(std::move(graph)),
+      input_name_(std::move(input_name)),
+      output_name_(std::move(output_name)),
+      threads_per_stage_(threads_per_stage) {
+  CHECK(graph_ != nullptr) << "The runtime graph of the pipeline is empty";
+  CHECK_GT(stage_count, 0);
+  CHECK_GT(queue_capacity, 0);
+  graph_->Build();
+  graph_->set_pipeline_stages({});
+
+  // 按实测的层耗时划分阶段
+  graph_->ResetProfile();
+  graph_->set_profile(true);
+  for (uint32_t i = 0; i < kProfileRepeats; ++i) {
+    graph_->set_inputs(input_name_, sample_inputs);
+    graph_->Forward(false);
+  }
+  graph_->set_profile(false);
+  const std::vector<double> costs = graph_->profile_times();
+  graph_->ResetProfile();
+
+  stage_ends_ = PartitionStages(costs, stage_count);
+  graph_->set_pipeline_stages(stage_ends_);
+  stage_count = uint32_t(stage_ends_.size());
+
+  // 每个阶段使用一组相邻的核心
+  const std::vector<uint32_t> cpus = utils::GetAvailableCpus();
+  const uint32_t group_size = uint32_t(cpus.size()) / stage_count;
+  if (threads_per_stage_ == 0) {
+    threads_per_stage_ =
+        group_size > 0 ? group_size
+                       : std::max(1u, uint32_t(omp_get_max_threads()) / stage_count);
+  }
+
+  for (uint32_t stage_index = 0, begin = 0; stage_index < stage_count; ++stage_index) {
+    auto stage = std::make_unique<Stage>();
+    if (group_size > 0) {
+      stage->cpus.assign(cpus.begin() + stage_index * group_size,
+                         cpus.begin() + (stage_index + 1) * group_size);
+    }
+    stage->queue = std::make_unique<FrameQueue>(queue_capacity);
+    const uint32_t end = stage_ends_.at(stage_index);
+    stage->profiled_time =
+        std::accumulate(costs.begin() + begin, costs.begin() + end, 0.) / 1000. / kProfileRepeats;
+    begin = end;
+    stages_.push_back(std::move(stage));
+  }
+
+  start_time_ = std::chrono::steady_clock::now();
+  for (uint32_t stage_index = 0; stage_index < stage_count; ++stage_index) {
+    stages_.at(stage_index)->thread = std::thread(&PipelineExecutor::StageLoop, this, stage_index);
+  }
+}
+
+PipelineExecutor::~PipelineExecutor() {
+  Stop();
+  // 恢复整图的执行计划
+  graph_->set_pipeline_stages({});
+}
+
+void PipelineExecutor::Push(std::vector<sftensor> inputs) {
+  CHECK(!input_closed_.load(std::memory_order_relaxed))
+      << "Push a frame to a stopped pipeline executor";
+  auto frame = std::make_unique<Frame>();
+  frame->emplace(input_name_, std::move(inputs));
+  FrameQueue& queue = *stages_.front()->queue;
+  uint32_t spin_count = 0;
+  while (!queue.TryPush(frame)) {
+    Backoff(spin_count);
+  }
+}
+
+bool PipelineExecutor::Pop(std::vector<sftensor>& outputs) {
+  std::unique_lock<std::mutex> lock(output_mutex_);
+  output_cond_.wait(lock, [this] {
+    return !outputs_.empty() || stages_.back()->done.load(std::memory_order_acquire);
+  });
+  if (outputs_.empty()) {
+    // stopped and drained
+    return false;
+  }
+  outputs = std::move(outputs_.front());
+  outputs_.pop_front();
+  return true;
+}
+
+void PipelineExecutor::Stop() {
+  std::lock_guard<std::mutex> lock(stop_mutex_);
+  if (stopped_) {
+    return;
+  }
+  stopped_ = true;
+  input_closed_.store(true, std::memory_order_release);
+  for (const auto& stage : stages_) {
+    if (stage->thread.joinable()) {
+      stage->thread.join();
+    }
+  }
+}
+
+void PipelineExecutor::StageLoop(uint32_t stage_index) {
+  Stage& stage = *stages_.at(stage_index);
+  if (!stage.cpus.empty() && !utils::BindThreadToCpus(stage.cpus)) {
+    LOG(WARNING) << "Failed to bind the pipeline stage " << stage_index << " to its cores";
+  }
+  omp_set_num_threads(int(threads_per_stage_));
+
+  const bool last_stage = stage_index + 1 == stages_.size();
+  const std::atomic<bool>& upstream_done =
+      stage_index == 0 ? input_closed_ : stages_.at(stage_index - 1)->done;
+  uint32_t spin_count = 0;
+  while (true) {
+    std::unique_ptr<Frame> frame;
+    if (!stage.queue->TryPop(frame)) {
+      // 上游结束前放入的帧在结束标志之前可见, 所以再取一次
+      if (upstream_done.load(std::memory_order_acquire) && !stage.queue->TryPop(frame)) {
+        break;
+      }
+      if (frame == nullptr) {
+        Backoff(spin_count);
+        continue;
+      }
+    }
+    spin_count = 0;
+
+    const auto start_time = std::chrono::steady_clock::now();
+    graph_->ForwardStage(stage_index, *frame);
+    const auto finish_time = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      stage.busy_time +=
+          std::chrono::duration<double, std::milli>(finish_time - start_time).count();
+      if (last_stage) {
+        frame_count_ += 1;
+      }
+    }
+
+    if (last_stage) {
+      const auto& outputs_iter = frame->find(output_name_);
+      CHECK(outputs_iter != frame->end()) << "Can not find the output operator " << output_name_;
+      {
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        outputs_.push_back(std::move(outputs_iter->second));
+      }
+      output_cond_.notify_one();
+    } else {
+      FrameQueue& next_queue = *stages_.at(stage_index + 1)->queue;
+      while (!next_queue.TryPush(frame)) {
+        Backoff(spin_count);
+      }
+      spin_count = 0;
+    }
+  }
+
+  {
+    // Pop在output_mutex_下检查最后一个阶段的结束标志
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    stage.done.store(true, std::memory_order_release);
+  }
+  output_cond_.notify_all();
+}
+
+PipelineStatistics PipelineExecutor::statistics() const {
+  const auto now = std::chrono::steady_clock::now();
+  const double elapsed_time = std::chrono::duration<double, std::milli>(now - start_time_).count();
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  PipelineStatistics statistics;
+  statistics.frame_count = frame_count_;
+  if (elapsed_time > 0.) {
+    statistics.frames_per_second = double(frame_count_) * 1000. / elapsed_time;
+  }
+  for (uint32_t stage_index = 0; stage_index < stages_.size(); ++stage_index) {
+    const Stage& stage = *stages_.at(stage_index);
+    PipelineStageStatistics stage_statistics;
+    stage_statistics.begin_step = stage_index == 0 ? 0 : stage_ends_.at(stage_index - 1);
+    stage_statistics.end_step = stage_ends_.at(stage_index);
+    stage_statistics.profiled_time = stage.profiled_time;
+    stage_statistics.busy_time = stage.busy_time;
+    if (elapsed_time > 0.) {
+      stage_statistics.utilization = stage.busy_time / elapsed_time;
+    }
+    statistics.stages.push_back(stage_statistics);
+  }
+  return statistics;
+}
+
+std::vector<uint32_t> PipelineExecutor::PartitionStages(const std::vector<double>& costs,
+                                                        uint32_t stage_count) {
+  CHECK(!costs.empty()) << "There are no steps to split into stages";
+  CHECK_GT(stage_count, 0);
+  const uint32_t step_count = uint32_t(costs.size());
+  stage_count = std::min(stage_count, step_count);
+
+  std::vector<double> prefix_costs(step_count + 1, 0.);
+  std::partial_sum(costs.begin(), costs.end(), prefix_costs.begin() + 1);
+
+  // max_costs[k][i]: 前i个步骤分成k个阶段时最大阶段耗时的最小值, splits记录最后一个阶段的起点
+  const double infinity = std::numeric_limits<double>::infinity();
+  std::vector<std::vector<double>> max_costs(stage_count + 1,
+                                             std::vector<double>(step_count + 1, infinity));
+  std::vector<std::vector<uint32_t>> splits(stage_count + 1,
+                                            std::vector<uint32_t>(step_count + 1, 0));
+  max_costs.at(0).at(0) = 0.;
+  for (uint32_t k = 1; k <= stage_count; ++k) {
+    for (uint32_t i = k; i <= step_count; ++i) {
+      for (uint32_t j = k - 1; j < i; ++j) {
+        const double max_cost =
+            std::max(max_costs.at(k - 1).at(j), prefix_costs.at(i) - prefix_costs.at(j));
+        if (max_cost < max_costs.at(k).at(i)) {
+          max_costs.at(k).at(i) = max_cost;
+          splits.at(k).at(i) = j;
+        }
+      }
+    }
+  }
+
+  std::vector<uint32_t> stage_ends(stage_count);
+  for (uint32_t k = stage_count, end = step_count; k > 0; --k) {
+    stage_ends.at(k - 1) = end;
+    end = splits.at(k).at(end);
+  }
+  return stage_ends;
+}
+}  // namespace kuiper_infer
@@ -20,16 +20,75 @@
 // SOFTWARE.
 
 #include "runtime/runtime_ir.hpp"
+#include <algorithm>
 #include <deque>
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <memory>
+#include <set>
+#include <sstream>
 #include <utility>
 #include <vector>
+#include "data/tensor_half.hpp"
+#include "data/tensor_io.hpp"
+#include "data/tensor_util.hpp"
 #include "layer/abstract/layer_factory.hpp"
 #include "runtime/runtime_ir.hpp"
+#include "runtime/tuning_cache.hpp"
+#include "utils/cpu/numa.hpp"
 #include "utils/time/time_logging.hpp"
 
 namespace kuiper_infer {
+
+// 链中带窗口的层越多, 光环越大, 块边缘的重复计算越多
+static constexpr uint32_t kMaxTiledChainWindows = 3;
+
+// 自动调优时每个实现计时的次数, 取最短的一次
+static constexpr uint32_t kAutotuneRepeats = 3;
+
+static bool IsIdentityWindow(const TileWindow& window) {
+  return window.kernel_h == 1 && window.kernel_w == 1 && window.stride_h == 1 &&
+         window.stride_w == 1 && window.padding_h == 0 && window.padding_w == 0;
+}
+
+// pnnx操作数形状的第一维是批次, 返回每个批次张量的形状, 与InitOperatorOutput创建的张量一致
+static std::vector<uint32_t> OperandTensorShapes(const std::vector<int32_t>& operand_shapes) {
+  switch (operand_shapes.size()) {
+    case 4: {
+      return {uint32_t(operand_shapes.at(1)), uint32_t(operand_shapes.at(2)),
+              uint32_t(operand_shapes.at(3))};
+    }
+    case 3: {
+      return {1, uint32_t(operand_shapes.at(1)), uint32_t(operand_shapes.at(2))};
+    }
+    case 2: {
+      return {1, 1, uint32_t(operand_shapes.at(1))};
+    }
+    default: {
+      LOG(FATAL) << "Unsupported shape sizes: " << operand_shapes.size();
+      return {};
+    }
+  }
+}
+
+// 层在Forward中不再检查输入形状, 图的输入在传入时检查
+// check_all时检查全部张量, 微批次执行时输入的数量与批次无关
+static void CheckGraphInputs(const RuntimeOperand& input_operand,
+                             const std::vector<sftensor>& inputs, const std::string& input_name,
+                             bool check_all = false) {
+  const std::vector<uint32_t>& shapes = OperandTensorShapes(input_operand.shapes);
+  const uint32_t input_size = check_all ? inputs.size() : input_operand.datas.size();
+  CHECK_GE(inputs.size(), std::max(input_size, 1u))
+      << "Too few input tensors for the input operator: " << input_name;
+  for (uint32_t i = 0; i < input_size; ++i) {
+    CHECK(inputs.at(i) != nullptr && !inputs.at(i)->empty() && inputs.at(i)->shapes() == shapes)
+        << "The input tensor " << i << " of the input operator " << input_name
+        << " does not match the input shape of the model";
+  }
+}
+
 RuntimeGraph::RuntimeGraph(std::string param_path, std::string bin_path)
     : param_path_(std::move(param_path)), bin_path_(std::move(bin_path)) {}
 
@@ -105,9 +164,18 @@ void RuntimeGraph::Build() {
       << "Graph status error, current state is " << int32_t(graph_state_);
   LOG_IF(FATAL, this->operators_.empty()) << "Graph operators is empty, may be no init";
 
+  // 按内存预算缩小图的批次, 须在创建层之前
+  if (memory_budget_ > 0) {
+    InitMicroBatch();
+  }
+
   // 构建节点关系
   CreateNodeRelation();
 
+  // 删除不影响图输出的算子, 并在构建时计算只依赖权重的算子
+  EliminateDeadOperators();
+  FoldConstants();
+
   // 节点拓扑排序
   ReverseTopoSort();
 
@@ -115,6 +183,35 @@ void RuntimeGraph::Build() {
   RuntimeOperatorUtils<float>::InitOperatorInput(operators_);
   RuntimeOperatorUtils<float>::InitOperatorOutput(graph_->ops, operators_);
 
+  // 将线程, 权重和输出空间放到对应的NUMA节点
+  if (numa_aware_) {
+    InitNumaPlacement();
+  }
+
+  // 标记可以原地执行的算子
+  InitInplaceOperators();
+
+  // 生成执行计划
+  InitExecutionPlan();
+
+  // 检查每个算子的输入, 输出和权重形状, Forward中不再检查
+  CheckExecutionPlan();
+
+  // 为每个卷积选择最快的实现
+  if (autotune_) {
+    InitAutotune();
+  }
+
+  // 将连续的卷积, 池化和逐元素算子合并为分块执行的链
+  if (tiled_execution_) {
+    InitTiledChains();
+  }
+
+  // 跨层保存的激活以16位存储
+  if (activation_precision_ != ActivationPrecision::kFP32) {
+    InitActivationStorage();
+  }
+
   graph_state_ = GraphState::Complete;
   if (graph_ != nullptr) {
     graph_.reset();
@@ -128,56 +225,521 @@ void RuntimeGraph::Forward(bool debug) {
     LOG(FATAL) << "Graph need be build!"
                << ", current state is " << int32_t(graph_state_);
   }
+  CHECK(pipeline_stages_.empty()) << "The graph is split into pipeline stages";
 
   if (debug) {
     utils::LayerTimeStatesSingleton::LayerTimeStatesCollectorInit();
   }
 
-  auto forward_layer = [&](const std::shared_ptr<Layer<float>>& layer, const std::string& op_name,
-                           const std::string& op_type) {
-    StatusCode status;
-    if (debug) {
-      {
-        utils::LayerTimeLogging layer_time_logging(op_name, op_type);
-        status = layer->Forward();
-      }
-    } else {
-      status = layer->Forward();
+  if (profile_) {
+    profile_times_.resize(execution_plan_.size(), 0.);
+  }
+
+  if (!micro_batch_inputs_.empty()) {
+    ForwardMicroBatches(debug);
+  } else {
+    for (uint32_t step_index = 0; step_index < execution_plan_.size(); ++step_index) {
+      RunExecutionStep(step_index, debug);
     }
-    return status;
+  }
+
+  if (debug) {
+    utils::LayerTimeLogging::SummaryLogging();
+  }
+
+  for (const auto& op : operators_) {
+    LOG_IF(FATAL, !op->has_forward) << "The operator: " << op->name << " has not been forward yet!";
+  }
+}
+
+uint32_t RuntimeGraph::execution_step_count() const { return execution_plan_.size(); }
+
+void RuntimeGraph::ForwardStep(uint32_t step_index) {
+  if (graph_state_ < GraphState::Complete) {
+    LOG(FATAL) << "Graph need be build!"
+               << ", current state is " << int32_t(graph_state_);
+  }
+  CHECK(pipeline_stages_.empty()) << "The graph is split into pipeline stages";
+  CHECK(micro_batch_ == 0) << "Forward step does not support micro-batching";
+  CHECK_LT(step_index, execution_plan_.size());
+  if (profile_) {
+    profile_times_.resize(execution_plan_.size(), 0.);
+  }
+  RunExecutionStep(step_index, false);
+}
+
+std::map<std::string, std::vector<sftensor>> RuntimeGraph::PartialForward(
+    const std::vector<std::string>& output_names,
+    const std::map<std::string, std::vector<sftensor>>& cached_outputs) {
+  if (graph_state_ < GraphState::Complete) {
+    LOG(FATAL) << "Graph need be build!"
+               << ", current state is " << int32_t(graph_state_);
+  }
+  CHECK(pipeline_stages_.empty()) << "The graph is split into pipeline stages";
+  CHECK(activation_precision_ == ActivationPrecision::kFP32)
+      << "Partial forward does not support 16-bit activations";
+  CHECK(micro_batch_ == 0) << "Partial forward does not support micro-batching";
+
+  // 分块链内部的算子不单独执行, 其输出不可用
+  auto find_step = [this](const std::string& op_name) {
+    const auto step_iter = step_indices_.find(op_name);
+    CHECK(step_iter != step_indices_.end()) << "Can not find the operator: " << op_name;
+    const ExecutionStep& step = execution_plan_.at(step_iter->second);
+    CHECK(!step.skip || is_input_op(op_name) || is_output_op(op_name))
+        << "The operator " << op_name << " is inside a tiled chain";
+    return step_iter->second;
   };
 
-  for (const auto& current_op : operators_) {
-    current_op->has_forward = false;
-    CHECK_GT(current_op->forward_index, 0);
+  std::vector<bool> needed(execution_plan_.size(), false);
+  std::vector<bool> cached(execution_plan_.size(), false);
+  for (const auto& [op_name, _] : cached_outputs) {
+    cached.at(find_step(op_name)) = true;
+  }
+
+  // 从请求的算子向上游遍历, 遇到已缓存的算子停止
+  std::vector<uint32_t> pending_steps;
+  for (const std::string& output_name : output_names) {
+    pending_steps.push_back(find_step(output_name));
+  }
+  while (!pending_steps.empty()) {
+    const uint32_t step_index = pending_steps.back();
+    pending_steps.pop_back();
+    if (needed.at(step_index)) {
+      continue;
+    }
+    needed.at(step_index) = true;
+    if (cached.at(step_index)) {
+      continue;
+    }
+    for (const auto& input_operand : execution_plan_.at(step_index).op->input_operands_seq) {
+      // 折叠的常量算子不在执行计划中, 其输出一直保存在输入操作数中
+      const auto& input_step_iter = step_indices_.find(input_operand->name);
+      if (input_step_iter != step_indices_.end()) {
+        pending_steps.push_back(input_step_iter->second);
+      }
+    }
+  }
 
-    if (is_input_op(current_op->name) || is_output_op(current_op->name)) {
-      current_op->has_forward = true;
+  for (const auto& [op_name, outputs] : cached_outputs) {
+    const std::shared_ptr<RuntimeOperator>& op = operators_.at(step_indices_.at(op_name));
+    if (!needed.at(step_indices_.at(op_name))) {
       continue;
     }
+    // 层在Forward中不再检查输入形状
+    if (op->output_operands != nullptr) {
+      const std::vector<sftensor>& op_outputs = op->output_operands->datas;
+      CHECK_GE(outputs.size(), op_outputs.size()) << "Too few cached tensors for " << op_name;
+      for (uint32_t i = 0; i < op_outputs.size(); ++i) {
+        CHECK(outputs.at(i) != nullptr && !outputs.at(i)->empty() &&
+              outputs.at(i)->shapes() == op_outputs.at(i)->shapes())
+            << "The cached tensor " << i << " of " << op_name << " has a wrong shape";
+      }
+    }
+    PropagateLayerOutputs(op, outputs);
+  }
 
-    CHECK(current_op->layer != nullptr)
-        << "The layer corresponding to the op " << current_op->name
-        << " is empty, indicating that it may not have been created.";
+  auto collect_outputs = [&](uint32_t step_index) {
+    const RuntimeOperator* op = execution_plan_.at(step_index).op;
+    const auto cached_iter = cached_outputs.find(op->name);
+    if (cached_iter != cached_outputs.end()) {
+      return cached_iter->second;
+    }
+    if (is_output_op(op->name)) {
+      return get_outputs(op->name);
+    }
+    if (op->output_operands == nullptr) {
+      return std::vector<sftensor>{};
+    }
 
-    std::shared_ptr<Layer<float>> layer = current_op->layer;
-    StatusCode status = forward_layer(layer, current_op->name, current_op->type);
-    CHECK(status == StatusCode::kSuccess)
-        << layer->layer_name() << " layer forward failed, error code: " << int32_t(status);
+    // 后面执行的原地算子会覆盖这些输出, 需要拷贝一份
+    bool overwritten = false;
+    for (const auto& [next_name, next_op] : op->output_operators) {
+      const uint32_t next_index = step_indices_.at(next_name);
+      if (next_op->is_inplace && needed.at(next_index) && !cached.at(next_index)) {
+        overwritten = true;
+      }
+    }
+    std::vector<sftensor> outputs = op->output_operands->datas;
+    if (overwritten) {
+      for (sftensor& output : outputs) {
+        output = TensorClone(output);
+      }
+    }
+    return outputs;
+  };
 
+  std::map<std::string, std::vector<sftensor>> requested_outputs;
+  for (const std::string& output_name : output_names) {
+    requested_outputs.insert({output_name, {}});
+  }
+  for (uint32_t step_index = 0; step_index < execution_plan_.size(); ++step_index) {
+    if (!needed.at(step_index)) {
+      continue;
+    }
+    if (!cached.at(step_index)) {
+      RunExecutionStep(step_index, false);
+    }
+    const auto requested_iter = requested_outputs.find(execution_plan_.at(step_index).op->name);
+    if (requested_iter != requested_outputs.end()) {
+      requested_iter->second = collect_outputs(step_index);
+    }
+  }
+  return requested_outputs;
+}
+
+void RuntimeGraph::RunExecutionStep(uint32_t step_index, bool debug) {
+  ExecutionStep& step = execution_plan_.at(step_index);
+  RuntimeOperator* current_op = step.op;
+  current_op->has_forward = false;
+  if (step.skip) {
     current_op->has_forward = true;
-    PropagateLayerOutputs(current_op, current_op->output_operands->datas);
+    return;
+  }
+
+  // 不能直接读取16位存储的算子, 其输入先展开到暂存张量
+  for (const auto& [producer_index, input_datas] : step.unpacked_inputs) {
+    const ExecutionStep& producer_step = execution_plan_.at(producer_index);
+    for (uint32_t i = 0; i < producer_step.packed_outputs.size(); ++i) {
+      producer_step.packed_outputs.at(i).Unpack(input_datas->at(i));
+    }
   }
 
+  // 只有一个输入操作数时直接使用其数组, 否则合并各输入操作数的张量
+  const std::vector<sftensor>* inputs = step.input_datas.front();
+  if (step.input_datas.size() > 1) {
+    uint32_t index = 0;
+    for (const std::vector<sftensor>* input_datas : step.input_datas) {
+      for (const sftensor& input_data : *input_datas) {
+        step.inputs.at(index++) = input_data;
+      }
+    }
+    inputs = &step.inputs;
+  }
+
+  if (step.check_inputs) {
+    for (const sftensor& input : *inputs) {
+      CHECK(input != nullptr && !input->empty())
+          << "The input of the operator " << current_op->name << " is empty";
+    }
+  }
+
+  auto forward = [&]() {
+    if (step.tiled_chain != nullptr) {
+      return step.tiled_chain->Forward(*inputs, *step.output_datas);
+    }
+    if (!step.packed_inputs.empty()) {
+      return step.layer->ForwardPacked(*inputs, step.packed_inputs, *step.output_datas);
+    }
+    return step.layer->ForwardUnchecked(*inputs, *step.output_datas);
+  };
+
+  StatusCode status;
   if (debug) {
-    utils::LayerTimeLogging::SummaryLogging();
+    utils::LayerTimeLogging layer_time_logging(current_op->name, current_op->type);
+    status = forward();
+  } else if (profile_) {
+    const auto start_time = utils::Time::now();
+    status = forward();
+    profile_times_.at(step_index) +=
+        std::chrono::duration<double, std::micro>(utils::Time::now() - start_time).count();
+  } else {
+    status = forward();
   }
+  CHECK(status == StatusCode::kSuccess)
+      << step.layer->layer_name() << " layer forward failed, error code: " << int32_t(status);
 
-  for (const auto& op : operators_) {
-    LOG_IF(FATAL, !op->has_forward) << "The operator: " << op->name << " has not been forward yet!";
+  current_op->has_forward = true;
+
+  // 按批次保存算子的输出, 每个张量一个npy文件
+  if (!dump_dir_.empty()) {
+    std::string file_name = current_op->name;
+    std::replace(file_name.begin(), file_name.end(), '/', '_');
+    for (uint32_t i = 0; i < step.output_datas->size(); ++i) {
+      const std::string& file_path = dump_dir_ + "/" + file_name + "_" + std::to_string(i) + ".npy";
+      LOG_IF(ERROR, !TensorSaveNpy(step.output_datas->at(i), file_path))
+          << "Failed to dump the output of the operator " << current_op->name;
+    }
+  }
+
+  // 输出张量未发生变化时无需重新赋值
+  const std::vector<sftensor>& layer_output_datas = *step.output_datas;
+  for (std::vector<sftensor>* next_input_datas : step.next_input_datas) {
+    for (uint32_t i = 0; i < next_input_datas->size(); ++i) {
+      sftensor& next_input_data = next_input_datas->at(i);
+      const sftensor& layer_output_data = layer_output_datas.at(i);
+      if (next_input_data != layer_output_data) {
+        if (next_input_data != nullptr) {
+          CHECK(next_input_data->shapes() == layer_output_data->shapes());
+        }
+        next_input_data = layer_output_data;
+      }
+    }
+  }
+
+  // 输出的单精度张量会被其他算子复用, 后面的消费者从16位存储中读取
+  for (uint32_t i = 0; i < step.packed_outputs.size(); ++i) {
+    step.packed_outputs.at(i).Pack(layer_output_datas.at(i), activation_precision_);
+  }
+}
+
+void RuntimeGraph::set_profile(bool profile) { this->profile_ = profile; }
+
+void RuntimeGraph::ResetProfile() { std::fill(profile_times_.begin(), profile_times_.end(), 0.); }
+
+const std::vector<double>& RuntimeGraph::profile_times() const { return this->profile_times_; }
+
+void RuntimeGraph::set_tiled_execution(bool tiled_execution) {
+  CHECK(graph_state_ != GraphState::Complete)
+      << "Tiled execution has to be set before the graph is built";
+  this->tiled_execution_ = tiled_execution;
+}
+
+const std::vector<std::shared_ptr<TiledLayerChain>>& RuntimeGraph::tiled_chains() const {
+  return this->tiled_chains_;
+}
+
+void RuntimeGraph::set_numa_aware(bool numa_aware, bool replicate_weights) {
+  CHECK(graph_state_ != GraphState::Complete)
+      << "NUMA-aware execution has to be set before the graph is built";
+  this->numa_aware_ = numa_aware;
+  this->replicate_weights_ = numa_aware && replicate_weights;
+}
+
+void RuntimeGraph::set_dump_dir(const std::string& dump_dir) {
+  if (!dump_dir.empty()) {
+    std::error_code error_code;
+    std::filesystem::create_directories(dump_dir, error_code);
+    LOG_IF(ERROR, error_code) << "Failed to create the dump directory " << dump_dir << ": "
+                              << error_code.message();
+  }
+  this->dump_dir_ = dump_dir;
+}
+
+void RuntimeGraph::set_autotune(bool autotune, const std::string& cache_path) {
+  CHECK(graph_state_ != GraphState::Complete)
+      << "Autotuning has to be set before the graph is built";
+  this->autotune_ = autotune;
+  this->tuning_cache_path_ = cache_path;
+}
+
+void RuntimeGraph::set_activation_precision(ActivationPrecision precision) {
+  CHECK(graph_state_ != GraphState::Complete)
+      << "The activation precision has to be set before the graph is built";
+  this->activation_precision_ = precision;
+}
+
+size_t RuntimeGraph::activation_bytes() const {
+  std::set<const Tensor<float>*> counted_tensors;
+  size_t bytes = 0;
+  auto count_tensors = [&](const std::vector<sftensor>& tensors) {
+    for (const sftensor& tensor : tensors) {
+      if (tensor != nullptr && counted_tensors.insert(tensor.get()).second) {
+        bytes += tensor->size() * sizeof(float);
+      }
+    }
+  };
+  for (const ExecutionStep& step : execution_plan_) {
+    if (step.output_datas == nullptr) {
+      continue;
+    }
+    count_tensors(*step.output_datas);
+    for (const auto& [_, input_datas] : step.unpacked_inputs) {
+      count_tensors(*input_datas);
+    }
+    for (uint32_t i = 0; i < step.packed_outputs.size(); ++i) {
+      bytes += step.output_datas->at(i)->size() * sizeof(uint16_t);
+    }
+  }
+  return bytes;
+}
+
+size_t RuntimeGraph::activation_traffic_bytes() const {
+  size_t bytes = 0;
+  for (const ExecutionStep& step : execution_plan_) {
+    if (step.skip || step.output_datas == nullptr) {
+      continue;
+    }
+    uint32_t input_index = 0;
+    for (const std::vector<sftensor>* input_datas : step.input_datas) {
+      const bool unpacked = std::any_of(step.unpacked_inputs.begin(), step.unpacked_inputs.end(),
+                                        [input_datas](const auto& unpacked_input) {
+                                          return unpacked_input.second == input_datas;
+                                        });
+      for (const sftensor& input : *input_datas) {
+        const HalfTensor* packed_input =
+            step.packed_inputs.empty() ? nullptr : step.packed_inputs.at(input_index);
+        input_index += 1;
+        if (packed_input != nullptr) {
+          bytes += packed_input->bytes();
+        } else if (input != nullptr) {
+          bytes += input->size() * sizeof(float);
+          // 展开到暂存张量时读16位并写单精度
+          if (unpacked) {
+            bytes += input->size() * (sizeof(uint16_t) + sizeof(float));
+          }
+        }
+      }
+    }
+    for (const sftensor& output : *step.output_datas) {
+      bytes += output->size() * sizeof(float);
+    }
+    // 压缩时读单精度并写16位
+    for (const HalfTensor& packed_output : step.packed_outputs) {
+      bytes += packed_output.size() * (sizeof(float) + sizeof(uint16_t));
+    }
+  }
+  return bytes;
+}
+
+void RuntimeGraph::set_pipeline_stages(const std::vector<uint32_t>& stage_ends) {
+  CHECK(graph_state_ == GraphState::Complete)
+      << "Pipeline stages have to be set after the graph is built";
+  CHECK(activation_precision_ == ActivationPrecision::kFP32)
+      << "Pipeline stages do not support 16-bit activations";
+  CHECK(tiled_chains_.empty()) << "Pipeline stages do not support tiled execution";
+  if (stage_ends.empty() && pipeline_stages_.empty()) {
+    return;
+  }
+  // 重新标记原地算子并生成执行计划, 恢复跨阶段共用的输出空间和输出传递
+  if (!pipeline_stages_.empty()) {
+    InitInplaceOperators();
+  }
+  InitExecutionPlan();
+  pipeline_stages_.clear();
+  if (stage_ends.empty()) {
+    return;
+  }
+
+  CHECK_EQ(stage_ends.back(), execution_plan_.size());
+  std::vector<uint32_t> step_stages(execution_plan_.size());
+  for (uint32_t stage = 0, begin = 0; stage < stage_ends.size(); ++stage) {
+    CHECK_GT(stage_ends.at(stage), begin) << "The pipeline stage " << stage << " is empty";
+    std::fill(step_stages.begin() + begin, step_stages.begin() + stage_ends.at(stage), stage);
+    PipelineStage pipeline_stage;
+    pipeline_stage.begin = begin;
+    pipeline_stage.end = stage_ends.at(stage);
+    pipeline_stages_.push_back(std::move(pipeline_stage));
+    begin = stage_ends.at(stage);
+  }
+
+  for (uint32_t step_index = 0; step_index < execution_plan_.size(); ++step_index) {
+    ExecutionStep& step = execution_plan_.at(step_index);
+    RuntimeOperator* op = step.op;
+    const uint32_t stage = step_stages.at(step_index);
+    PipelineStage& pipeline_stage = pipeline_stages_.at(stage);
+    if (is_input_op(op->name)) {
+      continue;
+    }
+    if (is_output_op(op->name)) {
+      pipeline_stage.graph_outputs.push_back(op);
+    }
+
+    // 图的输入和前面阶段的输出由帧携带
+    for (const auto& input_operand : op->input_operands_seq) {
+      const auto& producer_iter = step_indices_.find(input_operand->name);
+      if (producer_iter == step_indices_.end()) {
+        continue;
+      }
+      if (is_input_op(input_operand->name) || step_stages.at(producer_iter->second) != stage) {
+        pipeline_stage.frame_inputs.emplace_back(input_operand.get(), input_operand->name);
+      }
+    }
+
+    // 只传递给同一阶段的后继算子, 后面阶段的后继算子从帧中读取
+    step.next_input_datas.clear();
+    bool read_by_later_stages = false;
+    for (const auto& [next_name, next_op] : op->output_operators) {
+      if (step_stages.at(step_indices_.at(next_name)) != stage) {
+        read_by_later_stages = true;
+        continue;
+      }
+      const auto& next_input_op_iter = next_op->input_operands.find(op->name);
+      if (next_input_op_iter != next_op->input_operands.end()) {
+        step.next_input_datas.push_back(&next_input_op_iter->second->datas);
+      }
+    }
+    if (read_by_later_stages) {
+      pipeline_stage.frame_outputs.push_back(op);
+    }
+
+    // 原地算子不能写入前面阶段的输出空间, 改为使用自己的输出空间
+    if (!op->is_inplace) {
+      continue;
+    }
+    const auto& producer_iter = step_indices_.find(op->input_operands_seq.front()->name);
+    if (producer_iter == step_indices_.end() || step_stages.at(producer_iter->second) == stage) {
+      continue;
+    }
+    const std::vector<sftensor> shared_datas = op->output_operands->datas;
+    std::vector<sftensor> own_datas;
+    for (const sftensor& shared_data : shared_datas) {
+      own_datas.push_back(TensorCreate<float>(shared_data->shapes()));
+    }
+    for (uint32_t next_index = step_index; next_index < pipeline_stage.end; ++next_index) {
+      const RuntimeOperator* next_op = execution_plan_.at(next_index).op;
+      if (next_op->output_operands == nullptr) {
+        continue;
+      }
+      for (sftensor& output_data : next_op->output_operands->datas) {
+        const auto shared_iter = std::find(shared_datas.begin(), shared_datas.end(), output_data);
+        if (shared_iter != shared_datas.end()) {
+          output_data = own_datas.at(shared_iter - shared_datas.begin());
+        }
+      }
+    }
+    op->is_inplace = false;
   }
 }
 
+void RuntimeGraph::ForwardStage(uint32_t stage,
+                                std::map<std::string, std::vector<sftensor>>& frame_tensors) {
+  CHECK_LT(stage, pipeline_stages_.size()) << "The graph is not split into pipeline stages";
+  const PipelineStage& pipeline_stage = pipeline_stages_.at(stage);
+  for (const auto& [input_operand, producer_name] : pipeline_stage.frame_inputs) {
+    const auto& tensors_iter = frame_tensors.find(producer_name);
+    CHECK(tensors_iter != frame_tensors.end())
+        << "The frame has no tensors of the operator " << producer_name;
+    if (is_input_op(producer_name)) {
+      CheckGraphInputs(*input_operand, tensors_iter->second, producer_name);
+    } else {
+      CHECK_EQ(tensors_iter->second.size(), input_operand->datas.size());
+    }
+    std::copy_n(tensors_iter->second.begin(), input_operand->datas.size(),
+                input_operand->datas.begin());
+  }
+
+  for (uint32_t step_index = pipeline_stage.begin; step_index < pipeline_stage.end;
+       ++step_index) {
+    RunExecutionStep(step_index, false);
+  }
+
+  // 下一帧会覆盖图中的输出空间, 传给后面阶段的输出需要拷贝
+  for (const RuntimeOperator* op : pipeline_stage.frame_outputs) {
+    std::vector<sftensor> output_copies;
+    for (const sftensor& output : op->output_operands->datas) {
+      output_copies.push_back(TensorClone(output));
+    }
+    frame_tensors[op->name] = std::move(output_copies);
+  }
+  for (const RuntimeOperator* op : pipeline_stage.graph_outputs) {
+    std::vector<sftensor> output_copies;
+    for (const auto& input_operand : op->input_operands_seq) {
+      for (const sftensor& output : input_operand->datas) {
+        output_copies.push_back(TensorClone(output));
+      }
+    }
+    frame_tensors[op->name] = std::move(output_copies);
+  }
+}
+
+void RuntimeGraph::set_memory_budget(size_t budget_bytes) {
+  CHECK(graph_state_ != GraphState::Complete)
+      << "The memory budget has to be set before the graph is built";
+  this->memory_budget_ = budget_bytes;
+}
+
+uint32_t RuntimeGraph::micro_batch_size() const { return this->micro_batch_; }
+
 std::shared_ptr<Layer<float>> RuntimeGraph::CreateLayer(
     const std::shared_ptr<RuntimeOperator>& op) {
   LOG_IF(FATAL, !op) << "Operator is empty!";
@@ -186,6 +748,568 @@ std::shared_ptr<Layer<float>> RuntimeGraph::CreateLayer(
   return layer;
 }
 
+void RuntimeGraph::InitInplaceOperators() {
+  for (const auto& op : operators_) {
+    op->is_inplace = false;
+    if (!op->layer || !op->layer->is_inplace_supported()) {
+      continue;
+    }
+    if (op->input_operands_seq.size() != 1 || !op->output_operands) {
+      continue;
+    }
+
+    const auto& input_operand = op->input_operands_seq.front();
+    if (!input_operand || input_operand->shapes != op->output_operands->shapes) {
+      continue;
+    }
+
+    std::shared_ptr<RuntimeOperator> producer;
+    for (const auto& candidate : operators_) {
+      if (candidate->name == input_operand->name) {
+        producer = candidate;
+        break;
+      }
+    }
+
+    // 图的输入由调用者提供, 不能被原地覆盖; 输入有多个消费者时也不能覆盖
+    if (!producer || producer->type == "pnnx.Input" || producer->output_operators.size() != 1 ||
+        !producer->output_operands) {
+      continue;
+    }
+
+    // operators_已按执行顺序排列, 生产者若也是原地算子, 其输出已指向更上游的空间
+    const auto& producer_datas = producer->output_operands->datas;
+    if (producer_datas.size() != op->output_operands->datas.size()) {
+      continue;
+    }
+    op->output_operands->datas = producer_datas;
+    op->is_inplace = true;
+  }
+}
+
+void RuntimeGraph::InitNumaPlacement() {
+  if (utils::GetNumaTopology().node_count() <= 1) {
+    LOG(INFO) << "Only one NUMA node, the NUMA placement is skipped";
+    return;
+  }
+
+  // 相邻的OpenMP线程绑定到不同的节点
+  utils::BindOmpThreadsToNumaNodes();
+
+  if (replicate_weights_) {
+    for (const auto& op : operators_) {
+      if (op->layer != nullptr) {
+        op->layer->ReplicateWeights();
+      }
+    }
+  }
+
+  uint32_t batch_size = 0;
+  for (const auto& op : operators_) {
+    if (op->output_operands != nullptr) {
+      batch_size = std::max(batch_size, uint32_t(op->output_operands->datas.size()));
+    }
+  }
+
+  // 层按批次并行, 第b个批次的输出由同一个线程写入, 移动到该线程所在的节点
+#pragma omp parallel for num_threads(batch_size)
+  for (uint32_t b = 0; b < batch_size; ++b) {
+    const uint32_t numa_node = utils::GetCurrentNumaNode();
+    for (const auto& op : operators_) {
+      if (op->output_operands == nullptr || b >= op->output_operands->datas.size()) {
+        continue;
+      }
+      const sftensor& output = op->output_operands->datas.at(b);
+      if (output != nullptr && !output->empty()) {
+        utils::MoveToNumaNode(output->raw_ptr(), output->size() * sizeof(float), numa_node);
+      }
+    }
+  }
+}
+
+void RuntimeGraph::InitAutotune() {
+  TuningCache cache(tuning_cache_path_);
+  if (!tuning_cache_path_.empty()) {
+    cache.Load();
+  }
+
+  bool cache_updated = false;
+  for (const auto& op : operators_) {
+    const std::shared_ptr<Layer<float>>& layer = op->layer;
+    if (layer == nullptr || op->input_operands_seq.size() != 1) {
+      continue;
+    }
+    const std::vector<std::string>& choices = layer->tuning_choices();
+    const std::string& layer_signature = layer->tuning_signature();
+    if (choices.size() <= 1 || layer_signature.empty()) {
+      continue;
+    }
+
+    // 层签名加上输入的形状, 相同签名的层共用一个选择
+    const std::vector<int32_t>& input_shapes = op->input_operands_seq.front()->shapes;
+    std::stringstream signature_stream;
+    signature_stream << layer_signature << " input";
+    for (int32_t dim : input_shapes) {
+      signature_stream << " " << dim;
+    }
+    const std::string& signature = signature_stream.str();
+
+    std::string cached_choice;
+    if (cache.Find(signature, cached_choice)) {
+      const auto choice_iter = std::find(choices.begin(), choices.end(), cached_choice);
+      if (choice_iter != choices.end()) {
+        layer->set_tuning_choice(uint32_t(choice_iter - choices.begin()));
+        continue;
+      }
+    }
+
+    // 用随机输入对每个实现计时
+    CHECK(input_shapes.size() >= 2 && input_shapes.front() > 0);
+    const std::vector<uint32_t> tensor_shapes(input_shapes.begin() + 1, input_shapes.end());
+    std::vector<sftensor> inputs(input_shapes.front());
+    for (sftensor& input : inputs) {
+      input = std::make_shared<ftensor>(tensor_shapes);
+      input->RandN();
+    }
+    std::vector<sftensor> outputs(inputs.size());
+
+    uint32_t best_choice = 0;
+    double best_time = std::numeric_limits<double>::max();
+    for (uint32_t choice = 0; choice < choices.size(); ++choice) {
+      layer->set_tuning_choice(choice);
+      CHECK(layer->Forward(inputs, outputs) == StatusCode::kSuccess)
+          << "The layer " << op->name << " failed with the choice " << choices.at(choice);
+      for (uint32_t repeat = 0; repeat < kAutotuneRepeats; ++repeat) {
+        const auto start_time = utils::Time::now();
+        layer->Forward(inputs, outputs);
+        const double time =
+            std::chrono::duration<double, std::milli>(utils::Time::now() - start_time).count();
+        if (time < best_time) {
+          best_time = time;
+          best_choice = choice;
+        }
+      }
+    }
+    layer->set_tuning_choice(best_choice);
+    cache.Insert(signature, choices.at(best_choice));
+    cache_updated = true;
+    LOG(INFO) << "Autotune " << op->name << " (" << signature << "): " << choices.at(best_choice)
+              << " " << best_time << "ms";
+  }
+
+  if (cache_updated && !tuning_cache_path_.empty()) {
+    cache.Save();
+  }
+}
+
+void RuntimeGraph::InitExecutionPlan() {
+  execution_plan_.clear();
+  execution_plan_.reserve(operators_.size());
+  step_indices_.clear();
+  for (const auto& op : operators_) {
+    CHECK_GT(op->forward_index, 0);
+    ExecutionStep step;
+    step.op = op.get();
+    step_indices_.insert({op->name, uint32_t(execution_plan_.size())});
+    if (is_input_op(op->name) || is_output_op(op->name)) {
+      step.skip = true;
+      execution_plan_.push_back(std::move(step));
+      continue;
+    }
+
+    CHECK(op->layer != nullptr) << "The layer corresponding to the op " << op->name
+                                << " is empty, indicating that it may not have been created.";
+    step.layer = op->layer.get();
+
+    uint32_t input_size = 0;
+    for (const auto& input_operand : op->input_operands_seq) {
+      CHECK(input_operand != nullptr) << "The input operand of the op " << op->name << " is empty";
+      step.input_datas.push_back(&input_operand->datas);
+      input_size += input_operand->datas.size();
+      if (is_input_op(input_operand->name)) {
+        step.check_inputs = true;
+      }
+    }
+    CHECK(!step.input_datas.empty() && input_size > 0)
+        << op->name << " Layer input data is empty";
+    if (step.input_datas.size() > 1) {
+      step.inputs.resize(input_size);
+    }
+
+    CHECK(op->output_operands != nullptr && !op->output_operands->datas.empty())
+        << op->name << " Layer output data is empty";
+    step.output_datas = &op->output_operands->datas;
+
+    for (const auto& [_, next_op] : op->output_operators) {
+      const auto& next_input_op_iter = next_op->input_operands.find(op->name);
+      if (next_input_op_iter != next_op->input_operands.end()) {
+        step.next_input_datas.push_back(&next_input_op_iter->second->datas);
+      }
+    }
+    execution_plan_.push_back(std::move(step));
+  }
+}
+
+void RuntimeGraph::CheckExecutionPlan() {
+  for (const ExecutionStep& step : execution_plan_) {
+    if (step.skip) {
+      continue;
+    }
+    const RuntimeOperator* op = step.op;
+    std::vector<sftensor> inputs;
+    for (const auto& input_operand : op->input_operands_seq) {
+      // 折叠的常量已经保存在输入操作数中
+      const auto& producer_iter = step_indices_.find(input_operand->name);
+      if (producer_iter == step_indices_.end()) {
+        inputs.insert(inputs.end(), input_operand->datas.begin(), input_operand->datas.end());
+        continue;
+      }
+
+      // 图的输入还没有设置, 用模型输入形状的张量代替
+      const RuntimeOperator* producer = execution_plan_.at(producer_iter->second).op;
+      if (is_input_op(producer->name)) {
+        const std::vector<uint32_t>& shapes = OperandTensorShapes(input_operand->shapes);
+        for (uint32_t i = 0; i < input_operand->datas.size(); ++i) {
+          inputs.push_back(TensorCreate<float>(shapes));
+        }
+      } else {
+        const std::vector<sftensor>& producer_datas = producer->output_operands->datas;
+        inputs.insert(inputs.end(), producer_datas.begin(), producer_datas.end());
+      }
+    }
+
+    const StatusCode status = step.layer->Check(inputs, *step.output_datas);
+    CHECK(status == StatusCode::kSuccess)
+        << op->name << " layer check failed, error code: " << int32_t(status);
+  }
+}
+
+void RuntimeGraph::InitTiledChains() {
+  tiled_chains_.clear();
+  std::map<const RuntimeOperator*, uint32_t> step_indices;
+  for (uint32_t i = 0; i < execution_plan_.size(); ++i) {
+    step_indices.insert({execution_plan_.at(i).op, i});
+  }
+
+  // 只有一个四维输入且层支持分块窗口的算子才能加入链
+  auto get_window = [&](const RuntimeOperator* op, TileWindow& window) {
+    const ExecutionStep& step = execution_plan_.at(step_indices.at(op));
+    return !step.skip && step.layer->GetTileWindow(window) && op->input_operands_seq.size() == 1 &&
+           op->input_operands_seq.front()->shapes.size() == 4 &&
+           op->output_operands->shapes.size() == 4;
+  };
+
+  std::set<const RuntimeOperator*> visited;
+  for (const ExecutionStep& head_step : execution_plan_) {
+    TileWindow window;
+    if (visited.count(head_step.op) || !get_window(head_step.op, window)) {
+      continue;
+    }
+
+    // operators_按拓扑顺序排列, 第一个遇到的算子就是链头, 链中的算子只被下一个算子使用
+    std::vector<const RuntimeOperator*> chain_ops{head_step.op};
+    uint32_t window_count = IsIdentityWindow(window) ? 0 : 1;
+    visited.insert(head_step.op);
+    while (chain_ops.back()->output_operators.size() == 1) {
+      const RuntimeOperator* next_op = chain_ops.back()->output_operators.begin()->second.get();
+      if (visited.count(next_op) || !get_window(next_op, window)) {
+        break;
+      }
+      if (!IsIdentityWindow(window)) {
+        if (window_count == kMaxTiledChainWindows) {
+          break;
+        }
+        window_count += 1;
+      }
+      chain_ops.push_back(next_op);
+      visited.insert(next_op);
+    }
+    if (chain_ops.size() < 2 || window_count == 0) {
+      continue;
+    }
+
+    std::vector<std::shared_ptr<Layer<float>>> layers;
+    std::vector<std::vector<uint32_t>> shapes;
+    const std::vector<int32_t>& input_shapes = head_step.op->input_operands_seq.front()->shapes;
+    shapes.push_back({uint32_t(input_shapes.at(1)), uint32_t(input_shapes.at(2)),
+                      uint32_t(input_shapes.at(3))});
+    for (const RuntimeOperator* op : chain_ops) {
+      const std::vector<int32_t>& output_shapes = op->output_operands->shapes;
+      CHECK_EQ(output_shapes.front(), input_shapes.front());
+      shapes.push_back({uint32_t(output_shapes.at(1)), uint32_t(output_shapes.at(2)),
+                        uint32_t(output_shapes.at(3))});
+      layers.push_back(op->layer);
+    }
+    if (!TiledLayerChain::IsTileable(layers, shapes)) {
+      continue;
+    }
+
+    auto tiled_chain = std::make_shared<TiledLayerChain>(layers, shapes, input_shapes.front());
+    for (uint32_t i = 0; i + 1 < chain_ops.size(); ++i) {
+      execution_plan_.at(step_indices.at(chain_ops.at(i))).skip = true;
+    }
+    // 链的最后一个算子读取链头的输入, 其输出照常传递给后续算子
+    ExecutionStep& tail_step = execution_plan_.at(step_indices.at(chain_ops.back()));
+    tail_step.input_datas = head_step.input_datas;
+    tail_step.check_inputs = head_step.check_inputs;
+    tail_step.tiled_chain = tiled_chain.get();
+    tiled_chains_.push_back(tiled_chain);
+  }
+}
+
+void RuntimeGraph::InitActivationStorage() {
+  CHECK(tiled_chains_.empty()) << "16-bit activations do not support tiled execution";
+
+  // 原地算子和它的生产者共用输出空间, 这些输出保持单精度
+  std::set<std::string> shared_outputs;
+  for (const auto& op : operators_) {
+    if (op->is_inplace) {
+      shared_outputs.insert(op->name);
+      shared_outputs.insert(op->input_operands_seq.front()->name);
+    }
+  }
+
+  // 需要单精度张量的区间[begin_step, end_step]
+  struct TensorLifetime {
+    uint32_t begin_step = 0;
+    uint32_t end_step = 0;
+    std::vector<sftensor>* datas = nullptr;
+    std::vector<std::vector<uint32_t>> shapes;
+  };
+  std::vector<TensorLifetime> lifetimes;
+  // 直接读取16位存储的算子和它的各个生产者
+  std::map<uint32_t, std::vector<std::pair<uint32_t, std::vector<sftensor>*>>> packed_sources;
+  for (uint32_t step_index = 0; step_index < execution_plan_.size(); ++step_index) {
+    ExecutionStep& step = execution_plan_.at(step_index);
+    RuntimeOperator* op = step.op;
+    if (step.skip || shared_outputs.find(op->name) != shared_outputs.end()) {
+      continue;
+    }
+
+    // 只有下一步之后还会被读取的输出才需要压缩, 图的输出保持单精度
+    bool read_by_output = false;
+    uint32_t last_step = step_index;
+    for (const auto& [next_name, _] : op->output_operators) {
+      read_by_output = read_by_output || is_output_op(next_name);
+      last_step = std::max(last_step, step_indices_.at(next_name));
+    }
+    if (read_by_output || last_step <= step_index + 1) {
+      continue;
+    }
+
+    std::vector<std::vector<uint32_t>> shapes;
+    for (const sftensor& output : *step.output_datas) {
+      shapes.push_back(output->shapes());
+    }
+    step.packed_outputs.resize(shapes.size());
+    for (uint32_t i = 0; i < shapes.size(); ++i) {
+      step.packed_outputs.at(i).Reshape(shapes.at(i), activation_precision_);
+    }
+    step.next_input_datas.clear();
+    bool read_by_next_step = false;
+    for (const auto& [next_name, next_op] : op->output_operators) {
+      const uint32_t next_index = step_indices_.at(next_name);
+      std::vector<sftensor>* next_input_datas = &next_op->input_operands.at(op->name)->datas;
+      ExecutionStep& next_step = execution_plan_.at(next_index);
+      if (next_index == step_index + 1) {
+        // 紧接着的算子直接读取单精度输出
+        step.next_input_datas.push_back(next_input_datas);
+        read_by_next_step = true;
+      } else if (next_step.layer->is_packed_input_supported()) {
+        // 算子在核内展开16位输入, 不需要单精度的暂存张量
+        packed_sources[next_index].emplace_back(step_index, next_input_datas);
+        next_input_datas->assign(next_input_datas->size(), nullptr);
+      } else {
+        next_step.unpacked_inputs.emplace_back(step_index, next_input_datas);
+        lifetimes.push_back({next_index, next_index, next_input_datas, shapes});
+      }
+    }
+    lifetimes.push_back(
+        {step_index, read_by_next_step ? step_index + 1 : step_index, step.output_datas, shapes});
+  }
+
+  // 按输入顺序排列每个输入张量的16位存储, 单精度的输入为nullptr
+  for (const auto& [consumer_index, sources] : packed_sources) {
+    ExecutionStep& consumer_step = execution_plan_.at(consumer_index);
+    for (const std::vector<sftensor>* input_datas : consumer_step.input_datas) {
+      const auto source_iter =
+          std::find_if(sources.begin(), sources.end(),
+                       [input_datas](const auto& source) { return source.second == input_datas; });
+      for (uint32_t i = 0; i < input_datas->size(); ++i) {
+        consumer_step.packed_inputs.push_back(
+            source_iter == sources.end()
+                ? nullptr
+                : &execution_plan_.at(source_iter->first).packed_outputs.at(i));
+      }
+    }
+  }
+
+  // 同形状且区间不重叠的张量共用空间, 按起点顺序贪心分配
+  std::stable_sort(lifetimes.begin(), lifetimes.end(),
+                   [](const TensorLifetime& a, const TensorLifetime& b) {
+                     return a.begin_step < b.begin_step;
+                   });
+  std::map<std::vector<uint32_t>, std::vector<std::pair<sftensor, uint32_t>>> tensor_pool;
+  for (const TensorLifetime& lifetime : lifetimes) {
+    for (uint32_t i = 0; i < lifetime.shapes.size(); ++i) {
+      auto& pooled_tensors = tensor_pool[lifetime.shapes.at(i)];
+      auto pooled_iter = std::find_if(
+          pooled_tensors.begin(), pooled_tensors.end(),
+          [&lifetime](const auto& pooled) { return pooled.second < lifetime.begin_step; });
+      if (pooled_iter == pooled_tensors.end()) {
+        pooled_tensors.emplace_back(TensorCreate<float>(lifetime.shapes.at(i)), 0);
+        pooled_iter = pooled_tensors.end() - 1;
+      }
+      pooled_iter->second = lifetime.end_step;
+      lifetime.datas->at(i) = pooled_iter->first;
+    }
+  }
+}
+
+void RuntimeGraph::InitMicroBatch() {
+  CHECK(graph_ != nullptr);
+  micro_batch_ = 0;
+  // 从图的输入出发, 标记第一维是批次的操作数
+  int32_t model_batch = 0;
+  std::set<const pnnx::Operand*> batched_operands;
+  for (const pnnx::Operator* op : graph_->ops) {
+    if (op->type != "pnnx.Input") {
+      continue;
+    }
+    for (const pnnx::Operand* output : op->outputs) {
+      CHECK(!output->shape.empty());
+      if (model_batch != 0 && output->shape.front() != model_batch) {
+        LOG(WARNING) << "The graph inputs have different batch sizes, micro-batching is disabled";
+        return;
+      }
+      model_batch = output->shape.front();
+      batched_operands.insert(output);
+    }
+  }
+  if (model_batch <= 0) {
+    LOG(WARNING) << "The graph has no batched input, micro-batching is disabled";
+    return;
+  }
+
+  // pnnx算子按拓扑顺序保存, 输入带批次的算子输出也须保持批次
+  size_t sample_bytes = 0;
+  std::set<std::string> batched_ops;
+  for (const pnnx::Operator* op : graph_->ops) {
+    const bool batched_input =
+        std::any_of(op->inputs.begin(), op->inputs.end(), [&](const pnnx::Operand* input) {
+          return batched_operands.find(input) != batched_operands.end();
+        });
+    if (!batched_input) {
+      continue;
+    }
+    batched_ops.insert(op->name);
+    for (const pnnx::Operand* output : op->outputs) {
+      if (output->shape.empty() || output->shape.front() != model_batch) {
+        LOG(WARNING) << "The operator " << op->name
+                     << " changes the batch dimension, micro-batching is disabled";
+        return;
+      }
+      size_t sample_size = 1;
+      for (uint32_t i = 1; i < output->shape.size(); ++i) {
+        sample_size *= output->shape.at(i);
+      }
+      sample_bytes += sample_size * sizeof(float);
+      batched_operands.insert(output);
+    }
+  }
+
+  // 估计值不计原地执行和16位存储省下的空间, 偏大
+  micro_batch_ = uint32_t(std::clamp(memory_budget_ / std::max(sample_bytes, size_t(1)), size_t(1),
+                                     size_t(model_batch)));
+  LOG_IF(WARNING, memory_budget_ < sample_bytes)
+      << "The memory budget is smaller than the activations of one batch element: "
+      << sample_bytes << " bytes";
+  LOG(INFO) << "Micro-batch size " << micro_batch_ << " of the batch size " << model_batch;
+  if (micro_batch_ == uint32_t(model_batch)) {
+    return;
+  }
+
+  // 运行时操作数以生产者命名
+  std::set<std::string> batched_producers;
+  for (pnnx::Operand* operand : graph_->operands) {
+    if (batched_operands.find(operand) != batched_operands.end()) {
+      operand->shape.front() = int32_t(micro_batch_);
+      batched_producers.insert(operand->producer->name);
+    }
+  }
+  for (const auto& op : operators_) {
+    for (const auto& input_operand : op->input_operands_seq) {
+      if (batched_producers.find(input_operand->name) != batched_producers.end()) {
+        input_operand->shapes.front() = int32_t(micro_batch_);
+      }
+    }
+    // view和reshape的形状参数中含有批次
+    if (batched_ops.find(op->name) == batched_ops.end() ||
+        (op->type != "Tensor.view" && op->type != "Tensor.reshape")) {
+      continue;
+    }
+    const auto& shape_iter = op->params.find("shape");
+    if (shape_iter == op->params.end()) {
+      continue;
+    }
+    auto shape = std::dynamic_pointer_cast<RuntimeParameterIntArray>(shape_iter->second);
+    if (shape != nullptr && !shape->value.empty() && shape->value.front() == model_batch) {
+      shape->value.front() = int32_t(micro_batch_);
+    }
+  }
+}
+
+void RuntimeGraph::ForwardMicroBatches(bool debug) {
+  const uint32_t batch_size = micro_batch_inputs_.begin()->second.size();
+  for (const auto& [input_name, inputs] : micro_batch_inputs_) {
+    CHECK_EQ(inputs.size(), batch_size)
+        << "The graph inputs have different batch sizes: " << input_name;
+  }
+
+  // 每个输出算子按输入操作数分别收集, 与get_outputs的顺序一致
+  std::map<std::string, std::vector<std::vector<sftensor>>> operand_outputs;
+  for (uint32_t begin = 0; begin < batch_size; begin += micro_batch_) {
+    const uint32_t valid_size = std::min(micro_batch_, batch_size - begin);
+    for (const auto& [input_name, inputs] : micro_batch_inputs_) {
+      // 最后一个微批次不满时用最后一个输入补齐
+      std::vector<sftensor> micro_inputs(micro_batch_);
+      for (uint32_t i = 0; i < micro_batch_; ++i) {
+        micro_inputs.at(i) = inputs.at(std::min(begin + i, batch_size - 1));
+      }
+      for (const auto& input_op : input_ops_) {
+        if (input_op->name == input_name) {
+          PropagateLayerOutputs(input_op, micro_inputs);
+        }
+      }
+    }
+
+    for (uint32_t step_index = 0; step_index < execution_plan_.size(); ++step_index) {
+      RunExecutionStep(step_index, debug);
+    }
+
+    // 下一个微批次会覆盖图中的输出空间, 需要拷贝
+    for (const auto& output_op : output_ops_) {
+      auto& outputs = operand_outputs[output_op->name];
+      outputs.resize(output_op->input_operands_seq.size());
+      for (uint32_t j = 0; j < output_op->input_operands_seq.size(); ++j) {
+        const auto& datas = output_op->input_operands_seq.at(j)->datas;
+        for (uint32_t i = 0; i < valid_size; ++i) {
+          outputs.at(j).push_back(TensorClone(datas.at(i)));
+        }
+      }
+    }
+  }
+
+  micro_batch_outputs_.clear();
+  for (auto& [output_name, outputs] : operand_outputs) {
+    auto& gathered_outputs = micro_batch_outputs_[output_name];
+    for (auto& operand_output : outputs) {
+      std::move(operand_output.begin(), operand_output.end(),
+                std::back_inserter(gathered_outputs));
+    }
+  }
+}
+
 void RuntimeGraph::InitGraphOperatorsInput(
     const std::vector<pnnx::Operand*>& inputs,
     const std::shared_ptr<RuntimeOperator>& runtime_operator) {
@@ -419,8 +1543,9 @@ void RuntimeGraph::CreateNodeRelation() {
         }
       }
     }
-    // 除了输入和输出节点，都创建layer
-    if (current_op->type != "pnnx.Input" && current_op->type != "pnnx.Output") {
+    // 除了输入, 输出和常量节点，都创建layer
+    if (current_op->type != "pnnx.Input" && current_op->type != "pnnx.Output" &&
+        current_op->type != "pnnx.Attribute") {
       std::shared_ptr<Layer<float>> layer = RuntimeGraph::CreateLayer(current_op);
       if (layer) {
         current_op->layer = layer;
@@ -432,6 +1557,131 @@ void RuntimeGraph::CreateNodeRelation() {
   }
 }
 
+void RuntimeGraph::EliminateDeadOperators() {
+  std::map<std::string, std::shared_ptr<RuntimeOperator>> operators_map;
+  std::vector<std::string> pending_ops;
+  for (const auto& op : operators_) {
+    operators_map.insert({op->name, op});
+    if (op->type == "pnnx.Output") {
+      pending_ops.push_back(op->name);
+    }
+  }
+  if (pending_ops.empty()) {
+    return;
+  }
+
+  // 从图的输出向上游遍历, 没有遍历到的算子不影响任何输出
+  std::set<std::string> live_ops;
+  while (!pending_ops.empty()) {
+    const std::string op_name = pending_ops.back();
+    pending_ops.pop_back();
+    if (!live_ops.insert(op_name).second) {
+      continue;
+    }
+    for (const auto& input_operand : operators_map.at(op_name)->input_operands_seq) {
+      pending_ops.push_back(input_operand->name);
+    }
+  }
+
+  auto is_dead = [&live_ops](const std::shared_ptr<RuntimeOperator>& op) {
+    return op->type != "pnnx.Input" && live_ops.find(op->name) == live_ops.end();
+  };
+  const uint32_t operator_count = operators_.size();
+  operators_.erase(std::remove_if(operators_.begin(), operators_.end(), is_dead),
+                   operators_.end());
+  for (const auto& op : operators_) {
+    for (auto iter = op->output_operators.begin(); iter != op->output_operators.end();) {
+      if (is_dead(iter->second)) {
+        iter = op->output_operators.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    auto& output_names = op->output_names;
+    output_names.erase(std::remove_if(output_names.begin(), output_names.end(),
+                                      [&](const std::string& output_name) {
+                                        return is_dead(operators_map.at(output_name));
+                                      }),
+                       output_names.end());
+  }
+  LOG_IF(INFO, operators_.size() < operator_count)
+      << "Removed " << operator_count - operators_.size() << " unused operators";
+}
+
+void RuntimeGraph::FoldConstants() {
+  CHECK(graph_ != nullptr) << "The pnnx graph has been released";
+  // pnnx中的算子已按拓扑顺序排列, 生产者都是常量的算子也是常量
+  std::map<std::string, std::shared_ptr<RuntimeOperator>> constant_ops_map;
+  std::vector<std::shared_ptr<RuntimeOperator>> constant_ops;
+  for (const auto& op : operators_) {
+    if (op->type == "pnnx.Input" || op->type == "pnnx.Output") {
+      continue;
+    }
+    bool is_constant = true;
+    for (const auto& input_operand : op->input_operands_seq) {
+      if (constant_ops_map.find(input_operand->name) == constant_ops_map.end()) {
+        is_constant = false;
+        break;
+      }
+    }
+    if (is_constant) {
+      constant_ops_map.insert({op->name, op});
+      constant_ops.push_back(op);
+    }
+  }
+  if (constant_ops.empty()) {
+    return;
+  }
+
+  RuntimeOperatorUtils<float>::InitOperatorOutput(graph_->ops, constant_ops);
+  for (const auto& op : constant_ops) {
+    CHECK(op->output_operands != nullptr)
+        << "The constant operator " << op->name << " has no output";
+    std::vector<sftensor>& outputs = op->output_operands->datas;
+    if (op->type == "pnnx.Attribute") {
+      const auto& data_iter = op->attribute.find("data");
+      CHECK(data_iter != op->attribute.end())
+          << "The attribute operator " << op->name << " has no data";
+      const std::vector<float>& values = data_iter->second->get<float>();
+      const uint32_t tensor_size = outputs.front()->size();
+      CHECK_EQ(values.size(), tensor_size * outputs.size())
+          << "The data size of the attribute operator " << op->name << " is wrong";
+      for (uint32_t i = 0; i < outputs.size(); ++i) {
+        outputs.at(i)->Fill(std::vector<float>(values.begin() + i * tensor_size,
+                                               values.begin() + (i + 1) * tensor_size));
+      }
+      continue;
+    }
+
+    std::vector<sftensor> inputs;
+    for (const auto& input_operand : op->input_operands_seq) {
+      const auto& input_datas = constant_ops_map.at(input_operand->name)->output_operands->datas;
+      inputs.insert(inputs.end(), input_datas.begin(), input_datas.end());
+    }
+    CHECK(op->layer != nullptr)
+        << "The layer of the constant operator " << op->name << " is empty";
+    const StatusCode status = op->layer->Forward(inputs, outputs);
+    CHECK(status == StatusCode::kSuccess)
+        << op->layer->layer_name() << " layer fold failed, error code: " << int32_t(status);
+  }
+
+  // 常量保存在后继算子的输入操作数中, 生产者不在图中, 这些输入不会被原地覆盖
+  for (const auto& op : constant_ops) {
+    for (const auto& [_, next_op] : op->output_operators) {
+      if (constant_ops_map.find(next_op->name) == constant_ops_map.end()) {
+        next_op->input_operands.at(op->name)->datas = op->output_operands->datas;
+      }
+    }
+  }
+  operators_.erase(std::remove_if(operators_.begin(), operators_.end(),
+                                  [&constant_ops_map](const auto& op) {
+                                    return constant_ops_map.find(op->name) !=
+                                           constant_ops_map.end();
+                                  }),
+                   operators_.end());
+  LOG(INFO) << "Folded " << constant_ops.size() << " constant operators";
+}
+
 RuntimeGraph::GraphState RuntimeGraph::graph_state() const { return this->graph_state_; }
 
 void RuntimeGraph::set_inputs(const std::string& input_name, const std::vector<sftensor>& inputs) {
@@ -444,7 +1694,17 @@ void RuntimeGraph::set_inputs(const std::string& input_name, const std::vector<s
     }
   }
   CHECK(input_op != nullptr) << "Can not find the input operator: " << input_name;
-  PropagateLayerOutputs(input_op, inputs);
+
+  const bool micro_batch = micro_batch_ > 0;
+  for (const auto& [_, next_op] : input_op->output_operators) {
+    CheckGraphInputs(*next_op->input_operands.at(input_name), inputs, input_name, micro_batch);
+  }
+  // 微批次执行时在Forward中分批传入
+  if (micro_batch) {
+    micro_batch_inputs_[input_name] = inputs;
+  } else {
+    PropagateLayerOutputs(input_op, inputs);
+  }
 }
 
 std::vector<sftensor> RuntimeGraph::get_outputs(const std::string& output_name) const {
@@ -457,6 +1717,11 @@ std::vector<sftensor> RuntimeGraph::get_outputs(const std::string& output_name)
   }
 
   CHECK(output_op != nullptr) << "Can not find the output operator: " << output_name;
+  const auto& micro_batch_outputs_iter = micro_batch_outputs_.find(output_name);
+  if (micro_batch_outputs_iter != micro_batch_outputs_.end()) {
+    return micro_batch_outputs_iter->second;
+  }
+
   std::vector<sftensor> outputs;
   for (const auto& input_operand : output_op->input_operands_seq) {
     std::copy(input_operand->datas.begin(), input_operand->datas.end(),
@@ -465,6 +1730,10 @@ std::vector<sftensor> RuntimeGraph::get_outputs(const std::string& output_name)
   return outputs;
 }
 
+const std::vector<std::shared_ptr<RuntimeOperator>>& RuntimeGraph::operators() const {
+  return this->operators_;
+}
+
 bool RuntimeGraph::is_input_op(const std::string& op_name) const {
   for (auto op : this->input_ops_) {
     CHECK(op != nullptr);
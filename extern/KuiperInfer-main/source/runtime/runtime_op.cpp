@@ -67,11 +67,21 @@ void RuntimeOperatorUtils<float>::InitOperatorInput(
 void RuntimeOperatorUtils<float>::InitOperatorOutput(
     const std::vector<pnnx::Operator*>& pnnx_operators,
     const std::vector<std::shared_ptr<RuntimeOperator>>& operators) {
-  CHECK(!pnnx_operators.empty() && !operators.empty() && pnnx_operators.size() == operators.size());
-  CHECK(pnnx_operators.size() == operators.size());
-  for (uint32_t i = 0; i < pnnx_operators.size(); ++i) {
+  CHECK(!pnnx_operators.empty() && !operators.empty());
+  CHECK(pnnx_operators.size() >= operators.size());
+  // 折叠和删除的算子不在运行时算子中, 按名称对应pnnx算子
+  std::map<std::string, std::shared_ptr<RuntimeOperator>> operators_map;
+  for (const auto& op : operators) {
+    operators_map.insert({op->name, op});
+  }
+
+  for (const pnnx::Operator* pnnx_operator : pnnx_operators) {
+    const auto& runtime_op_iter = operators_map.find(pnnx_operator->name);
+    if (runtime_op_iter == operators_map.end()) {
+      continue;
+    }
     // 得到pnnx原有的输出空间
-    const std::vector<pnnx::Operand*> operands = pnnx_operators.at(i)->outputs;
+    const std::vector<pnnx::Operand*> operands = pnnx_operator->outputs;
     const uint32_t operands_size = operands.size();
     if (!operands_size) {
       continue;
@@ -79,7 +89,7 @@ void RuntimeOperatorUtils<float>::InitOperatorOutput(
       LOG(FATAL) << "Only support one node one output yet!";
     } else {
       pnnx::Operand* operand = operands.front();
-      const auto& runtime_op = operators.at(i);
+      const auto& runtime_op = runtime_op_iter->second;
 
       CHECK(operand != nullptr && !operand->shape.empty()) << "Operand output is null or empty!";
       std::vector<int32_t> operand_shapes;
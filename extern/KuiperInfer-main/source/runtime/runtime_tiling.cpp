@@ -0,0 +1,380 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "runtime/runtime_tiling.hpp"
+#include <glog/logging.h>
+#include <omp.h>
+#include <algorithm>
+#include <cstring>
+#include "utils/cpu/cpu_features.hpp"
+
+namespace kuiper_infer {
+
+// 无法获取L2缓存大小时分块缓冲区的预算
+static constexpr uint32_t kDefaultTileCacheSize = 512 * 1024;
+
+static uint32_t WindowExtent(uint32_t kernel, uint32_t dilation) {
+  return (kernel - 1) * dilation + 1;
+}
+
+/**
+ * @brief Copies a window of the feature map into a tile buffer
+ *
+ * src covers the feature map region starting at (src_row, src_col), dst the window starting at
+ * (window_row, window_col). Elements of the window outside src are set to padding_value.
+ */
+static void CopyTileWindow(const Tensor<float>& src, int32_t src_row, int32_t src_col,
+                           int32_t window_row, int32_t window_col, float padding_value,
+                           Tensor<float>& dst) {
+  CHECK_EQ(src.channels(), dst.channels());
+  const int32_t rows = int32_t(dst.rows());
+  const int32_t cols = int32_t(dst.cols());
+  // 窗口中位于src内的行, 以窗口的行为坐标
+  const int32_t row_begin = std::max(window_row, src_row) - window_row;
+  const int32_t row_end = std::min(window_row + rows, src_row + int32_t(src.rows())) - window_row;
+  for (uint32_t c = 0; c < dst.channels(); ++c) {
+    const arma::fmat& src_channel = src.slice(c);
+    arma::fmat& dst_channel = dst.slice(c);
+    for (int32_t j = 0; j < cols; ++j) {
+      float* dst_ptr = dst_channel.colptr(j);
+      const int32_t col = window_col + j - src_col;
+      if (col < 0 || col >= int32_t(src.cols()) || row_end <= row_begin) {
+        std::fill(dst_ptr, dst_ptr + rows, padding_value);
+        continue;
+      }
+      std::fill(dst_ptr, dst_ptr + row_begin, padding_value);
+      std::memcpy(dst_ptr + row_begin, src_channel.colptr(col) + window_row + row_begin - src_row,
+                  (row_end - row_begin) * sizeof(float));
+      std::fill(dst_ptr + row_end, dst_ptr + rows, padding_value);
+    }
+  }
+}
+
+TiledLayerChain::TiledLayerChain(const std::vector<std::shared_ptr<Layer<float>>>& layers,
+                                 const std::vector<std::vector<uint32_t>>& shapes,
+                                 uint32_t batch_size, uint32_t cache_size)
+    : shapes_(shapes) {
+  CHECK(IsTileable(layers, shapes)) << "The layers of the chain can not run on tiles";
+  CHECK_GT(batch_size, 0);
+  for (const auto& layer : layers) {
+    TileWindow window;
+    layer->GetTileWindow(window);
+    // 有填充的层使用不填充的副本, 窗口越界的部分在复制输入时填充
+    std::shared_ptr<Layer<float>> tile_layer = layer->CreateTileLayer();
+    CHECK(tile_layer != nullptr || (window.padding_h == 0 && window.padding_w == 0))
+        << layer->layer_name() << " layer pads its input but has no tile layer";
+    windows_.push_back(window);
+    layers_.push_back(tile_layer != nullptr ? tile_layer : layer);
+  }
+
+  // L2缓存的另一半留给权重和卷积的im2col块
+  if (cache_size == 0) {
+    const uint32_t l2_cache_size = utils::GetCpuFeatures().l2_cache_size;
+    cache_size = l2_cache_size > 0 ? l2_cache_size / 2 : kDefaultTileCacheSize;
+  }
+  const uint32_t thread_count = std::max(omp_get_max_threads(), 1);
+  const uint32_t min_tiles = (thread_count + batch_size - 1) / batch_size;
+  tile_size_ = PlanTileSize(windows_, shapes_, cache_size, min_tiles);
+  InitTiles();
+  thread_buffers_.resize(thread_count);
+}
+
+bool TiledLayerChain::IsTileable(const std::vector<std::shared_ptr<Layer<float>>>& layers,
+                                 const std::vector<std::vector<uint32_t>>& shapes) {
+  if (layers.empty() || shapes.size() != layers.size() + 1) {
+    return false;
+  }
+  for (const auto& shape : shapes) {
+    if (shape.size() != 3 || !shape.at(0) || !shape.at(1) || !shape.at(2)) {
+      return false;
+    }
+  }
+
+  for (uint32_t i = 0; i < layers.size(); ++i) {
+    TileWindow window;
+    if (!layers.at(i) || !layers.at(i)->GetTileWindow(window)) {
+      return false;
+    }
+    if (!window.kernel_h || !window.kernel_w || !window.stride_h || !window.stride_w ||
+        !window.dilation_h || !window.dilation_w) {
+      return false;
+    }
+
+    const std::vector<uint32_t>& input_shape = shapes.at(i);
+    const std::vector<uint32_t>& output_shape = shapes.at(i + 1);
+    const uint32_t extent_h = WindowExtent(window.kernel_h, window.dilation_h);
+    const uint32_t extent_w = WindowExtent(window.kernel_w, window.dilation_w);
+    // 填充不小于窗口时, 边缘的输出只读取填充值, 前一层的输出块会为空
+    if (window.padding_h >= extent_h || window.padding_w >= extent_w) {
+      return false;
+    }
+
+    const uint32_t padded_h = input_shape.at(1) + 2 * window.padding_h;
+    const uint32_t padded_w = input_shape.at(2) + 2 * window.padding_w;
+    if (padded_h < extent_h || padded_w < extent_w) {
+      return false;
+    }
+    if (output_shape.at(1) != (padded_h - extent_h) / window.stride_h + 1 ||
+        output_shape.at(2) != (padded_w - extent_w) / window.stride_w + 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t TiledLayerChain::TileWorkingSet(const std::vector<TileWindow>& windows,
+                                       const std::vector<std::vector<uint32_t>>& shapes,
+                                       const TileSize& tile_size) {
+  CHECK(!windows.empty() && shapes.size() == windows.size() + 1);
+  size_t rows = tile_size.rows;
+  size_t cols = tile_size.cols;
+  size_t elements = 0;
+  for (int32_t i = int32_t(windows.size()) - 1; i >= 0; --i) {
+    const TileWindow& window = windows.at(i);
+    const std::vector<uint32_t>& input_shape = shapes.at(i);
+    const std::vector<uint32_t>& output_shape = shapes.at(i + 1);
+    rows = std::min<size_t>(rows, output_shape.at(1));
+    cols = std::min<size_t>(cols, output_shape.at(2));
+    elements += output_shape.at(0) * rows * cols;
+
+    // 输入窗口包含光环和填充, 前一层只计算其中位于特征图内的部分
+    rows = (rows - 1) * window.stride_h + WindowExtent(window.kernel_h, window.dilation_h);
+    cols = (cols - 1) * window.stride_w + WindowExtent(window.kernel_w, window.dilation_w);
+    elements += input_shape.at(0) * rows * cols;
+    rows = std::min<size_t>(rows, input_shape.at(1));
+    cols = std::min<size_t>(cols, input_shape.at(2));
+  }
+  return elements * sizeof(float);
+}
+
+TileSize TiledLayerChain::PlanTileSize(const std::vector<TileWindow>& windows,
+                                       const std::vector<std::vector<uint32_t>>& shapes,
+                                       size_t cache_size, uint32_t min_tiles) {
+  CHECK(!windows.empty() && shapes.size() == windows.size() + 1);
+  const uint32_t output_rows = shapes.back().at(1);
+  const uint32_t output_cols = shapes.back().at(2);
+  uint32_t row_tiles = 1;
+  uint32_t col_tiles = 1;
+  TileSize tile_size{output_rows, output_cols};
+  while (row_tiles < output_rows || col_tiles < output_cols) {
+    const uint32_t tile_count = ((output_rows + tile_size.rows - 1) / tile_size.rows) *
+                                ((output_cols + tile_size.cols - 1) / tile_size.cols);
+    if (tile_count >= min_tiles && TileWorkingSet(windows, shapes, tile_size) <= cache_size) {
+      break;
+    }
+
+    // 优先切分较长的一边, 块接近正方形时光环的重复计算最少
+    if (col_tiles == output_cols || (tile_size.rows >= tile_size.cols && row_tiles < output_rows)) {
+      row_tiles = std::min(row_tiles * 2, output_rows);
+    } else {
+      col_tiles = std::min(col_tiles * 2, output_cols);
+    }
+    tile_size.rows = (output_rows + row_tiles - 1) / row_tiles;
+    tile_size.cols = (output_cols + col_tiles - 1) / col_tiles;
+  }
+  return tile_size;
+}
+
+void TiledLayerChain::InitTiles() {
+  tiles_.clear();
+  buffer_shapes_.clear();
+  const uint32_t layer_count = layers_.size();
+  const uint32_t output_rows = shapes_.back().at(1);
+  const uint32_t output_cols = shapes_.back().at(2);
+
+  // 张量按列存储, 先沿行方向遍历块
+  for (uint32_t col = 0; col < output_cols; col += tile_size_.cols) {
+    for (uint32_t row = 0; row < output_rows; row += tile_size_.rows) {
+      std::vector<TileLevel> tile(layer_count);
+      int32_t row_begin = int32_t(row);
+      int32_t row_end = int32_t(std::min(row + tile_size_.rows, output_rows));
+      int32_t col_begin = int32_t(col);
+      int32_t col_end = int32_t(std::min(col + tile_size_.cols, output_cols));
+
+      // 从最后一层向前推导每一层需要的输入窗口
+      for (int32_t i = int32_t(layer_count) - 1; i >= 0; --i) {
+        const TileWindow& window = windows_.at(i);
+        const std::vector<uint32_t>& input_shape = shapes_.at(i);
+        const std::vector<uint32_t>& output_shape = shapes_.at(i + 1);
+        TileLevel& level = tile.at(i);
+        level.output_row_begin = row_begin;
+        level.output_row_end = row_end;
+        level.output_col_begin = col_begin;
+        level.output_col_end = col_end;
+        level.output_buffer =
+            FindBuffer(2 * i + 1, {output_shape.at(0), uint32_t(row_end - row_begin),
+                                   uint32_t(col_end - col_begin)});
+
+        const int32_t extent_h = int32_t(WindowExtent(window.kernel_h, window.dilation_h));
+        const int32_t extent_w = int32_t(WindowExtent(window.kernel_w, window.dilation_w));
+        level.input_row_begin = row_begin * int32_t(window.stride_h) - int32_t(window.padding_h);
+        level.input_row_end = (row_end - 1) * int32_t(window.stride_h) + extent_h -
+                              int32_t(window.padding_h);
+        level.input_col_begin = col_begin * int32_t(window.stride_w) - int32_t(window.padding_w);
+        level.input_col_end = (col_end - 1) * int32_t(window.stride_w) + extent_w -
+                              int32_t(window.padding_w);
+
+        // 前一层只计算输入窗口中位于特征图内的部分
+        row_begin = std::max(level.input_row_begin, 0);
+        row_end = std::min(level.input_row_end, int32_t(input_shape.at(1)));
+        col_begin = std::max(level.input_col_begin, 0);
+        col_end = std::min(level.input_col_end, int32_t(input_shape.at(2)));
+        CHECK(row_begin < row_end && col_begin < col_end);
+
+        // 第一层从完整的输入中复制窗口, 其余层的窗口越界时需要填充
+        const bool padded = i == 0 || row_begin != level.input_row_begin ||
+                            row_end != level.input_row_end || col_begin != level.input_col_begin ||
+                            col_end != level.input_col_end;
+        if (padded) {
+          level.input_buffer =
+              FindBuffer(2 * i, {input_shape.at(0),
+                                 uint32_t(level.input_row_end - level.input_row_begin),
+                                 uint32_t(level.input_col_end - level.input_col_begin)});
+        } else {
+          level.input_buffer = kNoBuffer;
+        }
+      }
+      tiles_.push_back(std::move(tile));
+    }
+  }
+}
+
+uint32_t TiledLayerChain::FindBuffer(uint32_t slot, const std::vector<uint32_t>& shape) {
+  for (uint32_t i = 0; i < buffer_shapes_.size(); ++i) {
+    if (buffer_shapes_.at(i).first == slot && buffer_shapes_.at(i).second == shape) {
+      return i;
+    }
+  }
+  buffer_shapes_.emplace_back(slot, shape);
+  return buffer_shapes_.size() - 1;
+}
+
+StatusCode TiledLayerChain::Forward(const std::vector<sftensor>& inputs,
+                                    std::vector<sftensor>& outputs) {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The input tensor array in the tiled layer chain is empty";
+    return StatusCode::kInferInputsEmpty;
+  }
+
+  if (outputs.empty()) {
+    LOG(ERROR) << "The output tensor array in the tiled layer chain is empty";
+    return StatusCode::kInferOutputsEmpty;
+  }
+
+  if (inputs.size() != outputs.size()) {
+    LOG(ERROR) << "The input and output tensor array size of the tiled layer "
+                  "chain do not match";
+    return StatusCode::kInferInOutDimMismatch;
+  }
+
+  const uint32_t batch_size = inputs.size();
+  for (uint32_t b = 0; b < batch_size; ++b) {
+    const sftensor& input = inputs.at(b);
+    CHECK(input != nullptr && input->shapes() == shapes_.front())
+        << "The input tensor array in the tiled layer chain has an incorrectly sized tensor " << b
+        << " th";
+
+    sftensor& output = outputs.at(b);
+    if (output == nullptr || output->empty()) {
+      output = std::make_shared<Tensor<float>>(shapes_.back());
+    }
+    CHECK(output->shapes() == shapes_.back())
+        << "The output tensor array in the tiled layer chain has an incorrectly sized tensor " << b
+        << " th";
+  }
+
+  // 构建后可能调整了线程数
+  const uint32_t max_threads = std::max(omp_get_max_threads(), 1);
+  if (thread_buffers_.size() < max_threads) {
+    thread_buffers_.resize(max_threads);
+  }
+
+  const uint32_t tile_count = tiles_.size();
+  const uint32_t task_count = batch_size * tile_count;
+  const uint32_t thread_count = std::min(max_threads, task_count);
+#pragma omp parallel for schedule(dynamic) num_threads(thread_count)
+  for (uint32_t task = 0; task < task_count; ++task) {
+    const uint32_t thread_index = omp_get_thread_num();
+    CHECK_LT(thread_index, thread_buffers_.size());
+    std::vector<sftensor>& buffers = thread_buffers_.at(thread_index);
+    if (buffers.empty()) {
+      buffers.resize(buffer_shapes_.size());
+    }
+    const uint32_t b = task / tile_count;
+    ForwardTile(tiles_.at(task % tile_count), inputs.at(b), outputs.at(b), buffers);
+  }
+  return StatusCode::kSuccess;
+}
+
+void TiledLayerChain::ForwardTile(const std::vector<TileLevel>& tile, const sftensor& input,
+                                  const sftensor& output, std::vector<sftensor>& buffers) const {
+  auto get_buffer = [&](uint32_t buffer_id) -> const sftensor& {
+    sftensor& buffer = buffers.at(buffer_id);
+    if (buffer == nullptr) {
+      buffer = std::make_shared<Tensor<float>>(buffer_shapes_.at(buffer_id).second);
+    }
+    return buffer;
+  };
+
+  std::vector<sftensor> layer_inputs(1);
+  std::vector<sftensor> layer_outputs(1);
+  // current覆盖特征图中从(current_row, current_col)开始的区域
+  sftensor current = input;
+  int32_t current_row = 0;
+  int32_t current_col = 0;
+  for (uint32_t i = 0; i < tile.size(); ++i) {
+    const TileLevel& level = tile.at(i);
+    if (level.input_buffer == kNoBuffer) {
+      layer_inputs.front() = current;
+    } else {
+      const sftensor& window = get_buffer(level.input_buffer);
+      CopyTileWindow(*current, current_row, current_col, level.input_row_begin,
+                     level.input_col_begin, windows_.at(i).padding_value, *window);
+      layer_inputs.front() = window;
+    }
+    layer_outputs.front() = get_buffer(level.output_buffer);
+
+    const StatusCode status = layers_.at(i)->Forward(layer_inputs, layer_outputs);
+    CHECK(status == StatusCode::kSuccess)
+        << layers_.at(i)->layer_name()
+        << " layer forward failed in the tiled layer chain, error code: " << int32_t(status);
+    current = layer_outputs.front();
+    current_row = int32_t(level.output_row_begin);
+    current_col = int32_t(level.output_col_begin);
+  }
+
+  // 最后一层的输出块写回完整的输出
+  const uint32_t rows = current->rows();
+  for (uint32_t c = 0; c < current->channels(); ++c) {
+    const arma::fmat& tile_channel = current->slice(c);
+    arma::fmat& output_channel = output->slice(c);
+    for (uint32_t j = 0; j < current->cols(); ++j) {
+      std::memcpy(output_channel.colptr(current_col + j) + current_row, tile_channel.colptr(j),
+                  rows * sizeof(float));
+    }
+  }
+}
+
+const TileSize& TiledLayerChain::tile_size() const { return this->tile_size_; }
+
+uint32_t TiledLayerChain::tile_count() const { return this->tiles_.size(); }
+
+}  // namespace kuiper_infer
@@ -0,0 +1,85 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "runtime/tuning_cache.hpp"
+#include <glog/logging.h>
+#include <fstream>
+#include "utils/cpu/cpu_features.hpp"
+
+namespace kuiper_infer {
+TuningCache::TuningCache(std::string file_path)
+    : file_path_(std::move(file_path)), cpu_key_(cpu_key()) {}
+
+std::string TuningCache::cpu_key() {
+  std::string brand = utils::GetCpuFeatures().brand;
+  // 制表符和换行符用于分隔缓存文件中的字段
+  for (char& c : brand) {
+    if (c == '\t' || c == '\n') {
+      c = ' ';
+    }
+  }
+  return brand.empty() ? "unknown" : brand;
+}
+
+bool TuningCache::Load() {
+  std::ifstream in(file_path_);
+  if (!in.is_open()) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    const size_t cpu_end = line.find('\t');
+    const size_t signature_end = line.rfind('\t');
+    if (line.empty() || cpu_end == std::string::npos || cpu_end == signature_end) {
+      LOG_IF(WARNING, !line.empty()) << "Skip the broken tuning cache line: " << line;
+      continue;
+    }
+    entries_[{line.substr(0, cpu_end), line.substr(cpu_end + 1, signature_end - cpu_end - 1)}] =
+        line.substr(signature_end + 1);
+  }
+  return true;
+}
+
+bool TuningCache::Save() const {
+  std::ofstream out(file_path_, std::ios::trunc);
+  if (!out.is_open()) {
+    LOG(ERROR) << "File open failed: " << file_path_;
+    return false;
+  }
+  for (const auto& [key, choice] : entries_) {
+    out << key.first << '\t' << key.second << '\t' << choice << '\n';
+  }
+  return out.good();
+}
+
+bool TuningCache::Find(const std::string& signature, std::string& choice) const {
+  const auto iter = entries_.find({cpu_key_, signature});
+  if (iter == entries_.end()) {
+    return false;
+  }
+  choice = iter->second;
+  return true;
+}
+
+void TuningCache::Insert(const std::string& signature, const std::string& choice) {
+  entries_[{cpu_key_, signature}] = choice;
+}
+}  // namespace kuiper_infer
@@ -0,0 +1,199 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "utils/cpu/cpu_features.hpp"
+#include <glog/logging.h>
+#include <cstdlib>
+#include <cstring>
+#if KUIPER_X86_DISPATCH
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace kuiper_infer {
+namespace utils {
+
+#if KUIPER_X86_DISPATCH
+static void CpuId(uint32_t leaf, uint32_t sub_leaf, uint32_t regs[4]) {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuidex(info, (int)leaf, (int)sub_leaf);
+  for (int i = 0; i < 4; ++i) {
+    regs[i] = (uint32_t)info[i];
+  }
+#else
+  if (!__get_cpuid_count(leaf, sub_leaf, &regs[0], &regs[1], &regs[2], &regs[3])) {
+    regs[0] = regs[1] = regs[2] = regs[3] = 0;
+  }
+#endif
+}
+
+static uint64_t XGetBv() {
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  uint32_t eax = 0;
+  uint32_t edx = 0;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static CpuFeatures DetectCpuFeatures() {
+  CpuFeatures features;
+  uint32_t regs[4];
+  CpuId(0, 0, regs);
+  const uint32_t max_leaf = regs[0];
+  if (max_leaf < 1) {
+    return features;
+  }
+
+  CpuId(1, 0, regs);
+  const uint32_t ecx1 = regs[2];
+  features.sse4_1 = ecx1 & (1u << 19);
+  features.sse4_2 = ecx1 & (1u << 20);
+  const bool osxsave = ecx1 & (1u << 27);
+
+  // 操作系统需要保存YMM和ZMM寄存器的状态, 否则不能使用AVX和AVX-512
+  const uint64_t xcr0 = osxsave ? XGetBv() : 0;
+  const bool os_avx = (xcr0 & 0x6) == 0x6;
+  const bool os_avx512 = os_avx && (xcr0 & 0xe0) == 0xe0;
+
+  features.avx = os_avx && (ecx1 & (1u << 28));
+  features.fma = features.avx && (ecx1 & (1u << 12));
+  features.f16c = features.avx && (ecx1 & (1u << 29));
+
+  if (max_leaf >= 7) {
+    CpuId(7, 0, regs);
+    const uint32_t ebx7 = regs[1];
+    features.avx2 = features.avx && (ebx7 & (1u << 5));
+    features.avx512f = os_avx512 && (ebx7 & (1u << 16));
+    features.avx512dq = features.avx512f && (ebx7 & (1u << 17));
+    features.avx512bw = features.avx512f && (ebx7 & (1u << 30));
+    features.avx512vl = features.avx512f && (ebx7 & (1u << 31));
+
+    CpuId(7, 1, regs);
+    features.avx512_bf16 = features.avx512f && (regs[0] & (1u << 5));
+  }
+
+  CpuId(0x80000000, 0, regs);
+  const uint32_t max_ext_leaf = regs[0];
+  if (max_ext_leaf >= 0x80000004) {
+    char brand[49] = {0};
+    for (uint32_t i = 0; i < 3; ++i) {
+      CpuId(0x80000002 + i, 0, regs);
+      std::memcpy(brand + i * 16, regs, 16);
+    }
+    features.brand = brand;
+    const size_t begin = features.brand.find_first_not_of(' ');
+    features.brand = begin == std::string::npos ? "" : features.brand.substr(begin);
+  }
+
+  if (max_ext_leaf >= 0x80000006) {
+    // ecx的高16位是每个核心的L2缓存大小, 单位为KB
+    CpuId(0x80000006, 0, regs);
+    features.l2_cache_size = (regs[2] >> 16) * 1024;
+  }
+  return features;
+}
+#else
+static CpuFeatures DetectCpuFeatures() { return CpuFeatures(); }
+#endif
+
+const CpuFeatures& GetCpuFeatures() {
+  static const CpuFeatures features = DetectCpuFeatures();
+  return features;
+}
+
+bool IsCpuIsaSupported(CpuIsa isa) {
+  const CpuFeatures& features = GetCpuFeatures();
+  switch (isa) {
+    case CpuIsa::kSSE4: {
+      return KUIPER_X86_DISPATCH != 0;
+    }
+    case CpuIsa::kAVX2: {
+      return features.avx2 && features.fma;
+    }
+    case CpuIsa::kAVX512: {
+      return features.avx512f && features.avx2 && features.fma;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+static CpuIsa DetectCpuIsa() {
+  CpuIsa isa = CpuIsa::kSSE4;
+  if (IsCpuIsaSupported(CpuIsa::kAVX512)) {
+    isa = CpuIsa::kAVX512;
+  } else if (IsCpuIsaSupported(CpuIsa::kAVX2)) {
+    isa = CpuIsa::kAVX2;
+  }
+
+  const char* env_isa = std::getenv("KUIPER_CPU_ISA");
+  if (env_isa != nullptr) {
+    CpuIsa max_isa = isa;
+    if (std::strcmp(env_isa, "sse4") == 0) {
+      max_isa = CpuIsa::kSSE4;
+    } else if (std::strcmp(env_isa, "avx2") == 0) {
+      max_isa = CpuIsa::kAVX2;
+    } else if (std::strcmp(env_isa, "avx512") == 0) {
+      max_isa = CpuIsa::kAVX512;
+    } else {
+      LOG(WARNING) << "Unknown KUIPER_CPU_ISA value: " << env_isa;
+    }
+    if (max_isa < isa) {
+      isa = max_isa;
+    }
+  }
+  LOG(INFO) << "SIMD kernels use " << CpuIsaName(isa) << " on " << GetCpuFeatures().brand;
+  return isa;
+}
+
+CpuIsa GetCpuIsa() {
+  static const CpuIsa isa = DetectCpuIsa();
+  return isa;
+}
+
+const char* CpuIsaName(CpuIsa isa) {
+  switch (isa) {
+    case CpuIsa::kSSE4: {
+      return "SSE4";
+    }
+    case CpuIsa::kAVX2: {
+      return "AVX2";
+    }
+    case CpuIsa::kAVX512: {
+      return "AVX-512";
+    }
+    default: {
+      return "Unknown";
+    }
+  }
+}
+
+}  // namespace utils
+}  // namespace kuiper_infer
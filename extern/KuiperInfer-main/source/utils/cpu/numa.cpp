@@ -0,0 +1,222 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "utils/cpu/numa.hpp"
+#include <glog/logging.h>
+#include <omp.h>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace kuiper_infer {
+namespace utils {
+
+#ifdef __linux__
+// linux/mempolicy.h中的常量, 不依赖libnuma
+static constexpr int kMpolBind = 2;
+static constexpr unsigned kMpolMfMove = 1u << 1;
+
+/**
+ * @brief Parses a CPU list such as "0-15,32-47"
+ */
+static std::vector<uint32_t> ParseCpuList(const std::string& cpu_list) {
+  std::vector<uint32_t> cpus;
+  std::stringstream ss(cpu_list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty() || item == "\n") {
+      continue;
+    }
+    const size_t dash = item.find('-');
+    const uint32_t first = std::stoul(item.substr(0, dash));
+    const uint32_t last = dash == std::string::npos ? first : std::stoul(item.substr(dash + 1));
+    for (uint32_t cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+static NumaTopology DetectNumaTopology() {
+  NumaTopology topology;
+  // 节点编号可能不连续, 依次尝试直到连续多个节点不存在
+  for (uint32_t node = 0, missing = 0; missing < 8; ++node) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (!file.is_open()) {
+      missing += 1;
+      continue;
+    }
+    missing = 0;
+    std::string cpu_list;
+    std::getline(file, cpu_list);
+    std::vector<uint32_t> cpus = ParseCpuList(cpu_list);
+    // 没有CPU的节点(例如只有内存的节点)不参与线程绑定
+    if (cpus.empty()) {
+      continue;
+    }
+    for (uint32_t cpu : cpus) {
+      if (cpu >= topology.cpu_nodes.size()) {
+        topology.cpu_nodes.resize(cpu + 1, -1);
+      }
+      topology.cpu_nodes.at(cpu) = int32_t(topology.node_cpus.size());
+    }
+    topology.node_ids.push_back(node);
+    topology.node_cpus.push_back(std::move(cpus));
+  }
+  return topology;
+}
+#else
+static NumaTopology DetectNumaTopology() { return NumaTopology(); }
+#endif
+
+const NumaTopology& GetNumaTopology() {
+  static const NumaTopology topology = [] {
+    NumaTopology topology = DetectNumaTopology();
+    if (topology.node_count() == 0) {
+      topology.node_ids.push_back(0);
+      topology.node_cpus.emplace_back();
+    }
+    return topology;
+  }();
+  return topology;
+}
+
+uint32_t GetCurrentNumaNode() {
+  const NumaTopology& topology = GetNumaTopology();
+  if (topology.node_count() <= 1) {
+    return 0;
+  }
+#ifdef __linux__
+  const int cpu = sched_getcpu();
+  if (cpu >= 0 && uint32_t(cpu) < topology.cpu_nodes.size() && topology.cpu_nodes.at(cpu) >= 0) {
+    return uint32_t(topology.cpu_nodes.at(cpu));
+  }
+#endif
+  return 0;
+}
+
+uint32_t NumaNodeOfThread(uint32_t thread_index) {
+  return thread_index % GetNumaTopology().node_count();
+}
+
+std::vector<uint32_t> GetAvailableCpus() {
+  std::vector<uint32_t> cpus;
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    return cpus;
+  }
+  // 同一节点的CPU相邻, 连续分组时每组尽量落在一个节点内
+  const NumaTopology& topology = GetNumaTopology();
+  std::vector<bool> added(CPU_SETSIZE, false);
+  for (const std::vector<uint32_t>& node_cpus : topology.node_cpus) {
+    for (uint32_t cpu : node_cpus) {
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &cpu_set) && !added.at(cpu)) {
+        cpus.push_back(cpu);
+        added.at(cpu) = true;
+      }
+    }
+  }
+  for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set) && !added.at(cpu)) {
+      cpus.push_back(cpu);
+    }
+  }
+#endif
+  return cpus;
+}
+
+bool BindThreadToCpus(const std::vector<uint32_t>& cpus) {
+#ifdef __linux__
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (uint32_t cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+  return sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0;
+#else
+  return false;
+#endif
+}
+
+bool BindThreadToNumaNode(uint32_t node) {
+  const NumaTopology& topology = GetNumaTopology();
+  CHECK_LT(node, topology.node_count());
+  return BindThreadToCpus(topology.node_cpus.at(node));
+}
+
+bool BindOmpThreadsToNumaNodes() {
+  if (GetNumaTopology().node_count() <= 1) {
+    return false;
+  }
+  std::atomic<bool> bound{true};
+#pragma omp parallel
+  {
+    if (!BindThreadToNumaNode(NumaNodeOfThread(omp_get_thread_num()))) {
+      bound = false;
+    }
+  }
+  LOG_IF(WARNING, !bound) << "Failed to bind the OpenMP threads to the NUMA nodes";
+  return bound;
+}
+
+bool MoveToNumaNode(void* ptr, size_t bytes, uint32_t node) {
+  const NumaTopology& topology = GetNumaTopology();
+  CHECK_LT(node, topology.node_count());
+  if (topology.node_count() <= 1 || ptr == nullptr) {
+    return true;
+  }
+#ifdef __linux__
+  // mbind要求起始地址按页对齐, 只移动范围内的完整页
+  const uintptr_t page_size = uintptr_t(sysconf(_SC_PAGESIZE));
+  const uintptr_t begin = (uintptr_t(ptr) + page_size - 1) / page_size * page_size;
+  const uintptr_t end = (uintptr_t(ptr) + bytes) / page_size * page_size;
+  if (begin >= end) {
+    return true;
+  }
+
+  // 节点掩码的第i位对应系统中编号为i的节点
+  const uint32_t node_id = topology.node_ids.at(node);
+  const uint32_t bits_per_mask = sizeof(unsigned long) * 8;
+  std::vector<unsigned long> node_mask(node_id / bits_per_mask + 1, 0);
+  node_mask.at(node_id / bits_per_mask) |= 1ul << (node_id % bits_per_mask);
+  const long result = syscall(SYS_mbind, reinterpret_cast<void*>(begin), end - begin, kMpolBind,
+                              node_mask.data(), node_mask.size() * bits_per_mask + 1, kMpolMfMove);
+  return result == 0;
+#else
+  return false;
+#endif
+}
+
+}  // namespace utils
+}  // namespace kuiper_infer
@@ -0,0 +1,308 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "utils/image/image_preprocess.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "utils/cpu/cpu_features.hpp"
+#if __SSE2__ || KUIPER_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace kuiper_infer {
+namespace utils {
+
+// 每次处理的输出行数, 与列优先存储的8x8转置对应
+static constexpr uint32_t kRowBlock = 8;
+
+static void ComputeResizeIndex(uint32_t src_size, uint32_t dst_size, std::vector<uint32_t>& index0,
+                               std::vector<uint32_t>& index1, std::vector<float>& alpha) {
+  index0.resize(dst_size);
+  index1.resize(dst_size);
+  alpha.resize(dst_size);
+  const float scale = (float)src_size / (float)dst_size;
+  for (uint32_t d = 0; d < dst_size; ++d) {
+    float src = ((float)d + 0.5f) * scale - 0.5f;
+    if (src < 0.f) {
+      src = 0.f;
+    }
+    uint32_t i0 = (uint32_t)src;
+    float a = src - (float)i0;
+    if (i0 >= src_size - 1) {
+      i0 = src_size - 1;
+      a = 0.f;
+    }
+    index0.at(d) = i0;
+    index1.at(d) = std::min(i0 + 1, src_size - 1);
+    alpha.at(d) = a;
+  }
+}
+
+static void ResizeRowHorizontal(const uint8_t* src_row, const std::vector<uint32_t>& x0,
+                                const std::vector<uint32_t>& x1, const std::vector<float>& fx,
+                                const uint32_t channel_map[3], uint32_t width, float* dst[3]) {
+  for (uint32_t x = 0; x < width; ++x) {
+    const uint8_t* p0 = src_row + x0[x] * 3;
+    const uint8_t* p1 = src_row + x1[x] * 3;
+    const float a = fx[x];
+    for (uint32_t c = 0; c < 3; ++c) {
+      const float v0 = p0[channel_map[c]];
+      const float v1 = p1[channel_map[c]];
+      dst[c][x] = v0 + a * (v1 - v0);
+    }
+  }
+}
+
+#if KUIPER_X86_DISPATCH
+KUIPER_TARGET_AVX2 static uint32_t BlendRowVerticalAVX2(const float* row0, const float* row1,
+                                                        float fy, float a, float b,
+                                                        uint32_t width, float* dst) {
+  uint32_t x = 0;
+  const __m256 fy_vec = _mm256_set1_ps(fy);
+  const __m256 a_vec = _mm256_set1_ps(a);
+  const __m256 b_vec = _mm256_set1_ps(b);
+  for (; x + 7 < width; x += 8) {
+    const __m256 v0 = _mm256_loadu_ps(row0 + x);
+    const __m256 v1 = _mm256_loadu_ps(row1 + x);
+    const __m256 v = _mm256_fmadd_ps(fy_vec, _mm256_sub_ps(v1, v0), v0);
+    _mm256_storeu_ps(dst + x, _mm256_fmadd_ps(v, a_vec, b_vec));
+  }
+  return x;
+}
+#endif
+
+static void BlendRowVertical(const float* row0, const float* row1, float fy, float a, float b,
+                             uint32_t width, float* dst, bool use_avx2) {
+  uint32_t x = 0;
+#if KUIPER_X86_DISPATCH
+  if (use_avx2) {
+    x = BlendRowVerticalAVX2(row0, row1, fy, a, b, width, dst);
+  }
+#endif
+#if __SSE2__
+  const __m128 fy_vec = _mm_set1_ps(fy);
+  const __m128 a_vec = _mm_set1_ps(a);
+  const __m128 b_vec = _mm_set1_ps(b);
+  for (; x + 3 < width; x += 4) {
+    const __m128 v0 = _mm_loadu_ps(row0 + x);
+    const __m128 v1 = _mm_loadu_ps(row1 + x);
+    const __m128 v = _mm_add_ps(v0, _mm_mul_ps(fy_vec, _mm_sub_ps(v1, v0)));
+    _mm_storeu_ps(dst + x, _mm_add_ps(_mm_mul_ps(v, a_vec), b_vec));
+  }
+#endif
+  for (; x < width; ++x) {
+    const float v = row0[x] + fy * (row1[x] - row0[x]);
+    dst[x] = v * a + b;
+  }
+}
+
+#if KUIPER_X86_DISPATCH
+// 8x8转置后写入, 返回已经处理的列数
+KUIPER_TARGET_AVX2 static uint32_t StoreBlockColMajorAVX2(const float* block, uint32_t width,
+                                                          float* dst, uint32_t dst_stride) {
+  uint32_t x = 0;
+  for (; x + 7 < width; x += 8) {
+    __m256 r0 = _mm256_loadu_ps(block + 0 * width + x);
+    __m256 r1 = _mm256_loadu_ps(block + 1 * width + x);
+    __m256 r2 = _mm256_loadu_ps(block + 2 * width + x);
+    __m256 r3 = _mm256_loadu_ps(block + 3 * width + x);
+    __m256 r4 = _mm256_loadu_ps(block + 4 * width + x);
+    __m256 r5 = _mm256_loadu_ps(block + 5 * width + x);
+    __m256 r6 = _mm256_loadu_ps(block + 6 * width + x);
+    __m256 r7 = _mm256_loadu_ps(block + 7 * width + x);
+
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    const __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    const __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    const __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    const __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+    const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    r0 = _mm256_permute2f128_ps(s0, s4, 0x20);
+    r1 = _mm256_permute2f128_ps(s1, s5, 0x20);
+    r2 = _mm256_permute2f128_ps(s2, s6, 0x20);
+    r3 = _mm256_permute2f128_ps(s3, s7, 0x20);
+    r4 = _mm256_permute2f128_ps(s0, s4, 0x31);
+    r5 = _mm256_permute2f128_ps(s1, s5, 0x31);
+    r6 = _mm256_permute2f128_ps(s2, s6, 0x31);
+    r7 = _mm256_permute2f128_ps(s3, s7, 0x31);
+
+    float* out = dst + (size_t)x * dst_stride;
+    _mm256_storeu_ps(out + 0 * (size_t)dst_stride, r0);
+    _mm256_storeu_ps(out + 1 * (size_t)dst_stride, r1);
+    _mm256_storeu_ps(out + 2 * (size_t)dst_stride, r2);
+    _mm256_storeu_ps(out + 3 * (size_t)dst_stride, r3);
+    _mm256_storeu_ps(out + 4 * (size_t)dst_stride, r4);
+    _mm256_storeu_ps(out + 5 * (size_t)dst_stride, r5);
+    _mm256_storeu_ps(out + 6 * (size_t)dst_stride, r6);
+    _mm256_storeu_ps(out + 7 * (size_t)dst_stride, r7);
+  }
+  return x;
+}
+#endif
+
+/**
+ * 将行优先的块(rows行, 每行width个元素, 行间距为width)写入列优先的通道,
+ * dst指向块左上角, dst_stride为输出相邻两列之间的距离
+ */
+static void StoreBlockColMajor(const float* block, uint32_t rows, uint32_t width, float* dst,
+                               uint32_t dst_stride, bool use_avx2) {
+  uint32_t x = 0;
+#if KUIPER_X86_DISPATCH
+  if (use_avx2 && rows == kRowBlock) {
+    x = StoreBlockColMajorAVX2(block, width, dst, dst_stride);
+  }
+#endif
+  for (; x < width; ++x) {
+    float* out = dst + (size_t)x * dst_stride;
+    for (uint32_t y = 0; y < rows; ++y) {
+      out[y] = block[y * width + x];
+    }
+  }
+}
+
+LetterboxInfo ImagePreprocess(const uint8_t* image, uint32_t image_h, uint32_t image_w,
+                              size_t image_step, const ImagePreprocessParam& param,
+                              const sftensor& output) {
+  CHECK(image != nullptr) << "The input image of the preprocess is empty";
+  CHECK(image_h > 0 && image_w > 0) << "The input image of the preprocess is empty";
+  CHECK(image_step >= (size_t)image_w * 3) << "The row step of the input image is too small";
+  CHECK(output != nullptr && !output->empty()) << "The output tensor of the preprocess is empty";
+  CHECK_EQ(output->channels(), 3) << "The output tensor of the preprocess should have 3 channels";
+
+  const uint32_t target_h = output->rows();
+  const uint32_t target_w = output->cols();
+
+  LetterboxInfo info;
+  if (param.letterbox) {
+    float r = std::min((float)target_h / (float)image_h, (float)target_w / (float)image_w);
+    if (!param.scale_up) {
+      r = std::min(r, 1.0f);
+    }
+    info.resized_w = std::max(1u, (uint32_t)std::round((float)image_w * r));
+    info.resized_h = std::max(1u, (uint32_t)std::round((float)image_h * r));
+    info.resized_w = std::min(info.resized_w, target_w);
+    info.resized_h = std::min(info.resized_h, target_h);
+
+    const float dw = (float)(target_w - info.resized_w) / 2.0f;
+    const float dh = (float)(target_h - info.resized_h) / 2.0f;
+    info.pad_top = (uint32_t)std::round(dh - 0.1f);
+    info.pad_left = (uint32_t)std::round(dw - 0.1f);
+    info.ratio = 1.0f / r;
+  } else {
+    info.resized_w = target_w;
+    info.resized_h = target_h;
+  }
+
+  const uint32_t resized_h = info.resized_h;
+  const uint32_t resized_w = info.resized_w;
+  const uint32_t top = info.pad_top;
+  const uint32_t left = info.pad_left;
+
+  // 输出通道c读取输入通道channel_map[c], 并计算 v * alpha[c] + beta[c]
+  uint32_t channel_map[3];
+  float alpha[3];
+  float beta[3];
+  for (uint32_t c = 0; c < 3; ++c) {
+    channel_map[c] = param.bgr_to_rgb ? 2 - c : c;
+    CHECK(param.std.at(c) != 0.f) << "The std of the preprocess can not be zero";
+    alpha[c] = param.scale / param.std.at(c);
+    beta[c] = -param.mean.at(c) / param.std.at(c);
+  }
+
+  // 填充letterbox的边框, 每一列在列优先存储中是连续的
+  for (uint32_t c = 0; c < 3; ++c) {
+    const float pad = param.pad_value * alpha[c] + beta[c];
+    float* channel_ptr = output->matrix_raw_ptr(c);
+    for (uint32_t x = 0; x < target_w; ++x) {
+      float* col_ptr = channel_ptr + (size_t)x * target_h;
+      if (x < left || x >= left + resized_w) {
+        std::fill(col_ptr, col_ptr + target_h, pad);
+      } else {
+        std::fill(col_ptr, col_ptr + top, pad);
+        std::fill(col_ptr + top + resized_h, col_ptr + target_h, pad);
+      }
+    }
+  }
+
+  std::vector<uint32_t> x0, x1, y0, y1;
+  std::vector<float> fx, fy;
+  ComputeResizeIndex(image_w, resized_w, x0, x1, fx);
+  ComputeResizeIndex(image_h, resized_h, y0, y1, fy);
+
+  const bool use_avx2 = GetCpuIsa() >= CpuIsa::kAVX2;
+  const int32_t block_count = (int32_t)((resized_h + kRowBlock - 1) / kRowBlock);
+#pragma omp parallel
+  {
+    std::vector<float> row_buffer(6 * (size_t)resized_w);
+    std::vector<float> block_buffer(3 * kRowBlock * (size_t)resized_w);
+    float* row0[3];
+    float* row1[3];
+    for (uint32_t c = 0; c < 3; ++c) {
+      row0[c] = row_buffer.data() + c * (size_t)resized_w;
+      row1[c] = row_buffer.data() + (3 + c) * (size_t)resized_w;
+    }
+
+#pragma omp for schedule(static)
+    for (int32_t block = 0; block < block_count; ++block) {
+      const uint32_t y_begin = block * kRowBlock;
+      const uint32_t rows = std::min(kRowBlock, resized_h - y_begin);
+      for (uint32_t i = 0; i < rows; ++i) {
+        const uint32_t y = y_begin + i;
+        ResizeRowHorizontal(image + y0[y] * image_step, x0, x1, fx, channel_map, resized_w, row0);
+        const float* const* blend_row1 = row0;
+        if (y1[y] != y0[y] && fy[y] != 0.f) {
+          ResizeRowHorizontal(image + y1[y] * image_step, x0, x1, fx, channel_map, resized_w,
+                              row1);
+          blend_row1 = row1;
+        }
+        for (uint32_t c = 0; c < 3; ++c) {
+          float* block_row = block_buffer.data() + (c * kRowBlock + i) * (size_t)resized_w;
+          BlendRowVertical(row0[c], blend_row1[c], fy[y], alpha[c], beta[c], resized_w, block_row,
+                           use_avx2);
+        }
+      }
+
+      for (uint32_t c = 0; c < 3; ++c) {
+        float* dst = output->matrix_raw_ptr(c) + (size_t)left * target_h + top + y_begin;
+        StoreBlockColMajor(block_buffer.data() + c * kRowBlock * (size_t)resized_w, rows,
+                           resized_w, dst, target_h, use_avx2);
+      }
+    }
+  }
+  return info;
+}
+
+}  // namespace utils
+}  // namespace kuiper_infer
@@ -0,0 +1,133 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+#include "data/tensor.hpp"
+#include "utils/image/image_preprocess.hpp"
+
+static std::vector<uint8_t> MakeImage(uint32_t h, uint32_t w) {
+  std::vector<uint8_t> image(h * w * 3);
+  for (uint32_t i = 0; i < image.size(); ++i) {
+    image.at(i) = (uint8_t)((i * 37 + 11) % 256);
+  }
+  return image;
+}
+
+static float BilinearAt(const std::vector<uint8_t>& image, uint32_t h, uint32_t w, uint32_t rh,
+                        uint32_t rw, uint32_t y, uint32_t x, uint32_t c) {
+  auto coord = [](uint32_t d, uint32_t src, uint32_t dst, uint32_t& i0, uint32_t& i1, float& a) {
+    float s = ((float)d + 0.5f) * (float)src / (float)dst - 0.5f;
+    s = std::max(s, 0.f);
+    i0 = std::min((uint32_t)s, src - 1);
+    i1 = std::min(i0 + 1, src - 1);
+    a = i0 == src - 1 ? 0.f : s - (float)i0;
+  };
+  uint32_t y0, y1, x0, x1;
+  float fy, fx;
+  coord(y, h, rh, y0, y1, fy);
+  coord(x, w, rw, x0, x1, fx);
+  auto pixel = [&](uint32_t yy, uint32_t xx) { return (float)image.at((yy * w + xx) * 3 + c); };
+  const float top = pixel(y0, x0) + fx * (pixel(y0, x1) - pixel(y0, x0));
+  const float bottom = pixel(y1, x0) + fx * (pixel(y1, x1) - pixel(y1, x0));
+  return top + fy * (bottom - top);
+}
+
+TEST(test_image_preprocess, same_size) {
+  using namespace kuiper_infer;
+  const uint32_t h = 13;
+  const uint32_t w = 21;
+  const std::vector<uint8_t>& image = MakeImage(h, w);
+
+  sftensor output = std::make_shared<ftensor>(3, h, w);
+  utils::ImagePreprocessParam param;
+  const utils::LetterboxInfo& info =
+      utils::ImagePreprocess(image.data(), h, w, w * 3, param, output);
+  ASSERT_EQ(info.pad_top, 0);
+  ASSERT_EQ(info.pad_left, 0);
+  ASSERT_EQ(info.resized_h, h);
+  ASSERT_EQ(info.resized_w, w);
+
+  for (uint32_t c = 0; c < 3; ++c) {
+    for (uint32_t y = 0; y < h; ++y) {
+      for (uint32_t x = 0; x < w; ++x) {
+        const float expected = (float)image.at((y * w + x) * 3 + 2 - c) / 255.f;
+        ASSERT_NEAR(output->at(c, y, x), expected, 1e-5f);
+      }
+    }
+  }
+}
+
+TEST(test_image_preprocess, letterbox_pad) {
+  using namespace kuiper_infer;
+  const uint32_t h = 8;
+  const uint32_t w = 16;
+  const std::vector<uint8_t>& image = MakeImage(h, w);
+
+  sftensor output = std::make_shared<ftensor>(3, 16, 16);
+  utils::ImagePreprocessParam param;
+  param.bgr_to_rgb = false;
+  const utils::LetterboxInfo& info =
+      utils::ImagePreprocess(image.data(), h, w, w * 3, param, output);
+  ASSERT_EQ(info.pad_top, 4);
+  ASSERT_EQ(info.pad_left, 0);
+
+  for (uint32_t c = 0; c < 3; ++c) {
+    for (uint32_t y = 0; y < 16; ++y) {
+      for (uint32_t x = 0; x < 16; ++x) {
+        if (y < 4 || y >= 12) {
+          ASSERT_NEAR(output->at(c, y, x), 114.f / 255.f, 1e-5f);
+        } else {
+          const float expected = (float)image.at(((y - 4) * w + x) * 3 + c) / 255.f;
+          ASSERT_NEAR(output->at(c, y, x), expected, 1e-5f);
+        }
+      }
+    }
+  }
+}
+
+TEST(test_image_preprocess, resize_normalize) {
+  using namespace kuiper_infer;
+  const uint32_t h = 45;
+  const uint32_t w = 71;
+  const uint32_t target_h = 32;
+  const uint32_t target_w = 24;
+  const std::vector<uint8_t>& image = MakeImage(h, w);
+
+  sftensor output = std::make_shared<ftensor>(3, target_h, target_w);
+  utils::ImagePreprocessParam param;
+  param.letterbox = false;
+  param.mean = {0.485f, 0.456f, 0.406f};
+  param.std = {0.229f, 0.224f, 0.225f};
+  utils::ImagePreprocess(image.data(), h, w, w * 3, param, output);
+
+  for (uint32_t c = 0; c < 3; ++c) {
+    for (uint32_t y = 0; y < target_h; ++y) {
+      for (uint32_t x = 0; x < target_w; ++x) {
+        const float pixel = BilinearAt(image, h, w, target_h, target_w, y, x, 2 - c);
+        const float expected = (pixel / 255.f - param.mean.at(c)) / param.std.at(c);
+        ASSERT_NEAR(output->at(c, y, x), expected, 1e-4f);
+      }
+    }
+  }
+}
@@ -574,6 +574,53 @@ TEST(test_tensor, add6) {
   }
 }
 
+TEST(test_tensor, broadcast_stride) {
+  using namespace kuiper_infer;
+  // 每个维度分别为1时按步长0读取, 尺寸不是向量宽度的整数倍
+  const std::vector<std::vector<uint32_t>> shapes2 = {
+      {3, 1, 1}, {1, 13, 11}, {3, 13, 1}, {3, 1, 11}, {1, 1, 11}, {1, 1, 1}};
+  const auto& f1 = std::make_shared<Tensor<float>>(3, 13, 11);
+  for (uint32_t i = 0; i < f1->size(); ++i) {
+    f1->index(i) = float(i % 17) - 8.f;
+  }
+  for (const auto& shape2 : shapes2) {
+    const auto& f2 = std::make_shared<Tensor<float>>(shape2.at(0), shape2.at(1), shape2.at(2));
+    for (uint32_t i = 0; i < f2->size(); ++i) {
+      f2->index(i) = float(i % 5) + 0.5f;
+    }
+    const auto& f3 = TensorElementAdd(f2, f1);
+    const auto& f4 = TensorElementMultiply(f1, f2);
+    ASSERT_EQ(f3->shapes(), f1->shapes());
+    ASSERT_EQ(f4->shapes(), f1->shapes());
+    for (uint32_t c = 0; c < 3; ++c) {
+      for (uint32_t r = 0; r < 13; ++r) {
+        for (uint32_t w = 0; w < 11; ++w) {
+          const float value2 = f2->at(shape2.at(0) == 1 ? 0 : c, shape2.at(1) == 1 ? 0 : r,
+                                      shape2.at(2) == 1 ? 0 : w);
+          ASSERT_EQ(f3->at(c, r, w), f1->at(c, r, w) + value2);
+          ASSERT_EQ(f4->at(c, r, w), f1->at(c, r, w) * value2);
+        }
+      }
+    }
+  }
+}
+
+TEST(test_tensor, broadcast_inplace) {
+  using namespace kuiper_infer;
+  const auto& f1 = std::make_shared<Tensor<float>>(4, 7, 9);
+  f1->Fill(3.f);
+  const auto& f2 = std::make_shared<Tensor<float>>(4, 1, 1);
+  for (uint32_t c = 0; c < 4; ++c) {
+    f2->index(c) = float(c);
+  }
+  TensorElementMultiply(f1, f2, f1);
+  for (uint32_t c = 0; c < 4; ++c) {
+    for (uint32_t i = 0; i < 7 * 9; ++i) {
+      ASSERT_EQ(f1->index(c * 7 * 9 + i), 3.f * float(c));
+    }
+  }
+}
+
 TEST(test_tensor, shapes) {
   using namespace kuiper_infer;
   Tensor<float> f3(2, 3, 4);
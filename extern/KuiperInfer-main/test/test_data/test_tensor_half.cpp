@@ -0,0 +1,116 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "data/tensor_half.hpp"
+
+static uint32_t FloatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+TEST(test_tensor_half, fp16_special_values) {
+  using namespace kuiper_infer;
+  const float inf = std::numeric_limits<float>::infinity();
+  // 65520是最大半精度数65504和无穷大的中点, 舍入到偶数得到无穷大
+  const std::vector<float> values{0.f,   -0.f, 1.f,  -2.5f,          65504.f,           65520.f,
+                                  1e-8f, inf,  -inf, 5.96046448e-8f, 1.f + 1.f / 2048.f};
+  const std::vector<uint16_t> expected{0x0000, 0x8000, 0x3c00, 0xc100, 0x7bff, 0x7c00,
+                                       0x0000, 0x7c00, 0xfc00, 0x0001, 0x3c00};
+  std::vector<uint16_t> halves(values.size());
+  FloatToHalfSpan(values.data(), halves.data(), values.size(), ActivationPrecision::kFP16);
+  for (uint32_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(halves.at(i), expected.at(i)) << values.at(i);
+  }
+
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  uint16_t nan_half = 0;
+  FloatToHalfSpan(&nan, &nan_half, 1, ActivationPrecision::kFP16);
+  float nan_float = 0.f;
+  HalfToFloatSpan(&nan_half, &nan_float, 1, ActivationPrecision::kFP16);
+  ASSERT_TRUE(std::isnan(nan_float));
+}
+
+TEST(test_tensor_half, bf16_rounding) {
+  using namespace kuiper_infer;
+  // 1 + 2^-8正好在两个bfloat16之间, 舍入到偶数; 再加一点则向上舍入
+  const std::vector<float> values{1.f, 1.f + 1.f / 256.f, 1.f + 3.f / 256.f,
+                                  1.f + 1.f / 256.f + 1.f / 65536.f, -3.f};
+  const std::vector<uint16_t> expected{0x3f80, 0x3f80, 0x3f82, 0x3f81, 0xc040};
+  std::vector<uint16_t> halves(values.size());
+  FloatToHalfSpan(values.data(), halves.data(), values.size(), ActivationPrecision::kBF16);
+  for (uint32_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(halves.at(i), expected.at(i)) << values.at(i);
+  }
+}
+
+TEST(test_tensor_half, simd_matches_scalar) {
+  using namespace kuiper_infer;
+  // 随机的位模式覆盖非规格化数, 无穷大和NaN, 长度不是向量宽度的整数倍
+  const uint32_t size = 4099;
+  std::vector<float> values(size);
+  uint32_t state = 12345;
+  for (float& value : values) {
+    state = state * 1664525u + 1013904223u;
+    std::memcpy(&value, &state, sizeof(value));
+  }
+
+  for (ActivationPrecision precision : {ActivationPrecision::kFP16, ActivationPrecision::kBF16}) {
+    std::vector<uint16_t> halves(size);
+    FloatToHalfSpan(values.data(), halves.data(), size, precision);
+    std::vector<float> floats(size);
+    HalfToFloatSpan(halves.data(), floats.data(), size, precision);
+    for (uint32_t i = 0; i < size; ++i) {
+      // 单个元素只走标量路径
+      uint16_t half = 0;
+      FloatToHalfSpan(values.data() + i, &half, 1, precision);
+      ASSERT_EQ(halves.at(i), half) << i;
+      float value = 0.f;
+      HalfToFloatSpan(&half, &value, 1, precision);
+      ASSERT_EQ(FloatBits(floats.at(i)), FloatBits(value)) << i;
+    }
+  }
+}
+
+TEST(test_tensor_half, pack_unpack) {
+  using namespace kuiper_infer;
+  auto tensor = std::make_shared<ftensor>(3, 17, 33);
+  tensor->RandN();
+  for (ActivationPrecision precision : {ActivationPrecision::kFP16, ActivationPrecision::kBF16}) {
+    HalfTensor half_tensor;
+    half_tensor.Pack(tensor, precision);
+    ASSERT_EQ(half_tensor.shapes(), tensor->shapes());
+    ASSERT_EQ(half_tensor.bytes(), tensor->size() * sizeof(uint16_t));
+
+    auto unpacked = std::make_shared<ftensor>(3, 17, 33);
+    half_tensor.Unpack(unpacked);
+    const float relative_error =
+        precision == ActivationPrecision::kFP16 ? 1.f / 2048.f : 1.f / 256.f;
+    for (uint32_t i = 0; i < tensor->size(); ++i) {
+      ASSERT_NEAR(unpacked->index(i), tensor->index(i),
+                  std::abs(tensor->index(i)) * relative_error + 1e-7f);
+    }
+  }
+}
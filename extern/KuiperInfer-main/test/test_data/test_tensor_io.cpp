@@ -0,0 +1,106 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include "data/tensor_io.hpp"
+
+static const std::string kTensorIODir = "./tmp/tensor_io";
+
+TEST(test_tensor_io, npy_round_trip) {
+  using namespace kuiper_infer;
+  std::filesystem::create_directories(kTensorIODir);
+  const std::vector<std::vector<uint32_t>> shapes_list = {
+      {7}, {5, 9}, {1, 9}, {3, 4, 6}, {4, 1, 8}, {2, 5, 1}};
+  for (const auto& shapes : shapes_list) {
+    auto tensor = std::make_shared<ftensor>(shapes);
+    tensor->RandN();
+    const std::string file_path = kTensorIODir + "/round_trip.npy";
+    ASSERT_TRUE(TensorSaveNpy(tensor, file_path));
+
+    for (bool zero_copy : {true, false}) {
+      const auto& loaded = TensorLoadNpy<float>(file_path, zero_copy);
+      ASSERT_NE(loaded, nullptr);
+      ASSERT_EQ(loaded->raw_shapes(), tensor->raw_shapes());
+      ASSERT_EQ(loaded->shapes(), tensor->shapes());
+      for (uint32_t i = 0; i < tensor->size(); ++i) {
+        ASSERT_EQ(loaded->index(i), tensor->index(i));
+      }
+    }
+  }
+}
+
+TEST(test_tensor_io, npy_c_order) {
+  using namespace kuiper_infer;
+  std::filesystem::create_directories(kTensorIODir);
+  // numpy.arange(24, dtype=numpy.int32).reshape(2, 3, 4)
+  std::string dict = "{'descr': '<i4', 'fortran_order': False, 'shape': (2, 3, 4), }";
+  dict.append(64 - 10 - dict.size() - 1, ' ');
+  dict += '\n';
+  const std::string file_path = kTensorIODir + "/arange.npy";
+  {
+    std::ofstream out(file_path, std::ios::binary);
+    out.write("\x93NUMPY\x01\x00", 8);
+    out.put(char(dict.size()));
+    out.put(char(0));
+    out.write(dict.data(), dict.size());
+    for (int32_t i = 0; i < 24; ++i) {
+      out.write(reinterpret_cast<const char*>(&i), sizeof(i));
+    }
+  }
+
+  const auto& tensor = TensorLoadNpy<int32_t>(file_path);
+  ASSERT_NE(tensor, nullptr);
+  ASSERT_EQ(tensor->shapes(), std::vector<uint32_t>({2, 3, 4}));
+  for (uint32_t c = 0; c < 2; ++c) {
+    for (uint32_t h = 0; h < 3; ++h) {
+      for (uint32_t w = 0; w < 4; ++w) {
+        ASSERT_EQ(tensor->at(c, h, w), int32_t(c * 12 + h * 4 + w));
+      }
+    }
+  }
+}
+
+TEST(test_tensor_io, raw_zero_copy) {
+  using namespace kuiper_infer;
+  std::filesystem::create_directories(kTensorIODir);
+  auto tensor = std::make_shared<ftensor>(3, 17, 19);
+  tensor->RandN();
+  const std::string file_path = kTensorIODir + "/tensor.raw";
+  ASSERT_TRUE(TensorSaveRaw(tensor, file_path));
+  ASSERT_EQ(std::filesystem::file_size(file_path), tensor->size() * sizeof(float));
+
+  auto loaded = TensorLoadRaw<float>(file_path, {3, 17, 19});
+  ASSERT_NE(loaded, nullptr);
+  ASSERT_EQ(loaded->shapes(), tensor->shapes());
+  for (uint32_t i = 0; i < tensor->size(); ++i) {
+    ASSERT_EQ(loaded->index(i), tensor->index(i));
+  }
+
+  // 映射是私有的, 修改张量不会改变文件
+  loaded->Fill(0.f);
+  const auto& reloaded = TensorLoadRaw<float>(file_path, {3, 17, 19}, false);
+  for (uint32_t i = 0; i < tensor->size(); ++i) {
+    ASSERT_EQ(reloaded->index(i), tensor->index(i));
+  }
+  ASSERT_EQ(TensorLoadRaw<float>(kTensorIODir + "/missing.raw", {1}), nullptr);
+}
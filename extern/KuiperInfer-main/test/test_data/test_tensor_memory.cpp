@@ -0,0 +1,115 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <thread>
+#include "data/tensor.hpp"
+#include "data/tensor_memory.hpp"
+#include "data/tensor_util.hpp"
+
+TEST(test_tensor_memory, size_class) {
+  using namespace kuiper_infer;
+  size_t last_bytes = 0;
+  for (size_t bytes = 1; bytes < (1 << 20); bytes = bytes * 5 / 4 + 1) {
+    const uint32_t size_class = PooledMemoryResource::SizeClass(bytes);
+    const size_t class_bytes = PooledMemoryResource::SizeClassBytes(size_class);
+    ASSERT_GE(class_bytes, bytes);
+    ASSERT_LE(class_bytes, std::max(bytes * 5 / 4 + 64, (size_t)64) + 64);
+    ASSERT_EQ(class_bytes % TensorMemoryResource::kAlignment, 0);
+    ASSERT_GE(class_bytes, last_bytes);
+    last_bytes = class_bytes;
+  }
+  for (uint32_t size_class = 0; size_class < 64; ++size_class) {
+    const size_t class_bytes = PooledMemoryResource::SizeClassBytes(size_class);
+    ASSERT_EQ(PooledMemoryResource::SizeClass(class_bytes), size_class);
+  }
+}
+
+TEST(test_tensor_memory, pool_reuse) {
+  using namespace kuiper_infer;
+  PooledMemoryResource resource;
+  void* ptr1 = resource.Allocate(1000);
+  ASSERT_EQ((size_t)ptr1 % TensorMemoryResource::kAlignment, 0);
+  resource.Deallocate(ptr1, 1000);
+
+  void* ptr2 = resource.Allocate(990);
+  ASSERT_EQ(ptr1, ptr2);
+  resource.Deallocate(ptr2, 990);
+
+  const TensorMemoryStatistics& statistics = resource.statistics();
+  ASSERT_EQ(statistics.allocate_count, 2);
+  ASSERT_EQ(statistics.deallocate_count, 2);
+  ASSERT_EQ(statistics.pool_hit_count, 1);
+  ASSERT_EQ(statistics.system_allocate_count, 1);
+  ASSERT_EQ(statistics.bytes_in_use, 0);
+  ASSERT_EQ(statistics.bytes_cached, PooledMemoryResource::SizeClassBytes(
+                                         PooledMemoryResource::SizeClass(1000)));
+
+  resource.Trim();
+  ASSERT_EQ(resource.statistics().bytes_cached, 0);
+  ASSERT_EQ(resource.statistics().system_free_count, 1);
+}
+
+TEST(test_tensor_memory, pool_cross_thread) {
+  using namespace kuiper_infer;
+  PooledMemoryResource resource;
+  std::vector<void*> blocks;
+  for (uint32_t i = 0; i < 32; ++i) {
+    blocks.push_back(resource.Allocate(4096));
+  }
+  std::thread thread([&]() {
+    for (void* block : blocks) {
+      resource.Deallocate(block, 4096);
+    }
+  });
+  thread.join();
+
+  for (uint32_t i = 0; i < 32; ++i) {
+    blocks.at(i) = resource.Allocate(4096);
+  }
+  ASSERT_EQ(resource.statistics().system_allocate_count, 32);
+  for (void* block : blocks) {
+    resource.Deallocate(block, 4096);
+  }
+}
+
+TEST(test_tensor_memory, tensor_steady_state) {
+  using namespace kuiper_infer;
+  auto resource = std::make_shared<PooledMemoryResource>();
+  SetTensorMemoryResource(resource);
+  for (uint32_t i = 0; i < 8; ++i) {
+    sftensor tensor1 = TensorCreate<float>(3, 224, 224);
+    sftensor tensor2 = TensorCreate<float>(64, 56, 56);
+    ASSERT_EQ((size_t)tensor1->raw_ptr() % TensorMemoryResource::kAlignment, 0);
+    ASSERT_EQ((size_t)tensor2->raw_ptr() % TensorMemoryResource::kAlignment, 0);
+    ASSERT_EQ(tensor1->index(0), 0.f);
+
+    tensor1->Fill(1.f);
+    sftensor tensor3 = TensorClone(tensor1);
+    ASSERT_NE(tensor1->raw_ptr(), tensor3->raw_ptr());
+    ASSERT_EQ(tensor3->index(3 * 224 * 224 - 1), 1.f);
+  }
+  const TensorMemoryStatistics& statistics = resource->statistics();
+  ASSERT_EQ(statistics.system_allocate_count, 3);
+  ASSERT_EQ(statistics.bytes_in_use, 0);
+  SetTensorMemoryResource(nullptr);
+}
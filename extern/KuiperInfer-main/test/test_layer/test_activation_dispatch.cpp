@@ -0,0 +1,91 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include "../../source/layer/details/activation_sse.hpp"
+#include "data/tensor.hpp"
+#include "utils/cpu/cpu_features.hpp"
+
+using namespace kuiper_infer;
+
+static float ActivationReference(activation::ActivationType act_type, float x) {
+  switch (act_type) {
+    case activation::ActivationType::kActivationRelu:
+      return std::max(x, 0.f);
+    case activation::ActivationType::kActivationSigmoid:
+      return 1.f / (1.f + std::exp(-x));
+    case activation::ActivationType::kActivationSilu:
+      return x / (1.f + std::exp(-x));
+    case activation::ActivationType::kActivationHardSwish:
+      return x <= -3.f ? 0.f : (x >= 3.f ? x : x * (x + 3.f) / 6.f);
+    case activation::ActivationType::kActivationHardSigmoid:
+      return x <= -3.f ? 0.f : (x >= 3.f ? 1.f : x / 6.f + 0.5f);
+    default:
+      return 0.f;
+  }
+}
+
+TEST(test_layer, activation_dispatch_isa) {
+  const std::vector<activation::ActivationType> act_types = {
+      activation::ActivationType::kActivationRelu,
+      activation::ActivationType::kActivationSigmoid,
+      activation::ActivationType::kActivationSilu,
+      activation::ActivationType::kActivationHardSwish,
+      activation::ActivationType::kActivationHardSigmoid};
+  const std::vector<utils::CpuIsa> isas = {utils::CpuIsa::kSSE4, utils::CpuIsa::kAVX2,
+                                           utils::CpuIsa::kAVX512};
+
+  // 元素个数不是向量宽度的整数倍, 覆盖末尾的标量或掩码处理
+  sftensor input = std::make_shared<ftensor>(3, 17, 19);
+  const uint32_t size = input->size();
+  for (uint32_t i = 0; i < size; ++i) {
+    input->index(i) = -8.f + 16.f * float(i) / float(size);
+  }
+
+  for (utils::CpuIsa isa : isas) {
+    if (!utils::IsCpuIsaSupported(isa)) {
+      LOG(INFO) << "Skip the unsupported instruction set " << utils::CpuIsaName(isa);
+      continue;
+    }
+    for (activation::ActivationType act_type : act_types) {
+      sftensor output = std::make_shared<ftensor>(3, 17, 19);
+      activation::ApplySSEActivation(act_type, isa)(input, output);
+      for (uint32_t i = 0; i < size; ++i) {
+        const float expected = ActivationReference(act_type, input->index(i));
+        ASSERT_NEAR(output->index(i), expected, 1e-5f + 1e-5f * std::abs(expected))
+            << utils::CpuIsaName(isa) << " activation " << int(act_type) << " at " << i;
+      }
+    }
+  }
+}
+
+TEST(test_layer, activation_dispatch_inplace) {
+  sftensor input = std::make_shared<ftensor>(1, 5, 7);
+  for (uint32_t i = 0; i < input->size(); ++i) {
+    input->index(i) = float(i) - 17.f;
+  }
+  activation::ApplySSEActivation(activation::ActivationType::kActivationRelu)(input, input);
+  for (uint32_t i = 0; i < input->size(); ++i) {
+    ASSERT_EQ(input->index(i), std::max(float(i) - 17.f, 0.f));
+  }
+}
@@ -0,0 +1,224 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include "../../source/layer/details/attention.hpp"
+#include "data/tensor.hpp"
+
+using namespace kuiper_infer;
+
+// 先计算完整的注意力矩阵再做softmax的参考实现
+static void AttentionReference(const sftensor& query, const sftensor& key, const sftensor& value,
+                               bool is_causal, const sftensor& output) {
+  const uint32_t head_dim = query->cols();
+  for (uint32_t h = 0; h < query->channels(); ++h) {
+    for (uint32_t q = 0; q < query->rows(); ++q) {
+      const uint32_t key_count = is_causal ? q + 1 : key->rows();
+      std::vector<double> scores(key_count);
+      double max_score = -1e30;
+      for (uint32_t k = 0; k < key_count; ++k) {
+        double score = 0;
+        for (uint32_t d = 0; d < head_dim; ++d) {
+          score += query->at(h, q, d) * key->at(h, k, d);
+        }
+        scores.at(k) = score / std::sqrt(double(head_dim));
+        max_score = std::max(max_score, scores.at(k));
+      }
+      double sum = 0;
+      for (uint32_t k = 0; k < key_count; ++k) {
+        scores.at(k) = std::exp(scores.at(k) - max_score);
+        sum += scores.at(k);
+      }
+      for (uint32_t c = 0; c < value->cols(); ++c) {
+        double result = 0;
+        for (uint32_t k = 0; k < key_count; ++k) {
+          result += scores.at(k) * value->at(h, k, c);
+        }
+        output->at(h, q, c) = float(result / sum);
+      }
+    }
+  }
+}
+
+TEST(test_layer, attention_tiles) {
+  // {query_len, key_len}, 长度不是分块大小的整数倍
+  const std::vector<std::pair<uint32_t, uint32_t>> lengths = {
+      {1, 1}, {5, 7}, {64, 64}, {100, 130}, {197, 197}};
+  const uint32_t heads = 3;
+  const uint32_t head_dim = 16;
+  const uint32_t value_dim = 24;
+  for (const auto& [query_len, key_len] : lengths) {
+    sftensor query = std::make_shared<ftensor>(heads, query_len, head_dim);
+    sftensor key = std::make_shared<ftensor>(heads, key_len, head_dim);
+    sftensor value = std::make_shared<ftensor>(heads, key_len, value_dim);
+    query->RandN();
+    key->RandN();
+    value->RandN();
+    // 放大查询使softmax更尖锐, 检查在线softmax的缩放
+    query->Transform([](float v) { return v * 4.f; });
+
+    sftensor expected = std::make_shared<ftensor>(heads, query_len, value_dim);
+    AttentionReference(query, key, value, false, expected);
+
+    ScaledDotProductAttentionLayer attention_layer;
+    std::vector<sftensor> inputs = {query, key, value};
+    std::vector<sftensor> outputs(1);
+    ASSERT_EQ(attention_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+    ASSERT_EQ(outputs.front()->shapes(), expected->shapes());
+    for (uint32_t i = 0; i < expected->size(); ++i) {
+      ASSERT_NEAR(outputs.front()->index(i), expected->index(i), 1e-3f)
+          << "query " << query_len << " key " << key_len;
+    }
+  }
+}
+
+TEST(test_layer, attention_causal_batch) {
+  const uint32_t batch_size = 2;
+  const uint32_t heads = 4;
+  const uint32_t seq_len = 150;
+  const uint32_t head_dim = 32;
+  std::vector<sftensor> queries;
+  std::vector<sftensor> keys;
+  std::vector<sftensor> values;
+  for (uint32_t b = 0; b < batch_size; ++b) {
+    queries.push_back(std::make_shared<ftensor>(heads, seq_len, head_dim));
+    keys.push_back(std::make_shared<ftensor>(heads, seq_len, head_dim));
+    values.push_back(std::make_shared<ftensor>(heads, seq_len, head_dim));
+    queries.back()->RandN();
+    keys.back()->RandN();
+    values.back()->RandN();
+  }
+
+  // 输入依次是所有批次的查询, 键和值
+  std::vector<sftensor> inputs = queries;
+  inputs.insert(inputs.end(), keys.begin(), keys.end());
+  inputs.insert(inputs.end(), values.begin(), values.end());
+  std::vector<sftensor> outputs(batch_size);
+  ScaledDotProductAttentionLayer attention_layer(true);
+  ASSERT_EQ(attention_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  for (uint32_t b = 0; b < batch_size; ++b) {
+    sftensor expected = std::make_shared<ftensor>(heads, seq_len, head_dim);
+    AttentionReference(queries.at(b), keys.at(b), values.at(b), true, expected);
+    for (uint32_t i = 0; i < expected->size(); ++i) {
+      ASSERT_NEAR(outputs.at(b)->index(i), expected->index(i), 1e-3f) << "batch " << b;
+    }
+  }
+
+  std::vector<sftensor> wrong_inputs = {queries.front(), keys.front()};
+  std::vector<sftensor> wrong_outputs(1);
+  ASSERT_EQ(attention_layer.Forward(wrong_inputs, wrong_outputs),
+            StatusCode::kInferInOutDimMismatch);
+}
+
+// output = input * weight^T + bias, 按头拆成每个头一个通道
+static sftensor ProjectReference(const sftensor& input, const sftensor& weight,
+                                 const sftensor& bias, uint32_t heads) {
+  const uint32_t out_features = weight->rows();
+  const uint32_t head_dim = out_features / heads;
+  sftensor output = std::make_shared<ftensor>(heads, input->rows(), head_dim);
+  for (uint32_t r = 0; r < input->rows(); ++r) {
+    for (uint32_t o = 0; o < out_features; ++o) {
+      double sum = bias->at(0, 0, o);
+      for (uint32_t c = 0; c < input->cols(); ++c) {
+        sum += input->at(0, r, c) * weight->at(0, o, c);
+      }
+      output->at(o / head_dim, r, o % head_dim) = float(sum);
+    }
+  }
+  return output;
+}
+
+TEST(test_layer, multihead_attention) {
+  const uint32_t batch_size = 2;
+  const uint32_t embed_dim = 48;
+  const uint32_t heads = 3;
+  const uint32_t kdim = 40;
+  const uint32_t vdim = 24;
+  const uint32_t query_len = 70;
+  const uint32_t key_len = 90;
+
+  // 自注意力只有一个输入, 交叉注意力的键和值有各自的维度
+  for (const bool self_attention : {true, false}) {
+    const uint32_t key_dim = self_attention ? embed_dim : kdim;
+    const uint32_t value_dim = self_attention ? embed_dim : vdim;
+    MultiheadAttentionLayer attention_layer(embed_dim, heads, key_dim, value_dim, true);
+    std::vector<sftensor> weights;
+    std::vector<sftensor> bias;
+    for (uint32_t in_features : {embed_dim, key_dim, value_dim, embed_dim}) {
+      weights.push_back(std::make_shared<ftensor>(1, embed_dim, in_features));
+      weights.back()->RandN();
+      bias.push_back(std::make_shared<ftensor>(1, 1, embed_dim));
+      bias.back()->RandN();
+    }
+    attention_layer.set_weights(weights);
+    attention_layer.set_bias(bias);
+
+    std::vector<sftensor> queries;
+    std::vector<sftensor> keys;
+    std::vector<sftensor> values;
+    for (uint32_t b = 0; b < batch_size; ++b) {
+      queries.push_back(std::make_shared<ftensor>(1, query_len, embed_dim));
+      queries.back()->RandN();
+      if (self_attention) {
+        keys.push_back(queries.back());
+        values.push_back(queries.back());
+      } else {
+        keys.push_back(std::make_shared<ftensor>(1, key_len, key_dim));
+        values.push_back(std::make_shared<ftensor>(1, key_len, value_dim));
+        keys.back()->RandN();
+        values.back()->RandN();
+      }
+    }
+    std::vector<sftensor> inputs = queries;
+    if (!self_attention) {
+      inputs.insert(inputs.end(), keys.begin(), keys.end());
+      inputs.insert(inputs.end(), values.begin(), values.end());
+    }
+    std::vector<sftensor> outputs(batch_size);
+    ASSERT_EQ(attention_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+
+    for (uint32_t b = 0; b < batch_size; ++b) {
+      const sftensor query = ProjectReference(queries.at(b), weights.at(0), bias.at(0), heads);
+      const sftensor key = ProjectReference(keys.at(b), weights.at(1), bias.at(1), heads);
+      const sftensor value = ProjectReference(values.at(b), weights.at(2), bias.at(2), heads);
+      sftensor attention = std::make_shared<ftensor>(heads, query_len, embed_dim / heads);
+      AttentionReference(query, key, value, false, attention);
+
+      // 拼接各头的输出后做输出投影
+      sftensor concat = std::make_shared<ftensor>(1, query_len, embed_dim);
+      for (uint32_t h = 0; h < heads; ++h) {
+        for (uint32_t r = 0; r < query_len; ++r) {
+          for (uint32_t c = 0; c < embed_dim / heads; ++c) {
+            concat->at(0, r, h * (embed_dim / heads) + c) = attention->at(h, r, c);
+          }
+        }
+      }
+      const sftensor expected = ProjectReference(concat, weights.at(3), bias.at(3), 1);
+      ASSERT_EQ(outputs.at(b)->shapes(), expected->shapes());
+      for (uint32_t i = 0; i < expected->size(); ++i) {
+        ASSERT_NEAR(outputs.at(b)->index(i), expected->index(i), 1e-2f)
+            << "batch " << b << " self attention " << self_attention;
+      }
+    }
+  }
+}
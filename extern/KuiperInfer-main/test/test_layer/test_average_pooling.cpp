@@ -24,6 +24,7 @@
 #include <gtest/gtest.h>
 #include "../../source/layer/details/adaptive_avgpooling.hpp"
 #include "data/tensor.hpp"
+#include "data/tensor_half.hpp"
 
 void AveragePooling(const std::vector<std::shared_ptr<kuiper_infer::Tensor<float>>>& inputs,
                     std::vector<std::shared_ptr<kuiper_infer::Tensor<float>>>& outputs,
@@ -372,4 +373,24 @@ TEST(test_layer, forward_average_pooling_out7x11) {
       ASSERT_TRUE(arma::approx_equal(output1->slice(c), output2->slice(c), "absdiff", 0.01f));
     }
   }
-}
\ No newline at end of file
+}
+
+TEST(test_layer, forward_average_pooling_packed) {
+  using namespace kuiper_infer;
+  for (ActivationPrecision precision : {ActivationPrecision::kFP16, ActivationPrecision::kBF16}) {
+    sftensor input = std::make_shared<Tensor<float>>(5, 29, 23);
+    input->RandN();
+    HalfTensor packed_input;
+    packed_input.Pack(input, precision);
+    packed_input.Unpack(input);
+
+    AdaptiveAveragePoolingLayer average_layer(7, 5);
+    std::vector<sftensor> outputs1(1);
+    ASSERT_EQ(average_layer.Forward({input}, outputs1), StatusCode::kSuccess);
+    std::vector<sftensor> outputs2{std::make_shared<Tensor<float>>(5, 7, 5)};
+    ASSERT_EQ(average_layer.ForwardPacked({nullptr}, {&packed_input}, outputs2),
+              StatusCode::kSuccess);
+    ASSERT_TRUE(arma::approx_equal(outputs1.front()->data(), outputs2.front()->data(), "absdiff",
+                                   1e-6f));
+  }
+}
@@ -24,6 +24,7 @@
 #include <gtest/gtest.h>
 #include "../../source/layer/details/cat.hpp"
 #include "data/tensor.hpp"
+#include "data/tensor_half.hpp"
 
 TEST(test_layer, cat1) {
   using namespace kuiper_infer;
@@ -155,4 +156,38 @@ TEST(test_layer, cat4) {
     const arma::fmat& out_channel = outputs.at(0)->slice(i);
     ASSERT_TRUE(arma::approx_equal(in_channel, out_channel, "absdiff", 0.01f));
   }
-}
\ No newline at end of file
+}
+
+TEST(test_layer, cat_packed) {
+  using namespace kuiper_infer;
+  const uint32_t output_size = 2;
+  std::vector<sftensor> inputs;
+  std::vector<HalfTensor> packed_tensors(output_size);
+  std::vector<const HalfTensor*> packed_inputs;
+  // 第一个操作数以16位保存, 第二个操作数保持单精度
+  for (uint32_t i = 0; i < output_size * 2; ++i) {
+    sftensor input = std::make_shared<Tensor<float>>(i < output_size ? 3 : 5, 9, 11);
+    input->RandN();
+    if (i < output_size) {
+      packed_tensors.at(i).Pack(input, ActivationPrecision::kFP16);
+      packed_tensors.at(i).Unpack(input);
+      packed_inputs.push_back(&packed_tensors.at(i));
+    } else {
+      packed_inputs.push_back(nullptr);
+    }
+    inputs.push_back(input);
+  }
+
+  CatLayer cat_layer(1);
+  std::vector<sftensor> outputs1(output_size);
+  ASSERT_EQ(cat_layer.Forward(inputs, outputs1), StatusCode::kSuccess);
+  std::vector<sftensor> outputs2;
+  for (uint32_t i = 0; i < output_size; ++i) {
+    outputs2.push_back(std::make_shared<Tensor<float>>(8, 9, 11));
+  }
+  ASSERT_EQ(cat_layer.ForwardPacked(inputs, packed_inputs, outputs2), StatusCode::kSuccess);
+  for (uint32_t i = 0; i < output_size; ++i) {
+    ASSERT_TRUE(arma::approx_equal(outputs1.at(i)->data(), outputs2.at(i)->data(), "absdiff",
+                                   0.f));
+  }
+}
@@ -28,6 +28,7 @@
 #include "data/tensor_util.hpp"
 #include "runtime/runtime_ir.hpp"
 #include "tick.hpp"
+#include "utils/cpu/numa.hpp"
 
 using namespace kuiper_infer;
 
@@ -662,3 +663,304 @@ TEST(test_layer, conv_dilation2) {
         << i << " real: " << real_data.at(i) << " predict: " << outputs_values.at(i);
   }
 }
+
+static void ConvolutionDirect(const sftensor& input, const sftensor& output,
+                              const std::vector<sftensor>& weights, const std::vector<float>& bias,
+                              uint32_t padding, uint32_t stride, uint32_t groups) {
+  const uint32_t kernel_count_group = weights.size() / groups;
+  const uint32_t channels_per_group = input->channels() / groups;
+  for (uint32_t k = 0; k < weights.size(); ++k) {
+    const sftensor& kernel = weights.at(k);
+    const uint32_t group = k / kernel_count_group;
+    for (uint32_t ow = 0; ow < output->cols(); ++ow) {
+      for (uint32_t oh = 0; oh < output->rows(); ++oh) {
+        float sum = bias.empty() ? 0.f : bias.at(k);
+        for (uint32_t ic = 0; ic < channels_per_group; ++ic) {
+          for (uint32_t kw = 0; kw < kernel->cols(); ++kw) {
+            for (uint32_t kh = 0; kh < kernel->rows(); ++kh) {
+              const int32_t ih = int32_t(oh * stride + kh) - int32_t(padding);
+              const int32_t iw = int32_t(ow * stride + kw) - int32_t(padding);
+              if (ih >= 0 && iw >= 0 && ih < int32_t(input->rows()) &&
+                  iw < int32_t(input->cols())) {
+                sum += kernel->at(ic, kh, kw) *
+                       input->at(group * channels_per_group + ic, uint32_t(ih), uint32_t(iw));
+              }
+            }
+          }
+        }
+        output->at(k, oh, ow) = sum;
+      }
+    }
+  }
+}
+
+TEST(test_layer, conv_implicit_gemm) {
+  using namespace kuiper_infer;
+  // {kernel, padding, stride, groups}, 输入通道较多时im2col会分成多个块计算
+  const std::vector<std::vector<uint32_t>> configs = {
+      {3, 1, 1, 1}, {3, 1, 2, 2}, {1, 0, 1, 1}, {1, 0, 1, 4}, {1, 0, 2, 1}, {5, 2, 1, 1}};
+  const uint32_t in_channel = 64;
+  const uint32_t kernel_count = 16;
+  for (const auto& config : configs) {
+    const uint32_t kernel_size = config.at(0);
+    const uint32_t padding = config.at(1);
+    const uint32_t stride = config.at(2);
+    const uint32_t groups = config.at(3);
+
+    std::vector<sftensor> weights;
+    std::vector<float> bias;
+    for (uint32_t k = 0; k < kernel_count; ++k) {
+      sftensor kernel =
+          std::make_shared<ftensor>(in_channel / groups, kernel_size, kernel_size);
+      kernel->RandN();
+      weights.push_back(kernel);
+      bias.push_back(float(k) * 0.1f);
+    }
+
+    sftensor input = std::make_shared<ftensor>(in_channel, 37, 29);
+    input->RandN();
+    const uint32_t output_h = (37 + 2 * padding - kernel_size) / stride + 1;
+    const uint32_t output_w = (29 + 2 * padding - kernel_size) / stride + 1;
+    sftensor expected = std::make_shared<ftensor>(kernel_count, output_h, output_w);
+    ConvolutionDirect(input, expected, weights, bias, padding, stride, groups);
+
+    ConvolutionLayer conv_layer(kernel_count, in_channel, kernel_size, kernel_size, padding,
+                                padding, stride, stride, groups, true);
+    conv_layer.set_weights(weights);
+    conv_layer.set_bias(bias);
+    std::vector<sftensor> inputs = {input};
+    std::vector<sftensor> outputs(1);
+    ASSERT_EQ(conv_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+    ASSERT_EQ(outputs.front()->shapes(), expected->shapes());
+    for (uint32_t i = 0; i < expected->size(); ++i) {
+      ASSERT_NEAR(outputs.front()->index(i), expected->index(i), 1e-3f)
+          << "kernel " << kernel_size << " stride " << stride << " groups " << groups;
+    }
+  }
+}
+
+TEST(test_layer, conv_replicate_weights) {
+  using namespace kuiper_infer;
+  const uint32_t in_channel = 16;
+  const uint32_t kernel_count = 8;
+  std::vector<sftensor> weights;
+  for (uint32_t k = 0; k < kernel_count; ++k) {
+    sftensor kernel = std::make_shared<ftensor>(in_channel / 2, 3, 3);
+    kernel->RandN();
+    weights.push_back(kernel);
+  }
+
+  sftensor input = std::make_shared<ftensor>(in_channel, 23, 19);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs1(1);
+  std::vector<sftensor> outputs2(1);
+  ConvolutionLayer conv_layer(kernel_count, in_channel, 3, 3, 1, 1, 1, 1, 2, false);
+  conv_layer.set_weights(weights);
+  ASSERT_EQ(conv_layer.Forward(inputs, outputs1), StatusCode::kSuccess);
+
+  // 单节点的机器上不复制权重, 多节点时每个节点使用自己的副本, 结果都应该一致
+  conv_layer.ReplicateWeights();
+  ASSERT_EQ(conv_layer.Forward(inputs, outputs2), StatusCode::kSuccess);
+  ASSERT_EQ(outputs1.front()->shapes(), outputs2.front()->shapes());
+  for (uint32_t i = 0; i < outputs1.front()->size(); ++i) {
+    ASSERT_EQ(outputs1.front()->index(i), outputs2.front()->index(i));
+  }
+
+  const utils::NumaTopology& topology = utils::GetNumaTopology();
+  ASSERT_GE(topology.node_count(), 1);
+  ASSERT_LT(utils::GetCurrentNumaNode(), topology.node_count());
+  ASSERT_LT(utils::NumaNodeOfThread(7), topology.node_count());
+}
+
+TEST(test_layer, conv_tuning_choices) {
+  using namespace kuiper_infer;
+  // {kernel, padding, stride, groups}, 深度卷积的每组只有一个输入通道
+  const std::vector<std::vector<uint32_t>> configs = {
+      {3, 1, 1, 1}, {3, 1, 2, 32}, {1, 0, 1, 1}, {1, 0, 2, 2}, {5, 2, 1, 4}};
+  const uint32_t in_channel = 32;
+  const uint32_t kernel_count = 32;
+  for (const auto& config : configs) {
+    const uint32_t kernel_size = config.at(0);
+    const uint32_t padding = config.at(1);
+    const uint32_t stride = config.at(2);
+    const uint32_t groups = config.at(3);
+
+    std::vector<sftensor> weights;
+    std::vector<float> bias;
+    for (uint32_t k = 0; k < kernel_count; ++k) {
+      sftensor kernel =
+          std::make_shared<ftensor>(in_channel / groups, kernel_size, kernel_size);
+      kernel->RandN();
+      weights.push_back(kernel);
+      bias.push_back(float(k) * 0.1f);
+    }
+
+    sftensor input = std::make_shared<ftensor>(in_channel, 23, 31);
+    input->RandN();
+    const uint32_t output_h = (23 + 2 * padding - kernel_size) / stride + 1;
+    const uint32_t output_w = (31 + 2 * padding - kernel_size) / stride + 1;
+    sftensor expected = std::make_shared<ftensor>(kernel_count, output_h, output_w);
+    ConvolutionDirect(input, expected, weights, bias, padding, stride, groups);
+
+    ConvolutionLayer conv_layer(kernel_count, in_channel, kernel_size, kernel_size, padding,
+                                padding, stride, stride, groups, true);
+    conv_layer.set_weights(weights);
+    conv_layer.set_bias(bias);
+    ASSERT_FALSE(conv_layer.tuning_signature().empty());
+    const std::vector<std::string>& choices = conv_layer.tuning_choices();
+    const bool pointwise = kernel_size == 1 && stride == 1;
+    ASSERT_EQ(std::find(choices.begin(), choices.end(), "gemm_1x1") != choices.end(), pointwise);
+    for (uint32_t choice = 0; choice < choices.size(); ++choice) {
+      conv_layer.set_tuning_choice(choice);
+      std::vector<sftensor> inputs = {input};
+      std::vector<sftensor> outputs(1);
+      ASSERT_EQ(conv_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+      ASSERT_EQ(outputs.front()->shapes(), expected->shapes());
+      for (uint32_t i = 0; i < expected->size(); ++i) {
+        ASSERT_NEAR(outputs.front()->index(i), expected->index(i), 1e-3f)
+            << choices.at(choice) << " kernel " << kernel_size << " groups " << groups;
+      }
+    }
+  }
+}
+
+TEST(test_layer, conv_check_unchecked) {
+  using namespace kuiper_infer;
+  const uint32_t in_channel = 8;
+  const uint32_t kernel_count = 16;
+  const uint32_t batch_size = 3;
+  std::vector<sftensor> weights;
+  for (uint32_t k = 0; k < kernel_count; ++k) {
+    sftensor kernel = std::make_shared<ftensor>(in_channel, 3, 3);
+    kernel->RandN();
+    weights.push_back(kernel);
+  }
+  ConvolutionLayer conv_layer(kernel_count, in_channel, 3, 3, 1, 1, 2, 2, 1, false);
+  conv_layer.set_weights(weights);
+
+  std::vector<sftensor> inputs;
+  for (uint32_t b = 0; b < batch_size; ++b) {
+    sftensor input = std::make_shared<ftensor>(in_channel, 15, 20);
+    input->RandN();
+    inputs.push_back(input);
+  }
+
+  // 输入和输出数量不一致
+  std::vector<sftensor> wrong_outputs(batch_size - 1);
+  ASSERT_EQ(conv_layer.Check(inputs, wrong_outputs), StatusCode::kInferInOutDimMismatch);
+
+  std::vector<sftensor> outputs1(batch_size);
+  ASSERT_EQ(conv_layer.Forward(inputs, outputs1), StatusCode::kSuccess);
+  std::vector<sftensor> outputs2;
+  for (uint32_t b = 0; b < batch_size; ++b) {
+    outputs2.push_back(std::make_shared<ftensor>(kernel_count, 8, 10));
+  }
+  ASSERT_EQ(conv_layer.Check(inputs, outputs2), StatusCode::kSuccess);
+  ASSERT_EQ(conv_layer.ForwardUnchecked(inputs, outputs2), StatusCode::kSuccess);
+  for (uint32_t b = 0; b < batch_size; ++b) {
+    ASSERT_EQ(outputs1.at(b)->shapes(), outputs2.at(b)->shapes());
+    for (uint32_t i = 0; i < outputs1.at(b)->size(); ++i) {
+      ASSERT_EQ(outputs1.at(b)->index(i), outputs2.at(b)->index(i));
+    }
+  }
+}
+
+TEST(test_layer, conv_block_sparse) {
+  using namespace kuiper_infer;
+  // {kernel, padding, stride, groups}, 每组18个卷积核, 最后一个块只有两个卷积核
+  const std::vector<std::vector<uint32_t>> configs = {
+      {3, 1, 1, 1}, {3, 1, 2, 2}, {1, 0, 1, 1}, {1, 0, 1, 2}};
+  const uint32_t in_channel = 64;
+  const uint32_t kernel_count = 36;
+  for (const auto& config : configs) {
+    const uint32_t kernel_size = config.at(0);
+    const uint32_t padding = config.at(1);
+    const uint32_t stride = config.at(2);
+    const uint32_t groups = config.at(3);
+
+    std::vector<sftensor> weights;
+    std::vector<float> bias;
+    for (uint32_t k = 0; k < kernel_count; ++k) {
+      sftensor kernel =
+          std::make_shared<ftensor>(in_channel / groups, kernel_size, kernel_size);
+      kernel->RandN();
+      // 按4个卷积核x4个输入通道剪枝, 只保留四分之一的块
+      for (uint32_t ic = 0; ic < kernel->channels(); ++ic) {
+        if ((k % (kernel_count / groups) / 4 + ic / 4) % 4 != 0) {
+          kernel->slice(ic).zeros();
+        }
+      }
+      weights.push_back(kernel);
+      bias.push_back(float(k) * 0.1f);
+    }
+
+    sftensor input = std::make_shared<ftensor>(in_channel, 37, 29);
+    input->RandN();
+    const uint32_t output_h = (37 + 2 * padding - kernel_size) / stride + 1;
+    const uint32_t output_w = (29 + 2 * padding - kernel_size) / stride + 1;
+    sftensor expected = std::make_shared<ftensor>(kernel_count, output_h, output_w);
+    ConvolutionDirect(input, expected, weights, bias, padding, stride, groups);
+
+    ConvolutionLayer conv_layer(kernel_count, in_channel, kernel_size, kernel_size, padding,
+                                padding, stride, stride, groups, true);
+    conv_layer.set_weights(weights);
+    conv_layer.set_bias(bias);
+    // 块稀疏的权重在设置权重时建立, 不推迟到第一次Forward
+    for (uint32_t g = 0; g < groups; ++g) {
+      ASSERT_TRUE(conv_layer.block_sparse(g));
+    }
+    std::vector<sftensor> inputs = {input};
+    std::vector<sftensor> outputs(1);
+    ASSERT_EQ(conv_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+    ASSERT_EQ(outputs.front()->shapes(), expected->shapes());
+    for (uint32_t i = 0; i < expected->size(); ++i) {
+      ASSERT_NEAR(outputs.front()->index(i), expected->index(i), 1e-3f)
+          << "kernel " << kernel_size << " stride " << stride << " groups " << groups;
+    }
+  }
+
+  // 稠密的权重仍然使用稠密的矩阵乘法
+  std::vector<sftensor> weights;
+  for (uint32_t k = 0; k < kernel_count; ++k) {
+    sftensor kernel = std::make_shared<ftensor>(in_channel, 3, 3);
+    kernel->RandN();
+    weights.push_back(kernel);
+  }
+  ConvolutionLayer conv_layer(kernel_count, in_channel, 3, 3, 1, 1, 1, 1, 1, false);
+  conv_layer.set_weights(weights);
+  sftensor input = std::make_shared<ftensor>(in_channel, 15, 20);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs(1);
+  ASSERT_EQ(conv_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  ASSERT_FALSE(conv_layer.block_sparse());
+
+  // 替换权重后Forward使用按新权重展开的权重矩阵
+  for (uint32_t k = 0; k < kernel_count; ++k) {
+    weights.at(k) = std::make_shared<ftensor>(in_channel, 3, 3);
+    weights.at(k)->RandN();
+  }
+  conv_layer.set_weights(weights);
+  sftensor expected = std::make_shared<ftensor>(kernel_count, 15, 20);
+  ConvolutionDirect(input, expected, weights, {}, 1, 1, 1);
+  ASSERT_EQ(conv_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  for (uint32_t i = 0; i < expected->size(); ++i) {
+    ASSERT_NEAR(outputs.front()->index(i), expected->index(i), 1e-3f);
+  }
+}
+
+TEST(test_layer, conv_check_algorithm) {
+  using namespace kuiper_infer;
+  // 1x1卷积的算法在Check中拒绝3x3的卷积, 不留到ForwardUnchecked中检查
+  ConvolutionLayer conv_layer(4, 3, 3, 3, 1, 1, 1, 1, 1, true);
+  conv_layer.set_algorithm(ConvAlgorithm::kGemm1x1);
+  sftensor input = std::make_shared<ftensor>(3, 8, 8);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs(1);
+  ASSERT_EQ(conv_layer.Check(inputs, outputs), StatusCode::kInferParameterError);
+
+  conv_layer.set_algorithm(ConvAlgorithm::kDirect);
+  ASSERT_EQ(conv_layer.Check(inputs, outputs), StatusCode::kSuccess);
+}
@@ -0,0 +1,109 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include "../../source/layer/details/layer_norm.hpp"
+#include "data/tensor.hpp"
+
+using namespace kuiper_infer;
+
+TEST(test_layer, layer_norm_last_dim) {
+  // 行数不是8的倍数时由标量代码处理剩余的行
+  const std::vector<uint32_t> row_counts = {1, 7, 8, 70, 197};
+  const uint32_t channels = 3;
+  const uint32_t features = 37;
+  for (uint32_t rows : row_counts) {
+    sftensor input = std::make_shared<ftensor>(channels, rows, features);
+    input->RandN();
+    // 均值远大于方差时单次遍历的统计也要保持精度
+    input->Transform([](float v) { return v * 2.f + 100.f; });
+    std::vector<float> weight(features);
+    std::vector<float> bias(features);
+    for (uint32_t i = 0; i < features; ++i) {
+      weight.at(i) = 0.5f + float(i) * 0.1f;
+      bias.at(i) = float(i) * 0.01f - 0.2f;
+    }
+
+    LayerNormLayer layer_norm({int32_t(features)}, 1e-5f, weight, bias);
+    std::vector<sftensor> inputs = {input};
+    std::vector<sftensor> outputs(1);
+    ASSERT_EQ(layer_norm.Forward(inputs, outputs), StatusCode::kSuccess);
+    const sftensor& output = outputs.front();
+    ASSERT_EQ(output->shapes(), input->shapes());
+    for (uint32_t c = 0; c < channels; ++c) {
+      for (uint32_t r = 0; r < rows; ++r) {
+        double mean = 0;
+        for (uint32_t i = 0; i < features; ++i) {
+          mean += input->at(c, r, i);
+        }
+        mean /= features;
+        double var = 0;
+        for (uint32_t i = 0; i < features; ++i) {
+          var += (input->at(c, r, i) - mean) * (input->at(c, r, i) - mean);
+        }
+        var /= features;
+        for (uint32_t i = 0; i < features; ++i) {
+          const double expected =
+              (input->at(c, r, i) - mean) / std::sqrt(var + 1e-5) * weight.at(i) + bias.at(i);
+          ASSERT_NEAR(output->at(c, r, i), expected, 2e-3f) << "rows " << rows;
+        }
+      }
+    }
+  }
+}
+
+TEST(test_layer, layer_norm_last_two_dims) {
+  const uint32_t channels = 4;
+  const uint32_t rows = 9;
+  const uint32_t cols = 13;
+  sftensor input = std::make_shared<ftensor>(channels, rows, cols);
+  input->RandN();
+  // 仿射参数按行优先排列
+  std::vector<float> weight(rows * cols);
+  for (uint32_t i = 0; i < weight.size(); ++i) {
+    weight.at(i) = float(i % 7) * 0.3f - 1.f;
+  }
+
+  LayerNormLayer layer_norm({int32_t(rows), int32_t(cols)}, 1e-5f, weight);
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs(1);
+  ASSERT_EQ(layer_norm.Forward(inputs, outputs), StatusCode::kSuccess);
+  const sftensor& output = outputs.front();
+  for (uint32_t c = 0; c < channels; ++c) {
+    const arma::fmat& slice = input->slice(c);
+    const double mean = arma::mean(arma::vectorise(slice));
+    const double var = arma::var(arma::vectorise(slice), 1);
+    for (uint32_t r = 0; r < rows; ++r) {
+      for (uint32_t i = 0; i < cols; ++i) {
+        const double expected =
+            (input->at(c, r, i) - mean) / std::sqrt(var + 1e-5) * weight.at(r * cols + i);
+        ASSERT_NEAR(output->at(c, r, i), expected, 1e-3f);
+      }
+    }
+  }
+
+  // 归一化的维度和输入的最后几维不一致
+  LayerNormLayer wrong_layer_norm({int32_t(cols), int32_t(rows)}, 1e-5f);
+  std::vector<sftensor> wrong_outputs(1);
+  ASSERT_EQ(wrong_layer_norm.Forward(inputs, wrong_outputs), StatusCode::kInferInOutDimMismatch);
+}
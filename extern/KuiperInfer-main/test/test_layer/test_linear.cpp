@@ -307,4 +307,68 @@ TEST(test_layer, forward_linear10) {
       ASSERT_EQ(is_same, true);
     }
   }
-}
\ No newline at end of file
+}
+
+TEST(test_layer, forward_linear_block_sparse) {
+  using namespace kuiper_infer;
+  // 输入和输出特征数都不是4的倍数, 边缘的块需要补齐
+  const uint32_t in_features = 67;
+  const uint32_t out_features = 45;
+  const uint32_t in_dims = 37;
+
+  sftensor weight = std::make_shared<ftensor>(1, out_features, in_features);
+  weight->RandN();
+  // 按4个输出特征x4个输入特征剪枝, 只保留三分之一的块
+  for (uint32_t o = 0; o < out_features; ++o) {
+    for (uint32_t i = 0; i < in_features; ++i) {
+      if ((o / 4 + i / 4) % 3 != 0) {
+        weight->at(0, o, i) = 0.f;
+      }
+    }
+  }
+  sftensor bias = std::make_shared<ftensor>(1, 1, out_features);
+  bias->RandN();
+
+  LinearLayer linear_layer(in_features, out_features, true);
+  linear_layer.set_weights(std::vector<sftensor>{weight});
+  linear_layer.set_bias(std::vector<sftensor>{bias});
+  // 块稀疏权重在设置权重时建立, 不推迟到第一次Forward
+  ASSERT_TRUE(linear_layer.block_sparse());
+
+  sftensor input = std::make_shared<ftensor>(1, in_dims, in_features);
+  input->RandN();
+  std::vector<sftensor> inputs = {input};
+  std::vector<sftensor> outputs(1);
+  ASSERT_EQ(linear_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  ASSERT_TRUE(linear_layer.block_sparse());
+
+  const sftensor& output = outputs.front();
+  ASSERT_EQ(output->rows(), in_dims);
+  ASSERT_EQ(output->cols(), out_features);
+  for (uint32_t r = 0; r < in_dims; ++r) {
+    for (uint32_t o = 0; o < out_features; ++o) {
+      float expected = bias->at(0, 0, o);
+      for (uint32_t i = 0; i < in_features; ++i) {
+        expected += input->at(0, r, i) * weight->at(0, o, i);
+      }
+      ASSERT_NEAR(output->at(0, r, o), expected, 1e-3f);
+    }
+  }
+
+  // 替换成稠密权重后不能继续使用旧的块稀疏权重
+  sftensor dense_weight = std::make_shared<ftensor>(1, out_features, in_features);
+  dense_weight->RandN();
+  linear_layer.set_weights(std::vector<sftensor>{dense_weight});
+  ASSERT_FALSE(linear_layer.block_sparse());
+  ASSERT_EQ(linear_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  ASSERT_FALSE(linear_layer.block_sparse());
+  for (uint32_t r = 0; r < in_dims; ++r) {
+    for (uint32_t o = 0; o < out_features; ++o) {
+      float expected = bias->at(0, 0, o);
+      for (uint32_t i = 0; i < in_features; ++i) {
+        expected += input->at(0, r, i) * dense_weight->at(0, o, i);
+      }
+      ASSERT_NEAR(output->at(0, r, o), expected, 1e-3f);
+    }
+  }
+}
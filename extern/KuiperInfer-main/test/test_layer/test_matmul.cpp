@@ -0,0 +1,82 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include "../../source/layer/details/matmul.hpp"
+#include "data/tensor.hpp"
+
+using namespace kuiper_infer;
+
+TEST(test_layer, matmul_broadcast) {
+  // {左操作数通道数, 右操作数通道数}, 一个通道的输入广播到另一个输入的所有通道
+  const std::vector<std::pair<uint32_t, uint32_t>> channel_pairs = {{1, 1}, {4, 4}, {4, 1}, {1, 4}};
+  const uint32_t rows = 17;
+  const uint32_t inner = 33;
+  const uint32_t cols = 9;
+  for (const auto& [channels1, channels2] : channel_pairs) {
+    sftensor input1 = std::make_shared<ftensor>(channels1, rows, inner);
+    sftensor input2 = std::make_shared<ftensor>(channels2, inner, cols);
+    input1->RandN();
+    input2->RandN();
+
+    MatMulLayer matmul_layer;
+    std::vector<sftensor> inputs = {input1, input2};
+    std::vector<sftensor> outputs(1);
+    ASSERT_EQ(matmul_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+    const sftensor& output = outputs.front();
+    const uint32_t channels = std::max(channels1, channels2);
+    ASSERT_EQ(output->channels(), channels);
+    for (uint32_t c = 0; c < channels; ++c) {
+      const arma::fmat expected =
+          input1->slice(channels1 == 1 ? 0 : c) * input2->slice(channels2 == 1 ? 0 : c);
+      ASSERT_TRUE(arma::approx_equal(output->slice(c), expected, "absdiff", 1e-4f));
+    }
+  }
+}
+
+TEST(test_layer, matmul_vector) {
+  const uint32_t rows = 6;
+  const uint32_t cols = 11;
+  sftensor matrix = std::make_shared<ftensor>(rows, cols);
+  sftensor vector = std::make_shared<ftensor>(cols);
+  matrix->RandN();
+  vector->RandN();
+
+  MatMulLayer matmul_layer;
+  std::vector<sftensor> inputs = {matrix, vector};
+  std::vector<sftensor> outputs(1);
+  ASSERT_EQ(matmul_layer.Forward(inputs, outputs), StatusCode::kSuccess);
+  ASSERT_EQ(outputs.front()->size(), rows);
+  for (uint32_t r = 0; r < rows; ++r) {
+    float expected = 0.f;
+    for (uint32_t i = 0; i < cols; ++i) {
+      expected += matrix->at(0, r, i) * vector->index(i);
+    }
+    ASSERT_NEAR(outputs.front()->index(r), expected, 1e-4f);
+  }
+
+  // 内部维度不一致
+  std::vector<sftensor> wrong_inputs = {vector, matrix};
+  std::vector<sftensor> wrong_outputs(1);
+  ASSERT_EQ(matmul_layer.Forward(wrong_inputs, wrong_outputs),
+            StatusCode::kInferInOutDimMismatch);
+}
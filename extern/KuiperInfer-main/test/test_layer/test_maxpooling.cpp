@@ -24,6 +24,7 @@
 #include <gtest/gtest.h>
 #include "../../source/layer/details/maxpooling.hpp"
 #include "data/tensor.hpp"
+#include "data/tensor_half.hpp"
 
 void MaxPooling(const std::vector<std::shared_ptr<kuiper_infer::Tensor<float>>>& inputs,
                 std::vector<std::shared_ptr<kuiper_infer::Tensor<float>>>& outputs, int stride_w,
@@ -536,4 +537,23 @@ TEST(test_layer, forward_max_pooling_s77_k77) {
       ASSERT_TRUE(arma::approx_equal(output1->slice(c), output2->slice(c), "absdiff", 0.01f));
     }
   }
-}
\ No newline at end of file
+}
+
+TEST(test_layer, forward_max_pooling_packed) {
+  using namespace kuiper_infer;
+  for (ActivationPrecision precision : {ActivationPrecision::kFP16, ActivationPrecision::kBF16}) {
+    sftensor input = std::make_shared<Tensor<float>>(5, 31, 27);
+    input->RandN();
+    HalfTensor packed_input;
+    packed_input.Pack(input, precision);
+    packed_input.Unpack(input);
+
+    MaxPoolingLayer max_layer(1, 1, 3, 3, 2, 2);
+    std::vector<sftensor> outputs1(1);
+    ASSERT_EQ(max_layer.Forward({input}, outputs1), StatusCode::kSuccess);
+    std::vector<sftensor> outputs2{std::make_shared<Tensor<float>>(outputs1.front()->shapes())};
+    ASSERT_EQ(max_layer.ForwardPacked({nullptr}, {&packed_input}, outputs2), StatusCode::kSuccess);
+    ASSERT_TRUE(arma::approx_equal(outputs1.front()->data(), outputs2.front()->data(), "absdiff",
+                                   1e-6f));
+  }
+}
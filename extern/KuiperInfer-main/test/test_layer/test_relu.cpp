@@ -25,6 +25,7 @@
 #include <gtest/gtest.h>
 #include "../../source/layer/details/relu.hpp"
 #include "data/tensor.hpp"
+#include "data/tensor_half.hpp"
 
 TEST(test_layer, forward_relu1) {
   using namespace kuiper_infer;
@@ -140,4 +141,34 @@ TEST(test_layer, forward_relu4) {
       ASSERT_EQ(output_->index(j), input_->index(j));
     }
   }
-}
\ No newline at end of file
+}
+
+TEST(test_layer, forward_relu_packed) {
+  using namespace kuiper_infer;
+  for (ActivationPrecision precision : {ActivationPrecision::kFP16, ActivationPrecision::kBF16}) {
+    std::vector<sftensor> inputs;
+    std::vector<HalfTensor> packed_tensors(2);
+    for (uint32_t i = 0; i < 2; ++i) {
+      sftensor input = std::make_shared<Tensor<float>>(3, 37, 61);
+      input->RandN();
+      packed_tensors.at(i).Pack(input, precision);
+      // 与展开后的单精度输入比较
+      packed_tensors.at(i).Unpack(input);
+      inputs.push_back(input);
+    }
+    // 第二个输入保持单精度
+    const std::vector<const HalfTensor*> packed_inputs{&packed_tensors.at(0), nullptr};
+
+    ReluLayer relu_layer;
+    std::vector<sftensor> outputs1(2);
+    ASSERT_EQ(relu_layer.Forward(inputs, outputs1), StatusCode::kSuccess);
+    std::vector<sftensor> outputs2{std::make_shared<Tensor<float>>(3, 37, 61),
+                                   std::make_shared<Tensor<float>>(3, 37, 61)};
+    ASSERT_EQ(relu_layer.ForwardPacked({nullptr, inputs.at(1)}, packed_inputs, outputs2),
+              StatusCode::kSuccess);
+    for (uint32_t i = 0; i < 2; ++i) {
+      ASSERT_TRUE(arma::approx_equal(outputs1.at(i)->data(), outputs2.at(i)->data(), "absdiff",
+                                     1e-6f));
+    }
+  }
+}
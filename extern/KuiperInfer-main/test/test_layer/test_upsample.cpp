@@ -24,6 +24,7 @@
 #include <gtest/gtest.h>
 #include "../../source/layer/details/upsample.hpp"
 #include "data/load_data.hpp"
+#include "data/tensor_half.hpp"
 #include "runtime/runtime_ir.hpp"
 
 TEST(test_layer, forward_upsample1) {
@@ -439,4 +440,23 @@ TEST(test_layer, forward_upsample_nearest_equal) {
   for (uint32_t i = 0; i < input->size(); ++i) {
     ASSERT_LE(std::abs(output->index(i) - input->index(i)), 1e-4f);
   }
-}
\ No newline at end of file
+}
+
+TEST(test_layer, forward_upsample_packed) {
+  using namespace kuiper_infer;
+  sftensor input = std::make_shared<Tensor<float>>(4, 13, 17);
+  input->RandN();
+  HalfTensor packed_input;
+  packed_input.Pack(input, ActivationPrecision::kBF16);
+  packed_input.Unpack(input);
+
+  for (UpSampleMode mode : {UpSampleMode::kModeNearest, UpSampleMode::kModeBilinear}) {
+    UpSampleLayer layer(2.f, 2.f, mode);
+    std::vector<sftensor> outputs1(1);
+    ASSERT_EQ(layer.Forward({input}, outputs1), StatusCode::kSuccess);
+    std::vector<sftensor> outputs2{std::make_shared<Tensor<float>>(4, 26, 34)};
+    ASSERT_EQ(layer.ForwardPacked({nullptr}, {&packed_input}, outputs2), StatusCode::kSuccess);
+    ASSERT_TRUE(arma::approx_equal(outputs1.front()->data(), outputs2.front()->data(), "absdiff",
+                                   1e-6f));
+  }
+}
@@ -0,0 +1,87 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <thread>
+#include "data/load_data.hpp"
+#include "runtime/inference_queue.hpp"
+
+static void CheckYoloOutput(const kuiper_infer::sftensor& output, const std::string& file_path) {
+  using namespace kuiper_infer;
+  ASSERT_NE(output, nullptr);
+  const auto& output1 = CSVDataLoader::LoadData<float>(file_path);
+  ASSERT_EQ(output1.size(), output->size());
+  for (int r = 0; r < output1.n_rows; ++r) {
+    for (int c = 0; c < output1.n_cols; ++c) {
+      ASSERT_LE(std::abs(output1.at(r, c) - output->at(0, r, c)), 0.05)
+          << " row: " << r << " col: " << c;
+    }
+  }
+}
+
+TEST(test_runtime, inference_queue_full_batch) {
+  using namespace kuiper_infer;
+  auto graph = std::make_shared<RuntimeGraph>("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                                              "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  const uint32_t batch_size = 4;
+  InferenceQueue queue(graph, "pnnx_input_0", "pnnx_output_0", batch_size,
+                       std::chrono::milliseconds(100));
+
+  std::vector<std::future<sftensor>> futures(batch_size);
+  std::vector<std::thread> clients;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    clients.emplace_back([&queue, &futures, i]() {
+      sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+      input->Fill(127.f);
+      futures.at(i) = queue.Submit(input);
+    });
+  }
+  for (auto& client : clients) {
+    client.join();
+  }
+
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    CheckYoloOutput(futures.at(i).get(), "tmp/yolo/1.csv");
+  }
+
+  const InferenceQueueStatistics& statistics = queue.statistics();
+  ASSERT_EQ(statistics.request_count, batch_size);
+  ASSERT_EQ(statistics.batch_histogram.size(), batch_size + 1);
+  ASSERT_LE(statistics.latency_p50, statistics.latency_p99);
+}
+
+TEST(test_runtime, inference_queue_partial_batch) {
+  using namespace kuiper_infer;
+  auto graph = std::make_shared<RuntimeGraph>("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                                              "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  InferenceQueue queue(graph, "pnnx_input_0", "pnnx_output_0", 4, std::chrono::milliseconds(1));
+
+  sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+  input->Fill(127.f);
+  std::future<sftensor> output = queue.Submit(input);
+  CheckYoloOutput(output.get(), "tmp/yolo/1.csv");
+
+  queue.Stop();
+  const InferenceQueueStatistics& statistics = queue.statistics();
+  ASSERT_EQ(statistics.request_count, 1);
+  ASSERT_EQ(statistics.batch_count, 1);
+  ASSERT_EQ(statistics.batch_histogram.at(1), 1);
+}
@@ -0,0 +1,149 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "runtime/model_manager.hpp"
+
+static std::vector<kuiper_infer::sftensor> ForwardGraph(
+    const std::string& param_path, const std::string& bin_path,
+    const std::vector<kuiper_infer::sftensor>& inputs) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph(param_path, bin_path);
+  graph.Build();
+  graph.set_inputs("pnnx_input_0", inputs);
+  graph.Forward(false);
+  return graph.get_outputs("pnnx_output_0");
+}
+
+static void CheckOutputs(const std::vector<kuiper_infer::sftensor>& outputs1,
+                         const std::vector<kuiper_infer::sftensor>& outputs2) {
+  ASSERT_EQ(outputs1.size(), outputs2.size());
+  for (uint32_t i = 0; i < outputs1.size(); ++i) {
+    ASSERT_EQ(outputs1.at(i)->shapes(), outputs2.at(i)->shapes());
+    for (uint32_t j = 0; j < outputs1.at(i)->size(); ++j) {
+      ASSERT_NEAR(outputs1.at(i)->index(j), outputs2.at(i)->index(j), 1e-4f);
+    }
+  }
+}
+
+TEST(test_runtime, forward_step) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                     "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph.Build();
+  ASSERT_EQ(graph.execution_step_count(), graph.operators().size());
+
+  std::vector<sftensor> inputs;
+  for (uint32_t i = 0; i < 4; ++i) {
+    sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+    input->RandU(0.f, 1.f);
+    inputs.push_back(input);
+  }
+  graph.set_inputs("pnnx_input_0", inputs);
+  for (uint32_t i = 0; i < graph.execution_step_count(); ++i) {
+    graph.ForwardStep(i);
+  }
+  CheckOutputs(graph.get_outputs("pnnx_output_0"),
+               ForwardGraph("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                            "tmp/yolo/demo/yolov5n_small.pnnx.bin", inputs));
+}
+
+TEST(test_runtime, model_manager_two_models) {
+  using namespace kuiper_infer;
+  const std::string yolo_param = "tmp/yolo/demo/yolov5n_small.pnnx.param";
+  const std::string yolo_bin = "tmp/yolo/demo/yolov5n_small.pnnx.bin";
+  const std::string resnet_param = "tmp/resnet/resnet18_batch1.param";
+  const std::string resnet_bin = "tmp/resnet/resnet18_batch1.pnnx.bin";
+
+  ModelManager manager(2);
+  manager.LoadModel("yolo", yolo_param, yolo_bin, "pnnx_input_0", "pnnx_output_0", 1);
+  manager.LoadModel("resnet", resnet_param, resnet_bin, "pnnx_input_0", "pnnx_output_0", 0);
+
+  std::vector<sftensor> yolo_inputs;
+  for (uint32_t i = 0; i < 4; ++i) {
+    sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+    input->RandU(0.f, 1.f);
+    yolo_inputs.push_back(input);
+  }
+  sftensor resnet_input = std::make_shared<Tensor<float>>(3, 224, 224);
+  resnet_input->RandU(0.f, 1.f);
+
+  const uint32_t request_count = 3;
+  std::vector<std::future<std::vector<sftensor>>> resnet_outputs;
+  std::vector<std::future<std::vector<sftensor>>> yolo_outputs;
+  for (uint32_t i = 0; i < request_count; ++i) {
+    resnet_outputs.push_back(manager.Submit("resnet", {resnet_input}));
+    yolo_outputs.push_back(manager.Submit("yolo", yolo_inputs));
+  }
+
+  const std::vector<sftensor>& yolo_expected = ForwardGraph(yolo_param, yolo_bin, yolo_inputs);
+  const std::vector<sftensor>& resnet_expected =
+      ForwardGraph(resnet_param, resnet_bin, {resnet_input});
+  for (uint32_t i = 0; i < request_count; ++i) {
+    CheckOutputs(yolo_outputs.at(i).get(), yolo_expected);
+    CheckOutputs(resnet_outputs.at(i).get(), resnet_expected);
+  }
+
+  manager.Stop();
+  const ModelStatistics& yolo_statistics = manager.statistics("yolo");
+  const ModelStatistics& resnet_statistics = manager.statistics("resnet");
+  ASSERT_EQ(yolo_statistics.request_count, request_count);
+  ASSERT_EQ(resnet_statistics.request_count, request_count);
+  ASSERT_EQ(yolo_statistics.deadline_miss_count, 0);
+  ASSERT_GT(yolo_statistics.step_count, 0);
+  ASSERT_GT(yolo_statistics.utilization, 0.);
+  ASSERT_LE(yolo_statistics.utilization + resnet_statistics.utilization, 1.);
+}
+
+TEST(test_runtime, model_manager_priority_deadline) {
+  using namespace kuiper_infer;
+  const std::string resnet_param = "tmp/resnet/resnet18_batch1.param";
+  const std::string resnet_bin = "tmp/resnet/resnet18_batch1.pnnx.bin";
+
+  // 单个工作线程, 请求依次完成, 完成时间即为调度顺序
+  ModelManager manager(1);
+  manager.LoadModel("low", resnet_param, resnet_bin, "pnnx_input_0", "pnnx_output_0", 0);
+  manager.LoadModel("high_late", resnet_param, resnet_bin, "pnnx_input_0", "pnnx_output_0", 1);
+  manager.LoadModel("high_early", resnet_param, resnet_bin, "pnnx_input_0", "pnnx_output_0", 1);
+
+  sftensor input = std::make_shared<Tensor<float>>(3, 224, 224);
+  input->RandU(0.f, 1.f);
+  const auto now = std::chrono::steady_clock::now();
+
+  // 暂停时提交, 保证所有请求在调度前都已排队
+  manager.Pause();
+  std::vector<std::future<std::vector<sftensor>>> outputs;
+  outputs.push_back(manager.Submit("low", {input}, now + std::chrono::seconds(1)));
+  outputs.push_back(manager.Submit("high_late", {input}, now + std::chrono::hours(2)));
+  outputs.push_back(manager.Submit("high_early", {input}, now + std::chrono::hours(1)));
+  manager.Resume();
+  for (auto& output : outputs) {
+    ASSERT_EQ(output.get().size(), 1);
+  }
+  manager.Stop();
+
+  // 低优先级的请求截止时间最早, 仍然在高优先级的请求之后执行
+  const ModelStatistics& low_statistics = manager.statistics("low");
+  const ModelStatistics& high_late_statistics = manager.statistics("high_late");
+  const ModelStatistics& high_early_statistics = manager.statistics("high_early");
+  ASSERT_LT(high_early_statistics.last_finish_time, high_late_statistics.last_finish_time);
+  ASSERT_LT(high_late_statistics.last_finish_time, low_statistics.last_finish_time);
+}
@@ -0,0 +1,136 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "runtime/pipeline_executor.hpp"
+
+TEST(test_runtime, pipeline_partition_stages) {
+  using namespace kuiper_infer;
+  const std::vector<double> costs{1., 2., 3., 4., 5., 6., 7., 8., 9.};
+  ASSERT_EQ(PipelineExecutor::PartitionStages(costs, 3), (std::vector<uint32_t>{5, 7, 9}));
+  ASSERT_EQ(PipelineExecutor::PartitionStages(costs, 1), (std::vector<uint32_t>{9}));
+
+  // 阶段数多于步骤数时每个步骤一个阶段
+  const std::vector<double> small_costs{1., 1.};
+  ASSERT_EQ(PipelineExecutor::PartitionStages(small_costs, 4), (std::vector<uint32_t>{1, 2}));
+}
+
+TEST(test_runtime, pipeline_executor_yolo) {
+  using namespace kuiper_infer;
+  const std::string param_path = "tmp/yolo/demo/yolov5n_small.pnnx.param";
+  const std::string bin_path = "tmp/yolo/demo/yolov5n_small.pnnx.bin";
+  const uint32_t frame_count = 6;
+
+  std::vector<std::vector<sftensor>> frames;
+  for (uint32_t i = 0; i < frame_count; ++i) {
+    std::vector<sftensor> inputs;
+    for (uint32_t j = 0; j < 4; ++j) {
+      sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+      input->RandU(0.f, 1.f);
+      inputs.push_back(input);
+    }
+    frames.push_back(inputs);
+  }
+
+  auto graph = std::make_shared<RuntimeGraph>(param_path, bin_path);
+  PipelineExecutor executor(graph, "pnnx_input_0", "pnnx_output_0", frames.front(), 3);
+  std::thread producer([&]() {
+    for (const auto& inputs : frames) {
+      executor.Push(inputs);
+    }
+    executor.Stop();
+  });
+
+  RuntimeGraph reference_graph(param_path, bin_path);
+  reference_graph.Build();
+  uint32_t popped_count = 0;
+  std::vector<sftensor> outputs;
+  while (executor.Pop(outputs)) {
+    ASSERT_LT(popped_count, frame_count);
+    reference_graph.set_inputs("pnnx_input_0", frames.at(popped_count));
+    reference_graph.Forward(false);
+    const std::vector<sftensor>& reference_outputs = reference_graph.get_outputs("pnnx_output_0");
+    ASSERT_EQ(outputs.size(), reference_outputs.size());
+    for (uint32_t i = 0; i < outputs.size(); ++i) {
+      ASSERT_EQ(outputs.at(i)->shapes(), reference_outputs.at(i)->shapes());
+      for (uint32_t j = 0; j < outputs.at(i)->size(); ++j) {
+        ASSERT_NEAR(outputs.at(i)->index(j), reference_outputs.at(i)->index(j), 1e-4f);
+      }
+    }
+    popped_count += 1;
+  }
+  producer.join();
+  ASSERT_EQ(popped_count, frame_count);
+
+  const PipelineStatistics statistics = executor.statistics();
+  ASSERT_EQ(statistics.frame_count, frame_count);
+  ASSERT_EQ(statistics.stages.size(), 3);
+  ASSERT_EQ(statistics.stages.back().end_step, graph->execution_step_count());
+  for (const PipelineStageStatistics& stage : statistics.stages) {
+    ASSERT_LT(stage.begin_step, stage.end_step);
+    ASSERT_GT(stage.busy_time, 0.);
+  }
+}
+
+TEST(test_runtime, pipeline_stages_restore) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                     "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph.Build();
+  std::vector<std::string> inplace_ops;
+  for (const auto& op : graph.operators()) {
+    if (op->is_inplace) {
+      inplace_ops.push_back(op->name);
+    }
+  }
+  ASSERT_FALSE(inplace_ops.empty());
+  const size_t activation_bytes = graph.activation_bytes();
+
+  // 跨阶段的原地算子改用自己的输出空间
+  const std::vector<double> costs(graph.execution_step_count(), 1.);
+  const std::vector<uint32_t> stage_ends = PipelineExecutor::PartitionStages(costs, 4);
+  graph.set_pipeline_stages(stage_ends);
+  const size_t stage_activation_bytes = graph.activation_bytes();
+  ASSERT_GE(stage_activation_bytes, activation_bytes);
+
+  // 重新划分阶段不会累积额外的输出空间
+  graph.set_pipeline_stages(PipelineExecutor::PartitionStages(costs, 2));
+  graph.set_pipeline_stages(stage_ends);
+  ASSERT_EQ(graph.activation_bytes(), stage_activation_bytes);
+
+  // 删除阶段后和刚构建的图相同
+  graph.set_pipeline_stages({});
+  ASSERT_EQ(graph.activation_bytes(), activation_bytes);
+  std::vector<std::string> restored_inplace_ops;
+  for (const auto& op : graph.operators()) {
+    if (!op->is_inplace) {
+      continue;
+    }
+    restored_inplace_ops.push_back(op->name);
+    const std::string& producer_name = op->input_operands_seq.front()->name;
+    for (const auto& producer : graph.operators()) {
+      if (producer->name == producer_name) {
+        ASSERT_EQ(producer->output_operands->datas, op->output_operands->datas);
+      }
+    }
+  }
+  ASSERT_EQ(restored_inplace_ops, inplace_ops);
+}
@@ -21,8 +21,12 @@
 
 // Created by fss on 23-1-29.
 #include <gtest/gtest.h>
+#include <cmath>
+#include <fstream>
 #include "data/load_data.hpp"
+#include "data/tensor_util.hpp"
 #include "runtime/runtime_ir.hpp"
+#include "runtime/tuning_cache.hpp"
 
 TEST(test_runtime, runtime_graph_input_init1) {
   using namespace kuiper_infer;
@@ -605,3 +609,296 @@ TEST(test_runtime, op_is_output) {
   ASSERT_EQ(graph.is_output_op("pnnx_output_0"), true);
   ASSERT_EQ(graph.is_output_op("random_str"), false);
 }
+
+TEST(test_runtime, inplace_operators) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                     "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph.Build();
+
+  uint32_t inplace_count = 0;
+  for (const auto& op : graph.operators()) {
+    if (!op->is_inplace) {
+      continue;
+    }
+    inplace_count += 1;
+    ASSERT_EQ(op->type, "nn.SiLU");
+    ASSERT_EQ(op->input_operands_seq.size(), 1);
+
+    const std::string& producer_name = op->input_operands_seq.front()->name;
+    ASSERT_EQ(graph.is_input_op(producer_name), false);
+    for (const auto& producer : graph.operators()) {
+      if (producer->name == producer_name) {
+        ASSERT_EQ(producer->output_operators.size(), 1);
+        ASSERT_EQ(producer->output_operands->datas, op->output_operands->datas);
+      }
+    }
+  }
+  ASSERT_GT(inplace_count, 0);
+}
+
+TEST(test_runtime, tiled_execution) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph1("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                      "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph1.Build();
+  ASSERT_TRUE(graph1.tiled_chains().empty());
+
+  RuntimeGraph graph2("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                      "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph2.set_tiled_execution(true);
+  graph2.Build();
+  ASSERT_FALSE(graph2.tiled_chains().empty());
+
+  const uint32_t batch_size = 4;
+  std::vector<sftensor> inputs;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+    input->RandU(0.f, 1.f);
+    inputs.push_back(input);
+  }
+
+  graph1.set_inputs("pnnx_input_0", inputs);
+  graph1.Forward(false);
+  graph2.set_inputs("pnnx_input_0", inputs);
+  graph2.Forward(false);
+
+  const std::vector<sftensor>& outputs1 = graph1.get_outputs("pnnx_output_0");
+  const std::vector<sftensor>& outputs2 = graph2.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs1.size(), outputs2.size());
+  for (uint32_t i = 0; i < outputs1.size(); ++i) {
+    ASSERT_EQ(outputs1.at(i)->shapes(), outputs2.at(i)->shapes());
+    for (uint32_t j = 0; j < outputs1.at(i)->size(); ++j) {
+      ASSERT_NEAR(outputs1.at(i)->index(j), outputs2.at(i)->index(j), 1e-3f);
+    }
+  }
+}
+
+TEST(test_runtime, autotune_cache) {
+  using namespace kuiper_infer;
+  const std::string cache_path = "./tmp/autotune.cache";
+  std::remove(cache_path.c_str());
+
+  RuntimeGraph graph1("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                      "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph1.set_autotune(true, cache_path);
+  graph1.Build();
+
+  // 缓存的每一行是CPU型号, 层签名和实现名
+  std::ifstream cache_file(cache_path);
+  ASSERT_TRUE(cache_file.is_open());
+  std::string line;
+  uint32_t line_count = 0;
+  while (std::getline(cache_file, line)) {
+    ASSERT_EQ(line.substr(0, line.find('\t')), TuningCache::cpu_key());
+    ASSERT_EQ(std::count(line.begin(), line.end(), '\t'), 2);
+    line_count += 1;
+  }
+  ASSERT_GT(line_count, 0);
+
+  RuntimeGraph graph2("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                      "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph2.set_autotune(true, cache_path);
+  graph2.Build();
+  for (uint32_t i = 0; i < graph1.operators().size(); ++i) {
+    const auto& layer1 = graph1.operators().at(i)->layer;
+    const auto& layer2 = graph2.operators().at(i)->layer;
+    if (layer1 != nullptr && !layer1->tuning_choices().empty()) {
+      ASSERT_EQ(layer1->tuning_signature(), layer2->tuning_signature());
+    }
+  }
+
+  const uint32_t batch_size = 4;
+  std::vector<sftensor> inputs;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+    input->Fill(127.f);
+    inputs.push_back(input);
+  }
+  graph2.set_inputs("pnnx_input_0", inputs);
+  graph2.Forward(false);
+  const std::vector<sftensor>& outputs = graph2.get_outputs("pnnx_output_0");
+  const auto& expected = CSVDataLoader::LoadData<float>("tmp/yolo/1.csv");
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    ASSERT_EQ(expected.size(), outputs.at(i)->size());
+    for (uint32_t r = 0; r < expected.n_rows; ++r) {
+      for (uint32_t c = 0; c < expected.n_cols; ++c) {
+        ASSERT_LE(std::abs(expected.at(r, c) - outputs.at(i)->at(0, r, c)), 0.05);
+      }
+    }
+  }
+}
+
+TEST(test_runtime, partial_forward) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph1("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                      "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph1.Build();
+  RuntimeGraph graph2("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                      "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph2.Build();
+
+  const uint32_t batch_size = 4;
+  std::vector<sftensor> inputs;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+    input->RandU(0.f, 1.f);
+    inputs.push_back(input);
+  }
+  graph1.set_inputs("pnnx_input_0", inputs);
+  graph1.Forward(false);
+  graph2.set_inputs("pnnx_input_0", inputs);
+
+  // 只请求中间的一个卷积, 它下游的算子都不执行
+  const auto& operators = graph2.operators();
+  std::string conv_name;
+  for (uint32_t i = operators.size() / 2; i < operators.size() && conv_name.empty(); ++i) {
+    if (operators.at(i)->type == "nn.Conv2d") {
+      conv_name = operators.at(i)->name;
+    }
+  }
+  ASSERT_FALSE(conv_name.empty());
+  const auto& conv_outputs = graph2.PartialForward({conv_name});
+  ASSERT_EQ(conv_outputs.at(conv_name).size(), batch_size);
+  for (const auto& op : operators) {
+    if (graph2.is_output_op(op->name)) {
+      ASSERT_FALSE(op->has_forward);
+    }
+  }
+
+  // 从缓存的卷积输出继续执行, 结果和完整的Forward相同
+  std::vector<sftensor> cached;
+  for (const sftensor& conv_output : conv_outputs.at(conv_name)) {
+    cached.push_back(TensorClone(conv_output));
+  }
+  const auto& outputs = graph2.PartialForward({"pnnx_output_0"}, {{conv_name, cached}});
+  const std::vector<sftensor>& outputs1 = graph1.get_outputs("pnnx_output_0");
+  const std::vector<sftensor>& outputs2 = outputs.at("pnnx_output_0");
+  ASSERT_EQ(outputs1.size(), outputs2.size());
+  for (uint32_t i = 0; i < outputs1.size(); ++i) {
+    ASSERT_EQ(outputs1.at(i)->shapes(), outputs2.at(i)->shapes());
+    for (uint32_t j = 0; j < outputs1.at(i)->size(); ++j) {
+      ASSERT_NEAR(outputs1.at(i)->index(j), outputs2.at(i)->index(j), 1e-4f);
+    }
+  }
+}
+
+TEST(test_runtime, fold_and_prune) {
+  using namespace kuiper_infer;
+  RuntimeGraph graph("tmp/yolo/demo/yolov5n_small.pnnx.param",
+                     "tmp/yolo/demo/yolov5n_small.pnnx.bin");
+  graph.Build();
+
+  // 构建后只剩依赖图输入并影响图输出的算子
+  for (const auto& op : graph.operators()) {
+    ASSERT_NE(op->type, "pnnx.Attribute");
+    if (!graph.is_input_op(op->name)) {
+      ASSERT_FALSE(op->input_operands.empty());
+    }
+    if (!graph.is_output_op(op->name)) {
+      ASSERT_FALSE(op->output_operators.empty());
+    }
+  }
+
+  std::vector<sftensor> inputs;
+  for (uint32_t i = 0; i < 4; ++i) {
+    sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+    input->RandU(0.f, 1.f);
+    inputs.push_back(input);
+  }
+  graph.set_inputs("pnnx_input_0", inputs);
+  graph.Forward(false);
+  ASSERT_EQ(graph.get_outputs("pnnx_output_0").size(), 4);
+}
+
+TEST(test_runtime, half_precision_activations) {
+  using namespace kuiper_infer;
+  const std::string param_path = "tmp/yolo/demo/yolov5n_small.pnnx.param";
+  const std::string bin_path = "tmp/yolo/demo/yolov5n_small.pnnx.bin";
+  RuntimeGraph graph1(param_path, bin_path);
+  graph1.Build();
+
+  std::vector<sftensor> inputs;
+  for (uint32_t i = 0; i < 4; ++i) {
+    sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+    input->RandU(0.f, 1.f);
+    inputs.push_back(input);
+  }
+  graph1.set_inputs("pnnx_input_0", inputs);
+  graph1.Forward(false);
+  const std::vector<sftensor>& outputs1 = graph1.get_outputs("pnnx_output_0");
+
+  for (ActivationPrecision precision : {ActivationPrecision::kFP16, ActivationPrecision::kBF16}) {
+    RuntimeGraph graph2(param_path, bin_path);
+    graph2.set_activation_precision(precision);
+    graph2.Build();
+    ASSERT_LT(graph2.activation_bytes(), graph1.activation_bytes());
+
+    // 两次推理的结果相同, 复用的单精度张量不会被错误覆盖
+    for (uint32_t repeat = 0; repeat < 2; ++repeat) {
+      graph2.set_inputs("pnnx_input_0", inputs);
+      graph2.Forward(false);
+      const std::vector<sftensor>& outputs2 = graph2.get_outputs("pnnx_output_0");
+      ASSERT_EQ(outputs1.size(), outputs2.size());
+      double error = 0.;
+      double norm = 0.;
+      for (uint32_t i = 0; i < outputs1.size(); ++i) {
+        ASSERT_EQ(outputs1.at(i)->shapes(), outputs2.at(i)->shapes());
+        for (uint32_t j = 0; j < outputs1.at(i)->size(); ++j) {
+          const double diff = outputs1.at(i)->index(j) - outputs2.at(i)->index(j);
+          error += diff * diff;
+          norm += double(outputs1.at(i)->index(j)) * outputs1.at(i)->index(j);
+        }
+      }
+      const double max_error = precision == ActivationPrecision::kFP16 ? 1e-2 : 5e-2;
+      ASSERT_LT(std::sqrt(error / norm), max_error) << ActivationPrecisionName(precision);
+    }
+  }
+}
+
+TEST(test_runtime, memory_budget_micro_batch) {
+  using namespace kuiper_infer;
+  const std::string param_path = "tmp/yolo/demo/yolov5n_small.pnnx.param";
+  const std::string bin_path = "tmp/yolo/demo/yolov5n_small.pnnx.bin";
+  RuntimeGraph graph1(param_path, bin_path);
+  graph1.Build();
+  ASSERT_EQ(graph1.micro_batch_size(), 0);
+
+  RuntimeGraph graph2(param_path, bin_path);
+  graph2.set_memory_budget(graph1.activation_bytes() / 2);
+  graph2.Build();
+  ASSERT_GE(graph2.micro_batch_size(), 1);
+  ASSERT_LT(graph2.micro_batch_size(), 4);
+  ASSERT_LT(graph2.activation_bytes(), graph1.activation_bytes());
+
+  // 输入的数量可以超过模型的批次, 最后一个微批次不满
+  const uint32_t input_size = 9;
+  std::vector<sftensor> inputs;
+  for (uint32_t i = 0; i < input_size; ++i) {
+    sftensor input = std::make_shared<Tensor<float>>(3, 320, 320);
+    input->RandU(0.f, 1.f);
+    inputs.push_back(input);
+  }
+  graph2.set_inputs("pnnx_input_0", inputs);
+  graph2.Forward(false);
+  const std::vector<sftensor>& outputs2 = graph2.get_outputs("pnnx_output_0");
+  ASSERT_EQ(outputs2.size(), input_size);
+
+  for (uint32_t begin = 0; begin < input_size; begin += 4) {
+    std::vector<sftensor> batch_inputs;
+    for (uint32_t i = 0; i < 4; ++i) {
+      batch_inputs.push_back(inputs.at(std::min(begin + i, input_size - 1)));
+    }
+    graph1.set_inputs("pnnx_input_0", batch_inputs);
+    graph1.Forward(false);
+    const std::vector<sftensor>& outputs1 = graph1.get_outputs("pnnx_output_0");
+    for (uint32_t i = 0; i < 4 && begin + i < input_size; ++i) {
+      const sftensor& output1 = outputs1.at(i);
+      const sftensor& output2 = outputs2.at(begin + i);
+      ASSERT_EQ(output1->shapes(), output2->shapes());
+      for (uint32_t j = 0; j < output1->size(); ++j) {
+        ASSERT_NEAR(output1->index(j), output2->index(j), 1e-4f);
+      }
+    }
+  }
+}
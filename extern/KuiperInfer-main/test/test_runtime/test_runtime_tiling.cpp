@@ -0,0 +1,131 @@
+// MIT License
+// Copyright (c) 2022 - 傅莘莘
+// Source URL: https://github.com/zjhellofss/KuiperInfer
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "../../source/layer/details/batchnorm2d.hpp"
+#include "../../source/layer/details/convolution.hpp"
+#include "../../source/layer/details/maxpooling.hpp"
+#include "../../source/layer/details/relu.hpp"
+#include "runtime/runtime_tiling.hpp"
+
+using namespace kuiper_infer;
+
+static std::shared_ptr<Layer<float>> CreateConvolution(uint32_t in_channel, uint32_t kernel_count,
+                                                       uint32_t kernel_size, uint32_t padding,
+                                                       uint32_t stride, uint32_t dilation) {
+  auto conv_layer =
+      std::make_shared<ConvolutionLayer>(kernel_count, in_channel, kernel_size, kernel_size,
+                                         padding, padding, stride, stride, 1, true, 0, 0,
+                                         dilation, dilation);
+  std::vector<sftensor> weights;
+  std::vector<float> bias;
+  for (uint32_t k = 0; k < kernel_count; ++k) {
+    sftensor kernel = std::make_shared<ftensor>(in_channel, kernel_size, kernel_size);
+    kernel->RandN();
+    weights.push_back(kernel);
+    bias.push_back(float(k) * 0.1f);
+  }
+  conv_layer->set_weights(weights);
+  conv_layer->set_bias(bias);
+  return conv_layer;
+}
+
+TEST(test_runtime, tiled_chain_forward) {
+  // conv -> bn -> relu -> maxpool -> conv(dilation) -> conv(stride 2)
+  std::vector<std::shared_ptr<Layer<float>>> layers;
+  layers.push_back(CreateConvolution(3, 8, 3, 1, 1, 1));
+  auto bn_layer = std::make_shared<BatchNorm2dLayer>(8, 1e-5f, std::vector<float>(8, 2.f),
+                                                     std::vector<float>(8, -0.5f));
+  bn_layer->set_weights(std::vector<float>(8, 0.1f));
+  bn_layer->set_bias(std::vector<float>(8, 1.f));
+  layers.push_back(bn_layer);
+  layers.push_back(std::make_shared<ReluLayer>());
+  layers.push_back(std::make_shared<MaxPoolingLayer>(1, 1, 3, 3, 2, 2));
+  layers.push_back(CreateConvolution(8, 6, 3, 2, 1, 2));
+  layers.push_back(CreateConvolution(6, 4, 3, 1, 2, 1));
+
+  const uint32_t batch_size = 2;
+  std::vector<sftensor> inputs;
+  for (uint32_t i = 0; i < batch_size; ++i) {
+    sftensor input = std::make_shared<ftensor>(3, 61, 47);
+    input->RandN();
+    inputs.push_back(input);
+  }
+
+  // 逐层执行整个特征图作为参考
+  std::vector<std::vector<uint32_t>> shapes = {inputs.front()->shapes()};
+  std::vector<sftensor> expected = inputs;
+  for (const auto& layer : layers) {
+    std::vector<sftensor> outputs(batch_size);
+    ASSERT_EQ(layer->Forward(expected, outputs), StatusCode::kSuccess);
+    shapes.push_back(outputs.front()->shapes());
+    expected = outputs;
+  }
+  ASSERT_TRUE(TiledLayerChain::IsTileable(layers, shapes));
+
+  // 较小的缓存预算会切分出很多块, 覆盖边缘填充和内部的光环
+  for (uint32_t cache_size : {4u * 1024u, 32u * 1024u, 1024u * 1024u}) {
+    TiledLayerChain tiled_chain(layers, shapes, batch_size, cache_size);
+    std::vector<sftensor> outputs(batch_size);
+    ASSERT_EQ(tiled_chain.Forward(inputs, outputs), StatusCode::kSuccess);
+    for (uint32_t b = 0; b < batch_size; ++b) {
+      ASSERT_EQ(outputs.at(b)->shapes(), expected.at(b)->shapes());
+      for (uint32_t i = 0; i < expected.at(b)->size(); ++i) {
+        ASSERT_NEAR(outputs.at(b)->index(i), expected.at(b)->index(i), 1e-3f)
+            << "cache size " << cache_size << " tile count " << tiled_chain.tile_count();
+      }
+    }
+  }
+}
+
+TEST(test_runtime, tiled_chain_plan) {
+  std::vector<std::shared_ptr<Layer<float>>> layers;
+  layers.push_back(CreateConvolution(16, 32, 3, 1, 1, 1));
+  layers.push_back(std::make_shared<ReluLayer>());
+  layers.push_back(CreateConvolution(32, 32, 3, 1, 2, 1));
+  const std::vector<std::vector<uint32_t>> shapes = {
+      {16, 160, 160}, {32, 160, 160}, {32, 160, 160}, {32, 80, 80}};
+  ASSERT_TRUE(TiledLayerChain::IsTileable(layers, shapes));
+
+  std::vector<TileWindow> windows(layers.size());
+  for (uint32_t i = 0; i < layers.size(); ++i) {
+    ASSERT_TRUE(layers.at(i)->GetTileWindow(windows.at(i)));
+  }
+
+  const size_t cache_size = 512 * 1024;
+  const TileSize tile_size = TiledLayerChain::PlanTileSize(windows, shapes, cache_size, 8);
+  ASSERT_GT(tile_size.rows, 0);
+  ASSERT_GT(tile_size.cols, 0);
+  ASSERT_LE(TiledLayerChain::TileWorkingSet(windows, shapes, tile_size), cache_size);
+  const uint32_t tile_count =
+      ((80 + tile_size.rows - 1) / tile_size.rows) * ((80 + tile_size.cols - 1) / tile_size.cols);
+  ASSERT_GE(tile_count, 8);
+
+  // 整个特征图放得下缓存时不切分
+  const TileSize full_size = TiledLayerChain::PlanTileSize(windows, shapes, SIZE_MAX, 1);
+  ASSERT_EQ(full_size.rows, 80);
+  ASSERT_EQ(full_size.cols, 80);
+
+  // 填充不小于卷积核时不能分块
+  std::vector<std::shared_ptr<Layer<float>>> padded_layers = {
+      CreateConvolution(16, 32, 3, 3, 1, 1)};
+  ASSERT_FALSE(TiledLayerChain::IsTileable(padded_layers, {{16, 20, 20}, {32, 24, 24}}));
+}
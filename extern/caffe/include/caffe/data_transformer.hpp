@@ -37,6 +37,22 @@ class DataTransformer {
    */
   void Transform(const Datum& datum, Blob<Dtype>* transformed_blob);
 
+  /**
+   * @brief Same as Transform(datum, transformed_blob), but reads the data
+   * field from a buffer outside of the Datum.
+   *
+   * @param datum
+   *    Datum holding every field of the record but the data field.
+   * @param data
+   *    The bytes of the data field, e.g. as found by ParseDatumInPlace.
+   * @param data_size
+   *    The number of bytes of data.
+   * @param transformed_blob
+   *    This is destination blob, as for Transform(datum, transformed_blob).
+   */
+  void Transform(const Datum& datum, const char* data, size_t data_size,
+                 Blob<Dtype>* transformed_blob);
+
   /**
    * @brief Applies the transformation defined in the data layer's
    * transform_param block to a vector of Datum.
@@ -138,7 +154,8 @@ class DataTransformer {
    */
   virtual int Rand(int n);
 
-  void Transform(const Datum& datum, Dtype* transformed_data);
+  void Transform(const Datum& datum, const char* data, size_t data_size,
+                 Dtype* transformed_data);
   // Tranformation parameters
   TransformationParameter param_;
 
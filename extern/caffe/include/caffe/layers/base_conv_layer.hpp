@@ -7,6 +7,7 @@
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/im2col.hpp"
+#include "caffe/util/worker_pool.hpp"
 
 namespace caffe {
 
@@ -30,17 +31,26 @@ class BaseConvolutionLayer : public Layer<Dtype> {
 
  protected:
   // Helper functions that abstract away the column buffer and gemm arguments.
-  // The last argument in forward_cpu_gemm is so that we can skip the im2col if
-  // we just called weight_cpu_gemm with the same input.
+  // The skip_im2col argument in forward_cpu_gemm is so that we can skip the
+  // im2col if we just called weight_cpu_gemm with the same input. The worker
+  // argument selects the column buffer of a worker of cpu_pool_, so that the
+  // workers may process different images of the batch concurrently.
   void forward_cpu_gemm(const Dtype* input, const Dtype* weights,
-      Dtype* output, bool skip_im2col = false);
+      Dtype* output, bool skip_im2col = false, int worker = 0);
   void forward_cpu_bias(Dtype* output, const Dtype* bias);
   void backward_cpu_gemm(const Dtype* input, const Dtype* weights,
-      Dtype* output);
+      Dtype* output, int worker = 0);
   void weight_cpu_gemm(const Dtype* input, const Dtype* output, Dtype*
-      weights);
+      weights, int worker = 0);
   void backward_cpu_bias(Dtype* bias, const Dtype* input);
 
+  // Weight gradients of the workers of cpu_pool_: worker 0 accumulates into
+  // the weight diff, the others into their own buffers, which are cleared
+  // before and added to the weight diff in worker order after a backward pass.
+  void clear_worker_weight_diffs();
+  Dtype* worker_weight_diff(int worker);
+  void sum_worker_weight_diffs();
+
 #ifndef CPU_ONLY
   void forward_gpu_gemm(const Dtype* col_input, const Dtype* weights,
       Dtype* output, bool skip_im2col = false);
@@ -93,7 +103,13 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   bool is_1x1_;
   bool force_nd_im2col_;
 
+  /// @brief The workers convolving the images of a batch in CPU mode.
+  shared_ptr<WorkerPool> cpu_pool_;
+
  private:
+  inline Blob<Dtype>& worker_col_buffer(int worker) {
+    return worker == 0 ? col_buffer_ : *worker_col_buffers_[worker - 1];
+  }
   // wrap im2col/col2im so we don't have to remember the (long) argument lists
   inline void conv_im2col_cpu(const Dtype* data, Dtype* col_buff) {
     if (!force_nd_im2col_ && num_spatial_axes_ == 2) {
@@ -167,6 +183,9 @@ class BaseConvolutionLayer : public Layer<Dtype> {
 
   Blob<Dtype> col_buffer_;
   Blob<Dtype> bias_multiplier_;
+  // Column buffers and weight gradients of the workers but the first one.
+  vector<shared_ptr<Blob<Dtype> > > worker_col_buffers_;
+  vector<shared_ptr<Blob<Dtype> > > worker_weight_diffs_;
 };
 
 }  // namespace caffe
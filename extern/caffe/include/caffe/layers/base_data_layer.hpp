@@ -9,6 +9,7 @@
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/blocking_queue.hpp"
+#include "caffe/util/worker_pool.hpp"
 
 namespace caffe {
 
@@ -75,6 +76,12 @@ class BasePrefetchingDataLayer :
   Batch<Dtype>* prefetch_current_;
 
   Blob<Dtype> transformed_data_;
+
+  // Workers loading the items of a batch in parallel, the prefetch thread
+  // being worker 0 (see DataParameter.transform_threads). Worker w transforms
+  // with transformers_[w], transformers_[0] is data_transformer_.
+  shared_ptr<WorkerPool> transform_pool_;
+  vector<shared_ptr<DataTransformer<Dtype> > > transformers_;
 };
 
 }  // namespace caffe
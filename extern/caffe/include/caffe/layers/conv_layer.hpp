@@ -58,6 +58,8 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
    *  first group and input channels 3-4 and output channels 5-8 into the second
    *  group.
    *  - bias_term (\b optional, default true). Whether to have a bias.
+   *  - cpu_threads (\b optional, default 1). The number of threads convolving
+   *    the images of a batch concurrently in CPU mode.
    *  - engine: convolution has CAFFE (matrix multiplication) and CUDNN (library
    *    kernels + stream parallelism) engines.
    */
@@ -77,6 +79,14 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual inline bool reverse_dimensions() { return false; }
   virtual void compute_output_shape();
+
+  // Forward and backward passes of image n of the batch on a worker of
+  // cpu_pool_.
+  void forward_cpu_item(const Dtype* bottom_data, const Dtype* weight,
+      const Dtype* bias, Dtype* top_data, int n, int worker);
+  void backward_cpu_item(const Dtype* top_diff, const Dtype* bottom_data,
+      const Dtype* weight, Dtype* bottom_diff, bool propagate_down, int n,
+      int worker);
 };
 
 }  // namespace caffe
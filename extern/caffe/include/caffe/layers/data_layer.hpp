@@ -1,6 +1,8 @@
 #ifndef CAFFE_DATA_LAYER_HPP_
 #define CAFFE_DATA_LAYER_HPP_
 
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -29,10 +31,21 @@ class DataLayer : public BasePrefetchingDataLayer<Dtype> {
   void Next();
   bool Skip();
   virtual void load_batch(Batch<Dtype>* batch);
+  // Parses and transforms one record of the batch on a transform worker.
+  void load_item(Dtype* top_data, Dtype* top_label, int item_id, int worker);
 
   shared_ptr<db::DB> db_;
   shared_ptr<db::Cursor> cursor_;
   uint64_t offset_;
+
+  // Records of the batch being loaded, read in order from the cursor. They
+  // point into the database when the backend keeps values in place, and
+  // into record_copies_ otherwise.
+  vector<std::pair<const char*, size_t> > records_;
+  vector<string> record_copies_;
+  // Datum and view into the batch of every transform worker.
+  vector<Datum> datums_;
+  vector<shared_ptr<Blob<Dtype> > > transformed_datas_;
 };
 
 }  // namespace caffe
@@ -44,6 +44,14 @@ class DeconvolutionLayer : public BaseConvolutionLayer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual inline bool reverse_dimensions() { return true; }
   virtual void compute_output_shape();
+
+  // Forward and backward passes of image n of the batch on a worker of
+  // cpu_pool_.
+  void forward_cpu_item(const Dtype* bottom_data, const Dtype* weight,
+      const Dtype* bias, Dtype* top_data, int n, int worker);
+  void backward_cpu_item(const Dtype* top_diff, const Dtype* bottom_data,
+      const Dtype* weight, Dtype* bottom_diff, bool propagate_down, int n,
+      int worker);
 };
 
 }  // namespace caffe
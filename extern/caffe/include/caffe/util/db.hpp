@@ -18,6 +18,9 @@ class Cursor {
   virtual void Next() = 0;
   virtual string key() = 0;
   virtual string value() = 0;
+  // Returns the current value in place, or NULL if the backend cannot keep
+  // it around. The memory stays valid until the cursor is destroyed.
+  virtual const char* value_data(size_t* size) { return NULL; }
   virtual bool valid() = 0;
 
   DISABLE_COPY_AND_ASSIGN(Cursor);
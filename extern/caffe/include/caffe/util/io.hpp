@@ -126,6 +126,12 @@ inline bool ReadImageToDatum(const string& filename, const int label,
   return ReadImageToDatum(filename, label, 0, 0, true, encoding, datum);
 }
 
+// Parses a serialized Datum without copying its data field: every other
+// field is parsed into datum, whose data is left empty, and data points at
+// the bytes of the data field inside record (NULL if there is none).
+bool ParseDatumInPlace(const char* record, size_t size, Datum* datum,
+    const char** data, size_t* data_size);
+
 bool DecodeDatumNative(Datum* datum);
 bool DecodeDatum(Datum* datum, bool is_color);
 
@@ -144,6 +150,10 @@ cv::Mat ReadImageToCVMat(const string& filename);
 cv::Mat DecodeDatumToCVMatNative(const Datum& datum);
 cv::Mat DecodeDatumToCVMat(const Datum& datum, bool is_color);
 
+// Decode the encoded image held by the data field of a Datum in place.
+cv::Mat DecodeDatumToCVMatNative(const char* data, size_t size);
+cv::Mat DecodeDatumToCVMat(const char* data, size_t size, bool is_color);
+
 void CVMatToDatum(const cv::Mat& cv_img, Datum* datum);
 #endif  // USE_OPENCV
 
@@ -0,0 +1,58 @@
+#ifndef CAFFE_UTIL_WORKER_POOL_HPP_
+#define CAFFE_UTIL_WORKER_POOL_HPP_
+
+#include <boost/function.hpp>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A fixed set of threads running the iterations of a loop in parallel.
+ *
+ * Run(count, func) calls func(i, worker) for every i in [0, count) and
+ * returns once all calls are done. Worker w always runs the iterations
+ * w, w + size(), w + 2 * size(), ... in increasing order, so per-worker state
+ * such as random generators or scratch buffers gives the same results from
+ * run to run. The calling thread acts as worker 0, a pool of size 1 runs the
+ * loop inline without starting any thread. The worker threads inherit the
+ * Caffe mode, device and solver settings of the thread creating the pool.
+ * Only one thread may call Run at a time.
+ */
+class WorkerPool {
+ public:
+  explicit WorkerPool(int size);
+  ~WorkerPool();
+
+  void Run(int count, const boost::function<void(int, int)>& func);
+
+  inline int size() const { return size_; }
+
+ protected:
+  /**
+   Move synchronization fields out instead of including boost/thread.hpp
+   to avoid a boost/NVCC issues (#1009, #1010) on OSX.
+   */
+  class sync;
+  class Worker;
+
+  void WorkerEntry(int worker);
+  void RunIterations(int worker);
+
+  int size_;
+  vector<shared_ptr<Worker> > workers_;
+  shared_ptr<sync> sync_;
+
+  // Loop of the current Run, guarded by sync_ when it changes.
+  const boost::function<void(int, int)>* func_;
+  int count_;
+  int generation_;
+  int pending_;
+
+DISABLE_COPY_AND_ASSIGN(WorkerPool);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_WORKER_POOL_HPP_
@@ -40,8 +40,7 @@ DataTransformer<Dtype>::DataTransformer(const TransformationParameter& param,
 
 template<typename Dtype>
 void DataTransformer<Dtype>::Transform(const Datum& datum,
-                                       Dtype* transformed_data) {
-  const string& data = datum.data();
+    const char* data, size_t data_size, Dtype* transformed_data) {
   const int datum_channels = datum.channels();
   const int datum_height = datum.height();
   const int datum_width = datum.width();
@@ -50,7 +49,7 @@ void DataTransformer<Dtype>::Transform(const Datum& datum,
   const Dtype scale = param_.scale();
   const bool do_mirror = param_.mirror() && Rand(2);
   const bool has_mean_file = param_.has_mean_file();
-  const bool has_uint8 = data.size() > 0;
+  const bool has_uint8 = data_size > 0;
   const bool has_mean_values = mean_values_.size() > 0;
 
   CHECK_GT(datum_channels, 0);
@@ -130,6 +129,13 @@ void DataTransformer<Dtype>::Transform(const Datum& datum,
 template<typename Dtype>
 void DataTransformer<Dtype>::Transform(const Datum& datum,
                                        Blob<Dtype>* transformed_blob) {
+  const string& data = datum.data();
+  Transform(datum, data.data(), data.size(), transformed_blob);
+}
+
+template<typename Dtype>
+void DataTransformer<Dtype>::Transform(const Datum& datum,
+    const char* data, size_t data_size, Blob<Dtype>* transformed_blob) {
   // If datum is encoded, decode and transform the cv::image.
   if (datum.encoded()) {
 #ifdef USE_OPENCV
@@ -138,9 +144,9 @@ void DataTransformer<Dtype>::Transform(const Datum& datum,
     cv::Mat cv_img;
     if (param_.force_color() || param_.force_gray()) {
     // If force_color then decode in color otherwise decode in gray.
-      cv_img = DecodeDatumToCVMat(datum, param_.force_color());
+      cv_img = DecodeDatumToCVMat(data, data_size, param_.force_color());
     } else {
-      cv_img = DecodeDatumToCVMatNative(datum);
+      cv_img = DecodeDatumToCVMatNative(data, data_size);
     }
     // Transform the cv::image into blob.
     return Transform(cv_img, transformed_blob);
@@ -178,7 +184,7 @@ void DataTransformer<Dtype>::Transform(const Datum& datum,
   }
 
   Dtype* transformed_data = transformed_blob->mutable_cpu_data();
-  Transform(datum, transformed_data);
+  Transform(datum, data, data_size, transformed_data);
 }
 
 template<typename Dtype>
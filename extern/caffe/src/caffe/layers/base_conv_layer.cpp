@@ -179,6 +179,15 @@ void BaseConvolutionLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   weight_offset_ = conv_out_channels_ * kernel_dim_ / group_;
   // Propagate gradients to the parameters (as directed by backward pass).
   this->param_propagate_down_.resize(this->blobs_.size(), true);
+  // Set up the workers, each but the first with its own buffers.
+  cpu_pool_.reset(new WorkerPool(conv_param.cpu_threads()));
+  worker_col_buffers_.clear();
+  worker_weight_diffs_.clear();
+  for (int w = 1; w < cpu_pool_->size(); ++w) {
+    worker_col_buffers_.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+    worker_weight_diffs_.push_back(shared_ptr<Blob<Dtype> >(
+        new Blob<Dtype>(this->blobs_[0]->shape())));
+  }
 }
 
 template <typename Dtype>
@@ -240,6 +249,9 @@ void BaseConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
     }
   }
   col_buffer_.Reshape(col_buffer_shape_);
+  for (int w = 0; w < worker_col_buffers_.size(); ++w) {
+    worker_col_buffers_[w]->Reshape(col_buffer_shape_);
+  }
   bottom_dim_ = bottom[0]->count(channel_axis_);
   top_dim_ = top[0]->count(channel_axis_);
   num_kernels_im2col_ = conv_in_channels_ * conv_out_spatial_dim_;
@@ -256,13 +268,14 @@ void BaseConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
 
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::forward_cpu_gemm(const Dtype* input,
-    const Dtype* weights, Dtype* output, bool skip_im2col) {
+    const Dtype* weights, Dtype* output, bool skip_im2col, int worker) {
+  Blob<Dtype>& col_buffer = worker_col_buffer(worker);
   const Dtype* col_buff = input;
   if (!is_1x1_) {
     if (!skip_im2col) {
-      conv_im2col_cpu(input, col_buffer_.mutable_cpu_data());
+      conv_im2col_cpu(input, col_buffer.mutable_cpu_data());
     }
-    col_buff = col_buffer_.cpu_data();
+    col_buff = col_buffer.cpu_data();
   }
   for (int g = 0; g < group_; ++g) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, conv_out_channels_ /
@@ -282,8 +295,8 @@ void BaseConvolutionLayer<Dtype>::forward_cpu_bias(Dtype* output,
 
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::backward_cpu_gemm(const Dtype* output,
-    const Dtype* weights, Dtype* input) {
-  Dtype* col_buff = col_buffer_.mutable_cpu_data();
+    const Dtype* weights, Dtype* input, int worker) {
+  Dtype* col_buff = worker_col_buffer(worker).mutable_cpu_data();
   if (is_1x1_) {
     col_buff = input;
   }
@@ -300,11 +313,12 @@ void BaseConvolutionLayer<Dtype>::backward_cpu_gemm(const Dtype* output,
 
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::weight_cpu_gemm(const Dtype* input,
-    const Dtype* output, Dtype* weights) {
+    const Dtype* output, Dtype* weights, int worker) {
+  Blob<Dtype>& col_buffer = worker_col_buffer(worker);
   const Dtype* col_buff = input;
   if (!is_1x1_) {
-    conv_im2col_cpu(input, col_buffer_.mutable_cpu_data());
-    col_buff = col_buffer_.cpu_data();
+    conv_im2col_cpu(input, col_buffer.mutable_cpu_data());
+    col_buff = col_buffer.cpu_data();
   }
   for (int g = 0; g < group_; ++g) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, conv_out_channels_ / group_,
@@ -321,6 +335,31 @@ void BaseConvolutionLayer<Dtype>::backward_cpu_bias(Dtype* bias,
       input, bias_multiplier_.cpu_data(), 1., bias);
 }
 
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::clear_worker_weight_diffs() {
+  for (int w = 0; w < worker_weight_diffs_.size(); ++w) {
+    caffe_set(worker_weight_diffs_[w]->count(), Dtype(0),
+        worker_weight_diffs_[w]->mutable_cpu_data());
+  }
+}
+
+template <typename Dtype>
+Dtype* BaseConvolutionLayer<Dtype>::worker_weight_diff(int worker) {
+  if (worker == 0) {
+    return this->blobs_[0]->mutable_cpu_diff();
+  }
+  return worker_weight_diffs_[worker - 1]->mutable_cpu_data();
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::sum_worker_weight_diffs() {
+  Dtype* weight_diff = this->blobs_[0]->mutable_cpu_diff();
+  for (int w = 0; w < worker_weight_diffs_.size(); ++w) {
+    caffe_axpy(worker_weight_diffs_[w]->count(), Dtype(1),
+        worker_weight_diffs_[w]->cpu_data(), weight_diff);
+  }
+}
+
 #ifndef CPU_ONLY
 
 template <typename Dtype>
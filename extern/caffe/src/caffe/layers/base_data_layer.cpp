@@ -1,4 +1,5 @@
 #include <boost/thread.hpp>
+#include <algorithm>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -71,6 +72,16 @@ void BasePrefetchingDataLayer<Dtype>::LayerSetUp(
 #endif
   DLOG(INFO) << "Initializing prefetch";
   this->data_transformer_->InitRand();
+  // Every worker needs its own random generator for the transformations.
+  const int transform_threads =
+      std::max<int>(this->layer_param_.data_param().transform_threads(), 1);
+  transformers_.assign(1, this->data_transformer_);
+  for (int i = 1; i < transform_threads; ++i) {
+    transformers_.push_back(shared_ptr<DataTransformer<Dtype> >(
+        new DataTransformer<Dtype>(this->transform_param_, this->phase_)));
+    transformers_.back()->InitRand();
+  }
+  transform_pool_.reset(new WorkerPool(transform_threads));
   StartInternalThread();
   DLOG(INFO) << "Prefetch initialized.";
 }
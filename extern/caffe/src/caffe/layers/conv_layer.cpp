@@ -1,3 +1,4 @@
+#include <boost/bind.hpp>
 #include <vector>
 
 #include "caffe/layers/conv_layer.hpp"
@@ -25,17 +26,27 @@ template <typename Dtype>
 void ConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   const Dtype* weight = this->blobs_[0]->cpu_data();
+  const Dtype* bias = NULL;
+  if (this->bias_term_) {
+    bias = this->blobs_[1]->cpu_data();
+  }
   for (int i = 0; i < bottom.size(); ++i) {
     const Dtype* bottom_data = bottom[i]->cpu_data();
     Dtype* top_data = top[i]->mutable_cpu_data();
-    for (int n = 0; n < this->num_; ++n) {
-      this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
-          top_data + n * this->top_dim_);
-      if (this->bias_term_) {
-        const Dtype* bias = this->blobs_[1]->cpu_data();
-        this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
-      }
-    }
+    this->cpu_pool_->Run(this->num_, boost::bind(
+        &ConvolutionLayer<Dtype>::forward_cpu_item, this, bottom_data, weight,
+        bias, top_data, _1, _2));
+  }
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::forward_cpu_item(const Dtype* bottom_data,
+    const Dtype* weight, const Dtype* bias, Dtype* top_data, int n,
+    int worker) {
+  this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
+      top_data + n * this->top_dim_, false, worker);
+  if (bias) {
+    this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
   }
 }
 
@@ -43,7 +54,6 @@ template <typename Dtype>
 void ConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {
   const Dtype* weight = this->blobs_[0]->cpu_data();
-  Dtype* weight_diff = this->blobs_[0]->mutable_cpu_diff();
   for (int i = 0; i < top.size(); ++i) {
     const Dtype* top_diff = top[i]->cpu_diff();
     const Dtype* bottom_data = bottom[i]->cpu_data();
@@ -56,22 +66,36 @@ void ConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
       }
     }
     if (this->param_propagate_down_[0] || propagate_down[i]) {
-      for (int n = 0; n < this->num_; ++n) {
-        // gradient w.r.t. weight. Note that we will accumulate diffs.
-        if (this->param_propagate_down_[0]) {
-          this->weight_cpu_gemm(bottom_data + n * this->bottom_dim_,
-              top_diff + n * this->top_dim_, weight_diff);
-        }
-        // gradient w.r.t. bottom data, if necessary.
-        if (propagate_down[i]) {
-          this->backward_cpu_gemm(top_diff + n * this->top_dim_, weight,
-              bottom_diff + n * this->bottom_dim_);
-        }
+      if (this->param_propagate_down_[0]) {
+        this->clear_worker_weight_diffs();
+      }
+      this->cpu_pool_->Run(this->num_, boost::bind(
+          &ConvolutionLayer<Dtype>::backward_cpu_item, this, top_diff,
+          bottom_data, weight, bottom_diff, propagate_down[i], _1, _2));
+      if (this->param_propagate_down_[0]) {
+        this->sum_worker_weight_diffs();
       }
     }
   }
 }
 
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::backward_cpu_item(const Dtype* top_diff,
+    const Dtype* bottom_data, const Dtype* weight, Dtype* bottom_diff,
+    bool propagate_down, int n, int worker) {
+  // gradient w.r.t. weight. Note that we will accumulate diffs.
+  if (this->param_propagate_down_[0]) {
+    this->weight_cpu_gemm(bottom_data + n * this->bottom_dim_,
+        top_diff + n * this->top_dim_, this->worker_weight_diff(worker),
+        worker);
+  }
+  // gradient w.r.t. bottom data, if necessary.
+  if (propagate_down) {
+    this->backward_cpu_gemm(top_diff + n * this->top_dim_, weight,
+        bottom_diff + n * this->bottom_dim_, worker);
+  }
+}
+
 #ifdef CPU_ONLY
 STUB_GPU(ConvolutionLayer);
 #endif
@@ -3,11 +3,13 @@
 #endif  // USE_OPENCV
 #include <stdint.h>
 
+#include <boost/bind.hpp>
 #include <vector>
 
 #include "caffe/data_transformer.hpp"
 #include "caffe/layers/data_layer.hpp"
 #include "caffe/util/benchmark.hpp"
+#include "caffe/util/io.hpp"
 
 namespace caffe {
 
@@ -88,41 +90,61 @@ void DataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   CHECK(batch->data_.count());
   CHECK(this->transformed_data_.count());
   const int batch_size = this->layer_param_.data_param().batch_size();
+  const int workers = this->transform_pool_->size();
 
-  Datum datum;
+  // The cursor is read in order on this thread, the records are then parsed
+  // and transformed by the workers.
+  timer.Start();
+  records_.resize(batch_size);
+  record_copies_.resize(batch_size);
   for (int item_id = 0; item_id < batch_size; ++item_id) {
-    timer.Start();
     while (Skip()) {
       Next();
     }
-    datum.ParseFromString(cursor_->value());
-    read_time += timer.MicroSeconds();
-
-    if (item_id == 0) {
-      // Reshape according to the first datum of each batch
-      // on single input batches allows for inputs of varying dimension.
-      // Use data_transformer to infer the expected blob shape from datum.
-      vector<int> top_shape = this->data_transformer_->InferBlobShape(datum);
-      this->transformed_data_.Reshape(top_shape);
-      // Reshape batch according to the batch_size.
-      top_shape[0] = batch_size;
-      batch->data_.Reshape(top_shape);
+    size_t size;
+    const char* value = cursor_->value_data(&size);
+    if (!value) {
+      record_copies_[item_id] = cursor_->value();
+      value = record_copies_[item_id].data();
+      size = record_copies_[item_id].size();
     }
+    records_[item_id] = std::make_pair(value, size);
+    Next();
+  }
+  datums_.resize(workers);
+  Datum datum;
+  datum.ParseFromArray(records_[0].first, records_[0].second);
+  read_time += timer.MicroSeconds();
 
-    // Apply data transformations (mirror, scale, crop...)
-    timer.Start();
-    int offset = batch->data_.offset(item_id);
-    Dtype* top_data = batch->data_.mutable_cpu_data();
-    this->transformed_data_.set_cpu_data(top_data + offset);
-    this->data_transformer_->Transform(datum, &(this->transformed_data_));
-    // Copy label.
-    if (this->output_labels_) {
-      Dtype* top_label = batch->label_.mutable_cpu_data();
-      top_label[item_id] = datum.label();
+  // Reshape according to the first datum of each batch
+  // on single input batches allows for inputs of varying dimension.
+  // Use data_transformer to infer the expected blob shape from datum.
+  vector<int> top_shape = this->data_transformer_->InferBlobShape(datum);
+  this->transformed_data_.Reshape(top_shape);
+  if (transformed_datas_.size() != workers) {
+    transformed_datas_.resize(workers);
+    for (int w = 0; w < workers; ++w) {
+      transformed_datas_[w].reset(new Blob<Dtype>());
     }
-    trans_time += timer.MicroSeconds();
-    Next();
   }
+  for (int w = 0; w < workers; ++w) {
+    transformed_datas_[w]->Reshape(top_shape);
+  }
+  // Reshape batch according to the batch_size.
+  top_shape[0] = batch_size;
+  batch->data_.Reshape(top_shape);
+  // The workers only write to their own items of the batch.
+  Dtype* top_data = batch->data_.mutable_cpu_data();
+  Dtype* top_label = NULL;
+  if (this->output_labels_) {
+    top_label = batch->label_.mutable_cpu_data();
+  }
+
+  // Apply data transformations (mirror, scale, crop...)
+  timer.Start();
+  this->transform_pool_->Run(batch_size, boost::bind(
+      &DataLayer<Dtype>::load_item, this, top_data, top_label, _1, _2));
+  trans_time += timer.MicroSeconds();
   timer.Stop();
   batch_timer.Stop();
   DLOG(INFO) << "Prefetch batch: " << batch_timer.MilliSeconds() << " ms.";
@@ -130,6 +152,28 @@ void DataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   DLOG(INFO) << "Transform time: " << trans_time / 1000 << " ms.";
 }
 
+// This function is called on the transform workers
+template<typename Dtype>
+void DataLayer<Dtype>::load_item(Dtype* top_data, Dtype* top_label,
+    int item_id, int worker) {
+  // Only the small fields are parsed, the image bytes are read from the
+  // record itself.
+  Datum& datum = datums_[worker];
+  const char* data;
+  size_t data_size;
+  CHECK(ParseDatumInPlace(records_[item_id].first, records_[item_id].second,
+      &datum, &data, &data_size)) << "Could not parse datum " << item_id;
+  Blob<Dtype>* transformed_data = transformed_datas_[worker].get();
+  int offset = transformed_data->count() * item_id;
+  transformed_data->set_cpu_data(top_data + offset);
+  this->transformers_[worker]->Transform(datum, data, data_size,
+      transformed_data);
+  // Copy label.
+  if (top_label) {
+    top_label[item_id] = datum.label();
+  }
+}
+
 INSTANTIATE_CLASS(DataLayer);
 REGISTER_LAYER_CLASS(Data);
 
@@ -420,5 +420,77 @@ TEST_F(IOTest, TestDecodeDatumToCVMatContentNative) {
   }
 }
 
+TEST_F(IOTest, TestParseDatumInPlace) {
+  string filename = EXAMPLES_SOURCE_DIR "images/cat.jpg";
+  Datum datum_ref;
+  EXPECT_TRUE(ReadImageToDatum(filename, 5, &datum_ref));
+  string record;
+  datum_ref.SerializeToString(&record);
+  Datum datum;
+  const char* data;
+  size_t data_size;
+  EXPECT_TRUE(ParseDatumInPlace(record.data(), record.size(), &datum,
+      &data, &data_size));
+  EXPECT_EQ(datum.channels(), datum_ref.channels());
+  EXPECT_EQ(datum.height(), datum_ref.height());
+  EXPECT_EQ(datum.width(), datum_ref.width());
+  EXPECT_EQ(datum.label(), 5);
+  EXPECT_FALSE(datum.encoded());
+  EXPECT_TRUE(datum.data().empty());
+  // The data is not copied.
+  EXPECT_GE(data, record.data());
+  EXPECT_LE(data + data_size, record.data() + record.size());
+  EXPECT_EQ(string(data, data_size), datum_ref.data());
+  // A truncated record is rejected.
+  EXPECT_FALSE(ParseDatumInPlace(record.data(), record.size() - 1, &datum,
+      &data, &data_size));
+}
+
+TEST_F(IOTest, TestParseDatumInPlaceFloat) {
+  Datum datum_ref;
+  datum_ref.set_channels(1);
+  datum_ref.set_height(2);
+  datum_ref.set_width(3);
+  for (int i = 0; i < 6; ++i) {
+    datum_ref.add_float_data(i);
+  }
+  string record;
+  datum_ref.SerializeToString(&record);
+  Datum datum;
+  const char* data;
+  size_t data_size;
+  EXPECT_TRUE(ParseDatumInPlace(record.data(), record.size(), &datum,
+      &data, &data_size));
+  EXPECT_TRUE(data == NULL);
+  EXPECT_EQ(datum.float_data_size(), 6);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(datum.float_data(i), i);
+  }
+}
+
+TEST_F(IOTest, TestDecodeDatumToCVMatInPlace) {
+  string filename = EXAMPLES_SOURCE_DIR "images/cat.jpg";
+  Datum datum_ref;
+  EXPECT_TRUE(ReadImageToDatum(filename, 0, std::string("jpg"), &datum_ref));
+  string record;
+  datum_ref.SerializeToString(&record);
+  Datum datum;
+  const char* data;
+  size_t data_size;
+  EXPECT_TRUE(ParseDatumInPlace(record.data(), record.size(), &datum,
+      &data, &data_size));
+  EXPECT_TRUE(datum.encoded());
+  cv::Mat cv_img = DecodeDatumToCVMat(data, data_size, true);
+  cv::Mat cv_img_ref = DecodeDatumToCVMat(datum_ref, true);
+  EXPECT_EQ(cv_img_ref.channels(), cv_img.channels());
+  EXPECT_EQ(cv_img_ref.rows, cv_img.rows);
+  EXPECT_EQ(cv_img_ref.cols, cv_img.cols);
+  EXPECT_EQ(0, cv::countNonZero(cv_img.reshape(1) != cv_img_ref.reshape(1)));
+  cv_img = DecodeDatumToCVMatNative(data, data_size);
+  EXPECT_EQ(cv_img.channels(), 3);
+  EXPECT_EQ(cv_img.rows, 360);
+  EXPECT_EQ(cv_img.cols, 480);
+}
+
 }  // namespace caffe
 #endif  // USE_OPENCV
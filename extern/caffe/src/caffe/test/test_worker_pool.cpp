@@ -0,0 +1,54 @@
+#include <boost/bind.hpp>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/worker_pool.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class WorkerPoolTest : public ::testing::Test {
+ protected:
+  void Record(int i, int worker) {
+    workers_[i] = worker;
+    ++calls_[i];
+  }
+
+  void TestRun(int size, int count) {
+    WorkerPool pool(size);
+    EXPECT_EQ(size, pool.size());
+    for (int repeat = 0; repeat < 3; ++repeat) {
+      workers_.assign(count, -1);
+      calls_.assign(count, 0);
+      pool.Run(count, boost::bind(&WorkerPoolTest::Record, this, _1, _2));
+      for (int i = 0; i < count; ++i) {
+        EXPECT_EQ(1, calls_[i]);
+        EXPECT_EQ(i % size, workers_[i]);
+      }
+    }
+  }
+
+  vector<int> workers_;
+  vector<int> calls_;
+};
+
+TEST_F(WorkerPoolTest, TestRunInline) {
+  this->TestRun(1, 10);
+}
+
+TEST_F(WorkerPoolTest, TestRunWorkers) {
+  this->TestRun(4, 10);
+}
+
+TEST_F(WorkerPoolTest, TestRunFewerIterations) {
+  this->TestRun(4, 2);
+}
+
+TEST_F(WorkerPoolTest, TestRunEmpty) {
+  this->TestRun(3, 0);
+}
+
+}  // namespace caffe
@@ -1,7 +1,9 @@
 #include <fcntl.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <google/protobuf/text_format.h>
+#include <google/protobuf/wire_format_lite.h>
 #ifdef USE_OPENCV
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -29,6 +31,8 @@ using google::protobuf::io::ZeroCopyInputStream;
 using google::protobuf::io::CodedInputStream;
 using google::protobuf::io::ZeroCopyOutputStream;
 using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::StringOutputStream;
+using google::protobuf::internal::WireFormatLite;
 using google::protobuf::Message;
 
 bool ReadProtoFromTextFile(const char* filename, Message* proto) {
@@ -162,26 +166,67 @@ bool ReadFileToDatum(const string& filename, const int label,
   }
 }
 
+bool ParseDatumInPlace(const char* record, size_t size, Datum* datum,
+    const char** data, size_t* data_size) {
+  CodedInputStream input(reinterpret_cast<const uint8_t*>(record), size);
+  // Copy every field but data aside and parse them at once, so the fields
+  // keep the usual last-one-wins semantics.
+  string fields;
+  {
+    StringOutputStream fields_stream(&fields);
+    CodedOutputStream fields_output(&fields_stream);
+    *data = NULL;
+    *data_size = 0;
+    for (uint32_t tag = input.ReadTag(); tag != 0; tag = input.ReadTag()) {
+      if (WireFormatLite::GetTagFieldNumber(tag) == Datum::kDataFieldNumber &&
+          WireFormatLite::GetTagWireType(tag) ==
+          WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+        uint32_t length;
+        if (!input.ReadVarint32(&length)) {
+          return false;
+        }
+        *data = record + input.CurrentPosition();
+        *data_size = length;
+        if (!input.Skip(length)) {
+          return false;
+        }
+      } else if (!WireFormatLite::SkipField(&input, tag, &fields_output)) {
+        return false;
+      }
+    }
+  }
+  if (input.CurrentPosition() != size) {
+    return false;
+  }
+  return datum->ParseFromString(fields);
+}
+
 #ifdef USE_OPENCV
 cv::Mat DecodeDatumToCVMatNative(const Datum& datum) {
-  cv::Mat cv_img;
   CHECK(datum.encoded()) << "Datum not encoded";
   const string& data = datum.data();
-  std::vector<char> vec_data(data.c_str(), data.c_str() + data.size());
-  cv_img = cv::imdecode(vec_data, -1);
+  return DecodeDatumToCVMatNative(data.data(), data.size());
+}
+cv::Mat DecodeDatumToCVMat(const Datum& datum, bool is_color) {
+  CHECK(datum.encoded()) << "Datum not encoded";
+  const string& data = datum.data();
+  return DecodeDatumToCVMat(data.data(), data.size(), is_color);
+}
+
+cv::Mat DecodeDatumToCVMatNative(const char* data, size_t size) {
+  // Wrap the encoded bytes without copying them.
+  const cv::Mat buffer(1, size, CV_8UC1, const_cast<char*>(data));
+  cv::Mat cv_img = cv::imdecode(buffer, -1);
   if (!cv_img.data) {
     LOG(ERROR) << "Could not decode datum ";
   }
   return cv_img;
 }
-cv::Mat DecodeDatumToCVMat(const Datum& datum, bool is_color) {
-  cv::Mat cv_img;
-  CHECK(datum.encoded()) << "Datum not encoded";
-  const string& data = datum.data();
-  std::vector<char> vec_data(data.c_str(), data.c_str() + data.size());
+cv::Mat DecodeDatumToCVMat(const char* data, size_t size, bool is_color) {
+  const cv::Mat buffer(1, size, CV_8UC1, const_cast<char*>(data));
   int cv_read_flag = (is_color ? CV_LOAD_IMAGE_COLOR :
     CV_LOAD_IMAGE_GRAYSCALE);
-  cv_img = cv::imdecode(vec_data, cv_read_flag);
+  cv::Mat cv_img = cv::imdecode(buffer, cv_read_flag);
   if (!cv_img.data) {
     LOG(ERROR) << "Could not decode datum ";
   }
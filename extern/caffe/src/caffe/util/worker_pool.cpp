@@ -0,0 +1,101 @@
+#include <boost/thread.hpp>
+#include <vector>
+
+#include "caffe/internal_thread.hpp"
+#include "caffe/util/worker_pool.hpp"
+
+namespace caffe {
+
+class WorkerPool::sync {
+ public:
+  boost::mutex mutex_;
+  boost::condition_variable start_;
+  boost::condition_variable done_;
+};
+
+class WorkerPool::Worker : public InternalThread {
+ public:
+  Worker(WorkerPool* pool, int worker)
+      : pool_(pool), worker_(worker) {}
+  virtual ~Worker() { StopInternalThread(); }
+
+ protected:
+  virtual void InternalThreadEntry() { pool_->WorkerEntry(worker_); }
+
+  WorkerPool* pool_;
+  int worker_;
+};
+
+WorkerPool::WorkerPool(int size)
+    : size_(size), sync_(new sync()), func_(NULL), count_(0),
+      generation_(0), pending_(0) {
+  CHECK_GT(size, 0) << "A worker pool needs at least one worker.";
+  for (int w = 1; w < size_; ++w) {
+    workers_.push_back(shared_ptr<Worker>(new Worker(this, w)));
+    workers_.back()->StartInternalThread();
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  // Workers must not outlive sync_.
+  for (int i = 0; i < workers_.size(); ++i) {
+    workers_[i]->StopInternalThread();
+  }
+}
+
+void WorkerPool::Run(int count,
+    const boost::function<void(int, int)>& func) {
+  if (workers_.empty()) {
+    for (int i = 0; i < count; ++i) {
+      func(i, 0);
+    }
+    return;
+  }
+  // The workers use func and the data of the caller, so the caller waits
+  // for them even if its own thread gets interrupted meanwhile.
+  boost::this_thread::disable_interruption no_interruption;
+  {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    func_ = &func;
+    count_ = count;
+    pending_ = workers_.size();
+    ++generation_;
+  }
+  sync_->start_.notify_all();
+  RunIterations(0);
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  while (pending_ > 0) {
+    sync_->done_.wait(lock);
+  }
+  func_ = NULL;
+}
+
+void WorkerPool::RunIterations(int worker) {
+  for (int i = worker; i < count_; i += size_) {
+    (*func_)(i, worker);
+  }
+}
+
+void WorkerPool::WorkerEntry(int worker) {
+  int generation = 0;
+  try {
+    while (true) {
+      {
+        boost::mutex::scoped_lock lock(sync_->mutex_);
+        while (generation_ == generation) {
+          sync_->start_.wait(lock);
+        }
+        generation = generation_;
+      }
+      RunIterations(worker);
+      boost::mutex::scoped_lock lock(sync_->mutex_);
+      if (--pending_ == 0) {
+        sync_->done_.notify_one();
+      }
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,96 @@
+// This program measures how many images per second a Data layer delivers
+// for different numbers of transform threads.
+// Usage:
+//    data_throughput [FLAGS] INPUT_DB
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "boost/algorithm/string.hpp"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/caffe.hpp"
+#include "caffe/util/benchmark.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+DEFINE_string(backend, "lmdb",
+        "The backend {leveldb, lmdb} containing the images");
+DEFINE_string(threads, "1,2,4,8",
+        "Comma separated numbers of transform threads to compare");
+DEFINE_int32(batch_size, 64, "The number of images per batch");
+DEFINE_int32(iterations, 50, "The number of batches to time");
+DEFINE_int32(crop_size, 0, "Randomly crop the images to this size");
+DEFINE_bool(mirror, false, "Randomly mirror the images");
+DEFINE_string(mean_file, "", "The mean image to subtract");
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Measure the images per second of a Data layer"
+        " against the number of transform threads\n"
+        "Usage:\n"
+        "    data_throughput [FLAGS] INPUT_DB\n");
+
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc != 2) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/data_throughput");
+    return 1;
+  }
+
+  Caffe::set_mode(Caffe::CPU);
+  vector<string> thread_counts;
+  boost::split(thread_counts, FLAGS_threads, boost::is_any_of(","));
+  for (int i = 0; i < thread_counts.size(); ++i) {
+    LayerParameter param;
+    param.set_name("data");
+    param.set_type("Data");
+    param.set_phase(TRAIN);
+    DataParameter* data_param = param.mutable_data_param();
+    data_param->set_source(argv[1]);
+    data_param->set_backend(FLAGS_backend == "leveldb" ?
+        DataParameter_DB_LEVELDB : DataParameter_DB_LMDB);
+    data_param->set_batch_size(FLAGS_batch_size);
+    data_param->set_transform_threads(atoi(thread_counts[i].c_str()));
+    TransformationParameter* transform_param = param.mutable_transform_param();
+    transform_param->set_crop_size(FLAGS_crop_size);
+    transform_param->set_mirror(FLAGS_mirror);
+    if (!FLAGS_mean_file.empty()) {
+      transform_param->set_mean_file(FLAGS_mean_file);
+    }
+
+    shared_ptr<Layer<float> > layer = LayerRegistry<float>::CreateLayer(param);
+    Blob<float> data;
+    Blob<float> label;
+    vector<Blob<float>*> bottom;
+    vector<Blob<float>*> top;
+    top.push_back(&data);
+    top.push_back(&label);
+    layer->SetUp(bottom, top);
+
+    // Drain the batches prefetched during set up, so only batches loaded
+    // while the timer runs are counted.
+    for (int j = 0; j < data_param->prefetch(); ++j) {
+      layer->Forward(bottom, top);
+    }
+    CPUTimer timer;
+    timer.Start();
+    for (int j = 0; j < FLAGS_iterations; ++j) {
+      layer->Forward(bottom, top);
+    }
+    timer.Stop();
+    const double images = static_cast<double>(FLAGS_iterations) *
+        FLAGS_batch_size;
+    LOG(INFO) << "Transform threads: " << data_param->transform_threads()
+        << "\t" << images / timer.Seconds() << " images/s";
+  }
+  return 0;
+}